@@ -19,6 +19,7 @@
 #include "Command.h"
 #include "Connection.h"
 #include "Dispatcher.h"
+#include "ExportFile.h"
 #include "Options.h"
 
 #include "../bswinfra/source/IApplication.h"
@@ -69,6 +70,8 @@ public:
   auto getDispatcher() -> std::shared_ptr<Dispatcher> { return m_dispatcher; }
   auto getConnection() -> std::shared_ptr<Connection> { return m_connection; }
   auto getCommand() -> std::shared_ptr<Command> { return m_command; }
+  void setExportFile(std::shared_ptr<ExportFile> exportFile) { m_exportFile = exportFile; }
+  auto getExportFile() -> std::shared_ptr<ExportFile> { return m_exportFile; }
 
 public:
   Application(Application const &) = delete;
@@ -79,6 +82,7 @@ private:
   std::shared_ptr<Connection> m_connection = nullptr;
   std::shared_ptr<Dispatcher> m_dispatcher = nullptr;
   std::shared_ptr<Command> m_command = nullptr;
+  std::shared_ptr<ExportFile> m_exportFile = nullptr;
   std::string m_session{};
 
 private:
@@ -15,6 +15,19 @@
 namespace tkm::control
 {
 
+static void copyListArgs(const Command::Request &request, Dispatcher::Request &rq)
+{
+  for (const auto arg : {Defaults::Arg::ListAfter,
+                         Defaults::Arg::ListLimit,
+                         Defaults::Arg::ListFrom,
+                         Defaults::Arg::ListTo,
+                         Defaults::Arg::ListState}) {
+    if (request.args.count(arg)) {
+      rq.args.emplace(arg, request.args.at(arg));
+    }
+  }
+}
+
 Command::Command()
 : UserEvent("Command")
 {
@@ -48,6 +61,21 @@ Command::Command()
         if (request.args.count(Defaults::Arg::Forced)) {
           rq.args.emplace(tkm::Defaults::Arg::Forced, request.args.at(tkm::Defaults::Arg::Forced));
         }
+        copyListArgs(request, rq);
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
+      case Command::Action::GetDeviceStats: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::GetDeviceStats,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
+      case Command::Action::GetLatency: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::GetLatency,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
         ControlApp()->getDispatcher()->pushRequest(rq);
         break;
       }
@@ -132,6 +160,48 @@ Command::Command()
         ControlApp()->getDispatcher()->pushRequest(rq);
         break;
       }
+      case Command::Action::BulkDevices: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::BulkDevices,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
+
+        for (const auto arg : {Defaults::Arg::What,
+                               Defaults::Arg::DeviceHash,
+                               Defaults::Arg::BulkPattern,
+                               Defaults::Arg::BulkConcurrency}) {
+          if (request.args.count(arg)) {
+            rq.args.emplace(arg, request.args.at(arg));
+          }
+        }
+
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
+      case Command::Action::Subscribe: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::Subscribe,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
+
+        rq.args.emplace(Defaults::Arg::DeviceHash, request.args.at(Defaults::Arg::DeviceHash));
+        if (request.args.count(Defaults::Arg::What)) {
+          rq.args.emplace(Defaults::Arg::What, request.args.at(Defaults::Arg::What));
+        }
+
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
+      case Command::Action::GetLatest: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::GetLatest,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
+
+        if (request.args.count(Defaults::Arg::What)) {
+          rq.args.emplace(Defaults::Arg::What, request.args.at(Defaults::Arg::What));
+        }
+
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
       case Command::Action::GetSessions: {
         Dispatcher::Request rq{.action = Dispatcher::Action::GetSessions,
                                .bulkData = std::make_any<int>(0),
@@ -144,6 +214,50 @@ Command::Command()
         if (request.args.count(Defaults::Arg::DeviceHash)) {
           rq.args.emplace(Defaults::Arg::DeviceHash, request.args.at(Defaults::Arg::DeviceHash));
         }
+        copyListArgs(request, rq);
+
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
+      case Command::Action::ExportSession: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::ExportSession,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
+
+        rq.args.emplace(Defaults::Arg::SessionHash, request.args.at(Defaults::Arg::SessionHash));
+        rq.args.emplace(Defaults::Arg::ExportPath, request.args.at(Defaults::Arg::ExportPath));
+        if (request.args.count(Defaults::Arg::What)) {
+          rq.args.emplace(Defaults::Arg::What, request.args.at(Defaults::Arg::What));
+        }
+        copyListArgs(request, rq);
+
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
+      case Command::Action::ArchiveSession: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::ArchiveSession,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
+
+        rq.args.emplace(Defaults::Arg::SessionHash, request.args.at(Defaults::Arg::SessionHash));
+        ControlApp()->getDispatcher()->pushRequest(rq);
+        break;
+      }
+      case Command::Action::Aggregate: {
+        Dispatcher::Request rq{.action = Dispatcher::Action::Aggregate,
+                               .bulkData = std::make_any<int>(0),
+                               .args = std::map<Defaults::Arg, std::string>()};
+
+        for (const auto arg : {Defaults::Arg::SessionHash,
+                               Defaults::Arg::What,
+                               Defaults::Arg::AggregateColumns,
+                               Defaults::Arg::AggregateWidth,
+                               Defaults::Arg::AggregateMatch}) {
+          if (request.args.count(arg)) {
+            rq.args.emplace(arg, request.args.at(arg));
+          }
+        }
+        copyListArgs(request, rq);
 
         ControlApp()->getDispatcher()->pushRequest(rq);
         break;
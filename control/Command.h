@@ -33,7 +33,12 @@ public:
     InitDatabase,
     QuitCollector,
     GetDevices,
+    GetDeviceStats,
+    GetLatency,
     GetSessions,
+    ExportSession,
+    ArchiveSession,
+    Aggregate,
     RemoveSession,
     AddDevice,
     RemoveDevice,
@@ -41,6 +46,9 @@ public:
     DisconnectDevice,
     StartCollecting,
     StopCollecting,
+    BulkDevices,
+    Subscribe,
+    GetLatest,
     Quit
   };
 
@@ -18,6 +18,7 @@
 #include "Application.h"
 #include "Connection.h"
 #include "Defaults.h"
+#include "Extension.pb.h"
 #include "Helpers.h"
 
 namespace tkm::control
@@ -57,6 +58,95 @@ Connection::Connection()
             continue;
           }
 
+          // Collector extension messages
+          if (envelope.mesg().Is<tkm::msg::ext::Message>()) {
+            tkm::msg::ext::Message extMsg;
+            envelope.mesg().UnpackTo(&extMsg);
+
+            if (extMsg.type() == tkm::msg::ext::Message_Type_DeviceStats) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::DeviceStats,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::DeviceStatsList statsList;
+
+              extMsg.data().UnpackTo(&statsList);
+              rq.bulkData = std::make_any<tkm::msg::ext::DeviceStatsList>(statsList);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            } else if (extMsg.type() == tkm::msg::ext::Message_Type_Latency) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::Latency,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::LatencyReport report;
+
+              extMsg.data().UnpackTo(&report);
+              rq.bulkData = std::make_any<tkm::msg::ext::LatencyReport>(report);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            } else if (extMsg.type() == tkm::msg::ext::Message_Type_ListEnd) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::ListEnd,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::ListEnd listEnd;
+
+              extMsg.data().UnpackTo(&listEnd);
+              rq.bulkData = std::make_any<tkm::msg::ext::ListEnd>(listEnd);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            } else if (extMsg.type() == tkm::msg::ext::Message_Type_ExportData) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::ExportData,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::ExportChunk chunk;
+
+              extMsg.data().UnpackTo(&chunk);
+              rq.bulkData = std::make_any<tkm::msg::ext::ExportChunk>(chunk);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            } else if (extMsg.type() == tkm::msg::ext::Message_Type_AggregateData) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::AggregateData,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::AggregateResult result;
+
+              extMsg.data().UnpackTo(&result);
+              rq.bulkData = std::make_any<tkm::msg::ext::AggregateResult>(result);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            } else if (extMsg.type() == tkm::msg::ext::Message_Type_BulkReport) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::BulkReport,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::BulkReport report;
+
+              extMsg.data().UnpackTo(&report);
+              rq.bulkData = std::make_any<tkm::msg::ext::BulkReport>(report);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            } else if (extMsg.type() == tkm::msg::ext::Message_Type_LiveData) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::LiveData,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::LiveData liveData;
+
+              extMsg.data().UnpackTo(&liveData);
+              rq.bulkData = std::make_any<tkm::msg::ext::LiveData>(liveData);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            } else if (extMsg.type() == tkm::msg::ext::Message_Type_LatestSnapshot) {
+              Dispatcher::Request rq{.action = Dispatcher::Action::LatestSnapshot,
+                                     .bulkData = std::make_any<int>(0),
+                                     .args = std::map<Defaults::Arg, std::string>()};
+              tkm::msg::ext::LatestSnapshot snapshot;
+
+              extMsg.data().UnpackTo(&snapshot);
+              rq.bulkData = std::make_any<tkm::msg::ext::LatestSnapshot>(snapshot);
+
+              ControlApp()->getDispatcher()->pushRequest(rq);
+            }
+            continue;
+          }
+
           tkm::msg::control::Message msg;
           envelope.mesg().UnpackTo(&msg);
 
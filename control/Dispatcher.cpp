@@ -9,10 +9,13 @@
  *-
  */
 
+#include <algorithm>
+#include <sstream>
 #include <unistd.h>
 
 #include "Application.h"
 #include "Dispatcher.h"
+#include "Extension.pb.h"
 #include "Helpers.h"
 
 namespace tkm::control
@@ -24,8 +27,13 @@ static bool doRequestSession();
 static bool doSetSession(const Dispatcher::Request &rq);
 static bool doQuit();
 static bool doInitDatabase(const Dispatcher::Request &rq);
-static bool doGetDevices();
+static bool doGetDevices(const Dispatcher::Request &rq);
+static bool doGetDeviceStats();
+static bool doGetLatency();
 static bool doGetSessions(const Dispatcher::Request &rq);
+static bool doExportSession(const std::shared_ptr<Dispatcher> mgr, const Dispatcher::Request &rq);
+static bool doArchiveSession(const Dispatcher::Request &rq);
+static bool doAggregate(const Dispatcher::Request &rq);
 static bool doRemoveSession(const Dispatcher::Request &rq);
 static bool doAddDevice(const Dispatcher::Request &rq);
 static bool doRemoveDevice(const Dispatcher::Request &rq);
@@ -33,9 +41,20 @@ static bool doConnectDevice(const Dispatcher::Request &rq);
 static bool doDisconnectDevice(const Dispatcher::Request &rq);
 static bool doStartCollecting(const Dispatcher::Request &rq);
 static bool doStopCollecting(const Dispatcher::Request &rq);
+static bool doBulkDevices(const Dispatcher::Request &rq);
+static bool doSubscribe(const Dispatcher::Request &rq);
+static bool doGetLatest(const Dispatcher::Request &rq);
 static bool doQuitCollector(const std::shared_ptr<Dispatcher> mgr, const Dispatcher::Request &rq);
 static bool doCollectorStatus(const std::shared_ptr<Dispatcher> mgr, const Dispatcher::Request &rq);
 static bool doDeviceList(const Dispatcher::Request &rq);
+static bool doDeviceStats(const Dispatcher::Request &rq);
+static bool doLatency(const Dispatcher::Request &rq);
+static bool doListEnd(const Dispatcher::Request &rq);
+static bool doExportData(const Dispatcher::Request &rq);
+static bool doAggregateData(const Dispatcher::Request &rq);
+static bool doBulkReport(const Dispatcher::Request &rq);
+static bool doLiveData(const Dispatcher::Request &rq);
+static bool doLatestSnapshot(const Dispatcher::Request &rq);
 static bool doSessionList(const Dispatcher::Request &rq);
 
 void Dispatcher::enableEvents()
@@ -62,9 +81,19 @@ bool Dispatcher::requestHandler(const Request &request)
   case Dispatcher::Action::InitDatabase:
     return doInitDatabase(request);
   case Dispatcher::Action::GetDevices:
-    return doGetDevices();
+    return doGetDevices(request);
+  case Dispatcher::Action::GetDeviceStats:
+    return doGetDeviceStats();
+  case Dispatcher::Action::GetLatency:
+    return doGetLatency();
   case Dispatcher::Action::GetSessions:
     return doGetSessions(request);
+  case Dispatcher::Action::ExportSession:
+    return doExportSession(getShared(), request);
+  case Dispatcher::Action::ArchiveSession:
+    return doArchiveSession(request);
+  case Dispatcher::Action::Aggregate:
+    return doAggregate(request);
   case Dispatcher::Action::RemoveSession:
     return doRemoveSession(request);
   case Dispatcher::Action::AddDevice:
@@ -79,12 +108,34 @@ bool Dispatcher::requestHandler(const Request &request)
     return doStartCollecting(request);
   case Dispatcher::Action::StopCollecting:
     return doStopCollecting(request);
+  case Dispatcher::Action::BulkDevices:
+    return doBulkDevices(request);
+  case Dispatcher::Action::Subscribe:
+    return doSubscribe(request);
+  case Dispatcher::Action::GetLatest:
+    return doGetLatest(request);
   case Dispatcher::Action::QuitCollector:
     return doQuitCollector(getShared(), request);
   case Dispatcher::Action::CollectorStatus:
     return doCollectorStatus(getShared(), request);
   case Dispatcher::Action::DeviceList:
     return doDeviceList(request);
+  case Dispatcher::Action::DeviceStats:
+    return doDeviceStats(request);
+  case Dispatcher::Action::Latency:
+    return doLatency(request);
+  case Dispatcher::Action::ListEnd:
+    return doListEnd(request);
+  case Dispatcher::Action::ExportData:
+    return doExportData(request);
+  case Dispatcher::Action::AggregateData:
+    return doAggregateData(request);
+  case Dispatcher::Action::BulkReport:
+    return doBulkReport(request);
+  case Dispatcher::Action::LiveData:
+    return doLiveData(request);
+  case Dispatcher::Action::LatestSnapshot:
+    return doLatestSnapshot(request);
   case Dispatcher::Action::SessionList:
     return doSessionList(request);
   case Dispatcher::Action::Quit:
@@ -186,11 +237,61 @@ static bool doInitDatabase(const Dispatcher::Request &rq)
   return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
 }
 
-static bool doGetDevices()
+static bool hasListArgs(const Dispatcher::Request &rq)
+{
+  return rq.args.count(Defaults::Arg::ListAfter) || rq.args.count(Defaults::Arg::ListLimit) ||
+         rq.args.count(Defaults::Arg::ListFrom) || rq.args.count(Defaults::Arg::ListTo) ||
+         rq.args.count(Defaults::Arg::ListState);
+}
+
+static bool doListRequest(tkm::msg::ext::Request_Type type, const Dispatcher::Request &rq)
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+  tkm::msg::ext::ListFilter filter;
+
+  if (rq.args.count(Defaults::Arg::ListAfter)) {
+    filter.set_after_id(std::stoll(rq.args.at(Defaults::Arg::ListAfter)));
+  }
+  if (rq.args.count(Defaults::Arg::ListLimit)) {
+    filter.set_limit(static_cast<uint32_t>(std::stoul(rq.args.at(Defaults::Arg::ListLimit))));
+  }
+  if (rq.args.count(Defaults::Arg::ListFrom)) {
+    filter.set_started_from(std::stoull(rq.args.at(Defaults::Arg::ListFrom)));
+  }
+  if (rq.args.count(Defaults::Arg::ListTo)) {
+    filter.set_started_to(std::stoull(rq.args.at(Defaults::Arg::ListTo)));
+  }
+  if (rq.args.count(Defaults::Arg::ListState)) {
+    filter.set_state((rq.args.at(Defaults::Arg::ListState) == "progress")
+                         ? tkm::msg::ext::ListFilter_State_Progress
+                         : tkm::msg::ext::ListFilter_State_Complete);
+  }
+  if (rq.args.count(Defaults::Arg::DeviceHash)) {
+    filter.set_device_hash(rq.args.at(Defaults::Arg::DeviceHash));
+  }
+
+  requestMessage.set_id((type == tkm::msg::ext::Request_Type_ListDevices) ? "ListDevices"
+                                                                          : "ListSessions");
+  requestMessage.set_type(type);
+  requestMessage.mutable_data()->PackFrom(filter);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request " << requestMessage.id() << " after " << filter.after_id();
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
+static bool doGetDevices(const Dispatcher::Request &rq)
 {
   tkm::msg::Envelope requestEnvelope;
   tkm::msg::control::Request requestMessage;
 
+  if (hasListArgs(rq)) {
+    return doListRequest(tkm::msg::ext::Request_Type_ListDevices, rq);
+  }
+
   requestMessage.set_id("GetDevices");
   requestMessage.set_type(tkm::msg::control::Request_Type_GetDevices);
   requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
@@ -201,6 +302,36 @@ static bool doGetDevices()
   return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
 }
 
+static bool doGetDeviceStats()
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+
+  requestMessage.set_id("GetDeviceStats");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_GetDeviceStats);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request get device stats";
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
+static bool doGetLatency()
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+
+  requestMessage.set_id("GetLatency");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_GetLatency);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request get latency";
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
 static bool doAddDevice(const Dispatcher::Request &rq)
 {
   tkm::msg::Envelope requestEnvelope;
@@ -382,12 +513,113 @@ static bool doStopCollecting(const Dispatcher::Request &rq)
   return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
 }
 
+static bool doBulkDevices(const Dispatcher::Request &rq)
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+  tkm::msg::ext::BulkFilter filter;
+  tkm::msg::ext::BulkFilter_Action action;
+
+  if (tkm::msg::ext::BulkFilter_Action_Parse(rq.args.at(Defaults::Arg::What), &action)) {
+    filter.set_action(action);
+  }
+
+  if (rq.args.count(Defaults::Arg::DeviceHash)) {
+    std::stringstream hashes(rq.args.at(Defaults::Arg::DeviceHash));
+    std::string hash;
+    while (std::getline(hashes, hash, ',')) {
+      filter.add_hash(hash);
+    }
+  }
+  if (rq.args.count(Defaults::Arg::BulkPattern)) {
+    filter.set_name_pattern(rq.args.at(Defaults::Arg::BulkPattern));
+  }
+  if (rq.args.count(Defaults::Arg::BulkConcurrency)) {
+    filter.set_concurrency(
+        static_cast<uint32_t>(std::stoul(rq.args.at(Defaults::Arg::BulkConcurrency))));
+  }
+
+  requestMessage.set_id("BulkDevices");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_BulkDevices);
+  requestMessage.mutable_data()->PackFrom(filter);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request bulk " << rq.args.at(Defaults::Arg::What) << " for "
+             << filter.hash_size() << " devices";
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
+static bool doSubscribe(const Dispatcher::Request &rq)
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+  tkm::msg::ext::SubscribeFilter filter;
+
+  filter.set_device_hash(rq.args.at(Defaults::Arg::DeviceHash));
+  if (rq.args.count(Defaults::Arg::What)) {
+    std::stringstream types(rq.args.at(Defaults::Arg::What));
+    std::string name;
+
+    while (std::getline(types, name, ',')) {
+      tkm::msg::monitor::Data_What what;
+      if (tkm::msg::monitor::Data_What_Parse(name, &what)) {
+        filter.add_what(what);
+      }
+    }
+  }
+
+  requestMessage.set_id("Subscribe");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_Subscribe);
+  requestMessage.mutable_data()->PackFrom(filter);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request live data for device " << filter.device_hash();
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
+static bool doGetLatest(const Dispatcher::Request &rq)
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+  tkm::msg::ext::LatestFilter filter;
+
+  if (rq.args.count(Defaults::Arg::What)) {
+    std::stringstream types(rq.args.at(Defaults::Arg::What));
+    std::string name;
+
+    while (std::getline(types, name, ',')) {
+      tkm::msg::monitor::Data_What what;
+      if (tkm::msg::monitor::Data_What_Parse(name, &what)) {
+        filter.add_what(what);
+      }
+    }
+  }
+
+  requestMessage.set_id("GetLatest");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_GetLatest);
+  requestMessage.mutable_data()->PackFrom(filter);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request latest samples";
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
 static bool doGetSessions(const Dispatcher::Request &rq)
 {
   tkm::msg::Envelope requestEnvelope;
   tkm::msg::control::Request requestMessage;
   tkm::msg::control::DeviceData deviceData;
 
+  if (hasListArgs(rq)) {
+    return doListRequest(tkm::msg::ext::Request_Type_ListSessions, rq);
+  }
+
   requestMessage.set_id("GetSessions");
   requestMessage.set_type(tkm::msg::control::Request_Type_GetSessions);
   if (rq.args.count(Defaults::Arg::Forced)) {
@@ -409,6 +641,116 @@ static bool doGetSessions(const Dispatcher::Request &rq)
   return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
 }
 
+static bool doExportSession(const std::shared_ptr<Dispatcher> mgr, const Dispatcher::Request &rq)
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+  tkm::msg::ext::ExportFilter filter;
+
+  try {
+    ControlApp()->setExportFile(
+        std::make_shared<ExportFile>(rq.args.at(Defaults::Arg::ExportPath)));
+  } catch (std::exception &e) {
+    std::cout << e.what() << std::endl;
+    Dispatcher::Request nrq{.action = Dispatcher::Action::Quit,
+                            .bulkData = std::make_any<int>(0),
+                            .args = std::map<Defaults::Arg, std::string>()};
+    return mgr->pushRequest(nrq);
+  }
+
+  filter.set_session_hash(rq.args.at(Defaults::Arg::SessionHash));
+  if (rq.args.count(Defaults::Arg::What)) {
+    std::stringstream types(rq.args.at(Defaults::Arg::What));
+    std::string name;
+
+    while (std::getline(types, name, ',')) {
+      tkm::msg::monitor::Data_What what;
+      if (tkm::msg::monitor::Data_What_Parse(name, &what)) {
+        filter.add_what(what);
+      }
+    }
+  }
+  if (rq.args.count(Defaults::Arg::ListFrom)) {
+    filter.set_time_from(std::stoull(rq.args.at(Defaults::Arg::ListFrom)));
+  }
+  if (rq.args.count(Defaults::Arg::ListTo)) {
+    filter.set_time_to(std::stoull(rq.args.at(Defaults::Arg::ListTo)));
+  }
+
+  requestMessage.set_id("ExportSession");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_ExportSession);
+  requestMessage.mutable_data()->PackFrom(filter);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request export session " << filter.session_hash();
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
+static bool doArchiveSession(const Dispatcher::Request &rq)
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+  tkm::msg::ext::ExportFilter filter;
+
+  filter.set_session_hash(rq.args.at(Defaults::Arg::SessionHash));
+
+  requestMessage.set_id("ArchiveSession");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_ArchiveSession);
+  requestMessage.mutable_data()->PackFrom(filter);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request archive session " << filter.session_hash();
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
+static bool doAggregate(const Dispatcher::Request &rq)
+{
+  tkm::msg::Envelope requestEnvelope;
+  tkm::msg::ext::Request requestMessage;
+  tkm::msg::ext::AggregateFilter filter;
+  tkm::msg::monitor::Data_What what;
+
+  filter.set_session_hash(rq.args.at(Defaults::Arg::SessionHash));
+  if (tkm::msg::monitor::Data_What_Parse(rq.args.at(Defaults::Arg::What), &what)) {
+    filter.set_what(what);
+  }
+
+  std::stringstream columns(rq.args.at(Defaults::Arg::AggregateColumns));
+  std::string column;
+  while (std::getline(columns, column, ',')) {
+    filter.add_column(column);
+  }
+
+  filter.set_bucket_width(std::stoull(rq.args.at(Defaults::Arg::AggregateWidth)));
+  if (rq.args.count(Defaults::Arg::ListFrom)) {
+    filter.set_time_from(std::stoull(rq.args.at(Defaults::Arg::ListFrom)));
+  }
+  if (rq.args.count(Defaults::Arg::ListTo)) {
+    filter.set_time_to(std::stoull(rq.args.at(Defaults::Arg::ListTo)));
+  }
+  if (rq.args.count(Defaults::Arg::AggregateMatch)) {
+    const auto &match = rq.args.at(Defaults::Arg::AggregateMatch);
+    const auto pos = match.find('=');
+
+    filter.set_match_column(match.substr(0, pos));
+    filter.set_match_value((pos != std::string::npos) ? match.substr(pos + 1) : "");
+  }
+
+  requestMessage.set_id("Aggregate");
+  requestMessage.set_type(tkm::msg::ext::Request_Type_Aggregate);
+  requestMessage.mutable_data()->PackFrom(filter);
+  requestEnvelope.mutable_mesg()->PackFrom(requestMessage);
+  requestEnvelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  requestEnvelope.set_origin(tkm::msg::Envelope_Recipient_Control);
+
+  logDebug() << "Request aggregate for session " << filter.session_hash();
+  return ControlApp()->getConnection()->writeEnvelope(requestEnvelope);
+}
+
 static bool doQuitCollector(const std::shared_ptr<Dispatcher> mgr, const Dispatcher::Request &rq)
 {
   tkm::msg::Envelope requestEnvelope;
@@ -453,6 +795,20 @@ static bool doCollectorStatus(const std::shared_ptr<Dispatcher> mgr, const Dispa
     return true;
   }
 
+  // Live data is printed until the user stops the subscription
+  if ((requestStatus.request_id() == "Subscribe") &&
+      (requestStatus.what() == tkm::msg::control::Status_What_OK)) {
+    std::cout << "Subscribed, press Ctrl-C to stop" << std::endl;
+    return true;
+  }
+
+  auto exportFile = ControlApp()->getExportFile();
+  if (exportFile != nullptr) {
+    exportFile->close();
+    std::cout << "Wrote " << exportFile->getRowCount() << " rows to " << exportFile->getPath()
+              << std::endl;
+  }
+
   std::cout << "--------------------------------------------------" << std::endl;
   std::cout << "Status: " << statusText << " Reason: " << requestStatus.reason() << std::endl;
   std::cout << "--------------------------------------------------" << std::endl;
@@ -508,6 +864,208 @@ static bool doDeviceList(const Dispatcher::Request &rq)
   return true;
 }
 
+static bool doDeviceStats(const Dispatcher::Request &rq)
+{
+  std::cout << "--------------------------------------------------" << std::endl;
+
+  const auto &statsList = std::any_cast<tkm::msg::ext::DeviceStatsList>(rq.bulkData);
+  for (int i = 0; i < statsList.device_size(); i++) {
+    const tkm::msg::ext::DeviceStats &stats = statsList.device(i);
+    const auto perRow = [&stats](uint64_t value) -> double {
+      return (stats.db_rows() > 0)
+                 ? static_cast<double>(value) / static_cast<double>(stats.db_rows())
+                 : 0;
+    };
+
+    std::cout << "Id\t: " << stats.hash() << std::endl;
+    std::cout << "Name\t: " << stats.name() << std::endl;
+    std::cout << "Bytes\t: " << stats.bytes_read() << std::endl;
+    std::cout << "Msgs\t: " << stats.envelopes_read() << std::endl;
+    std::cout << "Decode\t: " << stats.decode_time_usec() << " usec" << std::endl;
+    std::cout << "Queue\t: " << stats.queue_time_usec() << " usec" << std::endl;
+    std::cout << "Rows\t: " << stats.db_rows() << std::endl;
+    std::cout << "DBTime\t: " << stats.db_time_usec() << " usec" << std::endl;
+    std::cout << "PerRow\t: " << perRow(stats.bytes_read()) << " bytes, "
+              << perRow(stats.decode_time_usec() + stats.queue_time_usec() + stats.db_time_usec())
+              << " usec" << std::endl;
+    if (i < statsList.device_size() - 1) {
+      std::cout << std::endl;
+    }
+  }
+
+  return true;
+}
+
+static auto latencyPercentile(const tkm::msg::ext::LatencyHistogram &histogram, double percent)
+    -> uint64_t
+{
+  const auto target = static_cast<uint64_t>(static_cast<double>(histogram.count()) * percent);
+  uint64_t cumulative = 0;
+
+  // Report the upper bound of the bucket holding the percentile
+  for (int i = 0; i < histogram.bucket_size(); i++) {
+    cumulative += histogram.bucket(i);
+    if ((cumulative > 0) && (cumulative >= target)) {
+      return std::min(static_cast<uint64_t>(1) << i, histogram.max_usec());
+    }
+  }
+
+  return histogram.max_usec();
+}
+
+static void printLatency(const std::string &name, const tkm::msg::ext::LatencyHistogram &histogram)
+{
+  const auto avg = (histogram.count() > 0) ? histogram.sum_usec() / histogram.count() : 0;
+
+  std::cout << name << "\t: count=" << histogram.count() << " avg=" << avg
+            << " p50<=" << latencyPercentile(histogram, 0.50)
+            << " p90<=" << latencyPercentile(histogram, 0.90)
+            << " p99<=" << latencyPercentile(histogram, 0.99) << " max=" << histogram.max_usec()
+            << " usec" << std::endl;
+}
+
+static bool doLatency(const Dispatcher::Request &rq)
+{
+  std::cout << "--------------------------------------------------" << std::endl;
+
+  const auto &report = std::any_cast<tkm::msg::ext::LatencyReport>(rq.bulkData);
+  for (int i = 0; i < report.table_size(); i++) {
+    const tkm::msg::ext::TableLatency &table = report.table(i);
+
+    std::cout << "Table\t: " << table.table() << std::endl;
+    printLatency("Commit", table.commit());
+    printLatency("Queue", table.dwell());
+    if (i < report.table_size() - 1) {
+      std::cout << std::endl;
+    }
+  }
+
+  return true;
+}
+
+static bool doListEnd(const Dispatcher::Request &rq)
+{
+  const auto &listEnd = std::any_cast<tkm::msg::ext::ListEnd>(rq.bulkData);
+
+  std::cout << "--------------------------------------------------" << std::endl;
+  std::cout << "Entries\t: " << listEnd.count() << std::endl;
+  if (listEnd.more()) {
+    std::cout << "Next\t: --after " << listEnd.last_id() << std::endl;
+  }
+
+  return true;
+}
+
+static bool doExportData(const Dispatcher::Request &rq)
+{
+  const auto &chunk = std::any_cast<tkm::msg::ext::ExportChunk>(rq.bulkData);
+  auto exportFile = ControlApp()->getExportFile();
+
+  if (exportFile == nullptr) {
+    logWarn() << "Export data received without export file";
+    return true;
+  }
+
+  if (!exportFile->write(chunk)) {
+    logError() << "Fail to write export file " << exportFile->getPath();
+  }
+
+  return true;
+}
+
+static bool doAggregateData(const Dispatcher::Request &rq)
+{
+  const auto &result = std::any_cast<tkm::msg::ext::AggregateResult>(rq.bulkData);
+  // Results arrive in chunks, the header is printed once
+  static bool printHeader = true;
+
+  if (printHeader) {
+    std::cout << "Table\t: " << result.table() << std::endl;
+    std::cout << "Bucket\t: " << result.bucket_width() << "s" << std::endl;
+    std::cout << "--------------------------------------------------" << std::endl;
+    std::cout << "Start\tCount";
+    for (const auto &series : result.series()) {
+      std::cout << "\t" << series.column() << ".min\t" << series.column() << ".max\t"
+                << series.column() << ".avg\t" << series.column() << ".last";
+    }
+    std::cout << std::endl;
+    printHeader = false;
+  }
+
+  for (int i = 0; i < result.bucket_start_size(); i++) {
+    std::cout << result.bucket_start(i) << "\t" << result.count(i);
+    for (const auto &series : result.series()) {
+      if (i < series.min_size()) {
+        std::cout << "\t" << series.min(i) << "\t" << series.max(i) << "\t" << series.avg(i)
+                  << "\t" << series.last(i);
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  return true;
+}
+
+static bool doBulkReport(const Dispatcher::Request &rq)
+{
+  const auto &report = std::any_cast<tkm::msg::ext::BulkReport>(rq.bulkData);
+
+  std::cout << "--------------------------------------------------" << std::endl;
+  std::cout << "Id\tName\tStatus\tTime\tReason" << std::endl;
+  for (const auto &result : report.result()) {
+    std::cout << result.hash() << "\t" << result.name() << "\t"
+              << (result.success() ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                   : tkmDefaults.valFor(Defaults::Val::StatusError))
+              << "\t" << result.duration_usec() / 1000 << "ms\t" << result.reason() << std::endl;
+  }
+  std::cout << "--------------------------------------------------" << std::endl;
+  std::cout << "Action\t: " << tkm::msg::ext::BulkFilter_Action_Name(report.action()) << std::endl;
+  std::cout << "Okay\t: " << report.succeeded() << std::endl;
+  std::cout << "Failed\t: " << report.failed() << std::endl;
+  std::cout << "Time\t: " << report.duration_usec() / 1000 << "ms" << std::endl;
+
+  return true;
+}
+
+static bool doLiveData(const Dispatcher::Request &rq)
+{
+  const auto &liveData = std::any_cast<tkm::msg::ext::LiveData>(rq.bulkData);
+  tkm::msg::monitor::Data data;
+
+  liveData.data().UnpackTo(&data);
+  std::cout << data.system_time_sec() << "\t" << tkm::msg::monitor::Data_What_Name(data.what())
+            << "\t" << data.payload().ShortDebugString() << std::endl;
+
+  return true;
+}
+
+static bool doLatestSnapshot(const Dispatcher::Request &rq)
+{
+  std::cout << "--------------------------------------------------" << std::endl;
+
+  const auto &snapshot = std::any_cast<tkm::msg::ext::LatestSnapshot>(rq.bulkData);
+  for (int i = 0; i < snapshot.device_size(); i++) {
+    const auto &device = snapshot.device(i);
+
+    std::cout << "Id\t: " << device.hash() << std::endl;
+    std::cout << "Name\t: " << device.name() << std::endl;
+    std::cout << "Session\t: " << device.session_hash() << std::endl;
+    for (const auto &entry : device.data()) {
+      tkm::msg::monitor::Data data;
+
+      entry.UnpackTo(&data);
+      std::cout << tkm::msg::monitor::Data_What_Name(data.what()) << "\t: "
+                << data.system_time_sec() << " " << data.payload().ShortDebugString()
+                << std::endl;
+    }
+    if (i < snapshot.device_size() - 1) {
+      std::cout << std::endl;
+    }
+  }
+
+  return true;
+}
+
 static bool doSessionList(const Dispatcher::Request &rq)
 {
   std::cout << "--------------------------------------------------" << std::endl;
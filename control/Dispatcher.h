@@ -36,7 +36,12 @@ public:
     InitDatabase,
     QuitCollector,
     GetDevices,
+    GetDeviceStats,
+    GetLatency,
     GetSessions,
+    ExportSession,
+    ArchiveSession,
+    Aggregate,
     RemoveSession,
     AddDevice,
     RemoveDevice,
@@ -44,8 +49,19 @@ public:
     DisconnectDevice,
     StartCollecting,
     StopCollecting,
+    BulkDevices,
+    Subscribe,
+    GetLatest,
     CollectorStatus,
     DeviceList,
+    DeviceStats,
+    Latency,
+    ListEnd,
+    ExportData,
+    AggregateData,
+    BulkReport,
+    LiveData,
+    LatestSnapshot,
     SessionList,
     Quit
   };
@@ -0,0 +1,92 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ExportFile Class
+ * @details   Write exported session data as CSV
+ *-
+ */
+
+#include "ExportFile.h"
+
+#include <stdexcept>
+
+namespace tkm::control
+{
+
+ExportFile::ExportFile(const std::string &path)
+: m_path(path)
+{
+  m_stream.open(path, std::ios::out | std::ios::trunc);
+  if (!m_stream.is_open()) {
+    throw std::runtime_error("Fail to open export file " + path);
+  }
+}
+
+ExportFile::~ExportFile()
+{
+  close();
+}
+
+void ExportFile::close()
+{
+  if (m_stream.is_open()) {
+    m_stream.flush();
+    m_stream.close();
+  }
+}
+
+void ExportFile::writeValue(const std::string &value)
+{
+  if (value.find_first_of(",\"\n") == std::string::npos) {
+    m_stream << value;
+    return;
+  }
+
+  m_stream << '"';
+  for (const auto c : value) {
+    if (c == '"') {
+      m_stream << '"';
+    }
+    m_stream << c;
+  }
+  m_stream << '"';
+}
+
+bool ExportFile::write(const tkm::msg::ext::ExportChunk &chunk)
+{
+  if (chunk.table() != m_table) {
+    if (!m_table.empty()) {
+      m_stream << '\n';
+    }
+    m_table = chunk.table();
+
+    m_stream << "# " << m_table << '\n';
+    for (int i = 0; i < chunk.column_size(); i++) {
+      if (i > 0) {
+        m_stream << ',';
+      }
+      writeValue(chunk.column(i));
+    }
+    m_stream << '\n';
+  }
+
+  for (int i = 0; i < chunk.row_size(); i++) {
+    const auto &row = chunk.row(i);
+
+    for (int j = 0; j < row.value_size(); j++) {
+      if (j > 0) {
+        m_stream << ',';
+      }
+      writeValue(row.value(j));
+    }
+    m_stream << '\n';
+  }
+  m_rows += static_cast<uint64_t>(chunk.row_size());
+
+  return m_stream.good();
+}
+
+} // namespace tkm::control
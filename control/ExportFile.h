@@ -0,0 +1,50 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ExportFile Class
+ * @details   Write exported session data as CSV
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "Extension.pb.h"
+
+namespace tkm::control
+{
+
+// One CSV section per table: a '# <table>' line, the column names and rows
+class ExportFile
+{
+public:
+  explicit ExportFile(const std::string &path);
+  ~ExportFile();
+
+  bool write(const tkm::msg::ext::ExportChunk &chunk);
+  void close();
+
+  [[nodiscard]] auto getPath() const -> const std::string & { return m_path; }
+  [[nodiscard]] auto getRowCount() const -> uint64_t { return m_rows; }
+
+public:
+  ExportFile(ExportFile const &) = delete;
+  void operator=(ExportFile const &) = delete;
+
+private:
+  void writeValue(const std::string &value);
+
+private:
+  std::ofstream m_stream;
+  std::string m_path{};
+  std::string m_table{};
+  uint64_t m_rows = 0;
+};
+
+} // namespace tkm::control
@@ -15,8 +15,10 @@
 #include <csignal>
 #include <cstdlib>
 #include <filesystem>
+#include <cctype>
 #include <getopt.h>
 #include <iostream>
+#include <sstream>
 
 #include <pwd.h>
 #include <taskmonitor/Helpers.h>
@@ -28,6 +30,35 @@ static void terminate(int signum)
   exit(EXIT_SUCCESS);
 }
 
+static bool isNumber(const char *value)
+{
+  if ((value == nullptr) || (*value == '\0')) {
+    return false;
+  }
+  for (; *value != '\0'; value++) {
+    if (!isdigit(static_cast<unsigned char>(*value))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool isDataTypeList(const char *value)
+{
+  std::stringstream types(value);
+  std::string name;
+  bool found = false;
+
+  while (std::getline(types, name, ',')) {
+    tkm::msg::monitor::Data_What what;
+    if (!tkm::msg::monitor::Data_What_Parse(name, &what)) {
+      return false;
+    }
+    found = true;
+  }
+  return found;
+}
+
 auto main(int argc, char **argv) -> int
 {
   const char *config_path = nullptr;
@@ -35,20 +66,41 @@ auto main(int argc, char **argv) -> int
   const char *device_name = nullptr;
   const char *device_address = nullptr;
   const char *device_port = nullptr;
+  const char *list_after = nullptr;
+  const char *list_limit = nullptr;
+  const char *list_from = nullptr;
+  const char *list_to = nullptr;
+  const char *list_state = nullptr;
+  const char *output_path = nullptr;
+  const char *export_types = nullptr;
+  const char *aggregate_columns = nullptr;
+  const char *aggregate_width = nullptr;
+  const char *aggregate_match = nullptr;
+  const char *bulk_devices = nullptr;
+  const char *bulk_pattern = nullptr;
+  const char *bulk_concurrency = nullptr;
 
   bool help = false;
   bool force = false;
   bool init_database = false;
   bool quit = false;
   bool list_devices = false;
+  bool verbose = false;
+  bool latency = false;
   bool list_sessions = false;
   bool add_device = false;
   bool remove_device = false;
   bool connect_device = false;
   bool disconnect_device = false;
   bool remove_session = false;
+  bool export_session = false;
+  bool archive_session = false;
+  bool aggregate = false;
   bool start_collecting = false;
   bool stop_collecting = false;
+  bool bulk_all = false;
+  bool subscribe = false;
+  bool latest = false;
   int long_index = 0;
   int c;
 
@@ -57,10 +109,17 @@ auto main(int argc, char **argv) -> int
                               {"initDatabase", no_argument, nullptr, 'i'},
                               {"quit", no_argument, nullptr, 'q'},
                               {"listDevices", no_argument, nullptr, 'l'},
+                              {"verbose", no_argument, nullptr, 'v'},
+                              {"latency", no_argument, nullptr, 't'},
                               {"listSessions", no_argument, nullptr, 'j'},
                               {"addDevice", no_argument, nullptr, 'a'},
                               {"remDevice", no_argument, nullptr, 'r'},
                               {"remSession", no_argument, nullptr, 'g'},
+                              {"exportSession", no_argument, nullptr, 'e'},
+                              {"archiveSession", no_argument, nullptr, 'Z'},
+                              {"aggregate", no_argument, nullptr, 'G'},
+                              {"subscribe", no_argument, nullptr, 'w'},
+                              {"latest", no_argument, nullptr, 'k'},
                               {"config", required_argument, nullptr, 'o'},
                               {"Id", required_argument, nullptr, 'I'},
                               {"Name", required_argument, nullptr, 'N'},
@@ -70,9 +129,27 @@ auto main(int argc, char **argv) -> int
                               {"disconnect", required_argument, nullptr, 'd'},
                               {"startCollecting", required_argument, nullptr, 's'},
                               {"stopCollecting", required_argument, nullptr, 'x'},
+                              {"after", required_argument, nullptr, 'K'},
+                              {"limit", required_argument, nullptr, 'L'},
+                              {"from", required_argument, nullptr, 'B'},
+                              {"to", required_argument, nullptr, 'U'},
+                              {"state", required_argument, nullptr, 'S'},
+                              {"output", required_argument, nullptr, 'O'},
+                              {"type", required_argument, nullptr, 'T'},
+                              {"columns", required_argument, nullptr, 'C'},
+                              {"bucket", required_argument, nullptr, 'W'},
+                              {"match", required_argument, nullptr, 'M'},
+                              {"all", no_argument, nullptr, 'y'},
+                              {"devices", required_argument, nullptr, 'D'},
+                              {"pattern", required_argument, nullptr, 'p'},
+                              {"concurrency", required_argument, nullptr, 'n'},
                               {nullptr, 0, nullptr, 0}};
 
-  while ((c = getopt_long(argc, argv, "hfiqljarcdsxgo:I:N:A:P:", longopts, &long_index)) != -1) {
+  while ((c = getopt_long(argc,
+                          argv,
+                          "hfiqlvtjarcdsxgeZGywko:I:N:A:P:K:L:B:U:S:O:T:C:W:M:D:p:n:",
+                          longopts,
+                          &long_index)) != -1) {
     switch (c) {
     case 'o':
       config_path = optarg;
@@ -89,6 +166,12 @@ auto main(int argc, char **argv) -> int
     case 'l':
       list_devices = true;
       break;
+    case 'v':
+      verbose = true;
+      break;
+    case 't':
+      latency = true;
+      break;
     case 'j':
       list_sessions = true;
       break;
@@ -125,6 +208,63 @@ auto main(int argc, char **argv) -> int
     case 'P':
       device_port = optarg;
       break;
+    case 'K':
+      list_after = optarg;
+      break;
+    case 'L':
+      list_limit = optarg;
+      break;
+    case 'B':
+      list_from = optarg;
+      break;
+    case 'U':
+      list_to = optarg;
+      break;
+    case 'S':
+      list_state = optarg;
+      break;
+    case 'e':
+      export_session = true;
+      break;
+    case 'Z':
+      archive_session = true;
+      break;
+    case 'G':
+      aggregate = true;
+      break;
+    case 'C':
+      aggregate_columns = optarg;
+      break;
+    case 'W':
+      aggregate_width = optarg;
+      break;
+    case 'M':
+      aggregate_match = optarg;
+      break;
+    case 'y':
+      bulk_all = true;
+      break;
+    case 'w':
+      subscribe = true;
+      break;
+    case 'k':
+      latest = true;
+      break;
+    case 'D':
+      bulk_devices = optarg;
+      break;
+    case 'p':
+      bulk_pattern = optarg;
+      break;
+    case 'n':
+      bulk_concurrency = optarg;
+      break;
+    case 'O':
+      output_path = optarg;
+      break;
+    case 'T':
+      export_types = optarg;
+      break;
     case 'h':
     default:
       help = true;
@@ -135,7 +275,8 @@ auto main(int argc, char **argv) -> int
   // Check for valid options
   if (!add_device && !remove_device && !connect_device && !disconnect_device && !start_collecting &&
       !stop_collecting && !init_database && !quit && !list_devices && !list_sessions &&
-      !remove_session && !help) {
+      !remove_session && !latency && !export_session && !archive_session && !aggregate &&
+      !subscribe && !latest && !help) {
     std::cout << "Please select one top level option" << std::endl;
     exit(EXIT_FAILURE);
   }
@@ -207,6 +348,134 @@ auto main(int argc, char **argv) -> int
     exit(EXIT_FAILURE);
   }
 
+  if (latency && (add_device || remove_device || connect_device || disconnect_device ||
+                  start_collecting || stop_collecting || init_database || quit || list_devices ||
+                  list_sessions || remove_session)) {
+    std::cout << "Latency option cannot be used with other top level options" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (export_session && (add_device || remove_device || connect_device || disconnect_device ||
+                         start_collecting || stop_collecting || init_database || quit ||
+                         list_devices || list_sessions || remove_session || latency ||
+                         archive_session || aggregate)) {
+    std::cout << "Export session option cannot be used with other top level options" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (archive_session && (add_device || remove_device || connect_device || disconnect_device ||
+                          start_collecting || stop_collecting || init_database || quit ||
+                          list_devices || list_sessions || remove_session || latency ||
+                          aggregate)) {
+    std::cout << "Archive session option cannot be used with other top level options" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (aggregate && (add_device || remove_device || connect_device || disconnect_device ||
+                    start_collecting || stop_collecting || init_database || quit || list_devices ||
+                    list_sessions || remove_session || latency)) {
+    std::cout << "Aggregate option cannot be used with other top level options" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (subscribe && (add_device || remove_device || connect_device || disconnect_device ||
+                    start_collecting || stop_collecting || init_database || quit || list_devices ||
+                    list_sessions || remove_session || latency || export_session ||
+                    archive_session || aggregate)) {
+    std::cout << "Subscribe option cannot be used with other top level options" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (latest && (add_device || remove_device || connect_device || disconnect_device ||
+                 start_collecting || stop_collecting || init_database || quit || list_devices ||
+                 list_sessions || remove_session || latency || export_session || archive_session ||
+                 aggregate || subscribe)) {
+    std::cout << "Latest option cannot be used with other top level options" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (verbose && !list_devices) {
+    std::cout << "Verbose option can only be used with list devices" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if ((list_after || list_limit) && !list_devices && !list_sessions) {
+    std::cout << "After and limit options can only be used with list devices or sessions"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if ((list_after || list_limit) && verbose) {
+    std::cout << "After and limit options cannot be used with verbose option" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if ((list_from || list_to) && !list_sessions && !export_session && !aggregate) {
+    std::cout << "From and to options can only be used with list, export or aggregate"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (list_state && !list_sessions) {
+    std::cout << "State option can only be used with list sessions" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (output_path && !export_session) {
+    std::cout << "Output option can only be used with export session" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (export_types && !export_session && !aggregate && !subscribe && !latest) {
+    std::cout << "Type option can only be used with export session, aggregate, subscribe or latest"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if ((aggregate_columns || aggregate_width || aggregate_match) && !aggregate) {
+    std::cout << "Columns, bucket and match options can only be used with aggregate"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (aggregate_width && (!isNumber(aggregate_width) || (std::stoull(aggregate_width) == 0))) {
+    std::cout << "Bucket option requires a positive number of seconds" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (aggregate_match && (std::string(aggregate_match).find('=') == std::string::npos)) {
+    std::cout << "Match option requires a column=value filter" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (export_types && !isDataTypeList(export_types)) {
+    std::cout << "Type option accepts a comma separated list of data types" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if ((list_after && !isNumber(list_after)) || (list_limit && !isNumber(list_limit)) ||
+      (list_from && !isNumber(list_from)) || (list_to && !isNumber(list_to))) {
+    std::cout << "After, limit, from and to options require a positive number" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const bool bulk = bulk_all || (bulk_devices != nullptr) || (bulk_pattern != nullptr);
+  if (bulk && !connect_device && !disconnect_device && !start_collecting && !stop_collecting) {
+    std::cout << "All, devices and pattern options can only be used with connect, disconnect,"
+              << " start or stop collecting" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if ((static_cast<int>(bulk_all) + static_cast<int>(bulk_devices != nullptr) +
+       static_cast<int>(bulk_pattern != nullptr)) > 1) {
+    std::cout << "Please select devices with only one of all, devices or pattern options"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (bulk && unique_id) {
+    std::cout << "Id option cannot be used with all, devices or pattern options" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (bulk_concurrency && !bulk) {
+    std::cout << "Concurrency option can only be used with all, devices or pattern options"
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (bulk_concurrency && (!isNumber(bulk_concurrency) || (std::stoul(bulk_concurrency) == 0))) {
+    std::cout << "Concurrency option requires a positive number" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (list_state && (std::string(list_state) != "progress") &&
+      (std::string(list_state) != "complete")) {
+    std::cout << "State option accepts 'progress' or 'complete'" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
   if (quit) {
     if (!force) {
       std::cout << "Quit collector can only be used with force option" << std::endl;
@@ -221,7 +490,8 @@ auto main(int argc, char **argv) -> int
     }
   }
 
-  if (remove_device || connect_device || disconnect_device || start_collecting || stop_collecting) {
+  if (remove_device ||
+      ((connect_device || disconnect_device || start_collecting || stop_collecting) && !bulk)) {
     if (!unique_id) {
       std::cout << "Please provide the device hash id" << std::endl;
       exit(EXIT_FAILURE);
@@ -233,6 +503,29 @@ auto main(int argc, char **argv) -> int
     exit(EXIT_FAILURE);
   }
 
+  if (export_session && (!unique_id || !output_path)) {
+    std::cout << "Please provide the session hash id and the output file" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (archive_session && !unique_id) {
+    std::cout << "Please provide the session hash id" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (aggregate && (!unique_id || !export_types || !aggregate_columns || !aggregate_width)) {
+    std::cout << "Please provide the session hash id, type, columns and bucket width" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (subscribe && !unique_id) {
+    std::cout << "Please provide the device hash id" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  if (aggregate && (std::string(export_types).find(',') != std::string::npos)) {
+    std::cout << "Aggregate option accepts a single data type" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
   if (help) {
     std::cout << "TaskMonitorCollector-Control: TaskMonitor collector control utility\n"
               << "Version: " << tkm::tkmDefaults.getFor(tkm::Defaults::Default::Version)
@@ -242,13 +535,26 @@ auto main(int argc, char **argv) -> int
     std::cout << "     --config, -o              <string>  Configuration file path\n";
     std::cout << "     --force, -f               <noarg>   Force actions\n";
     std::cout << "     --quit, -q                <noarg>   Ask tkm-collector to terminate\n";
+    std::cout << "     --latency, -t             <noarg>   Get sample latency histograms\n";
     std::cout << "  Database:\n";
     std::cout << "     --initDatabase, -i        <noarg>   Initialize database\n";
     std::cout << "  Devices:\n";
     std::cout << "     --listDevices, -l         <noarg>   Get list of devices from database\n";
+    std::cout << "        Optional:\n";
+    std::cout << "         --verbose, -v         <noarg>   Show per device collector cost\n";
+    std::cout << "         --after, -K           <int>     List entries after this cursor\n";
+    std::cout << "         --limit, -L           <int>     Maximum number of entries\n";
+    std::cout << "     --latest, -k              <noarg>   Get last sample of every device\n";
+    std::cout << "        Optional:\n";
+    std::cout << "         --type, -T            <string>  Data types, e.g. ProcInfo,SysProcStat\n";
     std::cout << "     --listSessions, -j        <noarg>   Get list of sessions for device\n";
     std::cout << "        Optional:\n";
     std::cout << "         --Id, -I              <string>  Device ID\n";
+    std::cout << "         --after, -K           <int>     List entries after this cursor\n";
+    std::cout << "         --limit, -L           <int>     Maximum number of entries\n";
+    std::cout << "         --from, -B            <int>     Sessions started at or after\n";
+    std::cout << "         --to, -U              <int>     Sessions started at or before\n";
+    std::cout << "         --state, -S           <string>  Session state: progress|complete\n";
     std::cout << "     --addDevice,  -a          <noarg>   Add a new device to the database\n";
     std::cout << "        Require:\n";
     std::cout << "         --Name, -N            <string>  Device name\n";
@@ -260,6 +566,32 @@ auto main(int argc, char **argv) -> int
     std::cout << "     --remSession, -g          <noarg>   Remove session from database\n";
     std::cout << "        Require:\n";
     std::cout << "         --Id, -I              <string>  Session ID\n";
+    std::cout << "     --exportSession, -e       <noarg>   Export session data as CSV\n";
+    std::cout << "        Require:\n";
+    std::cout << "         --Id, -I              <string>  Session ID\n";
+    std::cout << "         --output, -O          <string>  Output file path\n";
+    std::cout << "        Optional:\n";
+    std::cout << "         --type, -T            <string>  Data types, e.g. ProcInfo,SysProcStat\n";
+    std::cout << "         --from, -B            <int>     Samples at or after system time\n";
+    std::cout << "         --to, -U              <int>     Samples at or before system time\n";
+    std::cout << "     --archiveSession, -Z      <noarg>   Write session columnar archive\n";
+    std::cout << "        Require:\n";
+    std::cout << "         --Id, -I              <string>  Session ID\n";
+    std::cout << "     --aggregate, -G           <noarg>   Min/max/avg/last per time bucket\n";
+    std::cout << "        Require:\n";
+    std::cout << "         --Id, -I              <string>  Session ID\n";
+    std::cout << "         --type, -T            <string>  Data type, e.g. SysProcMemInfo\n";
+    std::cout << "         --columns, -C         <string>  Columns, e.g. MemFree,MemAvail\n";
+    std::cout << "         --bucket, -W          <int>     Bucket width in seconds\n";
+    std::cout << "        Optional:\n";
+    std::cout << "         --from, -B            <int>     Samples at or after system time\n";
+    std::cout << "         --to, -U              <int>     Samples at or before system time\n";
+    std::cout << "         --match, -M           <string>  Row filter, e.g. CPUStatName=cpu\n";
+    std::cout << "     --subscribe, -w           <noarg>   Print live samples from device\n";
+    std::cout << "        Require:\n";
+    std::cout << "         --Id, -I              <string>  Device ID\n";
+    std::cout << "        Optional:\n";
+    std::cout << "         --type, -T            <string>  Data types, e.g. ProcInfo,SysProcStat\n";
     std::cout << "     --connect, -c             <noarg>   Connect device to taskmonitor\n";
     std::cout << "       Require:\n";
     std::cout << "         --Id, -I              <string>  Device ID\n";
@@ -272,6 +604,14 @@ auto main(int argc, char **argv) -> int
     std::cout << "     --stopCollecting, -x      <noarg>   Stop collecting data from device\n";
     std::cout << "       Require:\n";
     std::cout << "         --Id, -I              <string>  Device ID\n";
+    std::cout << "  Device groups:\n";
+    std::cout << "     Use one of these instead of --Id with connect, disconnect,\n";
+    std::cout << "     startCollecting or stopCollecting to get one report for all devices\n";
+    std::cout << "         --all, -y             <noarg>   All devices\n";
+    std::cout << "         --devices, -D         <string>  Device IDs, e.g. id1,id2\n";
+    std::cout << "         --pattern, -p         <string>  Device name pattern, e.g. 'edge-*'\n";
+    std::cout << "        Optional:\n";
+    std::cout << "         --concurrency, -n     <int>     Devices handled at the same time\n";
     std::cout << "  Help:\n";
     std::cout << "     --help, -h                          Print this help\n\n";
 
@@ -306,9 +646,23 @@ auto main(int argc, char **argv) -> int
       }
       app.getCommand()->addRequest(rq);
     }
+    if (latency) {
+      tkm::control::Command::Request rq{.action = tkm::control::Command::Action::GetLatency,
+                                        .args = std::map<tkm::Defaults::Arg, std::string>()};
+      app.getCommand()->addRequest(rq);
+    }
     if (list_devices) {
       tkm::control::Command::Request rq{.action = tkm::control::Command::Action::GetDevices,
                                         .args = std::map<tkm::Defaults::Arg, std::string>()};
+      if (verbose) {
+        rq.action = tkm::control::Command::Action::GetDeviceStats;
+      }
+      if (list_after != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListAfter, list_after);
+      }
+      if (list_limit != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListLimit, list_limit);
+      }
       app.getCommand()->addRequest(rq);
     }
     if (add_device) {
@@ -330,6 +684,21 @@ auto main(int argc, char **argv) -> int
       if (unique_id != nullptr) {
         rq.args.emplace(tkm::Defaults::Arg::DeviceHash, unique_id);
       }
+      if (list_after != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListAfter, list_after);
+      }
+      if (list_limit != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListLimit, list_limit);
+      }
+      if (list_from != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListFrom, list_from);
+      }
+      if (list_to != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListTo, list_to);
+      }
+      if (list_state != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListState, list_state);
+      }
       if (force) {
         rq.args.emplace(tkm::Defaults::Arg::Forced,
                         tkm::tkmDefaults.valFor(tkm::Defaults::Val::True));
@@ -359,7 +728,93 @@ auto main(int argc, char **argv) -> int
       app.getCommand()->addRequest(rq);
     }
 
-    if (connect_device) {
+    if (export_session) {
+      tkm::control::Command::Request rq{.action = tkm::control::Command::Action::ExportSession,
+                                        .args = std::map<tkm::Defaults::Arg, std::string>()};
+      rq.args.emplace(tkm::Defaults::Arg::SessionHash, unique_id);
+      rq.args.emplace(tkm::Defaults::Arg::ExportPath, output_path);
+      if (export_types != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::What, export_types);
+      }
+      if (list_from != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListFrom, list_from);
+      }
+      if (list_to != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListTo, list_to);
+      }
+      app.getCommand()->addRequest(rq);
+    }
+
+    if (archive_session) {
+      tkm::control::Command::Request rq{.action = tkm::control::Command::Action::ArchiveSession,
+                                        .args = std::map<tkm::Defaults::Arg, std::string>()};
+      rq.args.emplace(tkm::Defaults::Arg::SessionHash, unique_id);
+      app.getCommand()->addRequest(rq);
+    }
+
+    if (aggregate) {
+      tkm::control::Command::Request rq{.action = tkm::control::Command::Action::Aggregate,
+                                        .args = std::map<tkm::Defaults::Arg, std::string>()};
+      rq.args.emplace(tkm::Defaults::Arg::SessionHash, unique_id);
+      rq.args.emplace(tkm::Defaults::Arg::What, export_types);
+      rq.args.emplace(tkm::Defaults::Arg::AggregateColumns, aggregate_columns);
+      rq.args.emplace(tkm::Defaults::Arg::AggregateWidth, aggregate_width);
+      if (aggregate_match != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::AggregateMatch, aggregate_match);
+      }
+      if (list_from != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListFrom, list_from);
+      }
+      if (list_to != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::ListTo, list_to);
+      }
+      app.getCommand()->addRequest(rq);
+    }
+
+    if (latest) {
+      tkm::control::Command::Request rq{.action = tkm::control::Command::Action::GetLatest,
+                                        .args = std::map<tkm::Defaults::Arg, std::string>()};
+      if (export_types != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::What, export_types);
+      }
+      app.getCommand()->addRequest(rq);
+    }
+
+    if (subscribe) {
+      tkm::control::Command::Request rq{.action = tkm::control::Command::Action::Subscribe,
+                                        .args = std::map<tkm::Defaults::Arg, std::string>()};
+      rq.args.emplace(tkm::Defaults::Arg::DeviceHash, unique_id);
+      if (export_types != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::What, export_types);
+      }
+      app.getCommand()->addRequest(rq);
+    }
+
+    if (bulk) {
+      tkm::control::Command::Request rq{.action = tkm::control::Command::Action::BulkDevices,
+                                        .args = std::map<tkm::Defaults::Arg, std::string>()};
+      if (connect_device) {
+        rq.args.emplace(tkm::Defaults::Arg::What, "Connect");
+      } else if (disconnect_device) {
+        rq.args.emplace(tkm::Defaults::Arg::What, "Disconnect");
+      } else if (start_collecting) {
+        rq.args.emplace(tkm::Defaults::Arg::What, "StartCollecting");
+      } else {
+        rq.args.emplace(tkm::Defaults::Arg::What, "StopCollecting");
+      }
+      if (bulk_devices != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::DeviceHash, bulk_devices);
+      }
+      if (bulk_pattern != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::BulkPattern, bulk_pattern);
+      }
+      if (bulk_concurrency != nullptr) {
+        rq.args.emplace(tkm::Defaults::Arg::BulkConcurrency, bulk_concurrency);
+      }
+      app.getCommand()->addRequest(rq);
+    }
+
+    if (connect_device && !bulk) {
       tkm::control::Command::Request rq{.action = tkm::control::Command::Action::ConnectDevice,
                                         .args = std::map<tkm::Defaults::Arg, std::string>()};
       rq.args.emplace(tkm::Defaults::Arg::DeviceHash, unique_id);
@@ -370,7 +825,7 @@ auto main(int argc, char **argv) -> int
       app.getCommand()->addRequest(rq);
     }
 
-    if (disconnect_device) {
+    if (disconnect_device && !bulk) {
       tkm::control::Command::Request rq{.action = tkm::control::Command::Action::DisconnectDevice,
                                         .args = std::map<tkm::Defaults::Arg, std::string>()};
       rq.args.emplace(tkm::Defaults::Arg::DeviceHash, unique_id);
@@ -381,7 +836,7 @@ auto main(int argc, char **argv) -> int
       app.getCommand()->addRequest(rq);
     }
 
-    if (start_collecting) {
+    if (start_collecting && !bulk) {
       tkm::control::Command::Request rq{.action = tkm::control::Command::Action::StartCollecting,
                                         .args = std::map<tkm::Defaults::Arg, std::string>()};
       rq.args.emplace(tkm::Defaults::Arg::DeviceHash, unique_id);
@@ -392,7 +847,7 @@ auto main(int argc, char **argv) -> int
       app.getCommand()->addRequest(rq);
     }
 
-    if (stop_collecting) {
+    if (stop_collecting && !bulk) {
       tkm::control::Command::Request rq{.action = tkm::control::Command::Action::StopCollecting,
                                         .args = std::map<tkm::Defaults::Arg, std::string>()};
       rq.args.emplace(tkm::Defaults::Arg::DeviceHash, unique_id);
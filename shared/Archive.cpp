@@ -0,0 +1,614 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Archive Class
+ * @details   Columnar session archive writer and mmap reader
+ *-
+ */
+
+#include "Archive.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace tkm
+{
+
+// Footer offset, footer size and magic
+constexpr size_t GArchiveTrailerSize = 2 * sizeof(uint64_t) + GArchiveMagicSize;
+
+static void putVarint(std::string &out, uint64_t value)
+{
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+static auto getVarint(const uint8_t *&pos, const uint8_t *end) -> uint64_t
+{
+  uint64_t value = 0;
+
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (pos >= end) {
+      throw std::runtime_error("Truncated archive data");
+    }
+    const uint8_t byte = *pos++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+
+  throw std::runtime_error("Invalid archive varint");
+}
+
+static auto zigzagEncode(int64_t value) -> uint64_t
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+static auto zigzagDecode(uint64_t value) -> int64_t
+{
+  return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+static void putDouble(std::string &out, double value)
+{
+  char raw[sizeof(double)];
+  memcpy(raw, &value, sizeof(double));
+  out.append(raw, sizeof(double));
+}
+
+static auto getDouble(const uint8_t *&pos, const uint8_t *end) -> double
+{
+  double value = 0;
+
+  if ((end - pos) < static_cast<std::ptrdiff_t>(sizeof(double))) {
+    throw std::runtime_error("Truncated archive data");
+  }
+  memcpy(&value, pos, sizeof(double));
+  pos += sizeof(double);
+
+  return value;
+}
+
+static void putString(std::string &out, std::string_view value)
+{
+  putVarint(out, value.size());
+  out.append(value.data(), value.size());
+}
+
+static auto getString(const uint8_t *&pos, const uint8_t *end) -> std::string_view
+{
+  const auto size = getVarint(pos, end);
+
+  if (static_cast<uint64_t>(end - pos) < size) {
+    throw std::runtime_error("Truncated archive data");
+  }
+  std::string_view value(reinterpret_cast<const char *>(pos), size);
+  pos += size;
+
+  return value;
+}
+
+static bool parseInteger(const std::string &text, int64_t &value)
+{
+  char *end = nullptr;
+
+  if (text.empty()) {
+    return false;
+  }
+  errno = 0;
+  value = std::strtoll(text.c_str(), &end, 10);
+
+  return (errno == 0) && (*end == '\0');
+}
+
+static bool parseReal(const std::string &text, double &value)
+{
+  char *end = nullptr;
+
+  if (text.empty()) {
+    return false;
+  }
+  errno = 0;
+  value = std::strtod(text.c_str(), &end);
+
+  return (errno == 0) && (*end == '\0');
+}
+
+ArchiveWriter::ArchiveWriter(const std::string &path, uint32_t blockRows)
+: m_path(path)
+, m_blockRows(blockRows > 0 ? blockRows : 1)
+{
+  m_stream.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!m_stream.is_open()) {
+    throw std::runtime_error("Fail to open archive file " + path);
+  }
+  m_stream.write(GArchiveMagic, GArchiveMagicSize);
+  m_offset = GArchiveMagicSize;
+}
+
+bool ArchiveWriter::startTable(const std::string &name, const std::vector<std::string> &columns)
+{
+  if (!m_columns.empty()) {
+    writeTable();
+  }
+
+  m_table = ArchiveTable{};
+  m_table.name = name;
+  m_table.blockRows = m_blockRows;
+
+  m_timeColumn = -1;
+  m_columns = std::vector<Column>(columns.size());
+  m_values.assign(columns.size(), std::string());
+  for (size_t i = 0; i < columns.size(); i++) {
+    m_columns.at(i).info.name = columns.at(i);
+    m_columns.at(i).pending.reserve(m_blockRows);
+    if (strcasecmp(columns.at(i).c_str(), GArchiveTimeColumn) == 0) {
+      m_timeColumn = static_cast<int>(i);
+    }
+  }
+
+  return m_stream.good();
+}
+
+bool ArchiveWriter::commitRow()
+{
+  for (size_t i = 0; i < m_columns.size(); i++) {
+    m_columns.at(i).pending.push_back(std::move(m_values.at(i)));
+    m_values.at(i).clear();
+  }
+  m_table.rows++;
+  m_rows++;
+
+  if (!m_columns.empty() && (m_columns.front().pending.size() >= m_blockRows)) {
+    encodeBlock();
+  }
+
+  return m_stream.good();
+}
+
+void ArchiveWriter::encodeBlock()
+{
+  if (m_columns.empty() || m_columns.front().pending.empty()) {
+    return;
+  }
+
+  if (m_timeColumn >= 0) {
+    ArchiveTimeRange range{};
+    bool first = true;
+
+    for (const auto &text : m_columns.at(static_cast<size_t>(m_timeColumn)).pending) {
+      int64_t value = 0;
+      if (!parseInteger(text, value)) {
+        continue;
+      }
+      range.first = first ? value : std::min(range.first, value);
+      range.last = first ? value : std::max(range.last, value);
+      first = false;
+    }
+    m_table.timeIndex.push_back(range);
+  }
+
+  for (auto &column : m_columns) {
+    std::vector<int64_t> integers;
+    std::vector<double> reals;
+    auto encoding = ArchiveType::Integer;
+
+    integers.reserve(column.pending.size());
+    for (const auto &text : column.pending) {
+      int64_t value = 0;
+      if (!parseInteger(text, value)) {
+        encoding = ArchiveType::Real;
+        break;
+      }
+      integers.push_back(value);
+    }
+
+    if (encoding == ArchiveType::Real) {
+      reals.reserve(column.pending.size());
+      for (const auto &text : column.pending) {
+        double value = 0;
+        if (!parseReal(text, value)) {
+          encoding = ArchiveType::Text;
+          break;
+        }
+        reals.push_back(value);
+      }
+    }
+
+    column.info.blocks.push_back(column.data.size());
+    column.data.push_back(static_cast<char>(encoding));
+    column.info.type = std::max(column.info.type, encoding);
+
+    const auto updateRange = [&column](double value) {
+      column.info.min = column.hasRange ? std::min(column.info.min, value) : value;
+      column.info.max = column.hasRange ? std::max(column.info.max, value) : value;
+      column.hasRange = true;
+    };
+
+    switch (encoding) {
+    case ArchiveType::Integer: {
+      int64_t previous = 0;
+      for (const auto value : integers) {
+        putVarint(column.data,
+                  zigzagEncode(static_cast<int64_t>(static_cast<uint64_t>(value) -
+                                                    static_cast<uint64_t>(previous))));
+        previous = value;
+        updateRange(static_cast<double>(value));
+      }
+      break;
+    }
+    case ArchiveType::Real:
+      for (const auto value : reals) {
+        putDouble(column.data, value);
+        updateRange(value);
+      }
+      break;
+    case ArchiveType::Text: {
+      std::unordered_map<std::string_view, uint64_t> index;
+      std::vector<std::string_view> dict;
+      std::string rows;
+
+      for (const auto &text : column.pending) {
+        auto it = index.find(text);
+        if (it == index.end()) {
+          it = index.emplace(text, dict.size()).first;
+          dict.push_back(text);
+        }
+        putVarint(rows, it->second);
+      }
+
+      putVarint(column.data, dict.size());
+      for (const auto &entry : dict) {
+        putString(column.data, entry);
+      }
+      column.data.append(rows);
+      break;
+    }
+    }
+
+    column.pending.clear();
+  }
+}
+
+bool ArchiveWriter::writeTable()
+{
+  encodeBlock();
+
+  for (auto &column : m_columns) {
+    column.info.offset = m_offset;
+    column.info.size = column.data.size();
+    m_stream.write(column.data.data(), static_cast<std::streamsize>(column.data.size()));
+    m_offset += column.data.size();
+
+    m_table.columns.push_back(std::move(column.info));
+  }
+
+  m_tables.push_back(std::move(m_table));
+  m_table = ArchiveTable{};
+  m_columns.clear();
+
+  return m_stream.good();
+}
+
+bool ArchiveWriter::finish()
+{
+  std::string footer;
+
+  if (!m_columns.empty()) {
+    writeTable();
+  }
+
+  putVarint(footer, m_tables.size());
+  for (const auto &table : m_tables) {
+    putString(footer, table.name);
+    putVarint(footer, table.rows);
+    putVarint(footer, table.blockRows);
+
+    putVarint(footer, table.timeIndex.size());
+    for (const auto &range : table.timeIndex) {
+      putVarint(footer, zigzagEncode(range.first));
+      putVarint(footer, zigzagEncode(range.last));
+    }
+
+    putVarint(footer, table.columns.size());
+    for (const auto &column : table.columns) {
+      putString(footer, column.name);
+      footer.push_back(static_cast<char>(column.type));
+      putVarint(footer, column.offset);
+      putVarint(footer, column.size);
+      putDouble(footer, column.min);
+      putDouble(footer, column.max);
+      putVarint(footer, column.blocks.size());
+      for (const auto block : column.blocks) {
+        putVarint(footer, block);
+      }
+    }
+  }
+
+  const uint64_t footerSize = footer.size();
+  m_stream.write(footer.data(), static_cast<std::streamsize>(footer.size()));
+  m_stream.write(reinterpret_cast<const char *>(&m_offset), sizeof(m_offset));
+  m_stream.write(reinterpret_cast<const char *>(&footerSize), sizeof(footerSize));
+  m_stream.write(GArchiveMagic, GArchiveMagicSize);
+  m_stream.flush();
+  m_stream.close();
+
+  return !m_stream.fail();
+}
+
+ArchiveReader::ArchiveReader(const std::string &path)
+{
+  struct stat info {
+  };
+
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::runtime_error("Fail to open archive file " + path);
+  }
+
+  if ((fstat(fd, &info) != 0) ||
+      (static_cast<uint64_t>(info.st_size) < GArchiveMagicSize + GArchiveTrailerSize)) {
+    ::close(fd);
+    throw std::runtime_error("Invalid archive file " + path);
+  }
+  m_size = static_cast<uint64_t>(info.st_size);
+
+  void *map = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    throw std::runtime_error("Fail to map archive file " + path);
+  }
+  m_data = static_cast<const uint8_t *>(map);
+  madvise(map, m_size, MADV_SEQUENTIAL);
+
+  try {
+    const uint8_t *trailer = m_data + m_size - GArchiveTrailerSize;
+    uint64_t footerOffset = 0;
+    uint64_t footerSize = 0;
+
+    memcpy(&footerOffset, trailer, sizeof(footerOffset));
+    memcpy(&footerSize, trailer + sizeof(footerOffset), sizeof(footerSize));
+
+    if ((memcmp(m_data, GArchiveMagic, GArchiveMagicSize) != 0) ||
+        (memcmp(trailer + 2 * sizeof(uint64_t), GArchiveMagic, GArchiveMagicSize) != 0)) {
+      throw std::runtime_error("Invalid archive file magic");
+    }
+    if ((footerOffset < GArchiveMagicSize) ||
+        (footerOffset + footerSize != m_size - GArchiveTrailerSize)) {
+      throw std::runtime_error("Invalid archive footer");
+    }
+
+    parseFooter(m_data + footerOffset, m_data + footerOffset + footerSize);
+  } catch (...) {
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+    throw;
+  }
+}
+
+ArchiveReader::~ArchiveReader()
+{
+  if (m_data != nullptr) {
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+  }
+}
+
+void ArchiveReader::parseFooter(const uint8_t *pos, const uint8_t *end)
+{
+  const auto dataEnd = static_cast<uint64_t>(end - m_data);
+  const auto tableCount = getVarint(pos, end);
+
+  for (uint64_t t = 0; t < tableCount; t++) {
+    ArchiveTable table{};
+
+    table.name = getString(pos, end);
+    table.rows = getVarint(pos, end);
+    table.blockRows = static_cast<uint32_t>(getVarint(pos, end));
+    if (table.blockRows == 0) {
+      throw std::runtime_error("Invalid archive block size");
+    }
+    const auto blockCount = (table.rows + table.blockRows - 1) / table.blockRows;
+
+    const auto rangeCount = getVarint(pos, end);
+    if ((rangeCount != 0) && (rangeCount != blockCount)) {
+      throw std::runtime_error("Invalid archive time index");
+    }
+    for (uint64_t i = 0; i < rangeCount; i++) {
+      ArchiveTimeRange range{};
+      range.first = zigzagDecode(getVarint(pos, end));
+      range.last = zigzagDecode(getVarint(pos, end));
+      table.timeIndex.push_back(range);
+    }
+
+    const auto columnCount = getVarint(pos, end);
+    for (uint64_t c = 0; c < columnCount; c++) {
+      ArchiveColumn column{};
+
+      column.name = getString(pos, end);
+      if (pos >= end) {
+        throw std::runtime_error("Truncated archive data");
+      }
+      column.type = static_cast<ArchiveType>(*pos++);
+      column.offset = getVarint(pos, end);
+      column.size = getVarint(pos, end);
+      column.min = getDouble(pos, end);
+      column.max = getDouble(pos, end);
+
+      if ((column.type > ArchiveType::Text) || (column.offset > dataEnd) ||
+          (column.size > dataEnd - column.offset)) {
+        throw std::runtime_error("Invalid archive column " + column.name);
+      }
+
+      if (getVarint(pos, end) != blockCount) {
+        throw std::runtime_error("Invalid archive column " + column.name);
+      }
+      for (uint64_t i = 0; i < blockCount; i++) {
+        const auto block = getVarint(pos, end);
+        if (block >= column.size) {
+          throw std::runtime_error("Invalid archive column " + column.name);
+        }
+        column.blocks.push_back(block);
+      }
+
+      table.columns.push_back(std::move(column));
+    }
+
+    m_tables.push_back(std::move(table));
+  }
+}
+
+auto ArchiveReader::getTable(const std::string &name) const -> const ArchiveTable *
+{
+  for (const auto &table : m_tables) {
+    if (strcasecmp(table.name.c_str(), name.c_str()) == 0) {
+      return &table;
+    }
+  }
+  return nullptr;
+}
+
+auto ArchiveReader::getColumn(const ArchiveTable &table, const std::string &name) const
+    -> const ArchiveColumn *
+{
+  for (const auto &column : table.columns) {
+    if (strcasecmp(column.name.c_str(), name.c_str()) == 0) {
+      return &column;
+    }
+  }
+  return nullptr;
+}
+
+auto ArchiveReader::findBlock(const ArchiveTable &table, int64_t time) const -> size_t
+{
+  // Samples are stored in insert order so the ranges are not strictly sorted
+  for (size_t i = 0; i < table.timeIndex.size(); i++) {
+    if (table.timeIndex.at(i).last >= time) {
+      return i;
+    }
+  }
+  return table.timeIndex.size();
+}
+
+ArchiveCursor::ArchiveCursor(const ArchiveReader &reader,
+                             const ArchiveTable &table,
+                             const ArchiveColumn &column,
+                             size_t firstBlock)
+: m_table(table)
+, m_column(column)
+, m_base(reader.getData() + column.offset)
+, m_block(firstBlock)
+{
+  m_row = static_cast<uint64_t>(firstBlock) * table.blockRows;
+  m_blockEnd = m_row;
+}
+
+bool ArchiveCursor::openBlock(size_t block)
+{
+  if (block >= m_column.blocks.size()) {
+    return false;
+  }
+
+  m_pos = m_base + m_column.blocks.at(block);
+  m_end = (block + 1 < m_column.blocks.size()) ? m_base + m_column.blocks.at(block + 1)
+                                               : m_base + m_column.size;
+  m_encoding = static_cast<ArchiveType>(*m_pos++);
+  m_blockEnd = std::min(m_table.rows, static_cast<uint64_t>(block + 1) * m_table.blockRows);
+  m_integer = 0;
+
+  m_dict.clear();
+  if (m_encoding == ArchiveType::Text) {
+    const auto count = getVarint(m_pos, m_end);
+    for (uint64_t i = 0; i < count; i++) {
+      m_dict.push_back(getString(m_pos, m_end));
+    }
+  } else if (m_encoding > ArchiveType::Text) {
+    throw std::runtime_error("Invalid archive block encoding");
+  }
+
+  return true;
+}
+
+bool ArchiveCursor::next()
+{
+  if (m_row >= m_table.rows) {
+    return false;
+  }
+
+  if (m_row == m_blockEnd) {
+    if (!openBlock(m_block++)) {
+      return false;
+    }
+  }
+
+  switch (m_encoding) {
+  case ArchiveType::Integer:
+    m_integer = static_cast<int64_t>(static_cast<uint64_t>(m_integer) +
+                                     static_cast<uint64_t>(zigzagDecode(getVarint(m_pos, m_end))));
+    break;
+  case ArchiveType::Real:
+    m_real = getDouble(m_pos, m_end);
+    break;
+  case ArchiveType::Text: {
+    const auto index = getVarint(m_pos, m_end);
+    if (index >= m_dict.size()) {
+      throw std::runtime_error("Invalid archive dictionary index");
+    }
+    m_text = m_dict.at(index);
+    break;
+  }
+  }
+
+  // Blocks of a text column may still hold numbers
+  if ((m_column.type == ArchiveType::Text) && (m_encoding != ArchiveType::Text)) {
+    m_buffer = (m_encoding == ArchiveType::Integer) ? std::to_string(m_integer)
+                                                    : std::to_string(m_real);
+    m_text = m_buffer;
+  }
+
+  m_row++;
+  return true;
+}
+
+auto ArchiveCursor::getInteger() const -> int64_t
+{
+  switch (m_encoding) {
+  case ArchiveType::Integer:
+    return m_integer;
+  case ArchiveType::Real:
+    return static_cast<int64_t>(m_real);
+  default:
+    break;
+  }
+  return 0;
+}
+
+auto ArchiveCursor::getReal() const -> double
+{
+  switch (m_encoding) {
+  case ArchiveType::Integer:
+    return static_cast<double>(m_integer);
+  case ArchiveType::Real:
+    return m_real;
+  default:
+    break;
+  }
+  return 0;
+}
+
+} // namespace tkm
@@ -0,0 +1,180 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Archive Class
+ * @details   Columnar session archive writer and mmap reader
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tkm
+{
+
+// Archive file layout (host byte order):
+//   header : 8 bytes magic "TKMARC01"
+//   data   : for each table, for each column, its blocks stored back to back
+//   footer : schema, see ArchiveReader::parseFooter
+//   trailer: uint64_t footer offset, uint64_t footer size, 8 bytes magic
+//
+// Every column is split in blocks of BlockRows rows, each block starts with
+// its encoding byte:
+//   Integer: zigzag varint of the delta to the previous value in the block
+//   Real   : raw doubles
+//   Text   : varint dictionary size, dictionary entries (varint size, bytes),
+//            one varint dictionary index per row
+// The time index keeps the SystemTime range of every block so readers can
+// skip the blocks outside of a time window. Table and column names are
+// matched ignoring case since PostgreSQL reports lower case column names.
+constexpr const char *GArchiveMagic = "TKMARC01";
+constexpr size_t GArchiveMagicSize = 8;
+constexpr const char *GArchiveTimeColumn = "SystemTime";
+
+enum class ArchiveType : uint8_t { Integer = 0, Real = 1, Text = 2 };
+
+struct ArchiveTimeRange {
+  int64_t first = 0;
+  int64_t last = 0;
+};
+
+struct ArchiveColumn {
+  std::string name{};
+  ArchiveType type = ArchiveType::Integer;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+  // Range of the numeric values, zero for text only columns
+  double min = 0;
+  double max = 0;
+  // Block offsets relative to the column offset
+  std::vector<uint64_t> blocks{};
+};
+
+struct ArchiveTable {
+  std::string name{};
+  uint64_t rows = 0;
+  uint32_t blockRows = 0;
+  std::vector<ArchiveColumn> columns{};
+  std::vector<ArchiveTimeRange> timeIndex{};
+};
+
+class ArchiveWriter
+{
+public:
+  ArchiveWriter(const std::string &path, uint32_t blockRows);
+  ~ArchiveWriter() = default;
+
+  // Write the previous table and start a new one
+  bool startTable(const std::string &name, const std::vector<std::string> &columns);
+  void setValue(size_t column, const std::string &value) { m_values.at(column) = value; }
+  bool commitRow();
+  // Write the footer, the file is not readable before
+  bool finish();
+
+  auto getPath() -> const std::string & { return m_path; }
+  [[nodiscard]] auto getRowCount() const -> uint64_t { return m_rows; }
+
+public:
+  ArchiveWriter(ArchiveWriter const &) = delete;
+  void operator=(ArchiveWriter const &) = delete;
+
+private:
+  struct Column {
+    ArchiveColumn info{};
+    std::vector<std::string> pending{};
+    std::string data{};
+    bool hasRange = false;
+  };
+
+  void encodeBlock();
+  bool writeTable();
+
+private:
+  std::ofstream m_stream;
+  std::string m_path{};
+  uint32_t m_blockRows = 0;
+  uint64_t m_offset = 0;
+  uint64_t m_rows = 0;
+  int m_timeColumn = -1;
+  ArchiveTable m_table{};
+  std::vector<Column> m_columns{};
+  std::vector<std::string> m_values{};
+  std::vector<ArchiveTable> m_tables{};
+};
+
+class ArchiveReader;
+
+// Forward iterator over the values of one column. Values are decoded in
+// place from the mapped file, text values point into the mapping.
+class ArchiveCursor
+{
+public:
+  ArchiveCursor(const ArchiveReader &reader,
+                const ArchiveTable &table,
+                const ArchiveColumn &column,
+                size_t firstBlock = 0);
+
+  bool next();
+  [[nodiscard]] auto getInteger() const -> int64_t;
+  [[nodiscard]] auto getReal() const -> double;
+  [[nodiscard]] auto getText() const -> std::string_view { return m_text; }
+  // Row number of the current value inside the table
+  [[nodiscard]] auto getRow() const -> uint64_t { return m_row - 1; }
+
+private:
+  bool openBlock(size_t block);
+
+private:
+  const ArchiveTable &m_table;
+  const ArchiveColumn &m_column;
+  const uint8_t *m_base = nullptr;
+  const uint8_t *m_pos = nullptr;
+  const uint8_t *m_end = nullptr;
+  std::vector<std::string_view> m_dict{};
+  std::string_view m_text{};
+  std::string m_buffer{};
+  ArchiveType m_encoding = ArchiveType::Integer;
+  size_t m_block = 0;
+  uint64_t m_row = 0;
+  uint64_t m_blockEnd = 0;
+  int64_t m_integer = 0;
+  double m_real = 0;
+};
+
+class ArchiveReader
+{
+public:
+  explicit ArchiveReader(const std::string &path);
+  ~ArchiveReader();
+
+  [[nodiscard]] auto getTables() const -> const std::vector<ArchiveTable> & { return m_tables; }
+  [[nodiscard]] auto getTable(const std::string &name) const -> const ArchiveTable *;
+  [[nodiscard]] auto getColumn(const ArchiveTable &table, const std::string &name) const
+      -> const ArchiveColumn *;
+  // First block that may hold samples at or after the time
+  [[nodiscard]] auto findBlock(const ArchiveTable &table, int64_t time) const -> size_t;
+  [[nodiscard]] auto getData() const -> const uint8_t * { return m_data; }
+  [[nodiscard]] auto getSize() const -> uint64_t { return m_size; }
+
+public:
+  ArchiveReader(ArchiveReader const &) = delete;
+  void operator=(ArchiveReader const &) = delete;
+
+private:
+  void parseFooter(const uint8_t *pos, const uint8_t *end);
+
+private:
+  const uint8_t *m_data = nullptr;
+  uint64_t m_size = 0;
+  std::vector<ArchiveTable> m_tables{};
+};
+
+} // namespace tkm
@@ -0,0 +1,219 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Capture Class
+ * @details   Raw envelope capture file writer and reader
+ *-
+ */
+
+#include "Capture.h"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+
+#include <google/protobuf/io/coded_stream.h>
+
+// Reject corrupted records instead of allocating huge buffers
+constexpr uint32_t GCaptureMaxRecordSize = 64 * 1024 * 1024;
+// Socket read size of the frame reader
+constexpr size_t GFrameReadSize = 64 * 1024;
+
+namespace pbio = google::protobuf::io;
+
+namespace tkm
+{
+
+auto encodeFrame(const std::string &envelope) -> std::string
+{
+  if (envelope.size() > GCaptureMaxRecordSize) {
+    return std::string();
+  }
+
+  std::string frame(envelope.size() + GFrameHeaderSize, '\0');
+  auto *start = reinterpret_cast<uint8_t *>(frame.data());
+  auto *end = pbio::CodedOutputStream::WriteVarint32ToArray(
+      static_cast<uint32_t>(envelope.size()), start);
+  memcpy(end, envelope.data(), envelope.size());
+
+  return frame;
+}
+
+bool writeFrame(int fd, const std::string &envelope)
+{
+  const auto frame = encodeFrame(envelope);
+  if (frame.empty()) {
+    return false;
+  }
+
+  size_t offset = 0;
+  while (offset < frame.size()) {
+    auto written =
+        ::send(fd, frame.data() + offset, frame.size() - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (written < 0) {
+      struct pollfd pfd = {.fd = fd, .events = POLLOUT, .revents = 0};
+
+      if (((errno != EAGAIN) && (errno != EINTR)) ||
+          (poll(&pfd, 1, -1) < 0)) {
+        return false;
+      }
+      continue;
+    }
+    offset += static_cast<size_t>(written);
+  }
+
+  return true;
+}
+
+FrameReader::FrameReader(int fd)
+: m_fd(fd)
+{
+}
+
+auto FrameReader::next(tkm::msg::Envelope &envelope) -> IAsyncEnvelope::Status
+{
+  m_frame.clear();
+
+  while (true) {
+    const auto available = m_buffer.size() - m_offset;
+
+    if (available > 0) {
+      const auto *start = reinterpret_cast<const uint8_t *>(m_buffer.data() + m_offset);
+      pbio::CodedInputStream codedInput(start, static_cast<int>(available));
+      uint32_t size = 0;
+
+      if (codedInput.ReadVarint32(&size)) {
+        if (size > GCaptureMaxRecordSize) {
+          return IAsyncEnvelope::Status::Error;
+        }
+        if (available >= size + GFrameHeaderSize) {
+          const auto header = static_cast<size_t>(codedInput.CurrentPosition());
+
+          m_frame.assign(m_buffer, m_offset + header, size);
+          m_offset += size + GFrameHeaderSize;
+          return envelope.ParseFromString(m_frame) ? IAsyncEnvelope::Status::Ok
+                                                   : IAsyncEnvelope::Status::Error;
+        }
+      } else if (available >= GFrameHeaderSize) {
+        return IAsyncEnvelope::Status::Error;
+      }
+    }
+
+    // Keep the incomplete frame at the start of the buffer
+    if (m_offset > 0) {
+      m_buffer.erase(0, m_offset);
+      m_offset = 0;
+    }
+
+    const auto used = m_buffer.size();
+    m_buffer.resize(used + GFrameReadSize);
+    auto readLen = ::recv(m_fd, m_buffer.data() + used, GFrameReadSize, MSG_DONTWAIT);
+    m_buffer.resize(used + static_cast<size_t>((readLen > 0) ? readLen : 0));
+
+    if (readLen == 0) {
+      return IAsyncEnvelope::Status::EndOfFile;
+    }
+    if (readLen < 0) {
+      if ((errno == EAGAIN) || (errno == EINTR)) {
+        return IAsyncEnvelope::Status::Again;
+      }
+      return IAsyncEnvelope::Status::Error;
+    }
+  }
+}
+
+CaptureWriter::CaptureWriter(const std::string &path)
+: m_path(path)
+{
+  m_stream.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!m_stream.is_open()) {
+    throw std::runtime_error("Fail to open capture file " + path);
+  }
+  m_stream.write(GCaptureMagic, GCaptureMagicSize);
+}
+
+CaptureWriter::~CaptureWriter()
+{
+  if (m_stream.is_open()) {
+    m_stream.flush();
+    m_stream.close();
+  }
+}
+
+bool CaptureWriter::write(const std::string &frame, uint64_t receiveTime)
+{
+  const auto size = static_cast<uint32_t>(frame.size());
+  m_stream.write(reinterpret_cast<const char *>(&receiveTime), sizeof(receiveTime));
+  m_stream.write(reinterpret_cast<const char *>(&size), sizeof(size));
+  m_stream.write(frame.data(), static_cast<std::streamsize>(size));
+
+  return m_stream.good();
+}
+
+bool EnvelopeSource::nextFrame(std::string &frame, uint64_t &receiveTime)
+{
+  tkm::msg::Envelope envelope;
+
+  if (!next(envelope, receiveTime)) {
+    return false;
+  }
+
+  frame.clear();
+  return envelope.SerializeToString(&frame);
+}
+
+CaptureReader::CaptureReader(const std::string &path)
+{
+  m_stream.open(path, std::ios::binary | std::ios::in);
+  if (!m_stream.is_open()) {
+    throw std::runtime_error("Fail to open capture file " + path);
+  }
+  rewind();
+}
+
+void CaptureReader::rewind()
+{
+  char magic[GCaptureMagicSize]{};
+
+  m_stream.clear();
+  m_stream.seekg(0);
+  m_stream.read(magic, GCaptureMagicSize);
+  if (!m_stream.good() || (memcmp(magic, GCaptureMagic, GCaptureMagicSize) != 0)) {
+    throw std::runtime_error("Invalid capture file header");
+  }
+}
+
+bool CaptureReader::nextFrame(std::string &frame, uint64_t &receiveTime)
+{
+  uint32_t size = 0;
+
+  m_stream.read(reinterpret_cast<char *>(&receiveTime), sizeof(receiveTime));
+  m_stream.read(reinterpret_cast<char *>(&size), sizeof(size));
+  if (!m_stream.good() || (size > GCaptureMaxRecordSize)) {
+    return false;
+  }
+
+  frame.resize(size);
+  m_stream.read(frame.data(), static_cast<std::streamsize>(size));
+
+  return m_stream.good();
+}
+
+bool CaptureReader::next(tkm::msg::Envelope &envelope, uint64_t &receiveTime)
+{
+  // Undecodable envelopes are only returned by nextFrame
+  while (nextFrame(m_buffer, receiveTime)) {
+    if (envelope.ParseFromString(m_buffer)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace tkm
@@ -0,0 +1,111 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Capture Class
+ * @details   Raw envelope capture file writer and reader
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <taskmonitor/taskmonitor.h>
+
+namespace tkm
+{
+
+// Capture file layout (host byte order):
+//   header: 8 bytes magic "TKMCAP01"
+//   record: uint64_t receive time (monotonic usec), uint32_t size, size bytes envelope
+// The envelope bytes are stored as read from the device socket, undecodable
+// envelopes included.
+constexpr const char *GCaptureMagic = "TKMCAP01";
+constexpr size_t GCaptureMagicSize = 8;
+
+// Device stream frame layout, as written by the libtaskmonitor EnvelopeWriter:
+// a varint32 envelope size, the envelope bytes, then padding up to size + 8 bytes
+constexpr size_t GFrameHeaderSize = sizeof(uint64_t);
+
+// Frame of a serialized envelope, empty if the envelope is too large
+auto encodeFrame(const std::string &envelope) -> std::string;
+// Write one envelope frame on a socket, the socket may be non blocking
+bool writeFrame(int fd, const std::string &envelope);
+
+// Device stream reader keeping the received bytes of the last envelope
+class FrameReader
+{
+public:
+  explicit FrameReader(int fd);
+
+  // Decode the next envelope, Again when no complete frame was received yet
+  auto next(tkm::msg::Envelope &envelope) -> IAsyncEnvelope::Status;
+  // Envelope bytes of the last complete frame, also set when they do not decode
+  auto getFrame() const -> const std::string & { return m_frame; }
+
+public:
+  FrameReader(FrameReader const &) = delete;
+  void operator=(FrameReader const &) = delete;
+
+private:
+  std::string m_buffer{};
+  std::string m_frame{};
+  size_t m_offset = 0;
+  int m_fd = -1;
+};
+
+class CaptureWriter
+{
+public:
+  explicit CaptureWriter(const std::string &path);
+  ~CaptureWriter();
+
+  bool write(const std::string &frame, uint64_t receiveTime);
+  auto getPath() -> const std::string & { return m_path; }
+
+public:
+  CaptureWriter(CaptureWriter const &) = delete;
+  void operator=(CaptureWriter const &) = delete;
+
+private:
+  std::ofstream m_stream;
+  std::string m_path{};
+};
+
+// Source of recorded device envelopes, receive time in monotonic usec
+class EnvelopeSource
+{
+public:
+  virtual ~EnvelopeSource() = default;
+
+  // Decodable envelopes only
+  virtual bool next(tkm::msg::Envelope &envelope, uint64_t &receiveTime) = 0;
+  // Envelope bytes as they are sent to the collector
+  virtual bool nextFrame(std::string &frame, uint64_t &receiveTime);
+  virtual void rewind() = 0;
+};
+
+class CaptureReader : public EnvelopeSource
+{
+public:
+  explicit CaptureReader(const std::string &path);
+
+  bool next(tkm::msg::Envelope &envelope, uint64_t &receiveTime) final;
+  bool nextFrame(std::string &frame, uint64_t &receiveTime) final;
+  void rewind() final;
+
+public:
+  CaptureReader(CaptureReader const &) = delete;
+  void operator=(CaptureReader const &) = delete;
+
+private:
+  std::ifstream m_stream;
+  std::string m_buffer{};
+};
+
+} // namespace tkm
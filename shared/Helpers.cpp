@@ -11,7 +11,10 @@
 
 #include "Helpers.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstring>
+#include <ctime>
 #include <memory>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -32,6 +35,29 @@ auto hashForDevice(const tkm::msg::control::DeviceData &data) -> std::string
   return std::to_string(jnkHsh(tmp.c_str()));
 }
 
+bool isValidHash(const std::string &hash)
+{
+  return !hash.empty() && std::all_of(hash.cbegin(), hash.cend(), [](unsigned char c) {
+    return std::isalnum(c) != 0;
+  });
+}
+
+auto getMonotonicTime() -> uint64_t
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+auto getMonotonicTimeNs() -> uint64_t
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
 bool sendControlDescriptor(int fd, tkm::msg::control::Descriptor &descriptor)
 {
   tkm::msg::control::Message message{};
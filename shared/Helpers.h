@@ -20,6 +20,11 @@ namespace tkm
 {
 
 auto hashForDevice(const tkm::msg::control::DeviceData &data) -> std::string;
+auto getMonotonicTime() -> uint64_t;
+auto getMonotonicTimeNs() -> uint64_t;
+// Session and device hashes are alphanumeric, they name files and are written
+// into SQL statements
+bool isValidHash(const std::string &hash);
 bool sendControlDescriptor(int fd, tkm::msg::control::Descriptor &descriptor);
 bool readControlDescriptor(int fd, tkm::msg::control::Descriptor &descriptor);
 
@@ -65,6 +65,44 @@ auto Options::getFor(Key key) -> string
       return prop.value_or(tkmDefaults.getFor(Defaults::Default::DBFilePath));
     }
     return tkmDefaults.getFor(Defaults::Default::DBFilePath);
+  case Key::DBListChunkSize:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("database", -1, "ListChunkSize");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DBListChunkSize));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DBListChunkSize);
+  case Key::DBExportChunkSize:
+    if (hasConfigFile()) {
+      const optional<string> prop =
+          m_configFile->getPropertyValue("database", -1, "ExportChunkSize");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DBExportChunkSize));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DBExportChunkSize);
+  case Key::DBPartitioning:
+    if (hasConfigFile()) {
+      const optional<string> prop =
+          m_configFile->getPropertyValue("database", -1, "Partitioning");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DBPartitioning));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DBPartitioning);
+  case Key::DBSharding:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("database", -1, "Sharding");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DBSharding));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DBSharding);
+  case Key::DBLayout:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("database", -1, "Layout");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DBLayout));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DBLayout);
+  case Key::DBPackedArrays:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("database", -1, "PackedArrays");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DBPackedArrays));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DBPackedArrays);
   case Key::RuntimeDirectory:
     if (hasConfigFile()) {
       const optional<string> prop =
@@ -78,6 +116,292 @@ auto Options::getFor(Key key) -> string
       return prop.value_or(tkmDefaults.getFor(Defaults::Default::DatabaseType));
     }
     return tkmDefaults.getFor(Defaults::Default::DatabaseType);
+  case Key::CaptureEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("capture", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::CaptureEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::CaptureEnabled);
+  case Key::CaptureDirectory:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("capture", -1, "Directory");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::CaptureDirectory));
+    }
+    return tkmDefaults.getFor(Defaults::Default::CaptureDirectory);
+  case Key::SelfMonitorEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("selfmonitor", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SelfMonitorEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SelfMonitorEnabled);
+  case Key::SelfMonitorInterval:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("selfmonitor", -1, "Interval");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SelfMonitorInterval));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SelfMonitorInterval);
+  case Key::ArchiveEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("archive", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::ArchiveEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::ArchiveEnabled);
+  case Key::ArchiveDirectory:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("archive", -1, "Directory");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::ArchiveDirectory));
+    }
+    return tkmDefaults.getFor(Defaults::Default::ArchiveDirectory);
+  case Key::ArchiveBlockRows:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("archive", -1, "BlockRows");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::ArchiveBlockRows));
+    }
+    return tkmDefaults.getFor(Defaults::Default::ArchiveBlockRows);
+  case Key::RollupEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("rollup", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RollupEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RollupEnabled);
+  case Key::DedupEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("dedup", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DedupEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DedupEnabled);
+  case Key::DedupEpsilon:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("dedup", -1, "Epsilon");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DedupEpsilon));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DedupEpsilon);
+  case Key::DedupKeyframeInterval:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("dedup", -1, "KeyframeInterval");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::DedupKeyframeInterval));
+    }
+    return tkmDefaults.getFor(Defaults::Default::DedupKeyframeInterval);
+  case Key::TopNEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("topn", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::TopNEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::TopNEnabled);
+  case Key::TopNCount:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("topn", -1, "Count");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::TopNCount));
+    }
+    return tkmDefaults.getFor(Defaults::Default::TopNCount);
+  case Key::TopNOrder:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("topn", -1, "Order");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::TopNOrder));
+    }
+    return tkmDefaults.getFor(Defaults::Default::TopNOrder);
+  case Key::TopNAllow:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("topn", -1, "Allow");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::TopNAllow));
+    }
+    return tkmDefaults.getFor(Defaults::Default::TopNAllow);
+  case Key::IngestDisabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "Disabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestDisabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestDisabled);
+  case Key::IngestSysProcStat:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "SysProcStat");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestSysProcStat));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestSysProcStat);
+  case Key::IngestSysProcMemInfo:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "SysProcMemInfo");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestSysProcMemInfo));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestSysProcMemInfo);
+  case Key::IngestSysProcDiskStats:
+    if (hasConfigFile()) {
+      const optional<string> prop =
+          m_configFile->getPropertyValue("ingest", -1, "SysProcDiskStats");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestSysProcDiskStats));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestSysProcDiskStats);
+  case Key::IngestSysProcPressure:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "SysProcPressure");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestSysProcPressure));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestSysProcPressure);
+  case Key::IngestSysProcBuddyInfo:
+    if (hasConfigFile()) {
+      const optional<string> prop =
+          m_configFile->getPropertyValue("ingest", -1, "SysProcBuddyInfo");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestSysProcBuddyInfo));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestSysProcBuddyInfo);
+  case Key::IngestSysProcWireless:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "SysProcWireless");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestSysProcWireless));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestSysProcWireless);
+  case Key::IngestSysProcVMStat:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "SysProcVMStat");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestSysProcVMStat));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestSysProcVMStat);
+  case Key::IngestProcAcct:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "ProcAcct");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestProcAcct));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestProcAcct);
+  case Key::IngestProcInfo:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "ProcInfo");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestProcInfo));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestProcInfo);
+  case Key::IngestProcEvent:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "ProcEvent");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestProcEvent));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestProcEvent);
+  case Key::IngestContextInfo:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("ingest", -1, "ContextInfo");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::IngestContextInfo));
+    }
+    return tkmDefaults.getFor(Defaults::Default::IngestContextInfo);
+  case Key::RetentionEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("retention", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RetentionEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RetentionEnabled);
+  case Key::RetentionInterval:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("retention", -1, "Interval");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RetentionInterval));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RetentionInterval);
+  case Key::RetentionBatchRows:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("retention", -1, "BatchRows");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RetentionBatchRows));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RetentionBatchRows);
+  case Key::RetentionMaxAge:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("retention", -1, "MaxAge");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RetentionMaxAge));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RetentionMaxAge);
+  case Key::RetentionMaxRows:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("retention", -1, "MaxRows");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RetentionMaxRows));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RetentionMaxRows);
+  case Key::RetentionMaxBytes:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("retention", -1, "MaxBytes");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RetentionMaxBytes));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RetentionMaxBytes);
+  case Key::RetentionDeviceMaxSessions:
+    if (hasConfigFile()) {
+      const optional<string> prop =
+          m_configFile->getPropertyValue("retention", -1, "DeviceMaxSessions");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::RetentionDeviceMaxSessions));
+    }
+    return tkmDefaults.getFor(Defaults::Default::RetentionDeviceMaxSessions);
+  case Key::BulkConcurrency:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("bulk", -1, "Concurrency");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::BulkConcurrency));
+    }
+    return tkmDefaults.getFor(Defaults::Default::BulkConcurrency);
+  case Key::BulkConnectTimeout:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("bulk", -1, "ConnectTimeout");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::BulkConnectTimeout));
+    }
+    return tkmDefaults.getFor(Defaults::Default::BulkConnectTimeout);
+  case Key::LiveQueueSize:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("live", -1, "QueueSize");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::LiveQueueSize));
+    }
+    return tkmDefaults.getFor(Defaults::Default::LiveQueueSize);
+  case Key::SegmentLogDirectory:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("segmentlog", -1, "Directory");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SegmentLogDirectory));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SegmentLogDirectory);
+  case Key::SegmentLogSegmentSize:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("segmentlog", -1, "SegmentSize");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SegmentLogSegmentSize));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SegmentLogSegmentSize);
+  case Key::SegmentLogSyncInterval:
+    if (hasConfigFile()) {
+      const optional<string> prop =
+          m_configFile->getPropertyValue("segmentlog", -1, "SyncInterval");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SegmentLogSyncInterval));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SegmentLogSyncInterval);
+  case Key::SegmentLogIndexStride:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("segmentlog", -1, "IndexStride");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SegmentLogIndexStride));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SegmentLogIndexStride);
+  case Key::SpoolEnabled:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("spool", -1, "Enabled");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SpoolEnabled));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SpoolEnabled);
+  case Key::SpoolPath:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("spool", -1, "Path");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SpoolPath));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SpoolPath);
+  case Key::SpoolMaxSize:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("spool", -1, "MaxSize");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SpoolMaxSize));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SpoolMaxSize);
+  case Key::SpoolInterval:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("spool", -1, "Interval");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SpoolInterval));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SpoolInterval);
+  case Key::SpoolReplayBatch:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("spool", -1, "ReplayBatch");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SpoolReplayBatch));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SpoolReplayBatch);
+  case Key::SpoolQueueLimit:
+    if (hasConfigFile()) {
+      const optional<string> prop = m_configFile->getPropertyValue("spool", -1, "QueueLimit");
+      return prop.value_or(tkmDefaults.getFor(Defaults::Default::SpoolQueueLimit));
+    }
+    return tkmDefaults.getFor(Defaults::Default::SpoolQueueLimit);
   default:
     logError() << "Unknown option key";
     break;
@@ -86,4 +410,30 @@ auto Options::getFor(Key key) -> string
   throw std::runtime_error("Cannot provide option for key");
 }
 
+auto Options::getFor(Key key, const string &deviceName) -> string
+{
+  optional<string> prop;
+
+  if (hasConfigFile()) {
+    switch (key) {
+    case Key::TopNEnabled:
+      prop = m_configFile->getPropertyValue("topn." + deviceName, -1, "Enabled");
+      break;
+    case Key::TopNCount:
+      prop = m_configFile->getPropertyValue("topn." + deviceName, -1, "Count");
+      break;
+    case Key::TopNOrder:
+      prop = m_configFile->getPropertyValue("topn." + deviceName, -1, "Order");
+      break;
+    case Key::TopNAllow:
+      prop = m_configFile->getPropertyValue("topn." + deviceName, -1, "Allow");
+      break;
+    default:
+      break;
+    }
+  }
+
+  return prop.value_or(getFor(key));
+}
+
 } // namespace tkm
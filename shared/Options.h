@@ -33,12 +33,67 @@ public:
     DBServerAddress,
     DBServerPort,
     DBFilePath,
+    DBListChunkSize,
+    DBExportChunkSize,
+    DBPartitioning,
+    DBSharding,
+    DBLayout,
+    DBPackedArrays,
+    CaptureEnabled,
+    CaptureDirectory,
+    SelfMonitorEnabled,
+    SelfMonitorInterval,
+    ArchiveEnabled,
+    ArchiveDirectory,
+    ArchiveBlockRows,
+    RollupEnabled,
+    DedupEnabled,
+    DedupEpsilon,
+    DedupKeyframeInterval,
+    TopNEnabled,
+    TopNCount,
+    TopNOrder,
+    TopNAllow,
+    IngestDisabled,
+    IngestSysProcStat,
+    IngestSysProcMemInfo,
+    IngestSysProcDiskStats,
+    IngestSysProcPressure,
+    IngestSysProcBuddyInfo,
+    IngestSysProcWireless,
+    IngestSysProcVMStat,
+    IngestProcAcct,
+    IngestProcInfo,
+    IngestProcEvent,
+    IngestContextInfo,
+    RetentionEnabled,
+    RetentionInterval,
+    RetentionBatchRows,
+    RetentionMaxAge,
+    RetentionMaxRows,
+    RetentionMaxBytes,
+    RetentionDeviceMaxSessions,
+    BulkConcurrency,
+    BulkConnectTimeout,
+    LiveQueueSize,
+    SegmentLogDirectory,
+    SegmentLogSegmentSize,
+    SegmentLogSyncInterval,
+    SegmentLogIndexStride,
+    SpoolEnabled,
+    SpoolPath,
+    SpoolMaxSize,
+    SpoolInterval,
+    SpoolReplayBatch,
+    SpoolQueueLimit,
   };
 
 public:
   explicit Options(const std::string &configFile);
 
   auto getFor(Key key) -> std::string;
+  // Device value from the [<section>.<deviceName>] section if set
+  auto getFor(Key key, const std::string &deviceName) -> std::string;
   bool hasConfigFile() { return m_configFile != nullptr; }
   auto getConfigFile() -> std::shared_ptr<bswi::kf::KeyFile> { return m_configFile; }
 
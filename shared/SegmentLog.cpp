@@ -0,0 +1,396 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SegmentLog Class
+ * @details   Append only sample log writer and reader
+ *-
+ */
+
+#include "SegmentLog.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+// Records are written to the segment file in chunks of this size
+constexpr size_t GSegmentBufferSize = 256 * 1024;
+// Reject corrupted records instead of allocating huge buffers
+constexpr uint32_t GSegmentMaxRecordSize = 64 * 1024 * 1024;
+
+namespace tkm
+{
+
+static bool readMagic(std::ifstream &stream, const char *magic)
+{
+  char header[GSegmentMagicSize]{};
+
+  stream.read(header, GSegmentMagicSize);
+  return stream.good() && (memcmp(header, magic, GSegmentMagicSize) == 0);
+}
+
+static bool readRecord(std::ifstream &stream, SegmentRecord &record)
+{
+  stream.read(reinterpret_cast<char *>(&record), sizeof(record));
+  return stream.good() && (record.size <= GSegmentMaxRecordSize);
+}
+
+static bool loadIndex(const std::filesystem::path &segment, std::vector<SegmentIndexEntry> &index)
+{
+  std::ifstream stream(std::filesystem::path(segment).replace_extension(GSegmentIndexExtension),
+                       std::ios::binary | std::ios::in);
+
+  if (!stream.is_open() || !readMagic(stream, GSegmentIndexMagic)) {
+    return false;
+  }
+
+  SegmentIndexEntry entry{};
+  while (stream.read(reinterpret_cast<char *>(&entry), sizeof(entry))) {
+    index.push_back(entry);
+  }
+
+  return true;
+}
+
+auto getSegmentTypeName(int32_t what) -> std::string
+{
+  // Data types are named after their payload message
+  return "tkm.msg.monitor." +
+         tkm::msg::monitor::Data_What_Name(static_cast<tkm::msg::monitor::Data_What>(what));
+}
+
+SegmentWriter::SegmentWriter(const std::filesystem::path &directory,
+                             uint64_t segmentSize,
+                             uint32_t indexStride)
+: m_directory(directory)
+, m_segmentSize(segmentSize)
+, m_indexStride((indexStride > 0) ? indexStride : 1)
+{
+  std::filesystem::create_directories(m_directory);
+
+  // Never append to an existing segment, it may end with a partial record
+  for (const auto &segment : SegmentReader(m_directory).getSegments()) {
+    m_sequence = std::max<uint64_t>(m_sequence, std::stoull(segment.stem().string()));
+  }
+
+  open();
+}
+
+SegmentWriter::~SegmentWriter()
+{
+  close();
+}
+
+void SegmentWriter::open()
+{
+  std::stringstream name;
+
+  name << std::setw(16) << std::setfill('0') << ++m_sequence << GSegmentExtension;
+  m_path = m_directory / name.str();
+
+  m_fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (m_fd < 0) {
+    throw std::runtime_error("Fail to open segment file " + m_path.string());
+  }
+
+  m_buffer.assign(GSegmentMagic, GSegmentMagicSize);
+  m_offset = GSegmentMagicSize;
+  m_index.clear();
+  m_sessionRecords.clear();
+  m_segments++;
+}
+
+void SegmentWriter::close()
+{
+  if (m_fd < 0) {
+    return;
+  }
+
+  flush();
+  ::fdatasync(m_fd);
+  ::close(m_fd);
+  m_fd = -1;
+  m_dirty = false;
+
+  std::ofstream index(std::filesystem::path(m_path).replace_extension(GSegmentIndexExtension),
+                      std::ios::binary | std::ios::out | std::ios::trunc);
+  index.write(GSegmentIndexMagic, GSegmentMagicSize);
+  index.write(reinterpret_cast<const char *>(m_index.data()),
+              static_cast<std::streamsize>(m_index.size() * sizeof(SegmentIndexEntry)));
+}
+
+bool SegmentWriter::append(const SegmentRecord &record, const std::string &payload)
+{
+  if (m_offset >= m_segmentSize) {
+    close();
+    open();
+  }
+
+  auto &count = m_sessionRecords[record.session];
+  if ((count++ % m_indexStride) == 0) {
+    m_index.push_back({.session = record.session,
+                       .reserved = 0,
+                       .systemTime = record.systemTime,
+                       .offset = m_offset});
+  }
+
+  SegmentRecord header = record;
+  header.size = static_cast<uint32_t>(payload.size());
+
+  m_buffer.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  m_buffer.append(payload);
+  m_offset += sizeof(header) + payload.size();
+  m_records++;
+
+  return (m_buffer.size() < GSegmentBufferSize) || flush();
+}
+
+bool SegmentWriter::flush()
+{
+  size_t written = 0;
+
+  while (written < m_buffer.size()) {
+    const auto status = ::write(m_fd, m_buffer.data() + written, m_buffer.size() - written);
+    if (status < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    written += static_cast<size_t>(status);
+  }
+
+  m_dirty = m_dirty || (written > 0);
+  m_buffer.clear();
+
+  return true;
+}
+
+bool SegmentWriter::sync()
+{
+  if (!flush()) {
+    return false;
+  }
+  if (m_dirty) {
+    m_dirty = false;
+    return ::fdatasync(m_fd) == 0;
+  }
+
+  return true;
+}
+
+SegmentReader::SegmentReader(const std::filesystem::path &directory)
+: m_directory(directory)
+{
+}
+
+auto SegmentReader::getSegments() const -> std::vector<std::filesystem::path>
+{
+  std::vector<std::filesystem::path> segments;
+
+  if (!std::filesystem::exists(m_directory)) {
+    return segments;
+  }
+
+  for (const auto &entry : std::filesystem::directory_iterator(m_directory)) {
+    if (entry.path().extension() == GSegmentExtension) {
+      segments.push_back(entry.path());
+    }
+  }
+  // Sequence numbers are zero padded
+  std::sort(segments.begin(), segments.end());
+
+  return segments;
+}
+
+bool SegmentReader::getIndexSessions(const std::filesystem::path &segment,
+                                     std::set<uint32_t> &sessions)
+{
+  std::vector<SegmentIndexEntry> index;
+
+  if (!loadIndex(segment, index)) {
+    return false;
+  }
+  for (const auto &entry : index) {
+    sessions.insert(entry.session);
+  }
+
+  return true;
+}
+
+bool SegmentReader::read(uint32_t session,
+                         uint64_t from,
+                         uint64_t to,
+                         const Callback &callback) const
+{
+  for (const auto &segment : getSegments()) {
+    if (!readSegment(segment, session, from, to, callback)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool SegmentReader::readSegment(const std::filesystem::path &segment,
+                                uint32_t session,
+                                uint64_t from,
+                                uint64_t to,
+                                const Callback &callback) const
+{
+  std::ifstream stream(segment, std::ios::binary | std::ios::in);
+  std::vector<SegmentIndexEntry> index;
+  uint64_t start = GSegmentMagicSize;
+
+  if (!stream.is_open() || !readMagic(stream, GSegmentMagic)) {
+    return true;
+  }
+
+  // The segment being written has no index yet and is fully scanned
+  if (loadIndex(segment, index)) {
+    bool found = false;
+
+    for (const auto &entry : index) {
+      if (entry.session != session) {
+        continue;
+      }
+      if (!found || ((from > 0) && (entry.systemTime <= from))) {
+        start = entry.offset;
+      }
+      found = true;
+    }
+    if (!found) {
+      return true;
+    }
+  }
+
+  SegmentRecord record{};
+  std::string payload;
+
+  stream.seekg(static_cast<std::streamoff>(start));
+  while (readRecord(stream, record)) {
+    if ((record.session != session) || ((from > 0) && (record.systemTime < from)) ||
+        ((to > 0) && (record.systemTime > to))) {
+      stream.seekg(record.size, std::ios::cur);
+      continue;
+    }
+
+    payload.resize(record.size);
+    if (!stream.read(payload.data(), static_cast<std::streamsize>(record.size))) {
+      break;
+    }
+    if (!callback(record, payload)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+SegmentSessionReader::SegmentSessionReader(const std::filesystem::path &directory,
+                                           const std::string &sessionHash)
+: m_directory(directory)
+, m_sessionHash(sessionHash)
+{
+  m_segments = SegmentReader(m_directory).getSegments();
+  if (m_segments.empty()) {
+    throw std::runtime_error("No segment files in " + m_directory.string());
+  }
+  rewind();
+}
+
+void SegmentSessionReader::rewind()
+{
+  m_stream.close();
+  m_stream.clear();
+  m_segment = 0;
+  m_session = 0;
+  m_found = false;
+}
+
+bool SegmentSessionReader::nextRecord(SegmentRecord &record, std::string &payload)
+{
+  while (m_segment < m_segments.size()) {
+    if (!m_stream.is_open()) {
+      m_stream.clear();
+      m_stream.open(m_segments.at(m_segment), std::ios::binary | std::ios::in);
+      if (!m_stream.is_open() || !readMagic(m_stream, GSegmentMagic)) {
+        m_stream.close();
+        m_segment++;
+        continue;
+      }
+    }
+
+    if (readRecord(m_stream, record)) {
+      payload.resize(record.size);
+      if (m_stream.read(payload.data(), static_cast<std::streamsize>(record.size))) {
+        return true;
+      }
+    }
+
+    // End of segment or truncated last record
+    m_stream.close();
+    m_segment++;
+  }
+
+  return false;
+}
+
+bool SegmentSessionReader::next(tkm::msg::Envelope &envelope, uint64_t &receiveTime)
+{
+  SegmentRecord record{};
+  std::string payload;
+
+  while (nextRecord(record, payload)) {
+    tkm::msg::monitor::Message message;
+
+    if (!m_found) {
+      tkm::msg::monitor::SessionInfo sessionInfo;
+
+      if ((record.what != GSegmentSessionRecord) || !sessionInfo.ParseFromString(payload) ||
+          (sessionInfo.hash() != m_sessionHash)) {
+        continue;
+      }
+
+      m_found = true;
+      m_session = record.session;
+      message.set_type(tkm::msg::monitor::Message_Type_SetSession);
+      message.mutable_payload()->PackFrom(sessionInfo);
+    } else {
+      tkm::msg::monitor::Data data;
+
+      if ((record.session != m_session) || (record.what == GSegmentSessionRecord)) {
+        continue;
+      }
+
+      data.set_what(static_cast<tkm::msg::monitor::Data_What>(record.what));
+      data.set_system_time_sec(record.systemTime);
+      data.set_monotonic_time_sec(record.monotonicTime);
+      data.set_receive_time_sec(record.receiveTime);
+      data.mutable_payload()->set_type_url("type.googleapis.com/" +
+                                           getSegmentTypeName(record.what));
+      data.mutable_payload()->set_value(payload);
+
+      message.set_type(tkm::msg::monitor::Message_Type_Data);
+      message.mutable_payload()->PackFrom(data);
+    }
+
+    envelope.mutable_mesg()->PackFrom(message);
+    envelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+    envelope.set_origin(tkm::msg::Envelope_Recipient_Monitor);
+    receiveTime = record.receiveTime * 1000000;
+
+    return true;
+  }
+
+  return false;
+}
+
+} // namespace tkm
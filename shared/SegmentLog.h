@@ -0,0 +1,171 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SegmentLog Class
+ * @details   Append only sample log writer and reader
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <taskmonitor/taskmonitor.h>
+
+#include "Capture.h"
+
+namespace tkm
+{
+
+// Segment file layout (host byte order):
+//   header: 8 bytes magic "TKMSEG01"
+//   record: SegmentRecord followed by size bytes payload
+//
+// The payload is the serialized sample message as received from the device
+// (tkm.msg.monitor.Data payload value), it is never decoded on ingest. Records
+// with what GSegmentSessionRecord hold the serialized SessionInfo written when
+// the session starts so a segment log can be replayed without its sidecar.
+// Segments are named <sequence>.tkmseg and a new one is started once the
+// current one is larger than the segment size.
+//
+// Index file layout, written when a segment is closed:
+//   header: 8 bytes magic "TKMIDX01"
+//   entry : SegmentIndexEntry
+// The first record of every session in the segment and then one record out
+// of IndexStride records of the session are indexed, so readers skip the
+// segments without the session and seek close to the requested time.
+constexpr const char *GSegmentMagic = "TKMSEG01";
+constexpr const char *GSegmentIndexMagic = "TKMIDX01";
+constexpr size_t GSegmentMagicSize = 8;
+constexpr const char *GSegmentExtension = ".tkmseg";
+constexpr const char *GSegmentIndexExtension = ".tkmidx";
+constexpr int32_t GSegmentSessionRecord = -1;
+
+struct SegmentRecord {
+  uint32_t size = 0;
+  uint32_t session = 0;
+  int32_t what = 0;
+  uint32_t reserved = 0;
+  uint64_t systemTime = 0;
+  uint64_t monotonicTime = 0;
+  uint64_t receiveTime = 0;
+};
+
+struct SegmentIndexEntry {
+  uint32_t session = 0;
+  uint32_t reserved = 0;
+  uint64_t systemTime = 0;
+  uint64_t offset = 0;
+};
+
+// Full protobuf name of the payload message for a data type
+auto getSegmentTypeName(int32_t what) -> std::string;
+
+class SegmentWriter
+{
+public:
+  SegmentWriter(const std::filesystem::path &directory, uint64_t segmentSize, uint32_t indexStride);
+  ~SegmentWriter();
+
+  // Records are buffered, written by flush and made durable by sync
+  bool append(const SegmentRecord &record, const std::string &payload);
+  bool flush();
+  bool sync();
+
+  [[nodiscard]] auto getSegmentCount() const -> uint64_t { return m_segments; }
+  [[nodiscard]] auto getRecordCount() const -> uint64_t { return m_records; }
+
+public:
+  SegmentWriter(SegmentWriter const &) = delete;
+  void operator=(SegmentWriter const &) = delete;
+
+private:
+  void open();
+  void close();
+
+private:
+  std::filesystem::path m_directory{};
+  std::filesystem::path m_path{};
+  std::string m_buffer{};
+  std::vector<SegmentIndexEntry> m_index{};
+  std::map<uint32_t, uint32_t> m_sessionRecords{};
+  uint64_t m_segmentSize = 0;
+  uint64_t m_offset = 0;
+  uint64_t m_sequence = 0;
+  uint64_t m_segments = 0;
+  uint64_t m_records = 0;
+  uint32_t m_indexStride = 0;
+  bool m_dirty = false;
+  int m_fd = -1;
+};
+
+class SegmentReader
+{
+public:
+  typedef std::function<bool(const SegmentRecord &, const std::string &)> Callback;
+
+public:
+  explicit SegmentReader(const std::filesystem::path &directory);
+
+  // Segment files in write order
+  auto getSegments() const -> std::vector<std::filesystem::path>;
+  // Sessions with records in a closed segment, false if the segment has no index
+  static bool getIndexSessions(const std::filesystem::path &segment, std::set<uint32_t> &sessions);
+
+  // Records of session with system time in [from, to], to zero for no upper bound.
+  // Reading stops when the callback returns false.
+  bool read(uint32_t session, uint64_t from, uint64_t to, const Callback &callback) const;
+
+public:
+  SegmentReader(SegmentReader const &) = delete;
+  void operator=(SegmentReader const &) = delete;
+
+private:
+  bool readSegment(const std::filesystem::path &segment,
+                   uint32_t session,
+                   uint64_t from,
+                   uint64_t to,
+                   const Callback &callback) const;
+
+private:
+  std::filesystem::path m_directory{};
+};
+
+// Envelopes of one logged session, the SetSession message first then one
+// Data message per record, as a device would have sent them
+class SegmentSessionReader : public EnvelopeSource
+{
+public:
+  SegmentSessionReader(const std::filesystem::path &directory, const std::string &sessionHash);
+
+  bool next(tkm::msg::Envelope &envelope, uint64_t &receiveTime) final;
+  void rewind() final;
+
+public:
+  SegmentSessionReader(SegmentSessionReader const &) = delete;
+  void operator=(SegmentSessionReader const &) = delete;
+
+private:
+  bool nextRecord(SegmentRecord &record, std::string &payload);
+
+private:
+  std::filesystem::path m_directory{};
+  std::string m_sessionHash{};
+  std::vector<std::filesystem::path> m_segments{};
+  std::ifstream m_stream;
+  size_t m_segment = 0;
+  uint32_t m_session = 0;
+  bool m_found = false;
+};
+
+} // namespace tkm
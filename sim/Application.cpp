@@ -0,0 +1,48 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Application Class
+ * @details   Main simulator application
+ *-
+ */
+
+#include <stdexcept>
+
+#include "Application.h"
+
+namespace tkm::sim
+{
+
+Application *Application::appInstance = nullptr;
+
+Application::Application(const std::string &name,
+                         const std::string &description,
+                         const std::string &address,
+                         uint16_t basePort,
+                         uint32_t deviceCount,
+                         const Generator::Settings &settings,
+                         const Replay::Settings &replay)
+: bswi::app::IApplication(name, description)
+{
+  if (Application::appInstance != nullptr) {
+    throw bswi::except::SingleInstance();
+  }
+  appInstance = this;
+
+  // Each simulated device listens on its own port
+  for (uint32_t i = 0; i < deviceCount; i++) {
+    auto server = std::make_shared<Server>(
+        address, static_cast<uint16_t>(basePort + i), settings, replay);
+    server->enableEvents();
+    server->start();
+    m_servers.push_back(server);
+  }
+
+  logInfo() << "Simulating " << deviceCount << " devices on " << address << ":" << basePort << "-"
+            << (basePort + deviceCount - 1);
+}
+
+} // namespace tkm::sim
@@ -0,0 +1,64 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Application Class
+ * @details   Main simulator application
+ *-
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Generator.h"
+#include "Server.h"
+
+#include "../bswinfra/source/EventLoop.h"
+#include "../bswinfra/source/Exceptions.h"
+#include "../bswinfra/source/IApplication.h"
+
+using namespace bswi::log;
+using namespace bswi::event;
+
+namespace tkm::sim
+{
+
+class Application : public bswi::app::IApplication
+{
+public:
+  explicit Application(const std::string &name,
+                       const std::string &description,
+                       const std::string &address,
+                       uint16_t basePort,
+                       uint32_t deviceCount,
+                       const Generator::Settings &settings,
+                       const Replay::Settings &replay);
+
+  static Application *getInstance() { return appInstance; }
+
+  void stop() final
+  {
+    if (m_running) {
+      m_mainEventLoop->stop();
+    }
+  }
+
+public:
+  Application(Application const &) = delete;
+  void operator=(Application const &) = delete;
+
+private:
+  std::vector<std::shared_ptr<Server>> m_servers{};
+
+private:
+  static Application *appInstance;
+};
+
+} // namespace tkm::sim
+
+#define SimApp() tkm::sim::Application::getInstance()
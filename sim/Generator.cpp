@@ -0,0 +1,239 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Generator Class
+ * @details   Build synthetic monitor data payloads
+ *-
+ */
+
+#include <ctime>
+
+#include "Generator.h"
+
+namespace tkm::sim
+{
+
+void Generator::fillSessionInfo(tkm::msg::monitor::SessionInfo &sessionInfo)
+{
+  sessionInfo.set_core_count(m_settings.coreCount);
+  sessionInfo.set_fast_lane_interval(m_settings.fastLaneInterval);
+  sessionInfo.set_pace_lane_interval(m_settings.paceLaneInterval);
+  sessionInfo.set_slow_lane_interval(m_settings.slowLaneInterval);
+
+  sessionInfo.add_fast_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_ProcInfo);
+  sessionInfo.add_fast_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_SysProcStat);
+  sessionInfo.add_fast_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_SysProcPressure);
+
+  sessionInfo.add_pace_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_ProcAcct);
+  sessionInfo.add_pace_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_ContextInfo);
+  sessionInfo.add_pace_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_SysProcMemInfo);
+  sessionInfo.add_pace_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_ProcEvent);
+
+  sessionInfo.add_slow_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_SysProcDiskStats);
+  sessionInfo.add_slow_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_SysProcBuddyInfo);
+  sessionInfo.add_slow_lane_sources(tkm::msg::monitor::SessionInfo_DataSource_SysProcWireless);
+}
+
+auto Generator::makeName(const std::string &prefix, uint32_t index) -> std::string
+{
+  std::string name = prefix + std::to_string(index);
+
+  // Pad names to the configured size to control the payload size
+  if (name.size() < m_settings.nameSize) {
+    name.append(m_settings.nameSize - name.size(), 'x');
+  }
+
+  return name;
+}
+
+bool Generator::fillData(tkm::msg::collector::Request_Type type, tkm::msg::monitor::Data &data)
+{
+  struct timespec monotonicTime;
+
+  clock_gettime(CLOCK_MONOTONIC, &monotonicTime);
+  data.set_system_time_sec(static_cast<uint64_t>(time(NULL)));
+  data.set_monotonic_time_sec(static_cast<uint64_t>(monotonicTime.tv_sec));
+
+  m_tick++;
+
+  switch (type) {
+  case tkm::msg::collector::Request_Type_GetProcInfo: {
+    tkm::msg::monitor::ProcInfo procInfo;
+
+    for (uint32_t i = 0; i < m_settings.procCount; i++) {
+      auto entry = procInfo.add_entry();
+      entry->set_comm(makeName("proc", i));
+      entry->set_pid(1000 + i);
+      entry->set_ppid(1);
+      entry->set_ctx_id(i % m_settings.contextCount);
+      entry->set_ctx_name(makeName("ctx", i % m_settings.contextCount));
+      entry->set_cpu_time(m_tick * (i % 7));
+      entry->set_cpu_percent((m_tick + i) % 100);
+      entry->set_mem_rss(4096 + (i * 64));
+      entry->set_mem_pss(2048 + (i * 32));
+      entry->set_fd_count(8 + (i % 32));
+    }
+
+    data.set_what(tkm::msg::monitor::Data_What_ProcInfo);
+    data.mutable_payload()->PackFrom(procInfo);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetProcAcct: {
+    tkm::msg::monitor::ProcAcct procAcct;
+
+    // A real monitor sends one ProcAcct message per process
+    procAcct.set_ac_comm(makeName("proc", static_cast<uint32_t>(m_tick % m_settings.procCount)));
+    procAcct.set_ac_pid(1000 + static_cast<uint32_t>(m_tick % m_settings.procCount));
+    procAcct.set_ac_ppid(1);
+    procAcct.set_ac_uid(0);
+    procAcct.set_ac_gid(0);
+    procAcct.set_ac_utime(m_tick * 10);
+    procAcct.set_ac_stime(m_tick * 5);
+    procAcct.mutable_cpu()->set_cpu_count(m_tick);
+    procAcct.mutable_cpu()->set_cpu_run_real_total(m_tick * 1000);
+    procAcct.mutable_cpu()->set_cpu_run_virtual_total(m_tick * 1000);
+    procAcct.mutable_io()->set_read_bytes(m_tick * 4096);
+    procAcct.mutable_io()->set_write_bytes(m_tick * 2048);
+    procAcct.mutable_mem()->set_hiwater_rss(8192);
+    procAcct.mutable_mem()->set_hiwater_vm(65536);
+    procAcct.mutable_ctx()->set_nvcsw(m_tick);
+    procAcct.mutable_ctx()->set_nivcsw(m_tick / 2);
+
+    data.set_what(tkm::msg::monitor::Data_What_ProcAcct);
+    data.mutable_payload()->PackFrom(procAcct);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetContextInfo: {
+    tkm::msg::monitor::ContextInfo ctxInfo;
+
+    for (uint32_t i = 0; i < m_settings.contextCount; i++) {
+      auto entry = ctxInfo.add_entry();
+      entry->set_ctx_id(i);
+      entry->set_ctx_name(makeName("ctx", i));
+      entry->set_total_cpu_time(m_tick * m_settings.procCount);
+      entry->set_total_cpu_percent((m_tick + i) % 100);
+      entry->set_total_mem_rss(4096 * m_settings.procCount);
+      entry->set_total_mem_pss(2048 * m_settings.procCount);
+      entry->set_total_fd_count(8 * m_settings.procCount);
+    }
+
+    data.set_what(tkm::msg::monitor::Data_What_ContextInfo);
+    data.mutable_payload()->PackFrom(ctxInfo);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetProcEventStats: {
+    tkm::msg::monitor::ProcEvent procEvent;
+
+    procEvent.set_fork_count(m_tick);
+    procEvent.set_exec_count(m_tick);
+    procEvent.set_exit_count(m_tick);
+    procEvent.set_uid_count(0);
+    procEvent.set_gid_count(0);
+
+    data.set_what(tkm::msg::monitor::Data_What_ProcEvent);
+    data.mutable_payload()->PackFrom(procEvent);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetSysProcStat: {
+    tkm::msg::monitor::SysProcStat sysProcStat;
+
+    sysProcStat.mutable_cpu()->set_name("cpu");
+    sysProcStat.mutable_cpu()->set_all(m_tick % 100);
+    sysProcStat.mutable_cpu()->set_usr(m_tick % 60);
+    sysProcStat.mutable_cpu()->set_sys(m_tick % 30);
+    sysProcStat.mutable_cpu()->set_iow(m_tick % 10);
+
+    for (uint32_t i = 0; i < m_settings.coreCount; i++) {
+      auto core = sysProcStat.add_core();
+      core->set_name("cpu" + std::to_string(i));
+      core->set_all((m_tick + i) % 100);
+      core->set_usr((m_tick + i) % 60);
+      core->set_sys((m_tick + i) % 30);
+      core->set_iow((m_tick + i) % 10);
+    }
+
+    data.set_what(tkm::msg::monitor::Data_What_SysProcStat);
+    data.mutable_payload()->PackFrom(sysProcStat);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetSysProcMemInfo: {
+    tkm::msg::monitor::SysProcMemInfo sysProcMem;
+
+    sysProcMem.set_mem_total(4194304);
+    sysProcMem.set_mem_free(1048576 + (m_tick % 1024));
+    sysProcMem.set_mem_available(2097152 + (m_tick % 1024));
+    sysProcMem.set_mem_cached(524288);
+    sysProcMem.set_mem_percent(50);
+    sysProcMem.set_swap_total(1048576);
+    sysProcMem.set_swap_free(1048576);
+    sysProcMem.set_swap_percent(100);
+
+    data.set_what(tkm::msg::monitor::Data_What_SysProcMemInfo);
+    data.mutable_payload()->PackFrom(sysProcMem);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetSysProcPressure: {
+    tkm::msg::monitor::SysProcPressure sysProcPressure;
+
+    sysProcPressure.mutable_cpu_some()->set_avg10(static_cast<float>(m_tick % 100) / 10);
+    sysProcPressure.mutable_cpu_some()->set_total(m_tick * 100);
+    sysProcPressure.mutable_mem_some()->set_avg10(static_cast<float>(m_tick % 50) / 10);
+    sysProcPressure.mutable_mem_some()->set_total(m_tick * 50);
+    sysProcPressure.mutable_io_some()->set_avg10(static_cast<float>(m_tick % 20) / 10);
+    sysProcPressure.mutable_io_some()->set_total(m_tick * 20);
+
+    data.set_what(tkm::msg::monitor::Data_What_SysProcPressure);
+    data.mutable_payload()->PackFrom(sysProcPressure);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetSysProcDiskStats: {
+    tkm::msg::monitor::SysProcDiskStats sysDiskStats;
+
+    auto disk = sysDiskStats.add_disk();
+    disk->set_name("sda");
+    disk->set_node_major(8);
+    disk->set_node_minor(0);
+    disk->set_reads_completed(m_tick * 10);
+    disk->set_writes_completed(m_tick * 5);
+    disk->set_io_spent_ms(m_tick);
+
+    data.set_what(tkm::msg::monitor::Data_What_SysProcDiskStats);
+    data.mutable_payload()->PackFrom(sysDiskStats);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetSysProcBuddyInfo: {
+    tkm::msg::monitor::SysProcBuddyInfo sysProcBuddyInfo;
+
+    auto node = sysProcBuddyInfo.add_node();
+    node->set_name("Node 0");
+    node->set_zone("Normal");
+    node->set_data("1 2 4 8 16 32 64 128 256 512 1024");
+
+    data.set_what(tkm::msg::monitor::Data_What_SysProcBuddyInfo);
+    data.mutable_payload()->PackFrom(sysProcBuddyInfo);
+    break;
+  }
+  case tkm::msg::collector::Request_Type_GetSysProcWireless: {
+    tkm::msg::monitor::SysProcWireless sysProcWireless;
+
+    auto ifw = sysProcWireless.add_ifw();
+    ifw->set_name("wlan0");
+    ifw->set_quality_link(70);
+    ifw->set_quality_level(-40);
+    ifw->set_quality_noise(-90);
+
+    data.set_what(tkm::msg::monitor::Data_What_SysProcWireless);
+    data.mutable_payload()->PackFrom(sysProcWireless);
+    break;
+  }
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace tkm::sim
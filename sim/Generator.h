@@ -0,0 +1,55 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Generator Class
+ * @details   Build synthetic monitor data payloads
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <taskmonitor/taskmonitor.h>
+
+namespace tkm::sim
+{
+
+class Generator
+{
+public:
+  typedef struct Settings {
+    uint32_t procCount;
+    uint32_t contextCount;
+    uint32_t coreCount;
+    uint32_t nameSize;
+    uint64_t fastLaneInterval;
+    uint64_t paceLaneInterval;
+    uint64_t slowLaneInterval;
+  } Settings;
+
+public:
+  explicit Generator(const Settings &settings)
+  : m_settings(settings)
+  {
+  }
+
+  void fillSessionInfo(tkm::msg::monitor::SessionInfo &sessionInfo);
+  bool fillData(tkm::msg::collector::Request_Type type, tkm::msg::monitor::Data &data);
+
+public:
+  Generator(Generator const &) = delete;
+  void operator=(Generator const &) = delete;
+
+private:
+  auto makeName(const std::string &prefix, uint32_t index) -> std::string;
+
+private:
+  Settings m_settings{};
+  uint64_t m_tick = 0;
+};
+
+} // namespace tkm::sim
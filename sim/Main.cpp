@@ -0,0 +1,188 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Main function
+ * @details   Simulator main function
+ *-
+ */
+
+#include "Application.h"
+#include "Defaults.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+
+#include <taskmonitor/Helpers.h>
+
+static void terminate(int signum)
+{
+  static_cast<void>(signum); // UNUSED
+  exit(EXIT_SUCCESS);
+}
+
+auto main(int argc, char **argv) -> int
+{
+  const char *address = "127.0.0.1";
+  unsigned long base_port = 3357;
+  unsigned long device_count = 1;
+  tkm::sim::Generator::Settings settings{.procCount = 100,
+                                         .contextCount = 4,
+                                         .coreCount = 4,
+                                         .nameSize = 16,
+                                         .fastLaneInterval = 1000000,
+                                         .paceLaneInterval = 5000000,
+                                         .slowLaneInterval = 10000000};
+  tkm::sim::Replay::Settings replay{.path = "", .speed = 1, .session = ""};
+
+  bool help = false;
+  int long_index = 0;
+  int c;
+
+  struct option longopts[] = {{"help", no_argument, nullptr, 'h'},
+                              {"address", required_argument, nullptr, 'a'},
+                              {"port", required_argument, nullptr, 'p'},
+                              {"devices", required_argument, nullptr, 'n'},
+                              {"procs", required_argument, nullptr, 'c'},
+                              {"contexts", required_argument, nullptr, 'x'},
+                              {"cores", required_argument, nullptr, 'k'},
+                              {"nameSize", required_argument, nullptr, 's'},
+                              {"fastLane", required_argument, nullptr, 'F'},
+                              {"paceLane", required_argument, nullptr, 'P'},
+                              {"slowLane", required_argument, nullptr, 'S'},
+                              {"replay", required_argument, nullptr, 'r'},
+                              {"speed", required_argument, nullptr, 'X'},
+                              {"session", required_argument, nullptr, 'R'},
+                              {nullptr, 0, nullptr, 0}};
+
+  try {
+    while ((c = getopt_long(argc, argv, "ha:p:n:c:x:k:s:F:P:S:r:X:R:", longopts, &long_index)) !=
+           -1) {
+      switch (c) {
+      case 'a':
+        address = optarg;
+        break;
+      case 'p':
+        base_port = std::stoul(optarg);
+        break;
+      case 'n':
+        device_count = std::stoul(optarg);
+        break;
+      case 'c':
+        settings.procCount = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 'x':
+        settings.contextCount = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 'k':
+        settings.coreCount = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 's':
+        settings.nameSize = static_cast<uint32_t>(std::stoul(optarg));
+        break;
+      case 'F':
+        settings.fastLaneInterval = std::stoull(optarg);
+        break;
+      case 'P':
+        settings.paceLaneInterval = std::stoull(optarg);
+        break;
+      case 'S':
+        settings.slowLaneInterval = std::stoull(optarg);
+        break;
+      case 'r':
+        replay.path = optarg;
+        break;
+      case 'X':
+        replay.speed = std::stod(optarg);
+        break;
+      case 'R':
+        replay.session = optarg;
+        break;
+      case 'h':
+      default:
+        help = true;
+        break;
+      }
+    }
+  } catch (std::exception &e) {
+    std::cout << "Invalid numeric argument" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (help) {
+    std::cout << "TaskMonitorCollector-Sim: Simulated taskmonitor devices\n"
+              << "Version: " << tkm::tkmDefaults.getFor(tkm::Defaults::Default::Version)
+              << " libtkm: " << TKMLIB_VERSION << "\n\n";
+    std::cout << "Usage: tkmsim [OPTIONS] \n\n";
+    std::cout << "  General:\n";
+    std::cout << "     --address, -a             <string>  Listen address (default 127.0.0.1)\n";
+    std::cout << "     --port, -p                <int>     First device port (default 3357)\n";
+    std::cout << "     --devices, -n             <int>     Number of devices (default 1)\n";
+    std::cout << "  Payload:\n";
+    std::cout << "     --procs, -c               <int>     Processes per device (default 100)\n";
+    std::cout << "     --contexts, -x            <int>     Contexts per device (default 4)\n";
+    std::cout << "     --cores, -k               <int>     CPU cores per device (default 4)\n";
+    std::cout << "     --nameSize, -s            <int>     Process name size (default 16)\n";
+    std::cout << "  Session:\n";
+    std::cout << "     --fastLane, -F            <usec>    Fast lane interval (default 1000000)\n";
+    std::cout << "     --paceLane, -P            <usec>    Pace lane interval (default 5000000)\n";
+    std::cout << "     --slowLane, -S            <usec>    Slow lane interval (default 10000000)\n";
+    std::cout << "  Replay:\n";
+    std::cout << "     --replay, -r              <path>    Replay a collector capture file\n";
+    std::cout << "     --speed, -X               <float>   Replay speed, 0 for max (default 1)\n";
+    std::cout << "     --session, -R             <string>  Replay session hash from segment log\n";
+    std::cout << "                                         directory given with --replay\n";
+    std::cout << "  Help:\n";
+    std::cout << "     --help, -h                          Print this help\n\n";
+
+    exit(EXIT_SUCCESS);
+  }
+
+  if ((device_count == 0) || ((base_port + device_count - 1) > UINT16_MAX)) {
+    std::cout << "Invalid device count or port range" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if ((settings.procCount == 0) || (settings.contextCount == 0)) {
+    std::cout << "Process and context count must be greater than zero" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (!replay.session.empty() && replay.path.empty()) {
+    std::cout << "Session option requires the segment log directory as replay path" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  if (replay.speed < 0) {
+    std::cout << "Replay speed cannot be negative" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  // Verify that the version of the library that we linked against is
+  // compatible with the version of the headers we compiled against.
+  GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+  signal(SIGINT, terminate);
+  signal(SIGTERM, terminate);
+  signal(SIGPIPE, SIG_IGN);
+
+  try {
+    tkm::sim::Application app{"TKM-Sim",
+                              "TaskMonitor Device Simulator",
+                              address,
+                              static_cast<uint16_t>(base_port),
+                              static_cast<uint32_t>(device_count),
+                              settings,
+                              replay};
+    app.run();
+  } catch (std::exception &e) {
+    std::cout << "Application start failed. " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Replay Class
+ * @details   Feed a captured device stream back to the collector
+ *-
+ */
+
+#include "Replay.h"
+#include "Application.h"
+#include "Helpers.h"
+
+// Timer resolution used to schedule captured envelopes
+constexpr uint64_t GReplayTickUsec = 1000;
+// Envelopes sent per tick when replaying at maximum speed
+constexpr uint32_t GReplayMaxBatch = 256;
+
+namespace tkm::sim
+{
+
+Replay::Replay(const Settings &settings, std::function<bool(const std::string &)> writer)
+: m_settings(settings)
+, m_writer(writer)
+{
+  if (m_settings.session.empty()) {
+    m_reader = std::make_unique<CaptureReader>(m_settings.path);
+  } else {
+    m_reader = std::make_unique<SegmentSessionReader>(m_settings.path, m_settings.session);
+  }
+}
+
+Replay::~Replay()
+{
+  stop();
+}
+
+bool Replay::getSessionInfo(tkm::msg::monitor::SessionInfo &sessionInfo)
+{
+  tkm::msg::Envelope envelope;
+  uint64_t receiveTime;
+  auto found = false;
+
+  m_reader->rewind();
+  while (!found && m_reader->next(envelope, receiveTime)) {
+    tkm::msg::monitor::Message msg;
+
+    envelope.mesg().UnpackTo(&msg);
+    if (msg.type() == tkm::msg::monitor::Message_Type_SetSession) {
+      msg.payload().UnpackTo(&sessionInfo);
+      found = true;
+    }
+  }
+  m_reader->rewind();
+
+  return found;
+}
+
+bool Replay::readNextData()
+{
+  uint64_t receiveTime;
+
+  while (m_reader->nextFrame(m_pending, receiveTime)) {
+    tkm::msg::Envelope envelope;
+    tkm::msg::monitor::Message msg;
+
+    // Session and status messages are generated by the replay client,
+    // undecodable envelopes are sent as captured
+    if (envelope.ParseFromString(m_pending) && envelope.mesg().UnpackTo(&msg) &&
+        (msg.type() != tkm::msg::monitor::Message_Type_Data)) {
+      continue;
+    }
+
+    m_pendingTime = receiveTime;
+    return true;
+  }
+
+  return false;
+}
+
+void Replay::start()
+{
+  stop();
+
+  m_reader->rewind();
+  m_hasPending = readNextData();
+  if (!m_hasPending) {
+    logWarn() << "No data in capture file " << m_settings.path;
+    return;
+  }
+
+  m_sent = 0;
+  m_captureStart = m_pendingTime;
+  m_replayStart = getMonotonicTime();
+
+  m_timer = std::make_shared<Timer>("ReplayTimer", [this]() { return update(); });
+  m_timer->start(GReplayTickUsec, true);
+  SimApp()->addEventSource(m_timer);
+
+  logInfo() << "Replay started from " << m_settings.path << " at speed " << m_settings.speed;
+}
+
+void Replay::stop()
+{
+  if (m_timer != nullptr) {
+    m_timer->stop();
+    SimApp()->remEventSource(m_timer);
+    m_timer.reset();
+  }
+}
+
+bool Replay::update()
+{
+  uint32_t batch = 0;
+
+  while (m_hasPending) {
+    if (m_settings.speed > 0) {
+      const auto elapsed =
+          static_cast<double>(getMonotonicTime() - m_replayStart) * m_settings.speed;
+      if (static_cast<double>(m_pendingTime - m_captureStart) > elapsed) {
+        break;
+      }
+    } else if (batch >= GReplayMaxBatch) {
+      break;
+    }
+
+    if (!m_writer(m_pending)) {
+      logError() << "Replay write failed";
+      m_hasPending = false;
+      return false;
+    }
+
+    batch++;
+    m_sent++;
+    m_hasPending = readNextData();
+  }
+
+  if (!m_hasPending) {
+    logInfo() << "Replay complete. Sent " << m_sent << " envelopes from " << m_settings.path;
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace tkm::sim
@@ -0,0 +1,68 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Replay Class
+ * @details   Feed a captured device stream back to the collector
+ *-
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <taskmonitor/taskmonitor.h>
+
+#include "Capture.h"
+#include "SegmentLog.h"
+
+#include "../bswinfra/source/Timer.h"
+
+using namespace bswi::event;
+
+namespace tkm::sim
+{
+
+class Replay
+{
+public:
+  typedef struct Settings {
+    std::string path;
+    double speed; // 1 real time, N times faster, 0 as fast as possible
+    std::string session; // Replay this session of the segment log in path
+  } Settings;
+
+public:
+  // The writer sends envelope bytes as they were captured
+  explicit Replay(const Settings &settings, std::function<bool(const std::string &)> writer);
+  ~Replay();
+
+  bool getSessionInfo(tkm::msg::monitor::SessionInfo &sessionInfo);
+  void start();
+  void stop();
+
+public:
+  Replay(Replay const &) = delete;
+  void operator=(Replay const &) = delete;
+
+private:
+  bool update();
+  bool readNextData();
+
+private:
+  Settings m_settings{};
+  std::function<bool(const std::string &)> m_writer;
+  std::unique_ptr<EnvelopeSource> m_reader = nullptr;
+  std::shared_ptr<Timer> m_timer = nullptr;
+  std::string m_pending{};
+  uint64_t m_pendingTime = 0;
+  bool m_hasPending = false;
+  uint64_t m_captureStart = 0;
+  uint64_t m_replayStart = 0;
+  uint64_t m_sent = 0;
+};
+
+} // namespace tkm::sim
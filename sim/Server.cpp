@@ -0,0 +1,124 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Server Class
+ * @details   TCP server for one simulated device
+ *-
+ */
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <unistd.h>
+
+#include "Application.h"
+#include "Server.h"
+#include "SimClient.h"
+
+namespace tkm::sim
+{
+
+Server::Server(const std::string &address,
+               uint16_t port,
+               const Generator::Settings &settings,
+               const Replay::Settings &replay)
+: Pollable("SimServer")
+, m_settings(settings)
+, m_replay(replay)
+, m_address(address)
+, m_port(port)
+{
+  if ((m_sockFd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+    throw std::runtime_error("Fail to create Server socket");
+  }
+
+  int enable = 1;
+  setsockopt(m_sockFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  lateSetup(
+      [this]() {
+        int clientFd = accept(m_sockFd, (struct sockaddr *) nullptr, nullptr);
+
+        if (clientFd < 0) {
+          logWarn() << "Fail to accept on Server socket";
+          return false;
+        }
+
+        // The collector has 3 seconds to send the descriptor or will be
+        // disconnected
+        struct timeval tv;
+        tv.tv_sec = 3;
+        tv.tv_usec = 0;
+        setsockopt(clientFd, SOL_SOCKET, SO_RCVTIMEO, (const char *) &tv, sizeof(tv));
+
+        tkm::msg::collector::Descriptor descriptor{};
+
+        if (!readCollectorDescriptor(clientFd, descriptor)) {
+          logWarn() << "Collector " << clientFd << " read descriptor failed";
+          close(clientFd);
+          return true; // this is a client issue, process next client
+        }
+
+        logInfo() << "Collector " << descriptor.id() << " connected on port " << m_port;
+        try {
+          std::shared_ptr<SimClient> client =
+              std::make_shared<SimClient>(clientFd, m_port, m_settings, m_replay);
+          client->enableEvents();
+        } catch (std::exception &e) {
+          logError() << "Fail to create client. Reason: " << e.what();
+          close(clientFd);
+        }
+
+        return true;
+      },
+      m_sockFd,
+      bswi::event::IPollable::Events::Level,
+      bswi::event::IEventSource::Priority::Normal);
+
+  // We are ready for events only after start
+  setPrepare([]() { return false; });
+}
+
+void Server::enableEvents()
+{
+  SimApp()->addEventSource(getShared());
+}
+
+Server::~Server()
+{
+  static_cast<void>(stop());
+}
+
+void Server::start()
+{
+  m_addr.sin_family = AF_INET;
+  m_addr.sin_port = htons(m_port);
+  if (inet_pton(AF_INET, m_address.c_str(), &m_addr.sin_addr) != 1) {
+    throw std::runtime_error("Invalid Server address");
+  }
+
+  if (bind(m_sockFd, (struct sockaddr *) &m_addr, sizeof(struct sockaddr_in)) != -1) {
+    // We are ready for events only after start
+    setPrepare([]() { return true; });
+    if (listen(m_sockFd, 10) == -1) {
+      logError() << "Server listening failed on port " << m_port << ". Error: " << strerror(errno);
+      throw std::runtime_error("Server listen failed");
+    }
+    logDebug() << "Simulated device listening on " << m_address << ":" << m_port;
+  } else {
+    logError() << "Server bind failed on port " << m_port << ". Error: " << strerror(errno);
+    throw std::runtime_error("Server bind failed");
+  }
+}
+
+void Server::stop()
+{
+  if (m_sockFd > 0) {
+    ::close(m_sockFd);
+    m_sockFd = -1;
+  }
+}
+
+} // namespace tkm::sim
@@ -0,0 +1,57 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Server Class
+ * @details   TCP server for one simulated device
+ *-
+ */
+
+#pragma once
+
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+
+#include "Generator.h"
+#include "Replay.h"
+
+#include "../bswinfra/source/Logger.h"
+#include "../bswinfra/source/Pollable.h"
+
+using namespace bswi::log;
+using namespace bswi::event;
+
+namespace tkm::sim
+{
+
+class Server : public Pollable, public std::enable_shared_from_this<Server>
+{
+public:
+  explicit Server(const std::string &address,
+                  uint16_t port,
+                  const Generator::Settings &settings,
+                  const Replay::Settings &replay);
+  ~Server();
+
+  auto getShared() -> std::shared_ptr<Server> { return shared_from_this(); }
+  void enableEvents();
+  void start();
+  void stop();
+
+public:
+  Server(Server const &) = delete;
+  void operator=(Server const &) = delete;
+
+private:
+  Generator::Settings m_settings{};
+  Replay::Settings m_replay{};
+  std::string m_address{};
+  struct sockaddr_in m_addr = {};
+  uint16_t m_port = 0;
+  int m_sockFd = -1;
+};
+
+} // namespace tkm::sim
@@ -0,0 +1,165 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SimClient Class
+ * @details   Simulated monitor side of a collector connection
+ *-
+ */
+
+#include <ctime>
+
+#include "Application.h"
+#include "SimClient.h"
+
+namespace tkm::sim
+{
+
+SimClient::SimClient(int clientFd,
+                     uint16_t port,
+                     const Generator::Settings &settings,
+                     const Replay::Settings &replay)
+: Pollable("SimClient")
+, m_port(port)
+, m_sockFd(clientFd)
+{
+  m_generator = std::make_unique<Generator>(settings);
+  m_reader = std::make_unique<EnvelopeReader>(m_sockFd);
+  m_writer = std::make_unique<EnvelopeWriter>(m_sockFd);
+
+  if (!replay.path.empty()) {
+    m_replay = std::make_unique<Replay>(
+        replay, [this](const std::string &frame) { return writeCaptured(frame); });
+  }
+
+  lateSetup(
+      [this]() {
+        auto status = true;
+
+        do {
+          tkm::msg::Envelope envelope;
+
+          // Read next message
+          auto readStatus = readEnvelope(envelope);
+          if (readStatus == IAsyncEnvelope::Status::Again) {
+            return true;
+          } else if (readStatus == IAsyncEnvelope::Status::Error) {
+            logDebug() << "SimClient read error";
+            return false;
+          } else if (readStatus == IAsyncEnvelope::Status::EndOfFile) {
+            logDebug() << "SimClient read end of file";
+            return false;
+          }
+
+          // Check for valid origin
+          if (envelope.origin() != tkm::msg::Envelope_Recipient_Collector) {
+            continue;
+          }
+
+          tkm::msg::collector::Request rq;
+          envelope.mesg().UnpackTo(&rq);
+
+          switch (rq.type()) {
+          case tkm::msg::collector::Request_Type_CreateSession:
+            status = sendSession();
+            break;
+          case tkm::msg::collector::Request_Type_GetProcInfo:
+          case tkm::msg::collector::Request_Type_GetProcAcct:
+          case tkm::msg::collector::Request_Type_GetContextInfo:
+          case tkm::msg::collector::Request_Type_GetProcEventStats:
+          case tkm::msg::collector::Request_Type_GetSysProcStat:
+          case tkm::msg::collector::Request_Type_GetSysProcMemInfo:
+          case tkm::msg::collector::Request_Type_GetSysProcPressure:
+          case tkm::msg::collector::Request_Type_GetSysProcDiskStats:
+          case tkm::msg::collector::Request_Type_GetSysProcBuddyInfo:
+          case tkm::msg::collector::Request_Type_GetSysProcWireless:
+            // In replay mode the captured stream drives the data flow
+            if (m_replay == nullptr) {
+              status = sendData(rq.type());
+            }
+            break;
+          default:
+            logDebug() << "SimClient ignore request: " << rq.id();
+            break;
+          }
+        } while (status);
+
+        return status;
+      },
+      m_sockFd,
+      bswi::event::IPollable::Events::Level,
+      bswi::event::IEventSource::Priority::Normal);
+
+  setFinalize([this]() { logInfo() << "Collector disconnected from port " << m_port; });
+}
+
+SimClient::~SimClient()
+{
+  m_replay.reset();
+  if (m_sockFd > 0) {
+    ::close(m_sockFd);
+    m_sockFd = -1;
+  }
+}
+
+void SimClient::enableEvents()
+{
+  SimApp()->addEventSource(getShared());
+}
+
+bool SimClient::sendSession()
+{
+  tkm::msg::Envelope envelope;
+  tkm::msg::monitor::Message message;
+  tkm::msg::monitor::SessionInfo sessionInfo;
+
+  // Replay keeps the captured lane setup but needs a new session hash
+  if ((m_replay == nullptr) || !m_replay->getSessionInfo(sessionInfo)) {
+    m_generator->fillSessionInfo(sessionInfo);
+  }
+
+  const std::string sessionId = "Sim." + std::to_string(m_port) + "." + std::to_string(time(NULL));
+  sessionInfo.set_hash(std::to_string(jnkHsh(sessionId.c_str())));
+
+  message.set_type(tkm::msg::monitor::Message_Type_SetSession);
+  message.mutable_payload()->PackFrom(sessionInfo);
+
+  envelope.mutable_mesg()->PackFrom(message);
+  envelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  envelope.set_origin(tkm::msg::Envelope_Recipient_Monitor);
+
+  logDebug() << "Session created on port " << m_port << ": " << sessionInfo.hash();
+  if (!writeEnvelope(envelope)) {
+    return false;
+  }
+
+  if (m_replay != nullptr) {
+    m_replay->start();
+  }
+
+  return true;
+}
+
+bool SimClient::sendData(tkm::msg::collector::Request_Type type)
+{
+  tkm::msg::Envelope envelope;
+  tkm::msg::monitor::Message message;
+  tkm::msg::monitor::Data data;
+
+  if (!m_generator->fillData(type, data)) {
+    return true;
+  }
+
+  message.set_type(tkm::msg::monitor::Message_Type_Data);
+  message.mutable_payload()->PackFrom(data);
+
+  envelope.mutable_mesg()->PackFrom(message);
+  envelope.set_target(tkm::msg::Envelope_Recipient_Collector);
+  envelope.set_origin(tkm::msg::Envelope_Recipient_Monitor);
+
+  return writeEnvelope(envelope);
+}
+
+} // namespace tkm::sim
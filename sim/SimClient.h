@@ -0,0 +1,76 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SimClient Class
+ * @details   Simulated monitor side of a collector connection
+ *-
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <taskmonitor/taskmonitor.h>
+#include <unistd.h>
+
+#include "Generator.h"
+#include "Replay.h"
+
+#include "../bswinfra/source/Logger.h"
+#include "../bswinfra/source/Pollable.h"
+
+using namespace bswi::log;
+using namespace bswi::event;
+
+namespace tkm::sim
+{
+
+class SimClient final : public Pollable, public std::enable_shared_from_this<SimClient>
+{
+public:
+  explicit SimClient(int clientFd,
+                     uint16_t port,
+                     const Generator::Settings &settings,
+                     const Replay::Settings &replay);
+  ~SimClient();
+
+  auto getShared() -> std::shared_ptr<SimClient> { return shared_from_this(); }
+  void enableEvents();
+
+  auto readEnvelope(tkm::msg::Envelope &envelope) -> IAsyncEnvelope::Status
+  {
+    return m_reader->next(envelope);
+  }
+
+  bool writeEnvelope(const tkm::msg::Envelope &envelope)
+  {
+    if (m_writer->send(envelope) == IAsyncEnvelope::Status::Ok) {
+      return m_writer->flush();
+    }
+    return true;
+  }
+
+  // Replayed envelope bytes, written as they were captured
+  bool writeCaptured(const std::string &frame) { return writeFrame(m_sockFd, frame); }
+
+public:
+  SimClient(SimClient const &) = delete;
+  void operator=(SimClient const &) = delete;
+
+private:
+  bool sendSession();
+  bool sendData(tkm::msg::collector::Request_Type type);
+
+private:
+  std::unique_ptr<Generator> m_generator = nullptr;
+  std::unique_ptr<Replay> m_replay = nullptr;
+  std::unique_ptr<EnvelopeReader> m_reader = nullptr;
+  std::unique_ptr<EnvelopeWriter> m_writer = nullptr;
+  uint16_t m_port = 0;
+  int m_sockFd = -1;
+};
+
+} // namespace tkm::sim
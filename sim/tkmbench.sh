@@ -0,0 +1,142 @@
+#!/bin/sh
+#
+# SPDX-License-Identifier: MIT
+#
+# TKM-Collector ingest benchmark driver
+#
+# Start tkmsim with N simulated devices, register them with a running
+# tkmcollector through tkmcontrol, collect for a fixed duration and report
+# the sustained inserted rows/s together with collector CPU and RSS usage.
+# The database is the one configured in the collector configuration file
+# (sqlite3 or pqsql) so the benchmark runs fully offline.
+
+DEVICES=10
+PORT=3357
+DURATION=60
+WARMUP=10
+PROCS=100
+CONFIG=/etc/tkmcollector.conf
+SIMARGS=""
+
+usage()
+{
+    echo "Usage: tkmbench.sh [-n devices] [-p port] [-d seconds] [-w seconds]"
+    echo "                   [-c procs] [-o config] [-s \"extra tkmsim args\"]"
+    exit 1
+}
+
+while getopts "n:p:d:w:c:o:s:h" opt; do
+    case $opt in
+        n) DEVICES=$OPTARG ;;
+        p) PORT=$OPTARG ;;
+        d) DURATION=$OPTARG ;;
+        w) WARMUP=$OPTARG ;;
+        c) PROCS=$OPTARG ;;
+        o) CONFIG=$OPTARG ;;
+        s) SIMARGS=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+
+confget()
+{
+    awk -F= -v sec="[$1]" -v key="$2" \
+        '/^\[/ { cur = $0 } cur == sec && $1 == key { print $2; exit }' "$CONFIG"
+}
+
+DBTYPE=$(confget general DatabaseType)
+DBPATH=$(confget database DatabasePath)
+DBHOST=$(confget database ServerAddress)
+DBPORT=$(confget database ServerPort)
+DBNAME=$(confget database DatabaseName)
+DBUSER=$(confget database UserName)
+DBPASS=$(confget database UserPassword)
+
+TABLES="tkmSysProcStat tkmSysProcMemInfo tkmSysProcDiskStats tkmSysProcPressure \
+        tkmSysProcBuddyInfo tkmSysProcWireless tkmProcAcct tkmProcInfo tkmProcEvent \
+        tkmContextInfo"
+
+rowcount()
+{
+    query="SELECT 0"
+    for t in $TABLES; do
+        query="$query + (SELECT COUNT(*) FROM $t)"
+    done
+
+    if [ "$DBTYPE" = "sqlite3" ]; then
+        sqlite3 "$DBPATH" "$query;"
+    else
+        PGPASSWORD=$DBPASS psql -h "$DBHOST" -p "$DBPORT" -U "$DBUSER" -d "$DBNAME" -tAc "$query;"
+    fi
+}
+
+cputicks()
+{
+    awk '{ print $14 + $15 }' "/proc/$1/stat"
+}
+
+rsskb()
+{
+    awk '/^VmRSS:/ { print $2 }' "/proc/$1/status"
+}
+
+# Map simulated ports to device hashes as reported by the collector
+devicehashes()
+{
+    tkmcontrol -o "$CONFIG" -l | awk -F'\t: ' -v first="$PORT" -v last="$((PORT + DEVICES - 1))" \
+        '$1 == "Id" { id = $2 } $1 == "Port" && $2 >= first && $2 <= last { print id }'
+}
+
+CPID=$(pidof tkmcollector)
+if [ -z "$CPID" ]; then
+    echo "tkmcollector is not running"
+    exit 1
+fi
+
+tkmsim -p "$PORT" -n "$DEVICES" -c "$PROCS" $SIMARGS &
+SIMPID=$!
+trap 'kill $SIMPID 2>/dev/null' EXIT
+sleep 1
+
+i=0
+while [ $i -lt "$DEVICES" ]; do
+    tkmcontrol -o "$CONFIG" -a -N "sim$i" -A 127.0.0.1 -P $((PORT + i)) > /dev/null
+    i=$((i + 1))
+done
+
+HASHES=$(devicehashes)
+DEVICELIST=$(echo $HASHES | tr ' ' ',')
+tkmcontrol -o "$CONFIG" -c -D "$DEVICELIST" > /dev/null
+tkmcontrol -o "$CONFIG" -s -D "$DEVICELIST" > /dev/null
+
+echo "Warming up for $WARMUP seconds with $DEVICES devices"
+sleep "$WARMUP"
+
+ROWS0=$(rowcount)
+TICKS0=$(cputicks "$CPID")
+RSSMAX=0
+
+t=0
+while [ $t -lt "$DURATION" ]; do
+    sleep 1
+    rss=$(rsskb "$CPID")
+    [ "$rss" -gt "$RSSMAX" ] && RSSMAX=$rss
+    t=$((t + 1))
+done
+
+ROWS1=$(rowcount)
+TICKS1=$(cputicks "$CPID")
+HZ=$(getconf CLK_TCK)
+
+tkmcontrol -o "$CONFIG" -x -D "$DEVICELIST" > /dev/null
+tkmcontrol -o "$CONFIG" -d -D "$DEVICELIST" > /dev/null
+for h in $HASHES; do
+    tkmcontrol -o "$CONFIG" -r -I "$h" > /dev/null
+done
+
+echo "Devices      : $DEVICES"
+echo "Duration     : $DURATION s"
+echo "Rows         : $((ROWS1 - ROWS0))"
+echo "Rows/s       : $(((ROWS1 - ROWS0) / DURATION))"
+echo "CPU          : $(((TICKS1 - TICKS0) * 100 / HZ / DURATION)) %"
+echo "RSS max      : $RSSMAX kB"
@@ -0,0 +1,122 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     AggregateStream Class
+ * @details   Send time bucket aggregates to control clients in chunks
+ *-
+ */
+
+#include "AggregateStream.h"
+#include "Application.h"
+#include "Query.h"
+
+#include <cstdlib>
+
+namespace tkm::collector
+{
+
+static auto toReal(const char *field) -> double
+{
+  return (field != nullptr) ? std::strtod(field, nullptr) : 0;
+}
+
+AggregateStream::AggregateStream(std::shared_ptr<IClient> client,
+                                 const tkm::msg::ext::AggregateFilter &filter)
+: m_client(client)
+{
+  const auto what = static_cast<tkm::msg::monitor::Data_What>(filter.what());
+
+  m_chunkSize = static_cast<uint32_t>(
+      std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::DBExportChunkSize)));
+  if (m_chunkSize == 0) {
+    m_chunkSize = 1;
+  }
+
+  if (tkmQuery.m_dataTableName.count(what) > 0) {
+    m_result.set_table(tkmQuery.m_dataTableName.at(what));
+  }
+  m_result.set_bucket_width(filter.bucket_width());
+  for (const auto &column : filter.column()) {
+    m_result.add_series()->set_column(column);
+  }
+}
+
+bool AggregateStream::addRow(const char *const *fields, size_t count)
+{
+  const auto seriesCount = static_cast<size_t>(m_result.series_size());
+
+  if (m_error) {
+    return false;
+  }
+
+  if (count < 2 + 4 * seriesCount) {
+    logWarn() << "Unexpected aggregate row size " << count;
+    return true;
+  }
+
+  m_result.add_bucket_start((fields[0] != nullptr) ? std::strtoull(fields[0], nullptr, 10) : 0);
+  m_result.add_count((fields[1] != nullptr) ? std::strtoull(fields[1], nullptr, 10) : 0);
+
+  for (size_t i = 0; i < seriesCount; i++) {
+    auto series = m_result.mutable_series(static_cast<int>(i));
+    const auto base = 2 + 4 * i;
+
+    series->add_min(toReal(fields[base]));
+    series->add_max(toReal(fields[base + 1]));
+    series->add_avg(toReal(fields[base + 2]));
+    series->add_last(toReal(fields[base + 3]));
+  }
+  m_buckets++;
+
+  if (static_cast<uint32_t>(m_result.bucket_start_size()) < m_chunkSize) {
+    return true;
+  }
+
+  return flush();
+}
+
+bool AggregateStream::flush()
+{
+  tkm::msg::Envelope envelope;
+  tkm::msg::ext::Message message;
+
+  message.set_type(tkm::msg::ext::Message_Type_AggregateData);
+  message.mutable_data()->PackFrom(m_result);
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(msg::Envelope_Recipient_Any);
+  envelope.set_origin(msg::Envelope_Recipient_Collector);
+
+  // Keep table, width and column names for the next chunk
+  m_result.clear_bucket_start();
+  m_result.clear_count();
+  for (auto &series : *m_result.mutable_series()) {
+    series.clear_min();
+    series.clear_max();
+    series.clear_avg();
+    series.clear_last();
+  }
+  m_chunks++;
+
+  if (!m_client->writeEnvelope(envelope)) {
+    logWarn() << "Fail to send aggregate chunk to client " << m_client->getFD();
+    m_error = true;
+  }
+
+  return !m_error;
+}
+
+bool AggregateStream::finish()
+{
+  // Clients expect at least one result message even if no bucket matched
+  if (!m_error && ((m_result.bucket_start_size() > 0) || (m_chunks == 0))) {
+    flush();
+  }
+
+  return !m_error;
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,57 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     AggregateStream Class
+ * @details   Send time bucket aggregates to control clients in chunks
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <taskmonitor/taskmonitor.h>
+
+#include "Extension.pb.h"
+#include "IClient.h"
+
+namespace tkm::collector
+{
+
+// Bucket rows are produced by the database (see Query::aggregateData) and
+// packed into the per column arrays of an AggregateResult. A message is
+// written every ExportChunkSize buckets.
+class AggregateStream
+{
+public:
+  AggregateStream(std::shared_ptr<IClient> client, const tkm::msg::ext::AggregateFilter &filter);
+  ~AggregateStream() = default;
+
+  // Fields: bucket start, sample count, then min, max, avg and last per column
+  bool addRow(const char *const *fields, size_t count);
+  bool finish();
+
+  [[nodiscard]] bool hasError() const { return m_error; }
+  [[nodiscard]] auto getBucketCount() const -> uint64_t { return m_buckets; }
+  [[nodiscard]] auto getChunkSize() const -> uint32_t { return m_chunkSize; }
+
+public:
+  AggregateStream(AggregateStream const &) = delete;
+  void operator=(AggregateStream const &) = delete;
+
+private:
+  bool flush();
+
+private:
+  std::shared_ptr<IClient> m_client = nullptr;
+  tkm::msg::ext::AggregateResult m_result{};
+  uint32_t m_chunkSize = 0;
+  uint64_t m_buckets = 0;
+  uint64_t m_chunks = 0;
+  bool m_error = false;
+};
+
+} // namespace tkm::collector
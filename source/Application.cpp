@@ -13,6 +13,7 @@
 #include <stdexcept>
 
 #include "Application.h"
+#include "SegmentLogDatabase.h"
 #ifdef WITH_SYSTEMD
 #include <systemd/sd-daemon.h>
 #endif
@@ -76,6 +77,19 @@ Application::Application(const std::string &name,
 #else
     static_assert(true, "SQLite3 database configured but support not enabled at build time");
 #endif
+  } else if (m_options->getFor(Options::Key::DatabaseType) == "segmentlog") {
+    try {
+      m_database = std::make_shared<SegmentLogDatabase>(m_options);
+      m_database->enableEvents();
+    } catch (std::exception &e) {
+      logError() << "Fail to open database. Reason: " << e.what();
+      std::cout << "Fail to open database. Reason: " << e.what() << std::endl;
+      Dispatcher::Request rq{.client = nullptr,
+                             .action = Dispatcher::Action::Quit,
+                             .args = std::map<Defaults::Arg, std::string>(),
+                             .bulkData = std::make_any<int>(0)};
+      m_dispatcher->pushRequest(rq);
+    }
   } else {
 #ifdef WITH_POSTGRESQL
     try {
@@ -117,6 +131,27 @@ Application::Application(const std::string &name,
     m_deviceManager->loadDevices();
     // Mark all in progress sessions as complete
     m_deviceManager->cleanSessions();
+
+    // Store collector own resource usage as a local pseudo-device
+    if (m_options->getFor(Options::Key::SelfMonitorEnabled) == "true") {
+      m_selfMonitor = std::make_shared<SelfMonitor>(
+          std::stoull(m_options->getFor(Options::Key::SelfMonitorInterval)));
+      m_selfMonitor->enableEvents();
+    }
+
+    // Remove expired sessions in the background
+    if (m_options->getFor(Options::Key::RetentionEnabled) == "true") {
+      Retention::Policy policy{
+          .maxAge = std::stoull(m_options->getFor(Options::Key::RetentionMaxAge)),
+          .maxRows = std::stoull(m_options->getFor(Options::Key::RetentionMaxRows)),
+          .maxBytes = std::stoull(m_options->getFor(Options::Key::RetentionMaxBytes)),
+          .deviceMaxSessions =
+              std::stoull(m_options->getFor(Options::Key::RetentionDeviceMaxSessions)),
+          .batchRows = std::stoull(m_options->getFor(Options::Key::RetentionBatchRows))};
+      m_retention = std::make_shared<Retention>(
+          std::stoull(m_options->getFor(Options::Key::RetentionInterval)), policy);
+      m_retention->enableEvents();
+    }
   }
 
   startWatchdog();
@@ -19,6 +19,8 @@
 #include "Dispatcher.h"
 #include "IDatabase.h"
 #include "Options.h"
+#include "Retention.h"
+#include "SelfMonitor.h"
 #include "UDSServer.h"
 
 #include "../bswinfra/source/EventLoop.h"
@@ -56,6 +58,7 @@ public:
   auto getDatabase() -> std::shared_ptr<IDatabase> { return m_database; }
   auto getOptions() -> std::shared_ptr<Options> { return m_options; }
   auto getDeviceManager() -> std::shared_ptr<DeviceManager> { return m_deviceManager; }
+  auto getRetention() -> std::shared_ptr<Retention> { return m_retention; }
 
 public:
   Application(Application const &) = delete;
@@ -70,6 +73,8 @@ private:
   std::shared_ptr<Dispatcher> m_dispatcher = nullptr;
   std::shared_ptr<IDatabase> m_database = nullptr;
   std::shared_ptr<DeviceManager> m_deviceManager = nullptr;
+  std::shared_ptr<SelfMonitor> m_selfMonitor = nullptr;
+  std::shared_ptr<Retention> m_retention = nullptr;
 
 private:
   static Application *appInstance;
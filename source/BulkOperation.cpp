@@ -0,0 +1,324 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     BulkOperation Class
+ * @details   Run one device action on a device group with bounded concurrency
+ *-
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fnmatch.h>
+#include <poll.h>
+#include <set>
+#include <vector>
+
+#include "Application.h"
+#include "BulkOperation.h"
+#include "Helpers.h"
+#include "SelfMonitor.h"
+
+namespace tkm::collector
+{
+
+BulkOperation::BulkOperation(std::shared_ptr<IClient> client,
+                             const std::string &requestId,
+                             const tkm::msg::ext::BulkFilter &filter)
+: m_client(client)
+, m_requestId(requestId)
+{
+  static uint64_t operationCount = 0;
+
+  m_id = "Bulk" + std::to_string(++operationCount);
+  m_startTime = getMonotonicTimeNs();
+  m_report.set_action(filter.action());
+
+  m_concurrency = filter.concurrency();
+  if (m_concurrency == 0) {
+    m_concurrency = std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::BulkConcurrency));
+  }
+  if (m_concurrency == 0) {
+    m_concurrency = 1;
+  }
+  m_connectTimeout =
+      std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::BulkConnectTimeout)) * 1000;
+
+  select(filter);
+}
+
+void BulkOperation::enableEvents()
+{
+  m_timer = std::make_shared<Timer>("BulkTimer", [this]() { return update(); });
+  m_timer->start(GBulkPollInterval, true);
+  CollectorApp()->addEventSource(m_timer);
+
+  logInfo() << "Bulk operation " << m_id << " started for " << m_queue.size()
+            << " devices with concurrency " << m_concurrency;
+}
+
+void BulkOperation::select(const tkm::msg::ext::BulkFilter &filter)
+{
+  auto deviceManager = CollectorApp()->getDeviceManager();
+
+  if (filter.hash_size() > 0) {
+    std::set<std::string> selected{};
+
+    for (const auto &hash : filter.hash()) {
+      if (!selected.insert(hash).second) {
+        continue;
+      }
+
+      auto device = deviceManager->getDevice(hash);
+      if (device == nullptr) {
+        addResult(hash, "", false, "No such device", m_startTime);
+        continue;
+      }
+      m_queue.push_back(device);
+    }
+    return;
+  }
+
+  // The collector self device only takes part when requested by hash
+  deviceManager->foreachDevice([this, &filter](const std::shared_ptr<MonitorDevice> &device) {
+    const auto &deviceData = device->getDeviceData();
+
+    if (deviceData.hash() == GSelfDeviceHash) {
+      return;
+    }
+    if (!filter.name_pattern().empty() &&
+        (fnmatch(filter.name_pattern().c_str(), deviceData.name().c_str(), 0) != 0)) {
+      return;
+    }
+    m_queue.push_back(device);
+  });
+}
+
+bool BulkOperation::update(void)
+{
+  pollConnects();
+
+  while ((m_inFlight.size() < m_concurrency) && !m_queue.empty()) {
+    auto device = m_queue.front();
+    m_queue.pop_front();
+    launch(device);
+  }
+
+  if (m_queue.empty() && m_inFlight.empty()) {
+    const auto id = m_id;
+
+    finish();
+    // Releases this object, the timer is removed by returning false
+    CollectorApp()->getDispatcher()->remBulkOperation(id);
+    return false;
+  }
+
+  return true;
+}
+
+void BulkOperation::launch(const std::shared_ptr<MonitorDevice> &device)
+{
+  const auto &hash = device->getDeviceData().hash();
+  auto &pending = m_inFlight[hash];
+
+  pending.device = device;
+  pending.startTime = getMonotonicTimeNs();
+
+  switch (m_report.action()) {
+  case tkm::msg::ext::BulkFilter_Action_Connect:
+    if (hash == GSelfDeviceHash) {
+      pushDeviceRequest(device, IDevice::Action::Connect);
+    } else {
+      launchConnect(pending);
+    }
+    break;
+  case tkm::msg::ext::BulkFilter_Action_Disconnect:
+    pushDeviceRequest(device, IDevice::Action::Disconnect);
+    break;
+  case tkm::msg::ext::BulkFilter_Action_StartCollecting:
+    pushDeviceRequest(device, IDevice::Action::StartCollecting);
+    break;
+  case tkm::msg::ext::BulkFilter_Action_StopCollecting:
+    pushDeviceRequest(device, IDevice::Action::StopCollecting);
+    break;
+  default:
+    complete(hash, false, "Unknown action");
+    break;
+  }
+}
+
+void BulkOperation::launchConnect(Pending &pending)
+{
+  auto device = pending.device;
+  const auto hash = device->getDeviceData().hash();
+
+  if (!device->createConnection()) {
+    complete(hash, false, "Device already connected");
+    return;
+  }
+
+  const auto status = device->getConnection()->startConnect();
+  if (status < 0) {
+    device->deleteConnection();
+    complete(hash, false, "Connection Failed");
+  } else if (status == 0) {
+    device->enableConnection();
+    pushDeviceRequest(device, IDevice::Action::SendDescriptor);
+  } else {
+    pending.connecting = true;
+  }
+}
+
+void BulkOperation::pushDeviceRequest(const std::shared_ptr<MonitorDevice> &device,
+                                      IDevice::Action action)
+{
+  IDevice::Request drq{.client = nullptr,
+                       .action = action,
+                       .args = std::map<Defaults::Arg, std::string>(),
+                       .bulkData = std::make_any<tkm::msg::control::DeviceData>(
+                           device->getDeviceData())};
+
+  drq.args.emplace(Defaults::Arg::RequestId, m_id + ":" + device->getDeviceData().hash());
+  if (!device->pushRequest(drq)) {
+    complete(device->getDeviceData().hash(), false, "Device queue full");
+  }
+}
+
+void BulkOperation::pollConnects(void)
+{
+  std::vector<struct pollfd> fds;
+  std::vector<std::string> hashes;
+
+  for (const auto &[hash, pending] : m_inFlight) {
+    if (pending.connecting) {
+      fds.push_back(
+          {.fd = pending.device->getConnection()->getFD(), .events = POLLOUT, .revents = 0});
+      hashes.push_back(hash);
+    }
+  }
+
+  if (fds.empty()) {
+    return;
+  }
+
+  if (::poll(fds.data(), fds.size(), 0) < 0) {
+    logError() << "Poll error on bulk connect: " << ::strerror(errno);
+    return;
+  }
+
+  const auto timeNow = getMonotonicTimeNs();
+  for (size_t i = 0; i < fds.size(); i++) {
+    auto &pending = m_inFlight.at(hashes[i]);
+    auto device = pending.device;
+
+    if (fds[i].revents == 0) {
+      if (timeNow - pending.startTime > m_connectTimeout) {
+        device->deleteConnection();
+        complete(hashes[i], false, "Connection timeout");
+      }
+      continue;
+    }
+
+    pending.connecting = false;
+    if (device->getConnection()->finishConnect() < 0) {
+      device->deleteConnection();
+      complete(hashes[i], false, "Connection Failed");
+      continue;
+    }
+
+    // Connected state and status are set once the descriptor is sent
+    device->enableConnection();
+    pushDeviceRequest(device, IDevice::Action::SendDescriptor);
+  }
+}
+
+void BulkOperation::complete(const std::string &hash, bool success, const std::string &reason)
+{
+  auto it = m_inFlight.find(hash);
+
+  if (it == m_inFlight.end()) {
+    logWarn() << "Bulk operation " << m_id << " has no device " << hash << " in flight";
+    return;
+  }
+
+  addResult(hash, it->second.device->getDeviceData().name(), success, reason, it->second.startTime);
+  m_inFlight.erase(it);
+}
+
+void BulkOperation::addResult(const std::string &hash,
+                              const std::string &name,
+                              bool success,
+                              const std::string &reason,
+                              uint64_t startTime)
+{
+  auto result = m_report.add_result();
+
+  result->set_hash(hash);
+  result->set_name(name);
+  result->set_success(success);
+  result->set_reason(reason);
+  result->set_duration_usec((getMonotonicTimeNs() - startTime) / 1000);
+
+  if (success) {
+    m_report.set_succeeded(m_report.succeeded() + 1);
+  } else {
+    m_report.set_failed(m_report.failed() + 1);
+  }
+}
+
+void BulkOperation::finish(void)
+{
+  tkm::msg::Envelope envelope;
+  tkm::msg::ext::Message message;
+
+  m_report.set_duration_usec((getMonotonicTimeNs() - m_startTime) / 1000);
+
+  message.set_type(tkm::msg::ext::Message_Type_BulkReport);
+  message.mutable_data()->PackFrom(m_report);
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(tkm::msg::Envelope_Recipient_Control);
+  envelope.set_origin(tkm::msg::Envelope_Recipient_Collector);
+
+  Dispatcher::Request nrq{.client = m_client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  nrq.args.emplace(Defaults::Arg::RequestId, m_requestId);
+
+  const auto total = m_report.succeeded() + m_report.failed();
+  if (m_client == nullptr || !m_client->writeEnvelope(envelope)) {
+    logWarn() << "Failed to send bulk report";
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    nrq.args.emplace(Defaults::Arg::Reason, "Failed to send bulk report");
+  } else if (m_report.failed() > 0) {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    nrq.args.emplace(Defaults::Arg::Reason,
+                     std::to_string(m_report.failed()) + " of " + std::to_string(total) +
+                         " devices failed");
+  } else {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusOkay));
+    nrq.args.emplace(Defaults::Arg::Reason, std::to_string(total) + " devices done");
+  }
+
+  logInfo() << "Bulk operation " << m_id << " done in " << m_report.duration_usec() / 1000
+            << "ms: " << m_report.succeeded() << " succeeded, " << m_report.failed() << " failed";
+
+  CollectorApp()->getDispatcher()->pushRequest(nrq);
+}
+
+auto BulkOperation::parseRequestId(const std::string &requestId, std::string &hash) -> std::string
+{
+  const auto pos = requestId.find(':');
+
+  if ((requestId.rfind("Bulk", 0) != 0) || (pos == std::string::npos)) {
+    return "";
+  }
+
+  hash = requestId.substr(pos + 1);
+  return requestId.substr(0, pos);
+}
+
+} // namespace tkm::collector
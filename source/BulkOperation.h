@@ -0,0 +1,97 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     BulkOperation Class
+ * @details   Run one device action on a device group with bounded concurrency
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <taskmonitor/taskmonitor.h>
+
+#include "Extension.pb.h"
+#include "IClient.h"
+#include "MonitorDevice.h"
+
+#include "../bswinfra/source/Timer.h"
+
+using namespace bswi::event;
+
+namespace tkm::collector
+{
+
+// Poll period in microseconds for connects in flight and finished operations
+constexpr uint64_t GBulkPollInterval = 10000;
+
+// At most Concurrency devices of the group are handled at a time, the next
+// device starts as soon as one completes. Connects are started non blocking
+// and polled together so unreachable devices time out in parallel instead of
+// one after the other. The other actions are queued to the devices as usual.
+// Device status replies carry a request id <operation id>:<device hash> and
+// are routed back to the operation by the dispatcher. The client receives a
+// single BulkReport followed by one status for the whole group.
+class BulkOperation : public std::enable_shared_from_this<BulkOperation>
+{
+public:
+  BulkOperation(std::shared_ptr<IClient> client,
+                const std::string &requestId,
+                const tkm::msg::ext::BulkFilter &filter);
+  ~BulkOperation() = default;
+
+  auto getShared() -> std::shared_ptr<BulkOperation> { return shared_from_this(); }
+  [[nodiscard]] auto getId() const -> const std::string & { return m_id; }
+
+  void enableEvents();
+  // Status reply of a device request issued by this operation
+  void complete(const std::string &hash, bool success, const std::string &reason);
+
+  // Split a device request id, returns the operation id or an empty string
+  static auto parseRequestId(const std::string &requestId, std::string &hash) -> std::string;
+
+public:
+  BulkOperation(BulkOperation const &) = delete;
+  void operator=(BulkOperation const &) = delete;
+
+private:
+  typedef struct Pending {
+    std::shared_ptr<MonitorDevice> device = nullptr;
+    uint64_t startTime = 0;
+    bool connecting = false;
+  } Pending;
+
+  bool update(void);
+  void select(const tkm::msg::ext::BulkFilter &filter);
+  void launch(const std::shared_ptr<MonitorDevice> &device);
+  void launchConnect(Pending &pending);
+  void pushDeviceRequest(const std::shared_ptr<MonitorDevice> &device, IDevice::Action action);
+  void pollConnects(void);
+  void addResult(const std::string &hash,
+                 const std::string &name,
+                 bool success,
+                 const std::string &reason,
+                 uint64_t startTime);
+  void finish(void);
+
+private:
+  std::shared_ptr<IClient> m_client = nullptr;
+  std::shared_ptr<Timer> m_timer = nullptr;
+  tkm::msg::ext::BulkReport m_report{};
+  std::deque<std::shared_ptr<MonitorDevice>> m_queue{};
+  std::map<std::string, Pending> m_inFlight{};
+  std::string m_id{};
+  std::string m_requestId{};
+  uint64_t m_concurrency = 0;
+  uint64_t m_connectTimeout = 0;
+  uint64_t m_startTime = 0;
+};
+
+} // namespace tkm::collector
@@ -0,0 +1,165 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ChangeFilter Class
+ * @details   Change only storage of ProcInfo and ContextInfo entries
+ *-
+ */
+
+#include <cmath>
+#include <functional>
+
+#include "ChangeFilter.h"
+
+namespace tkm::collector
+{
+
+auto ChangeFilter::filter(const std::string &sessionHash,
+                          const tkm::msg::monitor::ProcInfo &procInfo,
+                          uint64_t systemTime) -> const tkm::msg::monitor::ProcInfo &
+{
+  if (!m_enabled) {
+    return procInfo;
+  }
+
+  auto &table = m_sessions[sessionHash].procInfo;
+  const bool keyframe = isKeyframe(table, systemTime);
+
+  m_procInfo.clear_entry();
+  m_procInfoTombstones.clear_entry();
+  for (const auto &procEntry : procInfo.entry()) {
+    const Values next{.value = {static_cast<double>(procEntry.cpu_percent()),
+                                static_cast<double>(procEntry.mem_rss()),
+                                static_cast<double>(procEntry.mem_pss()),
+                                static_cast<double>(procEntry.fd_count())},
+                      .name = std::hash<std::string>{}(procEntry.comm()),
+                      .seen = table.sample};
+
+    if (update(table, static_cast<uint64_t>(procEntry.pid()), next) && !keyframe) {
+      m_procInfo.add_entry()->CopyFrom(procEntry);
+    }
+  }
+
+  if (keyframe) {
+    return procInfo;
+  }
+
+  for (const auto key : takeGone(table)) {
+    m_procInfoTombstones.add_entry()->set_pid(static_cast<int32_t>(key));
+  }
+
+  // Readers take the sample times from the stored rows
+  if ((m_procInfo.entry_size() == 0) && (m_procInfoTombstones.entry_size() == 0) &&
+      (procInfo.entry_size() > 0)) {
+    m_procInfo.add_entry()->CopyFrom(procInfo.entry(0));
+  }
+
+  return m_procInfo;
+}
+
+auto ChangeFilter::filter(const std::string &sessionHash,
+                          const tkm::msg::monitor::ContextInfo &ctxInfo,
+                          uint64_t systemTime) -> const tkm::msg::monitor::ContextInfo &
+{
+  if (!m_enabled) {
+    return ctxInfo;
+  }
+
+  auto &table = m_sessions[sessionHash].contextInfo;
+  const bool keyframe = isKeyframe(table, systemTime);
+
+  m_ctxInfo.clear_entry();
+  m_ctxInfoTombstones.clear_entry();
+  for (const auto &ctxEntry : ctxInfo.entry()) {
+    const Values next{.value = {static_cast<double>(ctxEntry.total_cpu_percent()),
+                                static_cast<double>(ctxEntry.total_mem_rss()),
+                                static_cast<double>(ctxEntry.total_mem_pss()),
+                                static_cast<double>(ctxEntry.total_fd_count())},
+                      .seen = table.sample};
+
+    if (update(table, static_cast<uint64_t>(ctxEntry.ctx_id()), next) && !keyframe) {
+      m_ctxInfo.add_entry()->CopyFrom(ctxEntry);
+    }
+  }
+
+  if (keyframe) {
+    return ctxInfo;
+  }
+
+  for (const auto key : takeGone(table)) {
+    m_ctxInfoTombstones.add_entry()->set_ctx_id(key);
+  }
+
+  if ((m_ctxInfo.entry_size() == 0) && (m_ctxInfoTombstones.entry_size() == 0) &&
+      (ctxInfo.entry_size() > 0)) {
+    m_ctxInfo.add_entry()->CopyFrom(ctxInfo.entry(0));
+  }
+
+  return m_ctxInfo;
+}
+
+void ChangeFilter::endSession(const std::string &sessionHash)
+{
+  m_sessions.erase(sessionHash);
+}
+
+bool ChangeFilter::isKeyframe(Table &table, uint64_t systemTime) const
+{
+  const uint64_t window = (m_keyframeInterval > 0) ? (systemTime / m_keyframeInterval) : systemTime;
+
+  table.sample++;
+  if (table.started && (window == table.window) && (m_keyframeInterval > 0)) {
+    return false;
+  }
+
+  // Processes which exited in the previous window are forgotten
+  table.entries.clear();
+  table.window = window;
+  table.started = true;
+
+  return true;
+}
+
+bool ChangeFilter::update(Table &table, uint64_t key, const Values &next) const
+{
+  auto [it, added] = table.entries.try_emplace(key, next);
+
+  if (added) {
+    return true;
+  }
+
+  auto &last = it->second;
+  last.seen = next.seen;
+  bool changed = (last.name != next.name);
+  for (size_t i = 0; (i < next.value.size()) && !changed; i++) {
+    const double limit = std::fabs(last.value[i]) * m_epsilon / 100;
+    changed = (std::fabs(next.value[i] - last.value[i]) > limit);
+  }
+
+  if (changed) {
+    last = next;
+  }
+
+  return changed;
+}
+
+auto ChangeFilter::takeGone(Table &table) const -> std::vector<uint64_t>
+{
+  std::vector<uint64_t> keys;
+
+  for (auto it = table.entries.begin(); it != table.entries.end();) {
+    if (it->second.seen != table.sample) {
+      keys.push_back(it->first);
+      it = table.entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  return keys;
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,111 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ChangeFilter Class
+ * @details   Change only storage of ProcInfo and ContextInfo entries
+ *-
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <taskmonitor/taskmonitor.h>
+#include <vector>
+
+namespace tkm::collector
+{
+
+// Entries whose tracked values did not move by more than Epsilon percent
+// since they were last written are dropped. The first sample of a session
+// in every KeyframeInterval seconds window of SystemTime is written in full,
+// so a sample is rebuilt from the latest rows of each process or context
+// written since its window start. The tracked values are the CPU percent,
+// RSS, PSS and fd count, a process whose comm changes is always written.
+// A process or context gone since the previous sample of the window gets a
+// tombstone entry holding only its key.
+class ChangeFilter
+{
+public:
+  ChangeFilter(bool enabled, double epsilon, uint64_t keyframeInterval)
+  : m_epsilon(epsilon)
+  , m_keyframeInterval(keyframeInterval)
+  , m_enabled(enabled)
+  {
+  }
+  ~ChangeFilter() = default;
+
+  // Entries to write, the sample itself on keyframes or when disabled.
+  // The returned reference is valid until the next call.
+  auto filter(const std::string &sessionHash,
+              const tkm::msg::monitor::ProcInfo &procInfo,
+              uint64_t systemTime) -> const tkm::msg::monitor::ProcInfo &;
+  auto filter(const std::string &sessionHash,
+              const tkm::msg::monitor::ContextInfo &ctxInfo,
+              uint64_t systemTime) -> const tkm::msg::monitor::ContextInfo &;
+  // Tombstones of the last filtered sample, written with a zero ReceiveTime.
+  // The returned reference is valid until the next filter call.
+  [[nodiscard]] auto getProcInfoTombstones() const -> const tkm::msg::monitor::ProcInfo &
+  {
+    return m_procInfoTombstones;
+  }
+  [[nodiscard]] auto getContextInfoTombstones() const -> const tkm::msg::monitor::ContextInfo &
+  {
+    return m_ctxInfoTombstones;
+  }
+  void endSession(const std::string &sessionHash);
+
+  [[nodiscard]] bool isEnabled() const { return m_enabled; }
+  // Zero when samples are written in full
+  [[nodiscard]] auto getKeyframeInterval() const -> uint64_t
+  {
+    return m_enabled ? m_keyframeInterval : 0;
+  }
+
+public:
+  ChangeFilter(ChangeFilter const &) = delete;
+  void operator=(ChangeFilter const &) = delete;
+
+private:
+  typedef struct Values {
+    std::array<double, 4> value{};
+    size_t name = 0;   // Hash of the process comm
+    uint64_t seen = 0; // Last sample with the entry
+  } Values;
+
+  typedef struct Table {
+    uint64_t window = 0;
+    uint64_t sample = 0;
+    bool started = false;
+    std::unordered_map<uint64_t, Values> entries{}; // Keyed by pid or context id
+  } Table;
+
+  typedef struct Session {
+    Table procInfo{};
+    Table contextInfo{};
+  } Session;
+
+  // Start a new window if the sample is past the current one
+  bool isKeyframe(Table &table, uint64_t systemTime) const;
+  // Store next and return true if the entry has to be written
+  bool update(Table &table, uint64_t key, const Values &next) const;
+  // Forget the entries missing from the last sample and return their keys
+  auto takeGone(Table &table) const -> std::vector<uint64_t>;
+
+private:
+  std::unordered_map<std::string, Session> m_sessions{};
+  tkm::msg::monitor::ProcInfo m_procInfo{};
+  tkm::msg::monitor::ContextInfo m_ctxInfo{};
+  tkm::msg::monitor::ProcInfo m_procInfoTombstones{};
+  tkm::msg::monitor::ContextInfo m_ctxInfoTombstones{};
+  double m_epsilon = 0;
+  uint64_t m_keyframeInterval = 0;
+  bool m_enabled = false;
+};
+
+} // namespace tkm::collector
@@ -11,6 +11,7 @@
 
 #include <csignal>
 #include <errno.h>
+#include <fcntl.h>
 #include <filesystem>
 #include <netdb.h>
 #include <string>
@@ -32,7 +33,11 @@ Connection::Connection(std::shared_ptr<IDevice> device)
     throw std::runtime_error("Fail to create Connection socket");
   }
 
-  m_reader = std::make_unique<EnvelopeReader>(m_sockFd);
+  if (CollectorApp()->getOptions()->getFor(Options::Key::CaptureEnabled) == "true") {
+    m_frameReader = std::make_unique<FrameReader>(m_sockFd);
+  } else {
+    m_reader = std::make_unique<EnvelopeReader>(m_sockFd);
+  }
   m_writer = std::make_unique<EnvelopeWriter>(m_sockFd);
 
   lateSetup(
@@ -44,6 +49,17 @@ Connection::Connection(std::shared_ptr<IDevice> device)
 
           // Read next message
           auto readStatus = readEnvelope(envelope);
+
+          // Keep the received bytes for replay, undecodable envelopes included
+          if ((m_capture != nullptr) && (m_frameReader != nullptr) &&
+              !m_frameReader->getFrame().empty()) {
+            if (!m_capture->write(m_frameReader->getFrame(), getMonotonicTime())) {
+              logWarn() << "Capture write failed, disable capture for device: "
+                        << m_device->getDeviceData().hash();
+              m_capture.reset();
+            }
+          }
+
           if (readStatus == IAsyncEnvelope::Status::Again) {
             return true;
           } else if (readStatus == IAsyncEnvelope::Status::Error) {
@@ -58,7 +74,14 @@ Connection::Connection(std::shared_ptr<IDevice> device)
           if (envelope.origin() != tkm::msg::Envelope_Recipient_Monitor) {
             continue;
           }
+          const auto receiveTime = getMonotonicTimeNs();
+
+          auto &stats = m_device->getStats();
+          stats.envelopesRead++;
+          stats.bytesRead += (m_frameReader != nullptr) ? m_frameReader->getFrame().size()
+                                                        : envelope.ByteSizeLong();
 
+          const auto decodeStart = getMonotonicTimeNs();
           tkm::msg::monitor::Message msg;
           envelope.mesg().UnpackTo(&msg);
 
@@ -71,6 +94,7 @@ Connection::Connection(std::shared_ptr<IDevice> device)
             tkm::msg::monitor::SessionInfo sessionInfo;
 
             msg.payload().UnpackTo(&sessionInfo);
+            stats.decodeTime += getMonotonicTimeNs() - decodeStart;
 
             const std::string sessionName =
                 "Collector." + std::to_string(getpid()) + "." + std::to_string(time(NULL));
@@ -89,10 +113,13 @@ Connection::Connection(std::shared_ptr<IDevice> device)
             tkm::msg::monitor::Data data;
 
             msg.payload().UnpackTo(&data);
+            stats.decodeTime += getMonotonicTimeNs() - decodeStart;
 
             // Set the receive timestamp
             data.set_receive_time_sec(static_cast<uint64_t>(time(NULL)));
             rq.bulkData = std::make_any<tkm::msg::monitor::Data>(data);
+            rq.args.emplace(Defaults::Arg::ReceiveTime, std::to_string(receiveTime));
+            rq.args.emplace(Defaults::Arg::EnqueueTime, std::to_string(getMonotonicTimeNs()));
 
             m_device->pushRequest(rq);
             break;
@@ -105,6 +132,7 @@ Connection::Connection(std::shared_ptr<IDevice> device)
             tkm::msg::monitor::Status s;
 
             msg.payload().UnpackTo(&s);
+            stats.decodeTime += getMonotonicTimeNs() - decodeStart;
             rq.bulkData = std::make_any<tkm::msg::monitor::Status>(s);
 
             m_device->pushRequest(rq);
@@ -151,15 +179,29 @@ void Connection::disconnect()
   }
 }
 
-auto Connection::connect() -> int
+bool Connection::resolveAddress()
 {
   std::string serverAddress = m_device->getDeviceData().address();
   struct hostent *server = gethostbyname(serverAddress.c_str());
 
+  if (server == nullptr) {
+    logError() << "Cannot resolve device address " << serverAddress;
+    return false;
+  }
+
   m_addr.sin_family = AF_INET;
   memcpy(&m_addr.sin_addr.s_addr, server->h_addr, (size_t) server->h_length);
   m_addr.sin_port = htons(static_cast<uint16_t>(m_device->getDeviceData().port()));
 
+  return true;
+}
+
+auto Connection::connect() -> int
+{
+  if (!resolveAddress()) {
+    return -1;
+  }
+
   if (::connect(m_sockFd, (struct sockaddr *) &m_addr, sizeof(struct sockaddr_in)) == -1) {
     if (errno == EINPROGRESS) {
       fd_set wfds, efds;
@@ -204,11 +246,84 @@ auto Connection::connect() -> int
     }
   }
 
+  setConnected();
+  return 0;
+}
+
+auto Connection::startConnect() -> int
+{
+  if (!resolveAddress()) {
+    return -1;
+  }
+
+  // The socket mode is restored once connected
+  m_sockFlags = fcntl(m_sockFd, F_GETFL, 0);
+  if ((m_sockFlags == -1) || (fcntl(m_sockFd, F_SETFL, m_sockFlags | O_NONBLOCK) == -1)) {
+    logError() << "Cannot set non blocking connect: " << ::strerror(errno);
+    return -1;
+  }
+
+  if (::connect(m_sockFd, (struct sockaddr *) &m_addr, sizeof(struct sockaddr_in)) == -1) {
+    if (errno == EINPROGRESS) {
+      return 1;
+    }
+    logError() << "Failed to connect to server: " << ::strerror(errno);
+    return -1;
+  }
+
+  return finishConnect();
+}
+
+auto Connection::finishConnect() -> int
+{
+  int error = 0;
+  socklen_t len = sizeof(error);
+
+  if (getsockopt(m_sockFd, SOL_SOCKET, SO_ERROR, &error, &len) < 0) {
+    logError() << "Connection failed";
+    return -1;
+  }
+  if (error != 0) {
+    logError() << "Connection failed. Socket error: " << ::strerror(error);
+    return -1;
+  }
+
+  if ((m_sockFlags != -1) && (fcntl(m_sockFd, F_SETFL, m_sockFlags) == -1)) {
+    logError() << "Cannot restore socket mode: " << ::strerror(errno);
+    return -1;
+  }
+
+  setConnected();
+  return 0;
+}
+
+void Connection::setConnected()
+{
   // We are ready to process events
   logInfo() << "Connected to server";
   setPrepare([]() { return true; });
 
-  return 0;
+  if (CollectorApp()->getOptions()->getFor(Options::Key::CaptureEnabled) == "true") {
+    openCapture();
+  }
+}
+
+void Connection::openCapture()
+{
+  std::filesystem::path capturePath(
+      CollectorApp()->getOptions()->getFor(Options::Key::CaptureDirectory));
+
+  try {
+    if (!std::filesystem::exists(capturePath)) {
+      std::filesystem::create_directories(capturePath);
+    }
+    capturePath /= m_device->getDeviceData().hash() + "." + std::to_string(time(NULL)) + ".tkmcap";
+    m_capture = std::make_unique<CaptureWriter>(capturePath.string());
+    logInfo() << "Capture device stream to " << capturePath.string();
+  } catch (std::exception &e) {
+    logWarn() << "Fail to open capture file. Reason: " << e.what();
+    m_capture.reset();
+  }
 }
 
 } // namespace tkm::collector
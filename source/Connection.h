@@ -16,6 +16,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 
+#include "Capture.h"
 #include "Helpers.h"
 #include "IDevice.h"
 #include "Options.h"
@@ -43,13 +44,16 @@ public:
 
   void enableEvents();
   auto connect() -> int;
+  // Non blocking connect, returns 1 while in progress and completed by finishConnect
+  auto startConnect() -> int;
+  auto finishConnect() -> int;
   void disconnect();
   [[nodiscard]] int getFD() const { return m_sockFd; }
   auto getShared() -> std::shared_ptr<Connection> { return shared_from_this(); }
 
   auto readEnvelope(tkm::msg::Envelope &envelope) -> IAsyncEnvelope::Status
   {
-    return m_reader->next(envelope);
+    return (m_frameReader != nullptr) ? m_frameReader->next(envelope) : m_reader->next(envelope);
   }
 
   bool writeEnvelope(const tkm::msg::Envelope &envelope)
@@ -60,12 +64,21 @@ public:
     return true;
   }
 
+private:
+  bool resolveAddress();
+  void setConnected();
+  void openCapture();
+
 private:
   std::shared_ptr<IDevice> m_device = nullptr;
+  std::unique_ptr<CaptureWriter> m_capture = nullptr;
   std::unique_ptr<EnvelopeReader> m_reader = nullptr;
+  // Replaces the reader when capture is enabled, it keeps the received bytes
+  std::unique_ptr<FrameReader> m_frameReader = nullptr;
   std::unique_ptr<EnvelopeWriter> m_writer = nullptr;
   struct sockaddr_in m_addr = {};
   int m_sockFd = -1;
+  int m_sockFlags = -1;
 };
 
 } // namespace tkm::collector
@@ -3,6 +3,7 @@
 #include "Application.h"
 #include "ControlClient.h"
 #include "Defaults.h"
+#include "Extension.pb.h"
 #include "Helpers.h"
 
 namespace tkm::collector
@@ -18,6 +19,8 @@ static bool doGetDevices(const std::shared_ptr<ControlClient> client,
                          tkm::msg::control::Request &rq);
 static bool doGetSessions(const std::shared_ptr<ControlClient> client,
                           tkm::msg::control::Request &rq);
+static bool doExtensionRequest(const std::shared_ptr<ControlClient> client,
+                               tkm::msg::ext::Request &rq);
 static bool doRemoveSession(const std::shared_ptr<ControlClient> client,
                             tkm::msg::control::Request &rq);
 static bool doAddDevice(const std::shared_ptr<ControlClient> client,
@@ -60,6 +63,14 @@ ControlClient::ControlClient(int clientFd)
             continue;
           }
 
+          // Collector extension requests
+          if (envelope.mesg().Is<tkm::msg::ext::Request>()) {
+            tkm::msg::ext::Request extRq;
+            envelope.mesg().UnpackTo(&extRq);
+            status = doExtensionRequest(getShared(), extRq);
+            continue;
+          }
+
           tkm::msg::control::Request rq;
           envelope.mesg().UnpackTo(&rq);
 
@@ -192,8 +203,95 @@ static bool doGetDevices(const std::shared_ptr<ControlClient> client,
   Dispatcher::Request nrq{.client = client,
                           .action = Dispatcher::Action::GetDevices,
                           .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<tkm::msg::ext::ListFilter>()};
+  nrq.args.emplace(Defaults::Arg::RequestId, rq.id());
+  return CollectorApp()->getDispatcher()->pushRequest(nrq);
+}
+
+static bool doExtensionRequest(const std::shared_ptr<ControlClient> client,
+                               tkm::msg::ext::Request &rq)
+{
+  Dispatcher::Request nrq{.client = client,
+                          .action = Dispatcher::Action::GetDeviceStats,
+                          .args = std::map<Defaults::Arg, std::string>(),
                           .bulkData = std::make_any<int>(0)};
   nrq.args.emplace(Defaults::Arg::RequestId, rq.id());
+
+  switch (rq.type()) {
+  case tkm::msg::ext::Request_Type_GetDeviceStats:
+    nrq.action = Dispatcher::Action::GetDeviceStats;
+    break;
+  case tkm::msg::ext::Request_Type_GetLatency:
+    nrq.action = Dispatcher::Action::GetLatency;
+    break;
+  case tkm::msg::ext::Request_Type_ListDevices:
+  case tkm::msg::ext::Request_Type_ListSessions: {
+    tkm::msg::ext::ListFilter filter;
+
+    rq.data().UnpackTo(&filter);
+    nrq.action = (rq.type() == tkm::msg::ext::Request_Type_ListDevices)
+                     ? Dispatcher::Action::GetDevices
+                     : Dispatcher::Action::GetSessions;
+    nrq.args.emplace(Defaults::Arg::Paged, tkmDefaults.valFor(Defaults::Val::True));
+    nrq.bulkData = std::make_any<tkm::msg::ext::ListFilter>(filter);
+    break;
+  }
+  case tkm::msg::ext::Request_Type_ExportSession: {
+    tkm::msg::ext::ExportFilter filter;
+
+    rq.data().UnpackTo(&filter);
+    nrq.action = Dispatcher::Action::ExportSession;
+    nrq.bulkData = std::make_any<tkm::msg::ext::ExportFilter>(filter);
+    break;
+  }
+  case tkm::msg::ext::Request_Type_ArchiveSession: {
+    tkm::msg::ext::ExportFilter filter;
+
+    rq.data().UnpackTo(&filter);
+    nrq.action = Dispatcher::Action::ArchiveSession;
+    nrq.bulkData = std::make_any<tkm::msg::ext::ExportFilter>(filter);
+    break;
+  }
+  case tkm::msg::ext::Request_Type_Aggregate: {
+    tkm::msg::ext::AggregateFilter filter;
+
+    rq.data().UnpackTo(&filter);
+    nrq.action = Dispatcher::Action::Aggregate;
+    nrq.bulkData = std::make_any<tkm::msg::ext::AggregateFilter>(filter);
+    break;
+  }
+  case tkm::msg::ext::Request_Type_BulkDevices: {
+    tkm::msg::ext::BulkFilter filter;
+
+    rq.data().UnpackTo(&filter);
+    nrq.action = Dispatcher::Action::BulkDevices;
+    nrq.bulkData = std::make_any<tkm::msg::ext::BulkFilter>(filter);
+    break;
+  }
+  case tkm::msg::ext::Request_Type_Subscribe:
+  case tkm::msg::ext::Request_Type_Unsubscribe: {
+    tkm::msg::ext::SubscribeFilter filter;
+
+    rq.data().UnpackTo(&filter);
+    nrq.action = (rq.type() == tkm::msg::ext::Request_Type_Subscribe)
+                     ? Dispatcher::Action::Subscribe
+                     : Dispatcher::Action::Unsubscribe;
+    nrq.bulkData = std::make_any<tkm::msg::ext::SubscribeFilter>(filter);
+    break;
+  }
+  case tkm::msg::ext::Request_Type_GetLatest: {
+    tkm::msg::ext::LatestFilter filter;
+
+    rq.data().UnpackTo(&filter);
+    nrq.action = Dispatcher::Action::GetLatest;
+    nrq.bulkData = std::make_any<tkm::msg::ext::LatestFilter>(filter);
+    break;
+  }
+  default:
+    logError() << "Unknown extension request type";
+    return false;
+  }
+
   return CollectorApp()->getDispatcher()->pushRequest(nrq);
 }
 
@@ -350,8 +448,11 @@ static bool doGetSessions(const std::shared_ptr<ControlClient> client,
   }
 
   tkm::msg::control::DeviceData data;
+  tkm::msg::ext::ListFilter filter;
+
   rq.data().UnpackTo(&data);
-  nrq.bulkData = std::make_any<tkm::msg::control::DeviceData>(data);
+  filter.set_device_hash(data.hash());
+  nrq.bulkData = std::make_any<tkm::msg::ext::ListFilter>(filter);
 
   return CollectorApp()->getDispatcher()->pushRequest(nrq);
 }
@@ -18,50 +18,54 @@ namespace tkm::collector
 
 bool DeviceManager::addDevice(std::shared_ptr<MonitorDevice> device)
 {
-  auto found = false;
-
-  m_devices.foreach ([this, &device, &found](const std::shared_ptr<MonitorDevice> entry) {
-    if (entry->getDeviceData().hash() == device->getDeviceData().hash()) {
-      found = true;
+  {
+    std::scoped_lock lock(m_indexLock);
+    if (!m_index.emplace(device->getDeviceData().hash(), device).second) {
+      return false;
     }
-  });
-
-  if (!found) {
-    m_devices.append(device);
-    m_devices.commit();
   }
 
-  return !found;
+  m_devices.append(device);
+  m_devices.commit();
+
+  return true;
 }
 
 bool DeviceManager::remDevice(std::shared_ptr<MonitorDevice> device)
 {
-  auto found = false;
-
-  m_devices.foreach ([this, &device, &found](const std::shared_ptr<MonitorDevice> entry) {
-    if (entry->getDeviceData().hash() == device->getDeviceData().hash()) {
-      logDebug() << "Found device to remove with hash " << entry->getDeviceData().hash();
-      entry->getConnection()->disconnect();
-      m_devices.remove(entry);
-      found = true;
+  std::shared_ptr<MonitorDevice> entry = nullptr;
+
+  {
+    std::scoped_lock lock(m_indexLock);
+    auto it = m_index.find(device->getDeviceData().hash());
+    if (it == m_index.end()) {
+      return false;
     }
-  });
+    entry = it->second;
+    m_index.erase(it);
+  }
+
+  logDebug() << "Found device to remove with hash " << entry->getDeviceData().hash();
+  entry->getConnection()->disconnect();
+  entry->clearLiveStreams();
+  m_devices.remove(entry);
   m_devices.commit();
 
-  return found;
+  return true;
 }
 
 auto DeviceManager::getDevice(const std::string &hash) -> std::shared_ptr<MonitorDevice>
 {
-  std::shared_ptr<MonitorDevice> retEntry = nullptr;
+  std::scoped_lock lock(m_indexLock);
+  auto it = m_index.find(hash);
 
-  m_devices.foreach ([&hash, &retEntry](const std::shared_ptr<MonitorDevice> entry) {
-    if (entry->getDeviceData().hash() == hash) {
-      retEntry = entry;
-    }
-  });
+  return (it != m_index.end()) ? it->second : nullptr;
+}
 
-  return retEntry;
+void DeviceManager::foreachDevice(
+    const std::function<void(const std::shared_ptr<MonitorDevice> &)> &callback)
+{
+  m_devices.foreach ([&callback](const std::shared_ptr<MonitorDevice> entry) { callback(entry); });
 }
 
 bool DeviceManager::loadDevices(void)
@@ -73,6 +77,22 @@ bool DeviceManager::loadDevices(void)
   return CollectorApp()->getDatabase()->pushRequest(dbrq);
 }
 
+bool DeviceManager::loadDevice(const tkm::msg::control::DeviceData &deviceData)
+{
+  if (getDevice(deviceData.hash()) != nullptr) {
+    return false;
+  }
+
+  auto newDevice = std::make_shared<MonitorDevice>(deviceData);
+  if (!addDevice(newDevice)) {
+    return false;
+  }
+  newDevice->getDeviceData().set_state(tkm::msg::control::DeviceData_State_Loaded);
+  newDevice->enableEvents();
+
+  return true;
+}
+
 bool DeviceManager::cleanSessions(void)
 {
   IDatabase::Request dbrq{.client = nullptr,
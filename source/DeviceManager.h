@@ -11,9 +11,12 @@
 
 #pragma once
 
+#include <functional>
+#include <mutex>
 #include <netinet/in.h>
 #include <string>
 #include <sys/socket.h>
+#include <unordered_map>
 
 #include "MonitorDevice.h"
 #include "Options.h"
@@ -39,14 +42,20 @@ public:
 
   bool hasDevices(void) { return (m_devices.getSize() > 0); }
   bool loadDevices(void);
+  // Create the device for a database entry unless already known
+  bool loadDevice(const tkm::msg::control::DeviceData &deviceData);
   bool cleanSessions(void);
 
   bool addDevice(std::shared_ptr<MonitorDevice> device);
   bool remDevice(std::shared_ptr<MonitorDevice> device);
   auto getDevice(const std::string &hash) -> std::shared_ptr<MonitorDevice>;
+  void foreachDevice(const std::function<void(const std::shared_ptr<MonitorDevice> &)> &callback);
 
 private:
+  // The list keeps the iteration order, lookups by hash go through the index
   bswi::util::SafeList<std::shared_ptr<MonitorDevice>> m_devices{"DeviceList"};
+  std::unordered_map<std::string, std::shared_ptr<MonitorDevice>> m_index{};
+  std::mutex m_indexLock{};
 };
 
 } // namespace tkm::collector
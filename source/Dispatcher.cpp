@@ -9,12 +9,15 @@
  *-
  */
 
+#include <set>
 #include <taskmonitor/taskmonitor.h>
 #include <unistd.h>
 
 #include "Application.h"
+#include "BulkOperation.h"
 #include "Defaults.h"
 #include "Dispatcher.h"
+#include "Extension.pb.h"
 #include "Helpers.h"
 
 #include "../bswinfra/source/Timer.h"
@@ -25,7 +28,12 @@ namespace tkm::collector
 static bool doInitDatabase(const Dispatcher::Request &rq);
 static bool doQuitCollector(const std::shared_ptr<Dispatcher> mgr);
 static bool doGetDevices(const Dispatcher::Request &rq);
+static bool doGetDeviceStats(const Dispatcher::Request &rq);
+static bool doGetLatency(const Dispatcher::Request &rq);
 static bool doGetSessions(const Dispatcher::Request &rq);
+static bool doExportSession(const Dispatcher::Request &rq);
+static bool doArchiveSession(const Dispatcher::Request &rq);
+static bool doAggregate(const Dispatcher::Request &rq);
 static bool doRemoveSession(const Dispatcher::Request &rq);
 static bool doAddDevice(const Dispatcher::Request &rq);
 static bool doRemoveDevice(const Dispatcher::Request &rq);
@@ -33,6 +41,10 @@ static bool doConnectDevice(const Dispatcher::Request &rq);
 static bool doDisconnectDevice(const Dispatcher::Request &rq);
 static bool doStartCollecting(const Dispatcher::Request &rq);
 static bool doStopCollecting(const Dispatcher::Request &rq);
+static bool doBulkDevices(const Dispatcher::Request &rq);
+static bool doSubscribe(const Dispatcher::Request &rq);
+static bool doUnsubscribe(const Dispatcher::Request &rq);
+static bool doGetLatest(const Dispatcher::Request &rq);
 static bool doQuit();
 static bool doSendStatus(const Dispatcher::Request &rq);
 
@@ -43,7 +55,28 @@ void Dispatcher::enableEvents()
 
 bool Dispatcher::pushRequest(Request &rq)
 {
-  return m_queue->push(rq);
+  m_pending++;
+  if (!m_queue->push(rq)) {
+    m_pending--;
+    return false;
+  }
+  return true;
+}
+
+void Dispatcher::addBulkOperation(const std::shared_ptr<BulkOperation> &operation)
+{
+  m_bulkOperations[operation->getId()] = operation;
+}
+
+void Dispatcher::remBulkOperation(const std::string &id)
+{
+  m_bulkOperations.erase(id);
+}
+
+auto Dispatcher::getBulkOperation(const std::string &id) -> std::shared_ptr<BulkOperation>
+{
+  auto it = m_bulkOperations.find(id);
+  return (it != m_bulkOperations.end()) ? it->second : nullptr;
 }
 
 bool Dispatcher::requestHandler(const Request &rq)
@@ -55,8 +88,18 @@ bool Dispatcher::requestHandler(const Request &rq)
     return doQuitCollector(getShared());
   case Dispatcher::Action::GetDevices:
     return doGetDevices(rq);
+  case Dispatcher::Action::GetDeviceStats:
+    return doGetDeviceStats(rq);
+  case Dispatcher::Action::GetLatency:
+    return doGetLatency(rq);
   case Dispatcher::Action::GetSessions:
     return doGetSessions(rq);
+  case Dispatcher::Action::ExportSession:
+    return doExportSession(rq);
+  case Dispatcher::Action::ArchiveSession:
+    return doArchiveSession(rq);
+  case Dispatcher::Action::Aggregate:
+    return doAggregate(rq);
   case Dispatcher::Action::RemoveSession:
     return doRemoveSession(rq);
   case Dispatcher::Action::AddDevice:
@@ -71,6 +114,14 @@ bool Dispatcher::requestHandler(const Request &rq)
     return doStartCollecting(rq);
   case Dispatcher::Action::StopCollecting:
     return doStopCollecting(rq);
+  case Dispatcher::Action::BulkDevices:
+    return doBulkDevices(rq);
+  case Dispatcher::Action::Subscribe:
+    return doSubscribe(rq);
+  case Dispatcher::Action::Unsubscribe:
+    return doUnsubscribe(rq);
+  case Dispatcher::Action::GetLatest:
+    return doGetLatest(rq);
   case Dispatcher::Action::SendStatus:
     return doSendStatus(rq);
   case Dispatcher::Action::Quit:
@@ -107,10 +158,95 @@ static bool doGetDevices(const Dispatcher::Request &rq)
   IDatabase::Request dbrq{.client = rq.client,
                           .action = IDatabase::Action::GetDevices,
                           .args = rq.args,
-                          .bulkData = std::make_any<int>(0)};
+                          .bulkData = rq.bulkData};
   return CollectorApp()->getDatabase()->pushRequest(dbrq);
 }
 
+static bool doGetDeviceStats(const Dispatcher::Request &rq)
+{
+  tkm::msg::ext::DeviceStatsList statsList;
+
+  CollectorApp()->getDeviceManager()->foreachDevice(
+      [&statsList](const std::shared_ptr<MonitorDevice> &device) {
+        const auto &stats = device->getStats();
+        auto entry = statsList.add_device();
+
+        entry->set_hash(device->getDeviceData().hash());
+        entry->set_name(device->getDeviceData().name());
+        entry->set_bytes_read(stats.bytesRead);
+        entry->set_envelopes_read(stats.envelopesRead);
+        entry->set_decode_time_usec(stats.decodeTime / 1000);
+        entry->set_queue_time_usec(stats.queueTime / 1000);
+        entry->set_db_rows(stats.dbRows);
+        entry->set_db_time_usec(stats.dbTime / 1000);
+      });
+
+  tkm::msg::Envelope envelope;
+  tkm::msg::ext::Message message;
+
+  message.set_type(tkm::msg::ext::Message_Type_DeviceStats);
+  message.mutable_data()->PackFrom(statsList);
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(tkm::msg::Envelope_Recipient_Control);
+  envelope.set_origin(tkm::msg::Envelope_Recipient_Collector);
+
+  Dispatcher::Request nrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    nrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  if (rq.client == nullptr || !rq.client->writeEnvelope(envelope)) {
+    logWarn() << "Failed to send device stats";
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    nrq.args.emplace(Defaults::Arg::Reason, "Failed to send device stats");
+  } else {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusOkay));
+    nrq.args.emplace(Defaults::Arg::Reason, "Device stats provided");
+  }
+
+  return CollectorApp()->getDispatcher()->pushRequest(nrq);
+}
+
+static bool doGetLatency(const Dispatcher::Request &rq)
+{
+  tkm::msg::ext::LatencyReport report;
+
+  CollectorApp()->getDatabase()->getLatency().fill(report);
+
+  tkm::msg::Envelope envelope;
+  tkm::msg::ext::Message message;
+
+  message.set_type(tkm::msg::ext::Message_Type_Latency);
+  message.mutable_data()->PackFrom(report);
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(tkm::msg::Envelope_Recipient_Control);
+  envelope.set_origin(tkm::msg::Envelope_Recipient_Collector);
+
+  Dispatcher::Request nrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    nrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  if (rq.client == nullptr || !rq.client->writeEnvelope(envelope)) {
+    logWarn() << "Failed to send latency report";
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    nrq.args.emplace(Defaults::Arg::Reason, "Failed to send latency report");
+  } else {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusOkay));
+    nrq.args.emplace(Defaults::Arg::Reason, "Latency report provided");
+  }
+
+  return CollectorApp()->getDispatcher()->pushRequest(nrq);
+}
+
 static bool doRemoveSession(const Dispatcher::Request &rq)
 {
   IDatabase::Request dbrq{.client = rq.client,
@@ -246,6 +382,110 @@ static bool doStopCollecting(const Dispatcher::Request &rq)
   return device->pushRequest(drq);
 }
 
+static bool doBulkDevices(const Dispatcher::Request &rq)
+{
+  const auto &filter = std::any_cast<tkm::msg::ext::BulkFilter>(rq.bulkData);
+  const auto requestId =
+      rq.args.count(Defaults::Arg::RequestId) ? rq.args.at(Defaults::Arg::RequestId) : "";
+  auto operation = std::make_shared<BulkOperation>(rq.client, requestId, filter);
+
+  CollectorApp()->getDispatcher()->addBulkOperation(operation);
+  operation->enableEvents();
+
+  return true;
+}
+
+static bool doSubscribe(const Dispatcher::Request &rq)
+{
+  const auto &filter = std::any_cast<tkm::msg::ext::SubscribeFilter>(rq.bulkData);
+  auto device = CollectorApp()->getDeviceManager()->getDevice(filter.device_hash());
+  Dispatcher::Request nrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    nrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  if ((device == nullptr) || (rq.client == nullptr)) {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    nrq.args.emplace(Defaults::Arg::Reason, "No such device");
+  } else {
+    device->addLiveStream(std::make_shared<LiveStream>(rq.client, filter));
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusOkay));
+    nrq.args.emplace(Defaults::Arg::Reason, "Subscribed");
+  }
+
+  return CollectorApp()->getDispatcher()->pushRequest(nrq);
+}
+
+static bool doUnsubscribe(const Dispatcher::Request &rq)
+{
+  const auto &filter = std::any_cast<tkm::msg::ext::SubscribeFilter>(rq.bulkData);
+  auto device = CollectorApp()->getDeviceManager()->getDevice(filter.device_hash());
+  Dispatcher::Request nrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    nrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  if ((device != nullptr) && device->remLiveStream(rq.client)) {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusOkay));
+    nrq.args.emplace(Defaults::Arg::Reason, "Unsubscribed");
+  } else {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    nrq.args.emplace(Defaults::Arg::Reason, "Not subscribed");
+  }
+
+  return CollectorApp()->getDispatcher()->pushRequest(nrq);
+}
+
+static bool doGetLatest(const Dispatcher::Request &rq)
+{
+  const auto &filter = std::any_cast<tkm::msg::ext::LatestFilter>(rq.bulkData);
+  const std::set<int32_t> what(filter.what().cbegin(), filter.what().cend());
+  tkm::msg::ext::LatestSnapshot snapshot;
+
+  // Served from the device caches, the database is not involved
+  CollectorApp()->getDeviceManager()->foreachDevice(
+      [&snapshot, &what](const std::shared_ptr<MonitorDevice> &device) {
+        device->fillLatest(*snapshot.add_device(), what);
+      });
+
+  tkm::msg::Envelope envelope;
+  tkm::msg::ext::Message message;
+
+  message.set_type(tkm::msg::ext::Message_Type_LatestSnapshot);
+  message.mutable_data()->PackFrom(snapshot);
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(tkm::msg::Envelope_Recipient_Control);
+  envelope.set_origin(tkm::msg::Envelope_Recipient_Collector);
+
+  Dispatcher::Request nrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    nrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  if (rq.client == nullptr || !rq.client->writeEnvelope(envelope)) {
+    logWarn() << "Failed to send latest snapshot";
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    nrq.args.emplace(Defaults::Arg::Reason, "Failed to send latest snapshot");
+  } else {
+    nrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusOkay));
+    nrq.args.emplace(Defaults::Arg::Reason, "Latest snapshot provided");
+  }
+
+  return CollectorApp()->getDispatcher()->pushRequest(nrq);
+}
+
 static bool doGetSessions(const Dispatcher::Request &rq)
 {
   IDatabase::Request dbrq{.client = rq.client,
@@ -255,6 +495,33 @@ static bool doGetSessions(const Dispatcher::Request &rq)
   return CollectorApp()->getDatabase()->pushRequest(dbrq);
 }
 
+static bool doExportSession(const Dispatcher::Request &rq)
+{
+  IDatabase::Request dbrq{.client = rq.client,
+                          .action = IDatabase::Action::ExportSession,
+                          .args = rq.args,
+                          .bulkData = rq.bulkData};
+  return CollectorApp()->getDatabase()->pushRequest(dbrq);
+}
+
+static bool doArchiveSession(const Dispatcher::Request &rq)
+{
+  IDatabase::Request dbrq{.client = rq.client,
+                          .action = IDatabase::Action::ArchiveSession,
+                          .args = rq.args,
+                          .bulkData = rq.bulkData};
+  return CollectorApp()->getDatabase()->pushRequest(dbrq);
+}
+
+static bool doAggregate(const Dispatcher::Request &rq)
+{
+  IDatabase::Request dbrq{.client = rq.client,
+                          .action = IDatabase::Action::Aggregate,
+                          .args = rq.args,
+                          .bulkData = rq.bulkData};
+  return CollectorApp()->getDatabase()->pushRequest(dbrq);
+}
+
 static bool doQuit()
 {
   exit(EXIT_SUCCESS);
@@ -262,6 +529,23 @@ static bool doQuit()
 
 static bool doSendStatus(const Dispatcher::Request &rq)
 {
+  // Device replies to bulk operations are collected in the operation report
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    std::string hash{};
+    auto operation = CollectorApp()->getDispatcher()->getBulkOperation(
+        BulkOperation::parseRequestId(rq.args.at(Defaults::Arg::RequestId), hash));
+
+    if (operation != nullptr) {
+      operation->complete(hash,
+                          rq.args.count(Defaults::Arg::Status) &&
+                              (rq.args.at(Defaults::Arg::Status) ==
+                               tkmDefaults.valFor(Defaults::Val::StatusOkay)),
+                          rq.args.count(Defaults::Arg::Reason) ? rq.args.at(Defaults::Arg::Reason)
+                                                               : "");
+      return true;
+    }
+  }
+
   if (rq.client == nullptr) {
     logDebug() << "No client set for send status";
     return true;
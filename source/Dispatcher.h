@@ -11,7 +11,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
+#include <memory>
 #include <string>
 
 #include "Defaults.h"
@@ -25,6 +27,8 @@ using namespace bswi::event;
 namespace tkm::collector
 {
 
+class BulkOperation;
+
 class Dispatcher : public std::enable_shared_from_this<Dispatcher>
 {
 public:
@@ -32,7 +36,12 @@ public:
     InitDatabase,
     QuitCollector,
     GetDevices,
+    GetDeviceStats,
+    GetLatency,
     GetSessions,
+    ExportSession,
+    ArchiveSession,
+    Aggregate,
     RemoveSession,
     AddDevice,
     RemoveDevice,
@@ -40,6 +49,10 @@ public:
     DisconnectDevice,
     StartCollecting,
     StopCollecting,
+    BulkDevices,
+    Subscribe,
+    Unsubscribe,
+    GetLatest,
     SendStatus,
     Quit
   };
@@ -55,18 +68,29 @@ public:
   Dispatcher()
   {
     m_queue = std::make_shared<AsyncQueue<Request>>(
-        "DispatcherQueue", [this](const Request &rq) { return requestHandler(rq); });
+        "DispatcherQueue", [this](const Request &rq) {
+          m_pending--;
+          return requestHandler(rq);
+        });
   }
 
   auto getShared() -> std::shared_ptr<Dispatcher> { return shared_from_this(); }
   void enableEvents();
   bool pushRequest(Request &request);
+  auto getPendingCount() -> uint64_t { return m_pending; }
+
+  // Bulk device operations in progress, see BulkOperation
+  void addBulkOperation(const std::shared_ptr<BulkOperation> &operation);
+  void remBulkOperation(const std::string &id);
+  auto getBulkOperation(const std::string &id) -> std::shared_ptr<BulkOperation>;
 
 private:
   bool requestHandler(const Request &request);
 
 private:
   std::shared_ptr<AsyncQueue<Request>> m_queue = nullptr;
+  std::map<std::string, std::shared_ptr<BulkOperation>> m_bulkOperations{};
+  std::atomic<uint64_t> m_pending{0};
 };
 
 } // namespace tkm::collector
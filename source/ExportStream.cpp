@@ -0,0 +1,354 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ExportStream Class
+ * @details   Send session data rows to control clients in chunks
+ *-
+ */
+
+#include "ExportStream.h"
+#include "Application.h"
+#include "Query.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <set>
+
+namespace tkm::collector
+{
+
+// Archive files being written, streams are only created on the database queue
+static std::set<std::filesystem::path> GArchivesInProgress{};
+
+ExportStream::ExportStream(std::shared_ptr<IClient> client)
+: m_client(client)
+{
+  m_chunkSize = static_cast<uint32_t>(
+      std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::DBExportChunkSize)));
+  if (m_chunkSize == 0) {
+    m_chunkSize = 1;
+  }
+}
+
+ExportStream::ExportStream(const std::filesystem::path &archivePath)
+: m_archivePath(archivePath)
+{
+  const auto blockRows = static_cast<uint32_t>(
+      std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::ArchiveBlockRows)));
+
+  m_chunkSize = static_cast<uint32_t>(
+      std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::DBExportChunkSize)));
+  if (m_chunkSize == 0) {
+    m_chunkSize = 1;
+  }
+
+  // Readers never see a partial archive under the final name
+  m_archive = std::make_unique<ArchiveWriter>(m_archivePath.string() + ".tmp", blockRows);
+  GArchivesInProgress.insert(m_archivePath);
+}
+
+ExportStream::~ExportStream()
+{
+  if (m_archive != nullptr) {
+    std::error_code ec;
+    std::filesystem::remove(m_archive->getPath(), ec);
+  }
+  if (!m_archivePath.empty()) {
+    GArchivesInProgress.erase(m_archivePath);
+  }
+}
+
+bool ExportStream::isArchiving(const std::string &sessionHash)
+{
+  return GArchivesInProgress.count(getArchivePath(sessionHash)) > 0;
+}
+
+auto ExportStream::getArchivePath(const std::string &sessionHash) -> std::filesystem::path
+{
+  std::filesystem::path archivePath(
+      CollectorApp()->getOptions()->getFor(Options::Key::ArchiveDirectory));
+
+  if (!std::filesystem::exists(archivePath)) {
+    std::filesystem::create_directories(archivePath);
+  }
+
+  return archivePath / (sessionHash + ".tkmarc");
+}
+
+auto ExportStream::getTypes(const tkm::msg::ext::ExportFilter &filter)
+    -> std::vector<tkm::msg::monitor::Data_What>
+{
+  std::vector<tkm::msg::monitor::Data_What> types;
+
+  for (int i = 0; i < filter.what_size(); i++) {
+    if (tkm::msg::monitor::Data_What_IsValid(filter.what(i))) {
+      types.push_back(static_cast<tkm::msg::monitor::Data_What>(filter.what(i)));
+    }
+  }
+
+  if (filter.what_size() == 0) {
+    for (const auto &entry : tkmQuery.m_dataTableName) {
+      types.push_back(entry.first);
+    }
+  }
+
+  return types;
+}
+
+bool ExportStream::startTable(const std::string &table)
+{
+  if (m_changes != nullptr) {
+    sendSample();
+    m_changes.reset();
+  }
+  if (m_chunk.row_size() > 0) {
+    flush();
+  }
+
+  m_chunk.Clear();
+  m_chunk.set_table(table);
+
+  return !m_error;
+}
+
+void ExportStream::setChanges(const std::string &keyColumn,
+                              uint64_t keyframeInterval,
+                              uint64_t timeFrom)
+{
+  m_changes = std::make_unique<Changes>();
+  m_changes->keyColumn = keyColumn;
+  m_changes->keyframeInterval = keyframeInterval;
+  m_changes->timeFrom = timeFrom;
+}
+
+bool ExportStream::commitRow()
+{
+  if (m_changes != nullptr) {
+    return addChange();
+  }
+
+  return sendRow();
+}
+
+bool ExportStream::sendRow()
+{
+  m_rows++;
+  if (static_cast<uint32_t>(m_chunk.row_size()) < m_chunkSize) {
+    return !m_error;
+  }
+
+  return flush();
+}
+
+bool ExportStream::addChange()
+{
+  auto &changes = *m_changes;
+
+  if (changes.timeIndex < 0) {
+    const auto &timeColumn = tkmQuery.m_procEventColumn.at(Query::ProcEventColumn::SystemTime);
+    const auto &receiveColumn =
+        tkmQuery.m_procEventColumn.at(Query::ProcEventColumn::ReceiveTime);
+
+    for (int i = 0; i < m_chunk.column_size(); i++) {
+      if (m_chunk.column(i) == changes.keyColumn) {
+        changes.keyIndex = i;
+      } else if (m_chunk.column(i) == timeColumn) {
+        changes.timeIndex = i;
+      } else if (m_chunk.column(i) == receiveColumn) {
+        changes.receiveIndex = i;
+      }
+    }
+    // Rows without a key can't be rebuilt and are sent as stored
+    if ((changes.keyIndex < 0) || (changes.timeIndex < 0)) {
+      m_changes.reset();
+      return sendRow();
+    }
+  }
+
+  std::unique_ptr<tkm::msg::ext::ExportRow> row(m_chunk.mutable_row()->ReleaseLast());
+  if (std::max(changes.keyIndex, changes.timeIndex) >= row->value_size()) {
+    return !m_error;
+  }
+
+  const auto systemTime = std::strtoull(row->value(changes.timeIndex).c_str(), nullptr, 10);
+  const auto window = (changes.keyframeInterval > 0) ? (systemTime / changes.keyframeInterval)
+                                                     : systemTime;
+
+  if (changes.started && (systemTime != changes.sampleTime)) {
+    sendSample();
+  }
+  // Keyframes hold every process or context of the sample
+  if (!changes.started || (window != changes.window)) {
+    changes.entries.clear();
+    changes.window = window;
+  }
+  changes.sampleTime = systemTime;
+  changes.started = true;
+
+  const auto key = row->value(changes.keyIndex);
+  if ((changes.receiveIndex >= 0) && (changes.receiveIndex < row->value_size()) &&
+      (row->value(changes.receiveIndex) == "0")) {
+    changes.entries.erase(key);
+  } else {
+    changes.entries[key] = std::move(*row);
+  }
+
+  return !m_error;
+}
+
+bool ExportStream::sendSample()
+{
+  const auto &changes = *m_changes;
+
+  if (!changes.started || (changes.sampleTime < changes.timeFrom)) {
+    return !m_error;
+  }
+
+  const auto sampleTime = std::to_string(changes.sampleTime);
+  for (const auto &[key, entry] : changes.entries) {
+    auto row = m_chunk.add_row();
+
+    *row = entry;
+    row->set_value(changes.timeIndex, sampleTime);
+    if (!sendRow()) {
+      return false;
+    }
+  }
+
+  return !m_error;
+}
+
+bool ExportStream::flush()
+{
+  if (m_error) {
+    return false;
+  }
+
+  if (m_archive != nullptr) {
+    return writeArchive();
+  }
+
+  tkm::msg::Envelope envelope;
+  tkm::msg::ext::Message message;
+
+  message.set_type(tkm::msg::ext::Message_Type_ExportData);
+  message.mutable_data()->PackFrom(m_chunk);
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(msg::Envelope_Recipient_Any);
+  envelope.set_origin(msg::Envelope_Recipient_Collector);
+
+  // Keep table and columns, the next chunk continues the same table
+  m_chunk.clear_row();
+
+  if (!m_client->writeEnvelope(envelope)) {
+    logWarn() << "Fail to send export chunk to client " << m_client->getFD();
+    m_error = true;
+  }
+
+  return !m_error;
+}
+
+bool ExportStream::writeArchive()
+{
+  if (m_chunk.table() != m_archiveTable) {
+    const std::vector<std::string> columns(m_chunk.column().begin(), m_chunk.column().end());
+
+    m_archiveTable = m_chunk.table();
+    m_archive->startTable(m_archiveTable, columns);
+  }
+
+  for (const auto &row : m_chunk.row()) {
+    for (int i = 0; (i < row.value_size()) && (i < m_chunk.column_size()); i++) {
+      m_archive->setValue(static_cast<size_t>(i), row.value(i));
+    }
+    if (!m_archive->commitRow()) {
+      logWarn() << "Fail to write archive file " << m_archive->getPath();
+      m_error = true;
+      break;
+    }
+  }
+  m_chunk.clear_row();
+
+  return !m_error;
+}
+
+bool ExportStream::finish()
+{
+  if (m_changes != nullptr) {
+    sendSample();
+    m_changes.reset();
+  }
+  if (m_chunk.row_size() > 0) {
+    flush();
+  }
+
+  if ((m_archive != nullptr) && !m_error) {
+    std::error_code ec;
+    const auto written = m_archive->finish();
+
+    if (written) {
+      std::filesystem::rename(m_archive->getPath(), m_archivePath, ec);
+    }
+    if (!written || ec) {
+      logWarn() << "Fail to write archive file " << m_archivePath.string();
+      m_error = true;
+    } else {
+      m_archive.reset();
+    }
+  }
+
+  return !m_error;
+}
+
+ExportJob::ExportJob(const tkm::msg::ext::ExportFilter &filter,
+                     std::shared_ptr<ExportStream> stream)
+: m_filter(filter)
+, m_stream(stream)
+{
+  m_types = ExportStream::getTypes(m_filter);
+}
+
+auto ExportJob::getStepRows(bool packed) const -> uint64_t
+{
+  const uint64_t rows = m_stream->getChunkSize();
+
+  if (packed) {
+    return std::max<uint64_t>(1, rows / GExportPackedStepDivisor);
+  }
+
+  return rows;
+}
+
+bool ExportJob::startTable(uint64_t keyframeInterval)
+{
+  if (m_started) {
+    return true;
+  }
+
+  m_started = true;
+  m_range = m_filter;
+  if (!m_stream->startTable(tkmQuery.m_dataTableName.at(getType()))) {
+    return false;
+  }
+
+  if (tkmQuery.hasChanges(getType(), keyframeInterval)) {
+    m_range.set_time_from(m_filter.time_from() - m_filter.time_from() % keyframeInterval);
+    m_stream->setChanges(
+        tkmQuery.getChangeKey(getType()), keyframeInterval, m_filter.time_from());
+  }
+
+  return true;
+}
+
+void ExportJob::nextTable()
+{
+  m_table++;
+  m_cursor = -1;
+  m_started = false;
+}
+
+} // namespace tkm::collector
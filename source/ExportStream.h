@@ -0,0 +1,170 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ExportStream Class
+ * @details   Send session data rows to control clients in chunks
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <taskmonitor/taskmonitor.h>
+#include <vector>
+
+#include "Archive.h"
+#include "Extension.pb.h"
+#include "IClient.h"
+
+namespace tkm::collector
+{
+
+// Packed rows hold every entry of a sample, an export step reads this many
+// times fewer of them
+constexpr uint64_t GExportPackedStepDivisor = 16;
+
+// Rows are copied as text while the database cursor advances and an
+// ExportData message is written every ExportChunkSize rows, so memory use
+// does not depend on the session size. Archive streams append the chunks to
+// a columnar archive file instead, the file is renamed in place by finish.
+//
+// Change only rows are read in order and rebuilt while they pass: the latest
+// row of every process or context is kept until the next keyframe window or
+// its tombstone, and each distinct SystemTime is sent as a full sample.
+class ExportStream
+{
+public:
+  explicit ExportStream(std::shared_ptr<IClient> client);
+  explicit ExportStream(const std::filesystem::path &archivePath);
+  ~ExportStream();
+
+  // Send pending rows of the previous table and start a new one
+  bool startTable(const std::string &table);
+  // Rebuild the rows of the current table from change only rows, samples
+  // before timeFrom only build the state
+  void setChanges(const std::string &keyColumn, uint64_t keyframeInterval, uint64_t timeFrom);
+  [[nodiscard]] bool hasColumns() const { return m_chunk.column_size() > 0; }
+  void addColumn(const std::string &name) { m_chunk.add_column(name); }
+  // Values are appended by the caller, commitRow sends full chunks
+  auto addRow() -> tkm::msg::ext::ExportRow * { return m_chunk.add_row(); }
+  bool commitRow();
+  bool finish();
+
+  // Data types requested by the filter, all data tables if none
+  static auto getTypes(const tkm::msg::ext::ExportFilter &filter)
+      -> std::vector<tkm::msg::monitor::Data_What>;
+  // Archive file of a session in the configured archive directory
+  static auto getArchivePath(const std::string &sessionHash) -> std::filesystem::path;
+  // An archive stream of the session exists
+  static bool isArchiving(const std::string &sessionHash);
+
+  [[nodiscard]] bool hasError() const { return m_error; }
+  [[nodiscard]] auto getRowCount() const -> uint64_t { return m_rows; }
+  [[nodiscard]] auto getChunkSize() const -> uint32_t { return m_chunkSize; }
+  [[nodiscard]] auto getArchivePath() const -> const std::filesystem::path &
+  {
+    return m_archivePath;
+  }
+
+public:
+  ExportStream(ExportStream const &) = delete;
+  void operator=(ExportStream const &) = delete;
+
+private:
+  // Order of numeric keys stored as text
+  struct KeyOrder {
+    bool operator()(const std::string &a, const std::string &b) const
+    {
+      return (a.size() != b.size()) ? (a.size() < b.size()) : (a < b);
+    }
+  };
+
+  typedef struct Changes {
+    std::string keyColumn{};
+    uint64_t keyframeInterval = 0;
+    uint64_t timeFrom = 0;
+    int keyIndex = -1;
+    int timeIndex = -1;
+    int receiveIndex = -1;
+    uint64_t window = 0;
+    uint64_t sampleTime = 0;
+    bool started = false;
+    std::map<std::string, tkm::msg::ext::ExportRow, KeyOrder> entries{};
+  } Changes;
+
+  bool sendRow();
+  // Take the last added row into the change state
+  bool addChange();
+  // Send the current sample from the change state
+  bool sendSample();
+  bool flush();
+  bool writeArchive();
+
+private:
+  std::shared_ptr<IClient> m_client = nullptr;
+  std::unique_ptr<ArchiveWriter> m_archive = nullptr;
+  std::filesystem::path m_archivePath{};
+  std::string m_archiveTable{};
+  tkm::msg::ext::ExportChunk m_chunk{};
+  std::unique_ptr<Changes> m_changes = nullptr;
+  uint32_t m_chunkSize = 0;
+  uint64_t m_rows = 0;
+  bool m_error = false;
+};
+
+// Exports run in bounded steps on the database queue. Each step sends the rows
+// of one key range of the current table and the database queues the next step,
+// so ingest and control requests are handled in between.
+class ExportJob
+{
+public:
+  ExportJob(const tkm::msg::ext::ExportFilter &filter, std::shared_ptr<ExportStream> stream);
+
+  [[nodiscard]] auto getFilter() const -> const tkm::msg::ext::ExportFilter & { return m_filter; }
+  [[nodiscard]] auto getStream() const -> ExportStream & { return *m_stream; }
+  [[nodiscard]] bool isDone() const { return m_table >= m_types.size(); }
+  [[nodiscard]] auto getType() const -> tkm::msg::monitor::Data_What
+  {
+    return m_types.at(m_table);
+  }
+  // Last exported key of the current table, -1 before the first step
+  [[nodiscard]] auto getCursor() const -> int64_t { return m_cursor; }
+  void setCursor(int64_t cursor) { m_cursor = cursor; }
+  // Rows read per step, packed rows hold a full sample each
+  [[nodiscard]] auto getStepRows(bool packed) const -> uint64_t;
+
+  // Start the current table on the stream on its first step, change only
+  // tables are rebuilt by the stream
+  bool startTable(uint64_t keyframeInterval);
+  void nextTable();
+  // Filter of the rows read for the current table, change only rows are read
+  // from the keyframe window start of the requested time range
+  [[nodiscard]] auto getRange() const -> const tkm::msg::ext::ExportFilter & { return m_range; }
+
+  // Set by the database if the session file was open before the export
+  [[nodiscard]] bool isShardOpen() const { return m_shardOpen; }
+  void setShardOpen(bool open) { m_shardOpen = open; }
+
+public:
+  ExportJob(ExportJob const &) = delete;
+  void operator=(ExportJob const &) = delete;
+
+private:
+  tkm::msg::ext::ExportFilter m_filter{};
+  tkm::msg::ext::ExportFilter m_range{};
+  std::shared_ptr<ExportStream> m_stream = nullptr;
+  std::vector<tkm::msg::monitor::Data_What> m_types{};
+  size_t m_table = 0;
+  int64_t m_cursor = -1;
+  bool m_started = false;
+  bool m_shardOpen = false;
+};
+
+} // namespace tkm::collector
@@ -11,11 +11,16 @@
 
 #pragma once
 
+#include "Capture.h"
 #include "Options.h"
 
+#include <cerrno>
 #include <fcntl.h>
 #include <memory>
 #include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
 #include <taskmonitor/taskmonitor.h>
 #include <unistd.h>
 
@@ -52,12 +57,68 @@ public:
   }
   bool writeEnvelope(const tkm::msg::Envelope &envelope)
   {
+    // A partly sent frame is completed first so frames never interleave
+    if (flushPending(true) != tkm::IAsyncEnvelope::Status::Ok) {
+      return false;
+    }
     if (m_writer->send(envelope) == tkm::IAsyncEnvelope::Status::Ok) {
       return m_writer->flush();
     }
     return true;
   }
 
+  // Send a frame without blocking. Ok when the frame is sent or kept pending,
+  // Again while the previous frame is still pending.
+  auto sendFrame(const std::string &frame) -> tkm::IAsyncEnvelope::Status
+  {
+    auto status = flushPending(false);
+    if (status != tkm::IAsyncEnvelope::Status::Ok) {
+      return status;
+    }
+
+    m_pending = frame;
+    m_pendingOffset = 0;
+    status = flushPending(false);
+
+    return (status == tkm::IAsyncEnvelope::Status::Again) ? tkm::IAsyncEnvelope::Status::Ok
+                                                          : status;
+  }
+
+  // Write the pending bytes, Again when the socket is full and not blocking
+  auto flushPending(bool block) -> tkm::IAsyncEnvelope::Status
+  {
+    while (m_pendingOffset < m_pending.size()) {
+      auto written = ::send(m_fd,
+                            m_pending.data() + m_pendingOffset,
+                            m_pending.size() - m_pendingOffset,
+                            MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (written >= 0) {
+        m_pendingOffset += static_cast<size_t>(written);
+        continue;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN) {
+        return tkm::IAsyncEnvelope::Status::Error;
+      }
+      if (!block) {
+        return tkm::IAsyncEnvelope::Status::Again;
+      }
+
+      struct pollfd pfd = {.fd = m_fd, .events = POLLOUT, .revents = 0};
+      if ((::poll(&pfd, 1, -1) < 0) && (errno != EINTR)) {
+        return tkm::IAsyncEnvelope::Status::Error;
+      }
+    }
+
+    m_pending.clear();
+    m_pendingOffset = 0;
+
+    return tkm::IAsyncEnvelope::Status::Ok;
+  }
+  [[nodiscard]] bool hasPending() const { return m_pendingOffset < m_pending.size(); }
+
 public:
   IClient(IClient const &) = delete;
   void operator=(IClient const &) = delete;
@@ -67,6 +128,9 @@ public:
 private:
   std::unique_ptr<tkm::EnvelopeReader> m_reader = nullptr;
   std::unique_ptr<tkm::EnvelopeWriter> m_writer = nullptr;
+  // Unsent tail of the last frame written without blocking
+  std::string m_pending{};
+  size_t m_pendingOffset = 0;
 };
 
 } // namespace tkm::collector
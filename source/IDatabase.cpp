@@ -0,0 +1,87 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     IDatabase Class
+ * @details   Interfaces for databases
+ *-
+ */
+
+#include <sstream>
+
+#include "IDatabase.h"
+#include "Logger.h"
+
+using namespace bswi::log;
+
+namespace tkm::collector
+{
+
+void IDatabase::setProjection(tkm::msg::monitor::Data_What what,
+                              const std::set<std::string> &columns)
+{
+  if (columns.size() == tkmQuery.getDataColumns(what).size()) {
+    m_projection.erase(what);
+    return;
+  }
+
+  m_projection[what] = columns;
+  if (m_changeFilter.isEnabled() &&
+      ((what == tkm::msg::monitor::Data_What_ProcInfo) ||
+       (what == tkm::msg::monitor::Data_What_ContextInfo)) &&
+      (columns.count(tkmQuery.getChangeKey(what)) == 0)) {
+    logWarn() << "Table " << tkmQuery.m_dataTableName.at(what) << " has no "
+              << tkmQuery.getChangeKey(what) << " column, change only exports cannot be rebuilt";
+  }
+}
+
+void IDatabase::loadIngest(const std::shared_ptr<Options> &options)
+{
+  const std::map<tkm::msg::monitor::Data_What, Options::Key> columnKeys{
+      {tkm::msg::monitor::Data_What_SysProcStat, Options::Key::IngestSysProcStat},
+      {tkm::msg::monitor::Data_What_SysProcMemInfo, Options::Key::IngestSysProcMemInfo},
+      {tkm::msg::monitor::Data_What_SysProcDiskStats, Options::Key::IngestSysProcDiskStats},
+      {tkm::msg::monitor::Data_What_SysProcPressure, Options::Key::IngestSysProcPressure},
+      {tkm::msg::monitor::Data_What_SysProcBuddyInfo, Options::Key::IngestSysProcBuddyInfo},
+      {tkm::msg::monitor::Data_What_SysProcWireless, Options::Key::IngestSysProcWireless},
+      {tkm::msg::monitor::Data_What_SysProcVMStat, Options::Key::IngestSysProcVMStat},
+      {tkm::msg::monitor::Data_What_ProcAcct, Options::Key::IngestProcAcct},
+      {tkm::msg::monitor::Data_What_ProcInfo, Options::Key::IngestProcInfo},
+      {tkm::msg::monitor::Data_What_ProcEvent, Options::Key::IngestProcEvent},
+      {tkm::msg::monitor::Data_What_ContextInfo, Options::Key::IngestContextInfo},
+  };
+  std::stringstream names(options->getFor(Options::Key::IngestDisabled));
+  std::string name;
+
+  // An empty column list stores all columns
+  for (const auto &[what, key] : columnKeys) {
+    const auto columns = options->getFor(key);
+    if (columns.empty()) {
+      continue;
+    }
+
+    auto projection = tkmQuery.parseColumns(what, columns);
+    // Change only exports and the per device process filters key the entries
+    // on PID and ContextId, they are stored whatever the projection says
+    if ((what == tkm::msg::monitor::Data_What_ProcInfo) ||
+        (what == tkm::msg::monitor::Data_What_ContextInfo)) {
+      projection.insert(tkmQuery.getChangeKey(what));
+    }
+    m_ingestProjection.emplace(what, projection);
+  }
+  m_projection = m_ingestProjection;
+
+  while (std::getline(names, name, ',')) {
+    auto what = tkm::msg::monitor::Data_What_ProcEvent;
+
+    name.erase(0, name.find_first_not_of(' '));
+    name.erase(name.find_last_not_of(' ') + 1);
+    if (tkm::msg::monitor::Data_What_Parse(name, &what)) {
+      m_disabled.insert(what);
+    }
+  }
+}
+
+} // namespace tkm::collector
@@ -11,12 +11,18 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 
+#include "ChangeFilter.h"
 #include "IClient.h"
+#include "LatencyStats.h"
 #include "Options.h"
+#include "Query.h"
+#include "Rollup.h"
 
 #include "../bswinfra/source/AsyncQueue.h"
 
@@ -42,6 +48,10 @@ public:
     RemSession,
     EndSession,
     CleanSessions,
+    ExportSession,
+    ArchiveSession,
+    Aggregate,
+    Retention,
     AddData
   };
 
@@ -55,13 +65,44 @@ public:
 public:
   explicit IDatabase(std::shared_ptr<Options> options)
   : m_options(options)
+  , m_rollup(options->getFor(Options::Key::RollupEnabled) == "true")
+  , m_changeFilter(options->getFor(Options::Key::DedupEnabled) == "true",
+                   std::stod(options->getFor(Options::Key::DedupEpsilon)),
+                   std::stoull(options->getFor(Options::Key::DedupKeyframeInterval)))
   {
     m_queue = std::make_shared<AsyncQueue<IDatabase::Request>>(
-        "DBQueue", [this](const IDatabase::Request &rq) { return requestHandler(rq); });
+        "DBQueue", [this](const IDatabase::Request &rq) {
+          m_pending--;
+          return requestHandler(rq);
+        });
+    loadIngest(options);
   }
   virtual ~IDatabase() = default;
 
-  bool pushRequest(Request &rq) { return m_queue->push(rq); }
+  bool pushRequest(Request &rq)
+  {
+    m_pending++;
+    if (!m_queue->push(rq)) {
+      m_pending--;
+      return false;
+    }
+    return true;
+  }
+  auto getPendingCount() -> uint64_t { return m_pending; }
+  auto getLatency() -> LatencyStats & { return m_latency; }
+  auto getRollup() -> Rollup & { return m_rollup; }
+  auto getChangeFilter() -> ChangeFilter & { return m_changeFilter; }
+  // Stored columns of the projected data tables
+  auto getProjection() const -> const Query::Projection & { return m_projection; }
+  // Columns of an existing table, they are stored instead of the configured ones
+  void setProjection(tkm::msg::monitor::Data_What what, const std::set<std::string> &columns);
+  // Back to the configured columns once the tables are dropped
+  void resetProjection() { m_projection = m_ingestProjection; }
+  // Samples of disabled data types are not stored
+  [[nodiscard]] bool isDisabled(tkm::msg::monitor::Data_What what) const
+  {
+    return m_disabled.count(what) > 0;
+  }
   virtual void enableEvents() = 0;
   virtual bool requestHandler(const IDatabase::Request &request) = 0;
 
@@ -69,9 +110,19 @@ public:
   IDatabase(IDatabase const &) = delete;
   void operator=(IDatabase const &) = delete;
 
+private:
+  void loadIngest(const std::shared_ptr<Options> &options);
+
 protected:
   std::shared_ptr<AsyncQueue<IDatabase::Request>> m_queue = nullptr;
   std::shared_ptr<Options> m_options = nullptr;
+  std::atomic<uint64_t> m_pending{0};
+  LatencyStats m_latency{};
+  Rollup m_rollup;
+  ChangeFilter m_changeFilter;
+  Query::Projection m_ingestProjection{};
+  Query::Projection m_projection{};
+  std::set<tkm::msg::monitor::Data_What> m_disabled{};
 };
 
 } // namespace tkm::collector
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <string>
 #include <taskmonitor/taskmonitor.h>
@@ -50,11 +51,24 @@ public:
     std::any bulkData;
   } Request;
 
+  // Collector cost accounting, times in nanoseconds
+  typedef struct Stats {
+    uint64_t bytesRead;
+    uint64_t envelopesRead;
+    uint64_t decodeTime;
+    uint64_t queueTime;
+    uint64_t dbRows;
+    uint64_t dbTime;
+  } Stats;
+
 public:
   IDevice()
   {
     m_queue = std::make_shared<AsyncQueue<Request>>(
-        "DeviceQueue", [this](const Request &request) { return requestHandler(request); });
+        "DeviceQueue", [this](const Request &request) {
+          m_pending--;
+          return requestHandler(request);
+        });
   }
   virtual ~IDevice() = default;
 
@@ -65,6 +79,8 @@ public:
   auto getDeviceData() -> tkm::msg::control::DeviceData & { return m_deviceData; }
   auto getSessionData() -> tkm::msg::control::SessionData & { return m_sessionData; }
   auto getSessionInfo() -> tkm::msg::monitor::SessionInfo & { return m_sessionInfo; }
+  auto getStats() -> Stats & { return m_stats; }
+  auto getPendingCount() -> uint64_t { return m_pending; }
 
   virtual bool pushRequest(Request &request) = 0;
   virtual void updateState(tkm::msg::control::DeviceData_State state) = 0;
@@ -77,6 +93,8 @@ protected:
   tkm::msg::control::DeviceData m_deviceData{};
   tkm::msg::control::SessionData m_sessionData{};
   tkm::msg::monitor::SessionInfo m_sessionInfo{};
+  Stats m_stats{};
+  std::atomic<uint64_t> m_pending{0};
 };
 
 } // namespace tkm::collector
@@ -0,0 +1,69 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     LatencyStats Class
+ * @details   Per table sample latency histograms
+ *-
+ */
+
+#include "LatencyStats.h"
+
+namespace tkm::collector
+{
+
+void LatencyHistogram::record(uint64_t usec)
+{
+  size_t bucket = 0;
+
+  while ((bucket < BucketCount - 1) && ((usec >> bucket) > 0)) {
+    bucket++;
+  }
+
+  m_buckets[bucket]++;
+  m_count++;
+  m_sum += usec;
+  if (usec > m_max) {
+    m_max = usec;
+  }
+}
+
+void LatencyHistogram::fill(tkm::msg::ext::LatencyHistogram &histogram) const
+{
+  histogram.set_count(m_count);
+  histogram.set_sum_usec(m_sum);
+  histogram.set_max_usec(m_max);
+  for (const auto &bucket : m_buckets) {
+    histogram.add_bucket(bucket);
+  }
+}
+
+void LatencyStats::record(tkm::msg::monitor::Data_What what,
+                          uint64_t receiveTime,
+                          uint64_t writeStart,
+                          uint64_t commitTime)
+{
+  auto &table = m_tables[what];
+
+  if (commitTime >= receiveTime) {
+    table.commit.record((commitTime - receiveTime) / 1000);
+  }
+  if (writeStart >= receiveTime) {
+    table.dwell.record((writeStart - receiveTime) / 1000);
+  }
+}
+
+void LatencyStats::fill(tkm::msg::ext::LatencyReport &report) const
+{
+  for (const auto &[what, latency] : m_tables) {
+    auto entry = report.add_table();
+
+    entry->set_table(tkm::msg::monitor::Data_What_Name(what));
+    latency.commit.fill(*entry->mutable_commit());
+    latency.dwell.fill(*entry->mutable_dwell());
+  }
+}
+
+} // namespace tkm::collector
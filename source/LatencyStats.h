@@ -0,0 +1,68 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     LatencyStats Class
+ * @details   Per table sample latency histograms
+ *-
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <taskmonitor/taskmonitor.h>
+
+#include "Extension.pb.h"
+
+namespace tkm::collector
+{
+
+// Log2 histogram in microseconds: bucket 0 counts samples below 1us,
+// bucket N counts samples in [2^(N-1), 2^N) us and the last bucket is open ended
+class LatencyHistogram
+{
+public:
+  static constexpr size_t BucketCount = 32;
+
+public:
+  void record(uint64_t usec);
+  void fill(tkm::msg::ext::LatencyHistogram &histogram) const;
+
+private:
+  std::array<uint64_t, BucketCount> m_buckets{};
+  uint64_t m_count = 0;
+  uint64_t m_sum = 0;
+  uint64_t m_max = 0;
+};
+
+class LatencyStats
+{
+public:
+  LatencyStats() = default;
+  ~LatencyStats() = default;
+
+  // All timestamps are monotonic nanoseconds
+  void record(tkm::msg::monitor::Data_What what,
+              uint64_t receiveTime,
+              uint64_t writeStart,
+              uint64_t commitTime);
+  void fill(tkm::msg::ext::LatencyReport &report) const;
+
+public:
+  LatencyStats(LatencyStats const &) = delete;
+  void operator=(LatencyStats const &) = delete;
+
+private:
+  typedef struct TableLatency {
+    LatencyHistogram commit;
+    LatencyHistogram dwell;
+  } TableLatency;
+
+  std::map<tkm::msg::monitor::Data_What, TableLatency> m_tables{};
+};
+
+} // namespace tkm::collector
@@ -0,0 +1,184 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ListStream Class
+ * @details   Send device and session lists to control clients in steps
+ *-
+ */
+
+#include "ListStream.h"
+#include "Application.h"
+
+namespace tkm::collector
+{
+
+ListStream::ListStream(std::shared_ptr<IClient> client,
+                       Kind kind,
+                       const tkm::msg::ext::ListFilter &filter,
+                       bool paged)
+: m_client(client)
+, m_kind(kind)
+, m_filter(filter)
+, m_lastId(filter.after_id())
+, m_paged(paged)
+{
+  m_chunkSize = static_cast<uint32_t>(
+      std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::DBListChunkSize)));
+  if (m_chunkSize == 0) {
+    m_chunkSize = 1;
+  }
+}
+
+auto ListStream::getStepRows() const -> uint32_t
+{
+  if ((m_filter.limit() > 0) && (m_filter.limit() - m_count < m_chunkSize)) {
+    return static_cast<uint32_t>(m_filter.limit() - m_count);
+  }
+
+  return m_chunkSize;
+}
+
+auto ListStream::getStepFilter() const -> tkm::msg::ext::ListFilter
+{
+  tkm::msg::ext::ListFilter filter = m_filter;
+
+  filter.set_after_id(m_lastId);
+  filter.set_limit(getStepRows());
+
+  return filter;
+}
+
+bool ListStream::accept(int64_t id)
+{
+  if (m_error) {
+    return false;
+  }
+
+  if (m_stepCount >= getStepRows()) {
+    m_stepMore = true;
+    return false;
+  }
+
+  m_count++;
+  m_stepCount++;
+  m_lastId = id;
+
+  return true;
+}
+
+bool ListStream::add(tkm::msg::control::DeviceData &device)
+{
+  if (!accept(device.id())) {
+    return false;
+  }
+
+  auto activeDevice = CollectorApp()->getDeviceManager()->getDevice(device.hash());
+  if (activeDevice != nullptr) {
+    device.set_state(activeDevice->getDeviceData().state());
+  }
+  m_deviceList.add_device()->CopyFrom(device);
+
+  return true;
+}
+
+bool ListStream::add(tkm::msg::control::SessionData &session)
+{
+  if (!accept(session.id())) {
+    return false;
+  }
+
+  if (session.ended() == 0) {
+    session.set_state(tkm::msg::control::SessionData_State_Progress);
+  } else {
+    session.set_state(tkm::msg::control::SessionData_State_Complete);
+  }
+  m_sessionList.add_session()->CopyFrom(session);
+
+  return true;
+}
+
+bool ListStream::flush()
+{
+  tkm::msg::Envelope envelope;
+  tkm::msg::control::Message message;
+
+  if (m_kind == Kind::Devices) {
+    message.set_type(tkm::msg::control::Message_Type_DeviceList);
+    message.mutable_data()->PackFrom(m_deviceList);
+    m_deviceList.clear_device();
+  } else {
+    message.set_type(tkm::msg::control::Message_Type_SessionList);
+    message.mutable_data()->PackFrom(m_sessionList);
+    m_sessionList.clear_session();
+  }
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(msg::Envelope_Recipient_Any);
+  envelope.set_origin(msg::Envelope_Recipient_Collector);
+
+  m_chunks++;
+
+  if (!m_client->writeEnvelope(envelope)) {
+    logWarn() << "Fail to send list chunk to client " << m_client->getFD();
+    m_error = true;
+  }
+
+  return !m_error;
+}
+
+bool ListStream::endStep()
+{
+  // A step stops at the extra row, the list is done once a step found no
+  // more rows or the requested limit is reached
+  const bool more = m_stepMore;
+
+  if (m_paged && !m_error && (m_stepCount > 0)) {
+    flush();
+  }
+
+  m_done = m_error || !more || ((m_filter.limit() > 0) && (m_count >= m_filter.limit()));
+  m_more = m_done && more;
+  m_stepCount = 0;
+  m_stepMore = false;
+
+  return !m_error;
+}
+
+bool ListStream::finish()
+{
+  // Clients expect one list message even if no rows matched
+  if (!m_error && (!m_paged || (m_chunks == 0))) {
+    flush();
+  }
+
+  if (m_error || !m_paged) {
+    return !m_error;
+  }
+
+  tkm::msg::Envelope envelope;
+  tkm::msg::ext::Message message;
+  tkm::msg::ext::ListEnd listEnd;
+
+  listEnd.set_count(m_count);
+  listEnd.set_last_id(m_lastId);
+  listEnd.set_more(m_more);
+
+  message.set_type(tkm::msg::ext::Message_Type_ListEnd);
+  message.mutable_data()->PackFrom(listEnd);
+  envelope.mutable_mesg()->PackFrom(message);
+
+  envelope.set_target(msg::Envelope_Recipient_Any);
+  envelope.set_origin(msg::Envelope_Recipient_Collector);
+
+  if (!m_client->writeEnvelope(envelope)) {
+    logWarn() << "Fail to send list end to client " << m_client->getFD();
+    m_error = true;
+  }
+
+  return !m_error;
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,82 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ListStream Class
+ * @details   Send device and session lists to control clients in steps
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <taskmonitor/taskmonitor.h>
+
+#include "Extension.pb.h"
+#include "IClient.h"
+
+namespace tkm::collector
+{
+
+// Lists are read in steps of at most ListChunkSize rows keyed on the row Id.
+// The database queues the next step behind the pending requests, so ingest
+// and control requests are handled in between. Paged requests get every step
+// as a DeviceList or SessionList message followed by ListEnd, legacy requests
+// get all rows in a single message once the last step is read.
+class ListStream
+{
+public:
+  enum class Kind { Devices, Sessions };
+
+public:
+  ListStream(std::shared_ptr<IClient> client,
+             Kind kind,
+             const tkm::msg::ext::ListFilter &filter,
+             bool paged);
+  ~ListStream() = default;
+
+  // Filter of the next step, the query returns one extra row if more follow
+  [[nodiscard]] auto getStepFilter() const -> tkm::msg::ext::ListFilter;
+  // Return false if the row is not part of the step
+  bool add(tkm::msg::control::DeviceData &device);
+  bool add(tkm::msg::control::SessionData &session);
+  // Send the rows of a paged step
+  bool endStep();
+  [[nodiscard]] bool isDone() const { return m_done; }
+  // Send the legacy list or the ListEnd message of paged requests
+  bool finish();
+
+  [[nodiscard]] bool hasError() const { return m_error; }
+  [[nodiscard]] auto getCount() const -> uint64_t { return m_count; }
+
+public:
+  ListStream(ListStream const &) = delete;
+  void operator=(ListStream const &) = delete;
+
+private:
+  [[nodiscard]] auto getStepRows() const -> uint32_t;
+  bool accept(int64_t id);
+  bool flush();
+
+private:
+  std::shared_ptr<IClient> m_client = nullptr;
+  Kind m_kind = Kind::Devices;
+  tkm::msg::ext::ListFilter m_filter{};
+  tkm::msg::control::DeviceList m_deviceList{};
+  tkm::msg::control::SessionList m_sessionList{};
+  uint32_t m_chunkSize = 0;
+  uint32_t m_stepCount = 0;
+  uint64_t m_count = 0;
+  uint64_t m_chunks = 0;
+  int64_t m_lastId = 0;
+  bool m_paged = false;
+  bool m_stepMore = false;
+  bool m_more = false;
+  bool m_done = false;
+  bool m_error = false;
+};
+
+} // namespace tkm::collector
@@ -0,0 +1,143 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     LiveStream Class
+ * @details   Forward live device samples to a subscribed control client
+ *-
+ */
+
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "Application.h"
+#include "LiveStream.h"
+
+namespace tkm::collector
+{
+
+LiveStream::LiveStream(std::shared_ptr<IClient> client,
+                       const tkm::msg::ext::SubscribeFilter &filter)
+: Pollable("LiveStream")
+, m_client(client)
+{
+  m_queueSize = std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::LiveQueueSize));
+  if (m_queueSize == 0) {
+    m_queueSize = 1;
+  }
+
+  for (const auto what : filter.what()) {
+    m_what.insert(what);
+  }
+
+  // The client socket is already polled for reading by the event loop, the
+  // write readiness goes through an epoll descriptor of its own
+  if ((m_epollFd = ::epoll_create1(EPOLL_CLOEXEC)) < 0) {
+    throw std::runtime_error("Fail to create LiveStream epoll descriptor");
+  }
+
+  lateSetup(
+      [this]() {
+        struct epoll_event event {};
+
+        // Consume the one shot event, it is armed again while frames are queued
+        static_cast<void>(::epoll_wait(m_epollFd, &event, 1, 0));
+        drain();
+
+        return true;
+      },
+      m_epollFd,
+      bswi::event::IPollable::Events::Level,
+      bswi::event::IEventSource::Priority::Normal);
+}
+
+LiveStream::~LiveStream()
+{
+  if (m_epollFd >= 0) {
+    ::close(m_epollFd);
+  }
+}
+
+void LiveStream::enableEvents()
+{
+  CollectorApp()->addEventSource(getShared());
+}
+
+void LiveStream::disableEvents()
+{
+  CollectorApp()->remEventSource(getShared());
+}
+
+bool LiveStream::accept(tkm::msg::monitor::Data_What what) const
+{
+  return !isClosed() && (m_what.empty() || (m_what.count(what) > 0));
+}
+
+void LiveStream::push(const std::shared_ptr<const tkm::msg::Envelope> &envelope)
+{
+  if (m_queue.size() >= m_queueSize) {
+    m_queue.pop_front();
+    if ((m_dropped++ % m_queueSize) == 0) {
+      logWarn() << "Live stream client too slow, " << m_dropped << " samples dropped";
+    }
+  }
+  m_queue.push_back(envelope);
+  watchWritable();
+}
+
+void LiveStream::watchWritable(void)
+{
+  auto client = m_client.lock();
+
+  if ((client == nullptr) || m_error) {
+    return;
+  }
+
+  struct epoll_event event {};
+  event.events = EPOLLOUT | EPOLLONESHOT;
+
+  // A new client descriptor is added, the known one is armed again
+  const auto op = (m_watchedFd == client->getFD()) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+  if (::epoll_ctl(m_epollFd, op, client->getFD(), &event) < 0) {
+    logDebug() << "Live stream fails to watch client socket";
+    m_error = true;
+    return;
+  }
+  m_watchedFd = client->getFD();
+}
+
+void LiveStream::drain(void)
+{
+  auto client = m_client.lock();
+
+  if ((client == nullptr) || m_error) {
+    m_queue.clear();
+    return;
+  }
+
+  // Another stream of the client may have left a partly written frame
+  auto status = client->flushPending(false);
+  while ((status == IAsyncEnvelope::Status::Ok) && !m_queue.empty()) {
+    status = client->sendFrame(encodeFrame(m_queue.front()->SerializeAsString()));
+    if (status == IAsyncEnvelope::Status::Ok) {
+      m_queue.pop_front();
+      m_sent++;
+      if (client->hasPending()) {
+        status = IAsyncEnvelope::Status::Again;
+      }
+    }
+  }
+
+  if (status == IAsyncEnvelope::Status::Again) {
+    watchWritable();
+  } else if (status != IAsyncEnvelope::Status::Ok) {
+    logDebug() << "Live stream write failed after " << m_sent << " samples";
+    m_queue.clear();
+    m_error = true;
+  }
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,76 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     LiveStream Class
+ * @details   Forward live device samples to a subscribed control client
+ *-
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <set>
+#include <taskmonitor/taskmonitor.h>
+
+#include "Extension.pb.h"
+#include "IClient.h"
+
+namespace tkm::collector
+{
+
+// The device builds one LiveData envelope per sample and shares it with all
+// its streams, the sample payload is packed once whatever the subscriber
+// count. Every stream queues at most LiveQueueSize envelopes and drops the
+// oldest one when full. Publishing only queues, the stream is an event source
+// on an epoll descriptor watching the client socket for POLLOUT and writes
+// without blocking when it fires. A partly written frame stays in the client
+// and is completed first, so a slow client loses samples instead of stalling
+// ingest.
+class LiveStream : public Pollable, public std::enable_shared_from_this<LiveStream>
+{
+public:
+  LiveStream(std::shared_ptr<IClient> client, const tkm::msg::ext::SubscribeFilter &filter);
+  ~LiveStream();
+
+  auto getShared() -> std::shared_ptr<LiveStream> { return shared_from_this(); }
+  void enableEvents();
+  void disableEvents();
+
+  [[nodiscard]] bool accept(tkm::msg::monitor::Data_What what) const;
+  void push(const std::shared_ptr<const tkm::msg::Envelope> &envelope);
+
+  // The client went away or a write failed
+  [[nodiscard]] bool isClosed() const { return m_error || m_client.expired(); }
+  [[nodiscard]] bool hasClient(const std::shared_ptr<IClient> &client) const
+  {
+    return m_client.lock() == client;
+  }
+  [[nodiscard]] auto getDropped() const -> uint64_t { return m_dropped; }
+
+public:
+  LiveStream(LiveStream const &) = delete;
+  void operator=(LiveStream const &) = delete;
+
+private:
+  void drain(void);
+  // Report the next time the client socket is writable
+  void watchWritable(void);
+
+private:
+  std::weak_ptr<IClient> m_client{};
+  std::set<int32_t> m_what{};
+  std::deque<std::shared_ptr<const tkm::msg::Envelope>> m_queue{};
+  size_t m_queueSize = 0;
+  uint64_t m_sent = 0;
+  uint64_t m_dropped = 0;
+  int m_epollFd = -1;
+  int m_watchedFd = -1;
+  bool m_error = false;
+};
+
+} // namespace tkm::collector
@@ -9,6 +9,7 @@
  *-
  */
 
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <iostream>
@@ -19,9 +20,11 @@
 #include "Application.h"
 #include "Defaults.h"
 #include "Dispatcher.h"
+#include "Extension.pb.h"
 #include "Helpers.h"
 #include "IDatabase.h"
 #include "MonitorDevice.h"
+#include "SelfMonitor.h"
 
 namespace tkm::collector
 {
@@ -45,9 +48,19 @@ static bool doStopStream(const std::shared_ptr<MonitorDevice> mgr,
 static bool doProcessData(const std::shared_ptr<MonitorDevice> mgr,
                           const MonitorDevice::Request &rq);
 static bool doStatus(const MonitorDevice::Request &rq);
+static bool doNotSupported(const MonitorDevice::Request &rq);
 
 void MonitorDevice::enableEvents()
 {
+  const auto options = CollectorApp()->getOptions();
+  const auto &name = m_deviceData.name();
+
+  m_processFilter = std::make_shared<ProcessFilter>(
+      options->getFor(Options::Key::TopNEnabled, name) == "true",
+      std::stoul(options->getFor(Options::Key::TopNCount, name)),
+      options->getFor(Options::Key::TopNOrder, name),
+      options->getFor(Options::Key::TopNAllow, name));
+
   CollectorApp()->addEventSource(m_queue);
 }
 
@@ -73,7 +86,12 @@ void MonitorDevice::enableConnection()
 
 bool MonitorDevice::pushRequest(Request &request)
 {
-  return m_queue->push(request);
+  m_pending++;
+  if (!m_queue->push(request)) {
+    m_pending--;
+    return false;
+  }
+  return true;
 }
 
 void MonitorDevice::updateState(tkm::msg::control::DeviceData_State state)
@@ -88,6 +106,17 @@ void MonitorDevice::updateState(tkm::msg::control::DeviceData_State state)
                               .bulkData = std::make_any<int>(0)};
       dbrq.args.emplace(Defaults::Arg::SessionHash, m_sessionData.hash());
       CollectorApp()->getDatabase()->pushRequest(dbrq);
+
+      if (CollectorApp()->getOptions()->getFor(Options::Key::ArchiveEnabled) == "true") {
+        tkm::msg::ext::ExportFilter filter;
+
+        filter.set_session_hash(m_sessionData.hash());
+        IDatabase::Request arrq{.client = nullptr,
+                                .action = IDatabase::Action::ArchiveSession,
+                                .args = std::map<Defaults::Arg, std::string>(),
+                                .bulkData = std::make_any<tkm::msg::ext::ExportFilter>(filter)};
+        CollectorApp()->getDatabase()->pushRequest(arrq);
+      }
     }
   }
 }
@@ -153,6 +182,82 @@ void MonitorDevice::stopUpdateLanes(void)
   }
 }
 
+void MonitorDevice::addLiveStream(const std::shared_ptr<LiveStream> &stream)
+{
+  stream->enableEvents();
+  m_liveStreams.push_back(stream);
+}
+
+void MonitorDevice::clearLiveStreams(void)
+{
+  for (auto &stream : m_liveStreams) {
+    stream->disableEvents();
+  }
+  m_liveStreams.clear();
+}
+
+bool MonitorDevice::remLiveStream(const std::shared_ptr<IClient> &client)
+{
+  const auto count = m_liveStreams.size();
+
+  m_liveStreams.erase(std::remove_if(m_liveStreams.begin(),
+                                     m_liveStreams.end(),
+                                     [&client](const std::shared_ptr<LiveStream> &stream) {
+                                       if (!stream->hasClient(client)) {
+                                         return false;
+                                       }
+                                       stream->disableEvents();
+                                       return true;
+                                     }),
+                      m_liveStreams.end());
+
+  return m_liveStreams.size() != count;
+}
+
+void MonitorDevice::publishLive(const tkm::msg::monitor::Data &data)
+{
+  m_liveStreams.erase(std::remove_if(m_liveStreams.begin(),
+                                     m_liveStreams.end(),
+                                     [](const std::shared_ptr<LiveStream> &stream) {
+                                       if (!stream->isClosed()) {
+                                         return false;
+                                       }
+                                       stream->disableEvents();
+                                       return true;
+                                     }),
+                      m_liveStreams.end());
+
+  if (std::none_of(m_liveStreams.cbegin(),
+                   m_liveStreams.cend(),
+                   [&data](const std::shared_ptr<LiveStream> &stream) {
+                     return stream->accept(data.what());
+                   })) {
+    return;
+  }
+
+  // Packed once, every subscriber queues the same envelope
+  auto envelope = std::make_shared<tkm::msg::Envelope>();
+  tkm::msg::ext::Message message;
+  tkm::msg::ext::LiveData liveData;
+
+  liveData.set_device_hash(getDeviceData().hash());
+  liveData.set_session_hash(getSessionData().hash());
+  liveData.mutable_data()->PackFrom(data);
+
+  message.set_type(tkm::msg::ext::Message_Type_LiveData);
+  message.mutable_data()->PackFrom(liveData);
+  envelope->mutable_mesg()->PackFrom(message);
+  envelope->set_target(tkm::msg::Envelope_Recipient_Control);
+  envelope->set_origin(tkm::msg::Envelope_Recipient_Collector);
+
+  const std::shared_ptr<const tkm::msg::Envelope> shared = envelope;
+  for (auto &stream : m_liveStreams) {
+    if (stream->accept(data.what())) {
+      stream->push(shared);
+    }
+  }
+}
+
 void MonitorDevice::configUpdateLanes(void)
 {
   const auto procAcctUpdateCallback = [this]() {
@@ -454,8 +559,41 @@ void MonitorDevice::configUpdateLanes(void)
   m_dataSources.commit();
 }
 
+void MonitorDevice::updateLatest(const tkm::msg::monitor::Data &data)
+{
+  // The cached message is reused so its buffers are kept between samples
+  m_latest[data.what()].CopyFrom(data);
+}
+
+void MonitorDevice::fillLatest(tkm::msg::ext::LatestDevice &entry,
+                               const std::set<int32_t> &what)
+{
+  entry.set_hash(getDeviceData().hash());
+  entry.set_name(getDeviceData().name());
+  entry.set_session_hash(getSessionData().hash());
+
+  for (const auto &[type, data] : m_latest) {
+    if (what.empty() || (what.count(type) > 0)) {
+      entry.add_data()->PackFrom(data);
+    }
+  }
+}
+
 bool MonitorDevice::requestHandler(const Request &request)
 {
+  // The collector self monitoring device has no remote endpoint
+  if (getDeviceData().hash() == GSelfDeviceHash) {
+    switch (request.action) {
+    case MonitorDevice::Action::Connect:
+    case MonitorDevice::Action::Disconnect:
+    case MonitorDevice::Action::StartCollecting:
+    case MonitorDevice::Action::StopCollecting:
+      return doNotSupported(request);
+    default:
+      break;
+    }
+  }
+
   switch (request.action) {
   case MonitorDevice::Action::Connect:
     return doConnect(getShared(), request);
@@ -721,12 +859,39 @@ static bool doStopCollecting(const std::shared_ptr<MonitorDevice> mgr,
 static bool doProcessData(const std::shared_ptr<MonitorDevice> mgr,
                           const MonitorDevice::Request &rq)
 {
+  const auto timeNow = getMonotonicTimeNs();
+
+  // Account the time spent in device queue
+  if (rq.args.count(Defaults::Arg::EnqueueTime)) {
+    mgr->getStats().queueTime += timeNow - std::stoull(rq.args.at(Defaults::Arg::EnqueueTime));
+  }
+
   // Add entry to database
   IDatabase::Request dbrq{.client = nullptr,
                           .action = IDatabase::Action::AddData,
                           .args = std::map<Defaults::Arg, std::string>(),
                           .bulkData = rq.bulkData};
   dbrq.args.emplace(Defaults::Arg::SessionHash, mgr->getSessionData().hash());
+  dbrq.args.emplace(Defaults::Arg::DeviceHash, mgr->getDeviceData().hash());
+  dbrq.args.emplace(Defaults::Arg::EnqueueTime, std::to_string(timeNow));
+  if (rq.args.count(Defaults::Arg::ReceiveTime)) {
+    dbrq.args.emplace(Defaults::Arg::ReceiveTime, rq.args.at(Defaults::Arg::ReceiveTime));
+  }
+  const auto &data = std::any_cast<const tkm::msg::monitor::Data &>(rq.bulkData);
+  mgr->updateLatest(data);
+  mgr->publishLive(data);
+
+  // Live clients still get the samples of the data types not stored
+  if (CollectorApp()->getDatabase()->isDisabled(data.what())) {
+    return true;
+  }
+
+  // Live clients get the full samples, the database only the selected processes
+  if ((mgr->getProcessFilter() != nullptr) &&
+      !mgr->getProcessFilter()->filter(data, dbrq.bulkData)) {
+    return true;
+  }
+
   return CollectorApp()->getDatabase()->pushRequest(dbrq);
 }
 
@@ -754,4 +919,20 @@ static bool doStatus(const MonitorDevice::Request &rq)
   return true;
 }
 
+static bool doNotSupported(const MonitorDevice::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+  mrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+  mrq.args.emplace(Defaults::Arg::Reason, "Not supported for collector self device");
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
 } // namespace tkm::collector
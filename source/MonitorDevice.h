@@ -12,13 +12,17 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 #include <taskmonitor/taskmonitor.h>
 
 #include "Connection.h"
 #include "DataSource.h"
 #include "IDevice.h"
+#include "LiveStream.h"
 #include "Options.h"
+#include "ProcessFilter.h"
 
 #include "../bswinfra/source/AsyncQueue.h"
 #include "../bswinfra/source/SafeList.h"
@@ -41,6 +45,7 @@ public:
 
   auto getShared() -> std::shared_ptr<MonitorDevice> { return shared_from_this(); }
   auto getConnection() -> std::shared_ptr<Connection> { return m_connection; }
+  auto getProcessFilter() -> std::shared_ptr<ProcessFilter> { return m_processFilter; }
   void enableEvents();
   bool pushRequest(Request &request) override;
   void updateState(tkm::msg::control::DeviceData_State state) final;
@@ -48,6 +53,17 @@ public:
   void startUpdateLanes(void);
   void stopUpdateLanes(void);
 
+  // Live data subscribers, samples are forwarded next to the database insert
+  void addLiveStream(const std::shared_ptr<LiveStream> &stream);
+  bool remLiveStream(const std::shared_ptr<IClient> &client);
+  // Live streams are event sources, removed devices drop them from the loop
+  void clearLiveStreams(void);
+  void publishLive(const tkm::msg::monitor::Data &data);
+
+  // Last sample received for each data type
+  void updateLatest(const tkm::msg::monitor::Data &data);
+  void fillLatest(tkm::msg::ext::LatestDevice &entry, const std::set<int32_t> &what);
+
 private:
   bool requestHandler(const Request &request) final;
   void configUpdateLanes(void);
@@ -55,9 +71,12 @@ private:
 private:
   bswi::util::SafeList<std::shared_ptr<DataSource>> m_dataSources{"DataSourceList"};
   std::shared_ptr<Connection> m_connection = nullptr;
+  std::shared_ptr<ProcessFilter> m_processFilter = nullptr;
   std::shared_ptr<Timer> m_fastLaneTimer = nullptr;
   std::shared_ptr<Timer> m_paceLaneTimer = nullptr;
   std::shared_ptr<Timer> m_slowLaneTimer = nullptr;
+  std::vector<std::shared_ptr<LiveStream>> m_liveStreams{};
+  std::map<int32_t, tkm::msg::monitor::Data> m_latest{};
 };
 
 } // namespace tkm::collector
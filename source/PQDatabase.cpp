@@ -10,13 +10,17 @@
  */
 
 #include "PQDatabase.h"
+#include "AggregateStream.h"
 #include "Application.h"
 #include "Defaults.h"
+#include "ExportStream.h"
+#include "ListStream.h"
 #include "Query.h"
 
 #include <Helpers.h>
 #include <any>
 #include <filesystem>
+#include <set>
 #include <string>
 #include <taskmonitor/taskmonitor.h>
 #include <vector>
@@ -42,7 +46,13 @@ static bool doAddSession(const std::shared_ptr<PQDatabase> &db, const IDatabase:
 static bool doRemSession(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq);
 static bool doEndSession(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq);
 static bool doCleanSessions(const std::shared_ptr<PQDatabase> &db);
+static bool doExportSession(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq);
+static bool doArchiveSession(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq);
+static bool doAggregate(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq);
+static bool doRetention(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq);
 static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq);
+static void writeRollups(const std::shared_ptr<PQDatabase> &db, const std::string &sessionHash);
+static bool replaySpool(const std::shared_ptr<PQDatabase> &db);
 
 PQDatabase::PQDatabase(std::shared_ptr<Options> options)
 : IDatabase(options)
@@ -63,11 +73,35 @@ PQDatabase::PQDatabase(std::shared_ptr<Options> options)
     logDebug() << "Can't open database";
     throw std::runtime_error("Fail to open posgress database");
   }
+
+  m_usePartitions = (m_options->getFor(Options::Key::DBPartitioning) == "session");
+  checkPartitioned();
+  m_usePacked = (m_options->getFor(Options::Key::DBPackedArrays) == "true");
+  checkPacked();
+  checkProjection();
+
+  if (m_options->getFor(Options::Key::SpoolEnabled) == "true") {
+    m_spoolBatch = std::stoul(m_options->getFor(Options::Key::SpoolReplayBatch));
+    m_spoolQueueLimit = std::stoull(m_options->getFor(Options::Key::SpoolQueueLimit));
+    if (m_spoolBatch == 0) {
+      m_spoolBatch = 1;
+    }
+
+    try {
+      m_spool = std::make_shared<Spool>(
+          m_options->getFor(Options::Key::SpoolPath),
+          std::stoull(m_options->getFor(Options::Key::SpoolMaxSize)),
+          std::stoull(m_options->getFor(Options::Key::SpoolInterval)));
+    } catch (std::exception &e) {
+      logError() << "Spool disabled. Reason: " << e.what();
+      m_spool = nullptr;
+    }
+  }
 }
 
 bool PQDatabase::reconnect()
 {
-  if (m_connection->is_open()) {
+  if (isConnected()) {
     return true;
   }
   m_connection.reset();
@@ -80,7 +114,14 @@ bool PQDatabase::reconnect()
            << "hostaddr = " << m_options->getFor(Options::Key::DBServerAddress) << " "
            << "port = " << m_options->getFor(Options::Key::DBServerPort);
 
-  m_connection = std::make_unique<pqxx::connection>(connInfo.str());
+  try {
+    m_connection = std::make_unique<pqxx::connection>(connInfo.str());
+  } catch (std::exception &e) {
+    logDebug() << "Can't open database. Reason: " << e.what();
+    m_connection.reset();
+    return false;
+  }
+
   if (m_connection->is_open()) {
     logInfo() << "Opened database successfully: " << m_connection->dbname();
   } else {
@@ -91,8 +132,81 @@ bool PQDatabase::reconnect()
   return true;
 }
 
+void PQDatabase::checkPartitioned()
+{
+  try {
+    auto result = runTransaction(tkmQuery.getPartitioned(Query::Type::PostgreSQL));
+    m_partitioned = !result.empty() && (result[0][0].as<int64_t>() > 0);
+  } catch (std::exception &e) {
+    logError() << "Database query fails: " << e.what();
+    m_partitioned = false;
+  }
+
+  if (m_partitioned != m_usePartitions) {
+    logWarn() << "Data tables are " << (m_partitioned ? "" : "not ")
+              << "partitioned by session, database init is needed to change the layout";
+  }
+}
+
+void PQDatabase::checkPacked()
+{
+  try {
+    auto result = runTransaction(tkmQuery.getPacked(Query::Type::PostgreSQL));
+    m_packed = !result.empty() && (result[0][0].as<int64_t>() > 0);
+  } catch (std::exception &e) {
+    logError() << "Database query fails: " << e.what();
+    m_packed = false;
+  }
+
+  if (m_packed != m_usePacked) {
+    logWarn() << "Data tables are " << (m_packed ? "" : "not ")
+              << "packed, forced database init is needed to change the layout";
+  }
+}
+
+void PQDatabase::checkProjection()
+{
+  for (const auto &[what, table] : tkmQuery.m_dataTableName) {
+    std::string columns;
+
+    try {
+      auto result = runTransaction(tkmQuery.getTableColumns(Query::Type::PostgreSQL, what));
+      if (!result.empty() && !result[0][0].is_null()) {
+        columns = result[0][0].as<std::string>();
+      }
+    } catch (std::exception &e) {
+      logError() << "Database query fails: " << e.what();
+    }
+    if (columns.empty()) {
+      continue;
+    }
+
+    const auto stored = tkmQuery.parseColumns(what, columns);
+    const auto configured = tkmQuery.getDataColumns(what, getProjection());
+    if (stored != std::set<std::string>(configured.cbegin(), configured.cend())) {
+      logWarn() << "Table " << table << " columns do not match the ingest configuration, "
+                << "forced database init is needed to change them";
+      setProjection(what, stored);
+    }
+  }
+}
+
+bool PQDatabase::shouldSpool()
+{
+  if (m_spool == nullptr) {
+    return false;
+  }
+
+  // Samples behind the spooled ones keep their order
+  return !m_spool->isEmpty() || !isConnected() ||
+         ((m_spoolQueueLimit > 0) && (getPendingCount() > m_spoolQueueLimit));
+}
+
 auto PQDatabase::runTransaction(const std::string &sql) -> pqxx::result
 {
+  if (!isConnected()) {
+    throw std::runtime_error("Database not connected");
+  }
   pqxx::work work(*m_connection);
 
   auto result = work.exec(sql);
@@ -101,6 +215,33 @@ auto PQDatabase::runTransaction(const std::string &sql) -> pqxx::result
   return result;
 }
 
+void PQDatabase::runCursor(const std::string &sql,
+                           uint32_t fetchSize,
+                           const std::function<bool(const pqxx::result &)> &consumer)
+{
+  if (!isConnected()) {
+    throw std::runtime_error("Database not connected");
+  }
+  pqxx::work work(*m_connection);
+  std::string select = sql;
+
+  if (!select.empty() && (select.back() == ';')) {
+    select.pop_back();
+  }
+  work.exec("DECLARE tkm_list_cursor NO SCROLL CURSOR FOR " + select + ";");
+
+  for (;;) {
+    auto result =
+        work.exec("FETCH FORWARD " + std::to_string(fetchSize) + " FROM tkm_list_cursor;");
+    if (result.empty() || !consumer(result)) {
+      break;
+    }
+  }
+
+  work.exec("CLOSE tkm_list_cursor;");
+  work.commit();
+}
+
 void PQDatabase::enableEvents()
 {
   CollectorApp()->addEventSource(m_queue);
@@ -109,6 +250,10 @@ void PQDatabase::enableEvents()
                           .args = std::map<Defaults::Arg, std::string>(),
                           .bulkData = std::make_any<int>(0)};
   pushRequest(dbrq);
+
+  if (m_spool != nullptr) {
+    m_spool->enableEvents();
+  }
 }
 
 bool PQDatabase::requestHandler(const Request &rq)
@@ -140,6 +285,14 @@ bool PQDatabase::requestHandler(const Request &rq)
     return doEndSession(getShared(), rq);
   case IDatabase::Action::CleanSessions:
     return doCleanSessions(getShared());
+  case IDatabase::Action::ExportSession:
+    return doExportSession(getShared(), rq);
+  case IDatabase::Action::ArchiveSession:
+    return doArchiveSession(getShared(), rq);
+  case IDatabase::Action::Aggregate:
+    return doAggregate(getShared(), rq);
+  case IDatabase::Action::Retention:
+    return doRetention(getShared(), rq);
   case IDatabase::Action::AddData:
     return doAddData(getShared(), rq);
   default:
@@ -151,9 +304,35 @@ bool PQDatabase::requestHandler(const Request &rq)
 
 static bool doCheckDatabase(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
 {
+  auto spool = db->getSpool();
+
   logDebug() << "Handling DB check request";
-  static_cast<void>(db); // UNUSED
   static_cast<void>(rq); // UNUSED
+
+  if ((spool == nullptr) || spool->isEmpty()) {
+    return true;
+  }
+
+  if (!db->isConnected() && !db->reconnect()) {
+    spool->setReplaying(false);
+    return true;
+  }
+
+  if (!replaySpool(db) || spool->isEmpty()) {
+    spool->setReplaying(false);
+    return true;
+  }
+
+  // Next batch at full speed, the requests queued meanwhile are served first
+  IDatabase::Request nrq{.client = nullptr,
+                         .action = IDatabase::Action::CheckDatabase,
+                         .args = std::map<Defaults::Arg, std::string>(),
+                         .bulkData = std::make_any<int>(0)};
+  spool->setReplaying(true);
+  if (!db->pushRequest(nrq)) {
+    spool->setReplaying(false);
+  }
+
   return true;
 }
 
@@ -171,7 +350,7 @@ static bool doInitDatabase(const std::shared_ptr<PQDatabase> &db, const IDatabas
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
   }
 
-  if (!db->getConnection()->is_open()) {
+  if (!db->isConnected()) {
     if (!db->reconnect()) {
       mrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
       mrq.args.emplace(Defaults::Arg::Reason, "Database connection error");
@@ -183,6 +362,7 @@ static bool doInitDatabase(const std::shared_ptr<PQDatabase> &db, const IDatabas
     if (rq.args.at(Defaults::Arg::Forced) == tkmDefaults.valFor(Defaults::Val::True)) {
       try {
         db->runTransaction(tkmQuery.dropTables(Query::Type::PostgreSQL));
+        db->resetProjection();
       } catch (std::exception &e) {
         logError() << "Database query fails: " << e.what();
       }
@@ -190,11 +370,31 @@ static bool doInitDatabase(const std::shared_ptr<PQDatabase> &db, const IDatabas
   }
 
   try {
-    db->runTransaction(tkmQuery.createTables(Query::Type::PostgreSQL));
+    db->runTransaction(tkmQuery.createTables(Query::Type::PostgreSQL,
+                                             db->usePartitions(),
+                                             false,
+                                             db->usePacked(),
+                                             db->getProjection()));
   } catch (std::exception &e) {
     logError() << "Database query fails: " << e.what();
     status = false;
   }
+  db->checkPartitioned();
+
+  // Existing tables keep their columns until a forced init
+  db->checkProjection();
+
+  // Entry views only go on tables that were created packed
+  db->checkPacked();
+  if (status && db->isPacked()) {
+    try {
+      db->runTransaction(
+          tkmQuery.createPackedViews(Query::Type::PostgreSQL, db->getProjection()));
+    } catch (std::exception &e) {
+      logError() << "Database query fails: " << e.what();
+      status = false;
+    }
+  }
 
   mrq.args.emplace(Defaults::Arg::Status,
                    status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
@@ -238,13 +438,7 @@ static bool doLoadDevices(const std::shared_ptr<PQDatabase> &db)
 
   if (status) {
     for (auto &deviceData : deviceList) {
-      if (CollectorApp()->getDeviceManager()->getDevice(deviceData.hash()) != nullptr)
-        continue;
-
-      auto newDevice = std::make_shared<MonitorDevice>(deviceData);
-      CollectorApp()->getDeviceManager()->addDevice(newDevice);
-      newDevice->getDeviceData().set_state(tkm::msg::control::DeviceData_State_Loaded);
-      newDevice->enableEvents();
+      CollectorApp()->getDeviceManager()->loadDevice(deviceData);
     }
   } else {
     logError() << "Failed to load devices";
@@ -303,39 +497,144 @@ static bool doCleanSessions(const std::shared_ptr<PQDatabase> &db)
   return true;
 }
 
+static auto deviceFromRow(const pqxx::result::const_iterator &c) -> tkm::msg::control::DeviceData
+{
+  tkm::msg::control::DeviceData deviceData;
+
+  deviceData.set_id(c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Id)].as<long>());
+  deviceData.set_hash(
+      c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Hash)].as<std::string>());
+  deviceData.set_name(
+      c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Name)].as<std::string>());
+  deviceData.set_address(
+      c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Address)].as<std::string>());
+  deviceData.set_port(c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Port)].as<int>());
+
+  return deviceData;
+}
+
+static auto sessionFromRow(const pqxx::result::const_iterator &c) -> tkm::msg::control::SessionData
+{
+  tkm::msg::control::SessionData sessionData;
+
+  sessionData.set_id(c[static_cast<pqxx::result::size_type>(Query::SessionColumn::Id)].as<long>());
+  sessionData.set_hash(
+      c[static_cast<pqxx::result::size_type>(Query::SessionColumn::Hash)].as<std::string>());
+  sessionData.set_name(
+      c[static_cast<pqxx::result::size_type>(Query::SessionColumn::Name)].as<std::string>());
+  sessionData.set_started(static_cast<uint64_t>(
+      c[static_cast<pqxx::result::size_type>(Query::SessionColumn::StartTimestamp)].as<long>()));
+  sessionData.set_ended(static_cast<uint64_t>(
+      c[static_cast<pqxx::result::size_type>(Query::SessionColumn::EndTimestamp)].as<long>()));
+
+  return sessionData;
+}
+
+// Queue the next list step behind the pending requests
+static bool queueList(const std::shared_ptr<PQDatabase> &db,
+                      const IDatabase::Request &rq,
+                      const std::shared_ptr<ListStream> &stream)
+{
+  IDatabase::Request dbrq{.client = rq.client,
+                          .action = rq.action,
+                          .args = rq.args,
+                          .bulkData = std::make_any<std::shared_ptr<ListStream>>(stream)};
+  return db->pushRequest(dbrq);
+}
+
 static bool doGetDevices(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
 {
   Dispatcher::Request mrq{.client = rq.client,
                           .action = Dispatcher::Action::SendStatus,
                           .args = std::map<Defaults::Arg, std::string>(),
                           .bulkData = std::make_any<int>(0)};
-  auto deviceList = std::vector<tkm::msg::control::DeviceData>();
+  std::shared_ptr<ListStream> stream = nullptr;
   bool status = true;
 
   if (rq.args.count(Defaults::Arg::RequestId)) {
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
   }
 
-  logDebug() << "Handling DB GetDevices request from client: " << rq.client->getName();
+  if (rq.bulkData.type() == typeid(std::shared_ptr<ListStream>)) {
+    stream = std::any_cast<std::shared_ptr<ListStream>>(rq.bulkData);
+  } else {
+    logDebug() << "Handling DB GetDevices request from client: " << rq.client->getName();
+    const auto &filter = std::any_cast<tkm::msg::ext::ListFilter>(rq.bulkData);
+    stream = std::make_shared<ListStream>(
+        rq.client, ListStream::Kind::Devices, filter, rq.args.count(Defaults::Arg::Paged) > 0);
+  }
 
   try {
-    auto result = db->runTransaction(tkmQuery.getDevices(Query::Type::PostgreSQL));
+    // The step query is bounded, its rows are read at once
+    auto result =
+        db->runTransaction(tkmQuery.listDevices(Query::Type::PostgreSQL, stream->getStepFilter()));
+    for (auto c = result.begin(); c != result.end(); ++c) {
+      auto deviceData = deviceFromRow(c);
+      if (!stream->add(deviceData)) {
+        break;
+      }
+    }
+  } catch (std::exception &e) {
+    logError() << "Database query fails: " << e.what();
+    status = false;
+  }
 
-    for (pqxx::result::const_iterator c = result.begin(); c != result.end(); ++c) {
-      tkm::msg::control::DeviceData deviceData;
+  if (status) {
+    status = stream->endStep();
+  }
+  if (status && !stream->isDone()) {
+    return queueList(db, rq, stream);
+  }
+  if (status) {
+    status = stream->finish();
+  }
 
-      deviceData.set_id(
-          c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Id)].as<long>());
-      deviceData.set_hash(
-          c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Hash)].as<std::string>());
-      deviceData.set_name(
-          c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Name)].as<std::string>());
-      deviceData.set_address(
-          c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Address)].as<std::string>());
-      deviceData.set_port(
-          c[static_cast<pqxx::result::size_type>(Query::DeviceColumn::Port)].as<int>());
+  if (status) {
+    mrq.args.emplace(Defaults::Arg::Reason, "List provided");
+  } else if (stream->hasError()) {
+    mrq.args.emplace(Defaults::Arg::Reason, "Failed to send device list");
+  } else {
+    mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
+  }
 
-      deviceList.push_back(deviceData);
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doGetSessions(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  std::shared_ptr<ListStream> stream = nullptr;
+  bool status = true;
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  if (rq.bulkData.type() == typeid(std::shared_ptr<ListStream>)) {
+    stream = std::any_cast<std::shared_ptr<ListStream>>(rq.bulkData);
+  } else {
+    logDebug() << "Handling DB GetSessions request from client: " << rq.client->getName();
+    const auto &filter = std::any_cast<tkm::msg::ext::ListFilter>(rq.bulkData);
+    stream = std::make_shared<ListStream>(
+        rq.client, ListStream::Kind::Sessions, filter, rq.args.count(Defaults::Arg::Paged) > 0);
+  }
+
+  try {
+    // The step query is bounded, its rows are read at once
+    auto result =
+        db->runTransaction(tkmQuery.listSessions(Query::Type::PostgreSQL, stream->getStepFilter()));
+    for (auto c = result.begin(); c != result.end(); ++c) {
+      auto sessionData = sessionFromRow(c);
+      if (!stream->add(sessionData)) {
+        break;
+      }
     }
   } catch (std::exception &e) {
     logError() << "Database query fails: " << e.what();
@@ -343,38 +642,256 @@ static bool doGetDevices(const std::shared_ptr<PQDatabase> &db, const IDatabase:
   }
 
   if (status) {
-    tkm::msg::Envelope envelope;
-    tkm::msg::control::Message message;
-    tkm::msg::control::DeviceList devList;
+    status = stream->endStep();
+  }
+  if (status && !stream->isDone()) {
+    return queueList(db, rq, stream);
+  }
+  if (status) {
+    status = stream->finish();
+  }
 
-    for (auto &dev : deviceList) {
-      auto activeDevice = CollectorApp()->getDeviceManager()->getDevice(dev.hash());
+  if (status) {
+    mrq.args.emplace(Defaults::Arg::Reason, "List provided");
+  } else if (stream->hasError()) {
+    mrq.args.emplace(Defaults::Arg::Reason, "Failed to send session list");
+  } else {
+    mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
+  }
+
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+// Check the session and start an export job, reason is set if the session is unknown.
+// The stream is created once the session is known.
+static auto startExport(const std::shared_ptr<PQDatabase> &db,
+                        const tkm::msg::ext::ExportFilter &filter,
+                        const std::function<std::shared_ptr<ExportStream>()> &makeStream,
+                        std::string &reason) -> std::shared_ptr<ExportJob>
+{
+  if (!isValidHash(filter.session_hash())) {
+    reason = "Invalid session hash";
+    return nullptr;
+  }
+
+  long sesId = -1;
+
+  try {
+    auto result =
+        db->runTransaction(tkmQuery.hasSession(Query::Type::PostgreSQL, filter.session_hash()));
+    for (pqxx::result::const_iterator c = result.begin(); c != result.end(); ++c) {
+      sesId = c[static_cast<pqxx::result::size_type>(Query::SessionColumn::Id)].as<long>();
+    }
+  } catch (std::exception &e) {
+    logError() << "Database query fails: " << e.what();
+    reason = "Query failed";
+    return nullptr;
+  }
+
+  if (sesId == -1) {
+    reason = "No such session";
+    return nullptr;
+  }
+
+  return std::make_shared<ExportJob>(filter, makeStream());
+}
+
+// Send the rows of the next key range of the current table, done is set once
+// every table is sent
+static bool
+exportStep(const std::shared_ptr<PQDatabase> &db, ExportJob &job, bool &done, std::string &reason)
+{
+  auto &stream = job.getStream();
+
+  done = job.isDone();
+  if (done) {
+    return true;
+  }
 
-      if (activeDevice != nullptr) {
-        dev.set_state(activeDevice->getDeviceData().state());
+  const auto what = job.getType();
+  const auto keyframeInterval = db->getChangeFilter().getKeyframeInterval();
+  const bool packedType = db->isPacked() && (tkmQuery.m_packedDataTypes.count(what) > 0);
+  int64_t bound = -1;
+
+  if (!job.startTable(keyframeInterval)) {
+    return false;
+  }
+
+  try {
+    auto last = db->runTransaction(tkmQuery.getExportBound(Query::Type::PostgreSQL,
+                                                           what,
+                                                           job.getRange(),
+                                                           false,
+                                                           db->isPacked(),
+                                                           job.getCursor(),
+                                                           job.getStepRows(packedType)));
+    if (last.empty() || last[0][0].is_null()) {
+      job.nextTable();
+      done = job.isDone();
+      return true;
+    }
+    bound = last[0][0].as<int64_t>();
+
+    const auto sql = tkmQuery.exportData(Query::Type::PostgreSQL,
+                                         what,
+                                         job.getRange(),
+                                         false,
+                                         db->isPacked(),
+                                         db->getProjection(),
+                                         job.getCursor(),
+                                         bound);
+
+    db->runCursor(sql, stream.getChunkSize(), [&stream](const pqxx::result &result) {
+      if (!stream.hasColumns()) {
+        for (pqxx::row::size_type i = 0; i < result.columns(); i++) {
+          stream.addColumn(result.column_name(i));
+        }
+      }
+      for (auto c = result.begin(); c != result.end(); ++c) {
+        auto row = stream.addRow();
+        for (auto field = c.begin(); field != c.end(); ++field) {
+          row->add_value(field.is_null() ? "" : field.c_str());
+        }
+        if (!stream.commitRow()) {
+          return false;
+        }
       }
+      return true;
+    });
+  } catch (std::exception &e) {
+    logError() << "Database query fails: " << e.what();
+    reason = "Query failed";
+    return false;
+  }
+
+  if (bound < 0) {
+    job.nextTable();
+  } else {
+    job.setCursor(bound);
+  }
+  done = job.isDone();
+
+  return !stream.hasError();
+}
+
+// Queue the next step behind the pending requests
+static bool queueExport(const std::shared_ptr<PQDatabase> &db,
+                        const IDatabase::Request &rq,
+                        const std::shared_ptr<ExportJob> &job)
+{
+  IDatabase::Request dbrq{.client = rq.client,
+                          .action = rq.action,
+                          .args = rq.args,
+                          .bulkData = std::make_any<std::shared_ptr<ExportJob>>(job)};
+  return db->pushRequest(dbrq);
+}
+
+static bool doExportSession(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  std::string reason = "Failed to send session data";
+  std::shared_ptr<ExportJob> job = nullptr;
+  bool status = false;
+  bool done = false;
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
 
-      auto tmpDev = devList.add_device();
-      tmpDev->CopyFrom(dev);
+  if (rq.bulkData.type() == typeid(std::shared_ptr<ExportJob>)) {
+    job = std::any_cast<std::shared_ptr<ExportJob>>(rq.bulkData);
+  } else {
+    logDebug() << "Handling DB ExportSession request from client: " << rq.client->getName();
+    const auto &filter = std::any_cast<tkm::msg::ext::ExportFilter>(rq.bulkData);
+    job = startExport(
+        db, filter, [&rq]() { return std::make_shared<ExportStream>(rq.client); }, reason);
+  }
+
+  if (job != nullptr) {
+    status = exportStep(db, *job, done, reason);
+    if (status && !done) {
+      return queueExport(db, rq, job);
+    }
+    if (status) {
+      status = job->getStream().finish();
     }
+  }
+
+  if (status) {
+    reason = "Exported " + std::to_string(job->getStream().getRowCount()) + " rows";
+  }
+
+  mrq.args.emplace(Defaults::Arg::Reason, reason);
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
 
-    message.set_type(tkm::msg::control::Message_Type_DeviceList);
-    message.mutable_data()->PackFrom(devList);
-    envelope.mutable_mesg()->PackFrom(message);
+static bool doArchiveSession(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  std::string reason = "Failed to write archive";
+  std::shared_ptr<ExportJob> job = nullptr;
+  bool status = false;
+  bool done = false;
 
-    envelope.set_target(msg::Envelope_Recipient_Any);
-    envelope.set_origin(msg::Envelope_Recipient_Collector);
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
 
-    if (!rq.client->writeEnvelope(envelope)) {
-      logWarn() << "Fail to send device list to client " << rq.client->getFD();
-      mrq.args.emplace(Defaults::Arg::Reason, "Failed to send device list");
+  try {
+    if (rq.bulkData.type() == typeid(std::shared_ptr<ExportJob>)) {
+      job = std::any_cast<std::shared_ptr<ExportJob>>(rq.bulkData);
     } else {
-      mrq.args.emplace(Defaults::Arg::Reason, "List provided");
+      const auto &filter = std::any_cast<tkm::msg::ext::ExportFilter>(rq.bulkData);
+      logDebug() << "Handling DB ArchiveSession request for session " << filter.session_hash();
+      // A second job would write the same temporary file
+      if (ExportStream::isArchiving(filter.session_hash())) {
+        reason = "Session archive already in progress";
+      } else {
+        job = startExport(
+            db,
+            filter,
+            [&filter]() {
+              return std::make_shared<ExportStream>(
+                  ExportStream::getArchivePath(filter.session_hash()));
+            },
+            reason);
+      }
+    }
+
+    if (job != nullptr) {
+      status = exportStep(db, *job, done, reason);
+      if (status && !done) {
+        return queueExport(db, rq, job);
+      }
+      if (status) {
+        status = job->getStream().finish();
+      }
+    }
+    if (status) {
+      reason = "Archived " + std::to_string(job->getStream().getRowCount()) + " rows to " +
+               job->getStream().getArchivePath().string();
+      logInfo() << reason;
     }
-  } else {
-    mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
+  } catch (std::exception &e) {
+    logError() << "Fail to create session archive. Reason: " << e.what();
+    status = false;
   }
 
+  mrq.args.emplace(Defaults::Arg::Reason, reason);
   mrq.args.emplace(Defaults::Arg::Status,
                    status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
                                   : tkmDefaults.valFor(Defaults::Val::StatusError));
@@ -382,90 +899,161 @@ static bool doGetDevices(const std::shared_ptr<PQDatabase> &db, const IDatabase:
   return CollectorApp()->getDispatcher()->pushRequest(mrq);
 }
 
-static bool doGetSessions(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
+static bool doAggregate(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
 {
   Dispatcher::Request mrq{.client = rq.client,
                           .action = Dispatcher::Action::SendStatus,
                           .args = std::map<Defaults::Arg, std::string>(),
                           .bulkData = std::make_any<int>(0)};
-  auto sessionList = std::vector<tkm::msg::control::SessionData>();
-  bool status = true;
+  bool status = false;
 
   if (rq.args.count(Defaults::Arg::RequestId)) {
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
   }
 
-  logDebug() << "Handling DB GetSessions request from client: " << rq.client->getName();
-  const auto &deviceData = std::any_cast<tkm::msg::control::DeviceData>(rq.bulkData);
+  logDebug() << "Handling DB Aggregate request from client: " << rq.client->getName();
+  const auto &filter = std::any_cast<tkm::msg::ext::AggregateFilter>(rq.bulkData);
+  const auto sql = tkmQuery.aggregateData(
+      Query::Type::PostgreSQL, filter, false, db->isPacked(), db->getProjection());
 
-  try {
-    pqxx::result result;
+  if (sql.empty()) {
+    mrq.args.emplace(Defaults::Arg::Reason,
+                     tkmQuery.checkAggregate(filter, db->getProjection()));
+  } else {
+    AggregateStream stream(rq.client, filter);
+    std::vector<const char *> fields;
+
+    try {
+      db->runCursor(sql, stream.getChunkSize(), [&stream, &fields](const pqxx::result &result) {
+        for (auto c = result.begin(); c != result.end(); ++c) {
+          fields.clear();
+          for (auto field = c.begin(); field != c.end(); ++field) {
+            fields.push_back(field.is_null() ? nullptr : field.c_str());
+          }
+          if (!stream.addRow(fields.data(), fields.size())) {
+            return false;
+          }
+        }
+        return true;
+      });
+      status = stream.finish();
+    } catch (std::exception &e) {
+      logError() << "Database query fails: " << e.what();
+    }
 
-    if (deviceData.hash().empty()) {
-      result = db->runTransaction(tkmQuery.getSessions(Query::Type::PostgreSQL));
+    if (status) {
+      mrq.args.emplace(Defaults::Arg::Reason,
+                       "Aggregated " + std::to_string(stream.getBucketCount()) + " buckets");
+    } else if (stream.hasError()) {
+      mrq.args.emplace(Defaults::Arg::Reason, "Failed to send aggregate data");
     } else {
-      result = db->runTransaction(tkmQuery.getSessions(Query::Type::PostgreSQL, deviceData.hash()));
+      mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
     }
+  }
 
-    for (pqxx::result::const_iterator c = result.begin(); c != result.end(); ++c) {
-      tkm::msg::control::SessionData sessionData;
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
 
-      sessionData.set_id(
-          c[static_cast<pqxx::result::size_type>(Query::SessionColumn::Id)].as<long>());
-      sessionData.set_hash(
-          c[static_cast<pqxx::result::size_type>(Query::SessionColumn::Hash)].as<std::string>());
-      sessionData.set_name(
-          c[static_cast<pqxx::result::size_type>(Query::SessionColumn::Name)].as<std::string>());
-      sessionData.set_started(static_cast<uint64_t>(
-          c[static_cast<pqxx::result::size_type>(Query::SessionColumn::StartTimestamp)]
-              .as<long>()));
-      sessionData.set_ended(static_cast<uint64_t>(
-          c[static_cast<pqxx::result::size_type>(Query::SessionColumn::EndTimestamp)].as<long>()));
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
 
-      sessionList.push_back(sessionData);
-    }
-  } catch (std::exception &e) {
-    logError() << "Database query fails: " << e.what();
-    status = false;
+static bool doRetention(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
+{
+  static_cast<void>(rq); // UNUSED
+  auto retention = CollectorApp()->getRetention();
+
+  if (retention == nullptr) {
+    return true;
   }
 
-  if (status) {
-    tkm::msg::Envelope envelope;
-    tkm::msg::control::Message message;
-    tkm::msg::control::SessionList msgSessionList;
+  auto &job = retention->getJob();
+  const auto &policy = retention->getPolicy();
+
+  // Pick the next session to remove, deleted tuples are left to autovacuum
+  if (job.sessionId == 0) {
+    auto sessionList = std::vector<tkm::msg::control::SessionData>();
+    std::string sessionHash;
+    std::string reason;
 
-    for (auto &session : sessionList) {
-      if (session.ended() == 0) {
-        session.set_state(tkm::msg::control::SessionData_State_Progress);
+    try {
+      pqxx::result result;
+
+      if (retention->takeScheduled(sessionHash)) {
+        reason = "removal request";
+        result = db->runTransaction(tkmQuery.getSession(Query::Type::PostgreSQL, sessionHash));
       } else {
-        session.set_state(tkm::msg::control::SessionData_State_Complete);
+        uint64_t rows = 0;
+
+        if (policy.maxRows > 0) {
+          auto estimate = db->runTransaction(tkmQuery.getRowEstimate(Query::Type::PostgreSQL));
+          if (!estimate.empty()) {
+            rows = estimate[0][0].as<uint64_t>();
+          }
+        }
+
+        const bool overQuota = (policy.maxRows > 0) && (rows > policy.maxRows);
+        const uint64_t now = static_cast<uint64_t>(time(NULL));
+        const uint64_t endedBefore =
+            ((policy.maxAge > 0) && (now > policy.maxAge)) ? now - policy.maxAge : 0;
+        const auto sql = tkmQuery.getExpiredSession(
+            Query::Type::PostgreSQL, endedBefore, policy.deviceMaxSessions, overQuota);
+
+        reason = overQuota ? "over quota" : "policy";
+        if (!sql.empty()) {
+          result = db->runTransaction(sql);
+        }
+      }
+
+      for (pqxx::result::const_iterator c = result.begin(); c != result.end(); ++c) {
+        sessionList.push_back(sessionFromRow(c));
       }
-      auto tmpSession = msgSessionList.add_session();
-      tmpSession->CopyFrom(session);
+    } catch (std::exception &e) {
+      logError() << "Retention query fails: " << e.what();
+    }
+
+    if (sessionList.empty()) {
+      retention->stepDone();
+      return true;
     }
 
-    message.set_type(tkm::msg::control::Message_Type_SessionList);
-    message.mutable_data()->PackFrom(msgSessionList);
-    envelope.mutable_mesg()->PackFrom(message);
+    const auto &sessionData = sessionList.front();
+    retention->startJob(sessionData.id(), sessionData.hash(), reason);
+  }
 
-    envelope.set_target(msg::Envelope_Recipient_Any);
-    envelope.set_origin(msg::Envelope_Recipient_Collector);
+  // One batch of one table per step, each batch is its own transaction
+  const auto &tables = retention->getTables();
 
-    if (!rq.client->writeEnvelope(envelope)) {
-      logWarn() << "Fail to send session list to client " << rq.client->getFD();
-      mrq.args.emplace(Defaults::Arg::Reason, "Failed to send session list");
+  try {
+    if (db->isPartitioned()) {
+      // The session partitions are dropped at once, only rollup rows are deleted
+      db->runTransaction(tkmQuery.remSessionPartitions(Query::Type::PostgreSQL, job.sessionId) +
+                         tkmQuery.remSession(Query::Type::PostgreSQL, job.hash));
+      retention->finishJob(true);
+    } else if (job.table < tables.size()) {
+      auto result = db->runTransaction(tkmQuery.remSessionRows(Query::Type::PostgreSQL,
+                                                               tables.at(job.table),
+                                                               job.sessionId,
+                                                               policy.batchRows));
+      const auto changes = static_cast<uint64_t>(result.affected_rows());
+
+      job.rows += changes;
+      if (changes < policy.batchRows) {
+        job.table++;
+      }
+      logDebug() << "Retention session " << job.hash << " removed " << job.rows << " rows, table "
+                 << job.table << "/" << tables.size();
     } else {
-      mrq.args.emplace(Defaults::Arg::Reason, "List provided");
+      db->runTransaction(tkmQuery.remSession(Query::Type::PostgreSQL, job.hash));
+      retention->finishJob(true);
     }
-  } else {
-    mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
+  } catch (std::exception &e) {
+    logError() << "Retention query fails: " << e.what();
+    retention->finishJob(false);
   }
 
-  mrq.args.emplace(Defaults::Arg::Status,
-                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
-                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
-
-  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+  retention->stepDone();
+  return true;
 }
 
 static bool doAddDevice(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
@@ -481,7 +1069,8 @@ static bool doAddDevice(const std::shared_ptr<PQDatabase> &db, const IDatabase::
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
   }
 
-  logDebug() << "Handling DB AddDevice request from client: " << rq.client->getName();
+  logDebug() << "Handling DB AddDevice request from client: "
+             << ((rq.client != nullptr) ? rq.client->getName() : "collector");
   const auto &deviceData = std::any_cast<tkm::msg::control::DeviceData>(rq.bulkData);
 
   try {
@@ -528,7 +1117,16 @@ static bool doAddDevice(const std::shared_ptr<PQDatabase> &db, const IDatabase::
       mrq.args.emplace(Defaults::Arg::Reason, "Failed to add device");
     } else {
       mrq.args.emplace(Defaults::Arg::Reason, "Device added");
-      CollectorApp()->getDeviceManager()->loadDevices();
+      // Only the new entry is read back for its database id
+      try {
+        auto result =
+            db->runTransaction(tkmQuery.getDevice(Query::Type::PostgreSQL, deviceData.hash()));
+        for (pqxx::result::const_iterator c = result.begin(); c != result.end(); ++c) {
+          CollectorApp()->getDeviceManager()->loadDevice(deviceFromRow(c));
+        }
+      } catch (std::exception &e) {
+        logError() << "Database query fails: " << e.what();
+      }
     }
   } else {
     mrq.args.emplace(Defaults::Arg::Reason, "Cannot check existing device");
@@ -620,7 +1218,10 @@ static bool doAddSession(const std::shared_ptr<PQDatabase> &db, const IDatabase:
   if (sesId != -1) {
     logError() << "Session hash collision detected. Remove old session " << sessionInfo.hash();
     try {
-      db->runTransaction(tkmQuery.remSession(Query::Type::PostgreSQL, sessionInfo.hash()));
+      db->runTransaction(
+          (db->isPartitioned() ? tkmQuery.remSessionPartitions(Query::Type::PostgreSQL, sesId)
+                               : std::string()) +
+          tkmQuery.remSession(Query::Type::PostgreSQL, sessionInfo.hash()));
     } catch (std::exception &e) {
       logError() << "Failed to remove existing session. Database query fails: " << e.what();
     }
@@ -638,6 +1239,20 @@ static bool doAddSession(const std::shared_ptr<PQDatabase> &db, const IDatabase:
     status = false;
   }
 
+  // Partitions are created with the session, before its first sample
+  if (status && db->isPartitioned()) {
+    try {
+      auto result =
+          db->runTransaction(tkmQuery.hasSession(Query::Type::PostgreSQL, sessionInfo.hash()));
+      if (!result.empty()) {
+        db->runTransaction(
+            tkmQuery.addSessionPartitions(Query::Type::PostgreSQL, result[0][0].as<int64_t>()));
+      }
+    } catch (std::exception &e) {
+      logError() << "Failed to add session partitions. Database query fails: " << e.what();
+    }
+  }
+
   if (!status) {
     logError() << "Query failed to add session";
   }
@@ -676,9 +1291,16 @@ static bool doRemSession(const std::shared_ptr<PQDatabase> &db, const IDatabase:
     if (sesId == -1) {
       mrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
       mrq.args.emplace(Defaults::Arg::Reason, "No such session");
+    } else if (CollectorApp()->getRetention() != nullptr) {
+      // Deleted in batches by the retention job
+      CollectorApp()->getRetention()->schedule(sessionData.hash());
+      mrq.args.emplace(Defaults::Arg::Reason, "Session removal scheduled");
     } else {
       try {
-        db->runTransaction(tkmQuery.remSession(Query::Type::PostgreSQL, sessionData.hash()));
+        db->runTransaction(
+            (db->isPartitioned() ? tkmQuery.remSessionPartitions(Query::Type::PostgreSQL, sesId)
+                                 : std::string()) +
+            tkmQuery.remSession(Query::Type::PostgreSQL, sessionData.hash()));
       } catch (std::exception &e) {
         logError() << "Database query fails: " << e.what();
         status = false;
@@ -708,6 +1330,20 @@ static bool doEndSession(const std::shared_ptr<PQDatabase> &db, const IDatabase:
     throw std::runtime_error("Invalid arguments");
   }
 
+  // Spooled samples need the session to be still open
+  if ((db->getSpool() != nullptr) && db->isConnected()) {
+    while (!db->getSpool()->isEmpty()) {
+      if (!replaySpool(db)) {
+        break;
+      }
+    }
+  }
+
+  // Rollup rows need the session to be still open
+  db->getRollup().endSession(rq.args.at(Defaults::Arg::SessionHash));
+  writeRollups(db, rq.args.at(Defaults::Arg::SessionHash));
+  db->getChangeFilter().endSession(rq.args.at(Defaults::Arg::SessionHash));
+
   logDebug() << "Mark end session for " << rq.args.at(Defaults::Arg::SessionHash);
   try {
     db->runTransaction(
@@ -719,197 +1355,420 @@ static bool doEndSession(const std::shared_ptr<PQDatabase> &db, const IDatabase:
   return true;
 }
 
+static void writeRollups(const std::shared_ptr<PQDatabase> &db, const std::string &sessionHash)
+{
+  const auto buckets = db->getRollup().takeClosed();
+
+  if (buckets.empty()) {
+    return;
+  }
+
+  try {
+    db->runTransaction(tkmQuery.addRollups(Query::Type::PostgreSQL, sessionHash, buckets));
+  } catch (std::exception &e) {
+    logError() << "Query failed to add rollups. Database query fails: " << e.what();
+  }
+}
+
+// Extra arguments are passed on to the addData overload of the message type
+template <typename T, typename... Args>
+static auto getDataQuery(const std::string &sessionId,
+                         const tkm::msg::monitor::Data &data,
+                         T &message,
+                         const Args &...args) -> std::string
+{
+  data.payload().UnpackTo(&message);
+  return tkmQuery.addData(Query::Type::PostgreSQL,
+                          sessionId,
+                          message,
+                          data.system_time_sec(),
+                          data.monotonic_time_sec(),
+                          data.receive_time_sec(),
+                          args...);
+}
+
+// Insert statement of a spooled sample, empty for unknown or disabled data types.
+// A replay batch mixes sessions, the open session is looked up by the statement.
+static auto getDataQuery(const std::shared_ptr<PQDatabase> &db,
+                         const std::string &sessionHash,
+                         const tkm::msg::monitor::Data &data,
+                         uint64_t &rows) -> std::string
+{
+  const auto &projection = db->getProjection();
+  const bool packed = db->isPacked();
+  const auto sessionId = tkmQuery.getSessionId(Query::Type::PostgreSQL, sessionHash);
+
+  rows = 1;
+  if (db->isDisabled(data.what())) {
+    rows = 0;
+    return "";
+  }
+
+  switch (data.what()) {
+  case tkm::msg::monitor::Data_What_ProcEvent: {
+    tkm::msg::monitor::ProcEvent procEvent;
+    return getDataQuery(sessionId, data, procEvent, projection);
+  }
+  case tkm::msg::monitor::Data_What_ProcAcct: {
+    tkm::msg::monitor::ProcAcct procAcct;
+    return getDataQuery(sessionId, data, procAcct, projection);
+  }
+  case tkm::msg::monitor::Data_What_ProcInfo: {
+    tkm::msg::monitor::ProcInfo procInfo;
+    auto sql = getDataQuery(sessionId, data, procInfo, projection);
+    rows = static_cast<uint64_t>(procInfo.entry_size());
+    return sql;
+  }
+  case tkm::msg::monitor::Data_What_ContextInfo: {
+    tkm::msg::monitor::ContextInfo ctxInfo;
+    auto sql = getDataQuery(sessionId, data, ctxInfo, projection);
+    rows = static_cast<uint64_t>(ctxInfo.entry_size());
+    return sql;
+  }
+  case tkm::msg::monitor::Data_What_SysProcStat: {
+    tkm::msg::monitor::SysProcStat sysProcStat;
+    auto sql = getDataQuery(sessionId, data, sysProcStat, packed, projection);
+    rows = packed ? 1 : 1 + static_cast<uint64_t>(sysProcStat.core_size());
+    return sql;
+  }
+  case tkm::msg::monitor::Data_What_SysProcMemInfo: {
+    tkm::msg::monitor::SysProcMemInfo sysProcMem;
+    return getDataQuery(sessionId, data, sysProcMem, projection);
+  }
+  case tkm::msg::monitor::Data_What_SysProcPressure: {
+    tkm::msg::monitor::SysProcPressure sysProcPressure;
+    return getDataQuery(sessionId, data, sysProcPressure, projection);
+  }
+  case tkm::msg::monitor::Data_What_SysProcDiskStats: {
+    tkm::msg::monitor::SysProcDiskStats sysProcDiskStats;
+    auto sql = getDataQuery(sessionId, data, sysProcDiskStats, packed, projection);
+    rows = packed ? 1 : static_cast<uint64_t>(sysProcDiskStats.disk_size());
+    return sql;
+  }
+  case tkm::msg::monitor::Data_What_SysProcBuddyInfo: {
+    tkm::msg::monitor::SysProcBuddyInfo sysProcBuddyInfo;
+    auto sql = getDataQuery(sessionId, data, sysProcBuddyInfo, packed, projection);
+    rows = packed ? 1 : static_cast<uint64_t>(sysProcBuddyInfo.node_size());
+    return sql;
+  }
+  case tkm::msg::monitor::Data_What_SysProcWireless: {
+    tkm::msg::monitor::SysProcWireless sysProcWireless;
+    auto sql = getDataQuery(sessionId, data, sysProcWireless, packed, projection);
+    rows = packed ? 1 : static_cast<uint64_t>(sysProcWireless.ifw_size());
+    return sql;
+  }
+  case tkm::msg::monitor::Data_What_SysProcVMStat: {
+    tkm::msg::monitor::SysProcVMStat sysProcVMStat;
+    return getDataQuery(sessionId, data, sysProcVMStat, projection);
+  }
+  default:
+    break;
+  }
+
+  return "";
+}
+
+// Write one batch of spooled samples in a single transaction, false if the
+// database went away and the batch is kept for the next attempt
+static bool replaySpool(const std::shared_ptr<PQDatabase> &db)
+{
+  auto spool = db->getSpool();
+  std::vector<Spool::Record> records;
+  std::string sql;
+  uint64_t rows = 0;
+
+  if (!spool->read(db->getSpoolBatch(), records)) {
+    return false;
+  }
+  if (records.empty()) {
+    return true;
+  }
+
+  for (const auto &record : records) {
+    uint64_t recordRows = 0;
+    sql += getDataQuery(db, record.sessionHash, record.data, recordRows);
+    rows += recordRows;
+  }
+
+  try {
+    db->runTransaction(sql);
+    logDebug() << "Replayed " << records.size() << " spooled samples, " << rows << " rows";
+    return spool->commit(records.size());
+  } catch (std::exception &e) {
+    if (!db->isConnected()) {
+      logWarn() << "Database connection lost during spool replay";
+      return false;
+    }
+    logError() << "Spool batch replay failed, retry samples one by one. Reason: " << e.what();
+  }
+
+  // A sample of a session unknown to the database fails the whole batch
+  for (size_t i = 0; i < records.size(); i++) {
+    uint64_t recordRows = 0;
+
+    try {
+      db->runTransaction(getDataQuery(db, records[i].sessionHash, records[i].data, recordRows));
+    } catch (std::exception &e) {
+      if (!db->isConnected()) {
+        spool->commit(i);
+        return false;
+      }
+      logError() << "Drop spooled sample for session " << records[i].sessionHash
+                 << ". Reason: " << e.what();
+    }
+  }
+
+  return spool->commit(records.size());
+}
+
 static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Request &rq)
 {
   const auto &data = std::any_cast<tkm::msg::monitor::Data>(rq.bulkData);
+  const auto writeStart = getMonotonicTimeNs();
   bool status = true;
+  uint64_t rows = 1;
 
   if ((rq.args.count(Defaults::Arg::SessionHash) == 0)) {
     logError() << "Invalid session data";
     throw std::runtime_error("Invalid arguments");
   }
 
-  auto writeProcAcct = [&db, &status](const std::string &sessionHash,
-                                      const tkm::msg::monitor::ProcAcct &acct,
-                                      uint64_t systemTime,
-                                      uint64_t monotonicTime,
-                                      uint64_t receiveTime) {
+  // Written later by the spool replay with the original timestamps
+  if (db->shouldSpool()) {
+    db->getSpool()->append(rq.args.at(Defaults::Arg::SessionHash), data);
+    return true;
+  }
+
+  // The open session is read once per sample, the inserts write its Id
+  std::string sessionId;
+  bool broken = false;
+  try {
+    pqxx::result result = db->runTransaction(
+        tkmQuery.getOpenSession(Query::Type::PostgreSQL, rq.args.at(Defaults::Arg::SessionHash)));
+    if (!result.empty()) {
+      sessionId = std::to_string(result[0][0].as<long>());
+    }
+  } catch (const pqxx::broken_connection &e) {
+    logError() << "Query failed to get session. Database connection lost: " << e.what();
+    broken = true;
+  } catch (std::exception &e) {
+    logError() << "Query failed to get session. Database query fails: " << e.what();
+    broken = !db->isConnected();
+  }
+
+  // The sample is kept if the connection dropped before it was written
+  if (broken && (db->getSpool() != nullptr)) {
+    db->getSpool()->append(rq.args.at(Defaults::Arg::SessionHash), data);
+    return true;
+  }
+  if (sessionId.empty()) {
+    logError() << "No open session " << rq.args.at(Defaults::Arg::SessionHash) << " for data";
+    return true;
+  }
+
+  auto writeProcAcct = [&db, &status, &sessionId](const tkm::msg::monitor::ProcAcct &acct,
+                                                  uint64_t systemTime,
+                                                  uint64_t monotonicTime,
+                                                  uint64_t receiveTime) {
     try {
-      db->runTransaction(tkmQuery.addData(
-          Query::Type::PostgreSQL, sessionHash, acct, systemTime, monotonicTime, receiveTime));
+      db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
+                                          sessionId,
+                                          acct,
+                                          systemTime,
+                                          monotonicTime,
+                                          receiveTime,
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
     }
   };
 
-  auto writeProcInfo = [&db, &status](const std::string &sessionHash,
-                                      const tkm::msg::monitor::ProcInfo &info,
-                                      uint64_t systemTime,
-                                      uint64_t monotonicTime,
-                                      uint64_t receiveTime) {
+  auto writeProcInfo = [&db, &status, &sessionId](const tkm::msg::monitor::ProcInfo &info,
+                                                  uint64_t systemTime,
+                                                  uint64_t monotonicTime,
+                                                  uint64_t receiveTime) {
     try {
-      db->runTransaction(tkmQuery.addData(
-          Query::Type::PostgreSQL, sessionHash, info, systemTime, monotonicTime, receiveTime));
+      db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
+                                          sessionId,
+                                          info,
+                                          systemTime,
+                                          monotonicTime,
+                                          receiveTime,
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
     }
   };
 
-  auto writeContextInfo = [&db, &status](const std::string &sessionHash,
-                                         const tkm::msg::monitor::ContextInfo &info,
-                                         uint64_t systemTime,
-                                         uint64_t monotonicTime,
-                                         uint64_t receiveTime) {
+  auto writeContextInfo = [&db, &status, &sessionId](const tkm::msg::monitor::ContextInfo &info,
+                                                     uint64_t systemTime,
+                                                     uint64_t monotonicTime,
+                                                     uint64_t receiveTime) {
     try {
-      db->runTransaction(tkmQuery.addData(
-          Query::Type::PostgreSQL, sessionHash, info, systemTime, monotonicTime, receiveTime));
+      db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
+                                          sessionId,
+                                          info,
+                                          systemTime,
+                                          monotonicTime,
+                                          receiveTime,
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
     }
   };
 
-  auto writeSysProcStat = [&db, &status](const std::string &sessionHash,
-                                         const tkm::msg::monitor::SysProcStat &sysProcStat,
-                                         uint64_t systemTime,
-                                         uint64_t monotonicTime,
-                                         uint64_t receiveTime) {
+  auto writeSysProcStat = [&db, &status, &sessionId](
+                              const tkm::msg::monitor::SysProcStat &sysProcStat,
+                              uint64_t systemTime,
+                              uint64_t monotonicTime,
+                              uint64_t receiveTime) {
     try {
       db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
-                                          sessionHash,
+                                          sessionId,
                                           sysProcStat,
                                           systemTime,
                                           monotonicTime,
-                                          receiveTime));
+                                          receiveTime,
+                                          db->isPacked(),
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
     }
   };
 
-  auto writeSysProcMemInfo = [&db, &status](const std::string &sessionHash,
-                                            const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
-                                            uint64_t systemTime,
-                                            uint64_t monotonicTime,
-                                            uint64_t receiveTime) {
+  auto writeSysProcMemInfo = [&db, &status, &sessionId](
+                                 const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
+                                 uint64_t systemTime,
+                                 uint64_t monotonicTime,
+                                 uint64_t receiveTime) {
     try {
       db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
-                                          sessionHash,
+                                          sessionId,
                                           sysProcMem,
                                           systemTime,
                                           monotonicTime,
-                                          receiveTime));
+                                          receiveTime,
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
     }
   };
 
-  auto writeSysProcBuddyInfo =
-      [&db, &status](const std::string &sessionHash,
-                     const tkm::msg::monitor::SysProcBuddyInfo &sysProcBuddyInfo,
-                     uint64_t systemTime,
-                     uint64_t monotonicTime,
-                     uint64_t receiveTime) {
-        try {
-          db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
-                                              sessionHash,
-                                              sysProcBuddyInfo,
-                                              systemTime,
-                                              monotonicTime,
-                                              receiveTime));
-        } catch (std::exception &e) {
-          logError() << "Query failed to addData. Database query fails: " << e.what();
-          status = false;
-        }
-      };
-
-  auto writeSysProcWireless = [&db,
-                               &status](const std::string &sessionHash,
-                                        const tkm::msg::monitor::SysProcWireless &sysProcWireless,
-                                        uint64_t systemTime,
-                                        uint64_t monotonicTime,
-                                        uint64_t receiveTime) {
+  auto writeSysProcBuddyInfo = [&db, &status, &sessionId](
+                                   const tkm::msg::monitor::SysProcBuddyInfo &sysProcBuddyInfo,
+                                   uint64_t systemTime,
+                                   uint64_t monotonicTime,
+                                   uint64_t receiveTime) {
+    try {
+      db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
+                                          sessionId,
+                                          sysProcBuddyInfo,
+                                          systemTime,
+                                          monotonicTime,
+                                          receiveTime,
+                                          db->isPacked(),
+                                          db->getProjection()));
+    } catch (std::exception &e) {
+      logError() << "Query failed to addData. Database query fails: " << e.what();
+      status = false;
+    }
+  };
+
+  auto writeSysProcWireless = [&db, &status, &sessionId](
+                                  const tkm::msg::monitor::SysProcWireless &sysProcWireless,
+                                  uint64_t systemTime,
+                                  uint64_t monotonicTime,
+                                  uint64_t receiveTime) {
     try {
       db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
-                                          sessionHash,
+                                          sessionId,
                                           sysProcWireless,
                                           systemTime,
                                           monotonicTime,
-                                          receiveTime));
+                                          receiveTime,
+                                          db->isPacked(),
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
     }
   };
 
-  auto writeSysProcPressure = [&db,
-                               &status](const std::string &sessionHash,
-                                        const tkm::msg::monitor::SysProcPressure &sysProcPressure,
-                                        uint64_t systemTime,
-                                        uint64_t monotonicTime,
-                                        uint64_t receiveTime) {
+  auto writeSysProcPressure = [&db, &status, &sessionId](
+                                  const tkm::msg::monitor::SysProcPressure &sysProcPressure,
+                                  uint64_t systemTime,
+                                  uint64_t monotonicTime,
+                                  uint64_t receiveTime) {
     try {
       db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
-                                          sessionHash,
+                                          sessionId,
                                           sysProcPressure,
                                           systemTime,
                                           monotonicTime,
-                                          receiveTime));
+                                          receiveTime,
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
     }
   };
 
-  auto writeSysProcDiskStats =
-      [&db, &status](const std::string &sessionHash,
-                     const tkm::msg::monitor::SysProcDiskStats &sysProcDiskStats,
-                     uint64_t systemTime,
-                     uint64_t monotonicTime,
-                     uint64_t receiveTime) {
-        try {
-          db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
-                                              sessionHash,
-                                              sysProcDiskStats,
-                                              systemTime,
-                                              monotonicTime,
-                                              receiveTime));
-        } catch (std::exception &e) {
-          logError() << "Query failed to addData. Database query fails: " << e.what();
-          status = false;
-        }
-      };
-
-  auto writeSysProcVMStat =
-      [&db, &status](const std::string &sessionHash,
-                     const tkm::msg::monitor::SysProcVMStat &sysProcVMStat,
-                     uint64_t systemTime,
-                     uint64_t monotonicTime,
-                     uint64_t receiveTime) {
-        try {
-          db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
-                                              sessionHash,
-                                              sysProcVMStat,
-                                              systemTime,
-                                              monotonicTime,
-                                              receiveTime));
-        } catch (std::exception &e) {
-          logError() << "Query failed to addData. Database query fails: " << e.what();
-          status = false;
-        }
-      };
+  auto writeSysProcDiskStats = [&db, &status, &sessionId](
+                                   const tkm::msg::monitor::SysProcDiskStats &sysProcDiskStats,
+                                   uint64_t systemTime,
+                                   uint64_t monotonicTime,
+                                   uint64_t receiveTime) {
+    try {
+      db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
+                                          sessionId,
+                                          sysProcDiskStats,
+                                          systemTime,
+                                          monotonicTime,
+                                          receiveTime,
+                                          db->isPacked(),
+                                          db->getProjection()));
+    } catch (std::exception &e) {
+      logError() << "Query failed to addData. Database query fails: " << e.what();
+      status = false;
+    }
+  };
+
+  auto writeSysProcVMStat = [&db, &status, &sessionId](
+                                const tkm::msg::monitor::SysProcVMStat &sysProcVMStat,
+                                uint64_t systemTime,
+                                uint64_t monotonicTime,
+                                uint64_t receiveTime) {
+    try {
+      db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
+                                          sessionId,
+                                          sysProcVMStat,
+                                          systemTime,
+                                          monotonicTime,
+                                          receiveTime,
+                                          db->getProjection()));
+    } catch (std::exception &e) {
+      logError() << "Query failed to addData. Database query fails: " << e.what();
+      status = false;
+    }
+  };
 
-  auto writeProcEvent = [&db, &status](const std::string &sessionHash,
-                                       const tkm::msg::monitor::ProcEvent &procEvent,
-                                       uint64_t systemTime,
-                                       uint64_t monotonicTime,
-                                       uint64_t receiveTime) {
+  auto writeProcEvent = [&db, &status, &sessionId](const tkm::msg::monitor::ProcEvent &procEvent,
+                                                   uint64_t systemTime,
+                                                   uint64_t monotonicTime,
+                                                   uint64_t receiveTime) {
     try {
-      db->runTransaction(tkmQuery.addData(
-          Query::Type::PostgreSQL, sessionHash, procEvent, systemTime, monotonicTime, receiveTime));
+      db->runTransaction(tkmQuery.addData(Query::Type::PostgreSQL,
+                                          sessionId,
+                                          procEvent,
+                                          systemTime,
+                                          monotonicTime,
+                                          receiveTime,
+                                          db->getProjection()));
     } catch (std::exception &e) {
       logError() << "Query failed to addData. Database query fails: " << e.what();
       status = false;
@@ -920,8 +1779,7 @@ static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Re
   case tkm::msg::monitor::Data_What_ProcEvent: {
     tkm::msg::monitor::ProcEvent procEvent;
     data.payload().UnpackTo(&procEvent);
-    writeProcEvent(rq.args.at(Defaults::Arg::SessionHash),
-                   procEvent,
+    writeProcEvent(procEvent,
                    data.system_time_sec(),
                    data.monotonic_time_sec(),
                    data.receive_time_sec());
@@ -930,8 +1788,7 @@ static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Re
   case tkm::msg::monitor::Data_What_ProcAcct: {
     tkm::msg::monitor::ProcAcct procAcct;
     data.payload().UnpackTo(&procAcct);
-    writeProcAcct(rq.args.at(Defaults::Arg::SessionHash),
-                  procAcct,
+    writeProcAcct(procAcct,
                   data.system_time_sec(),
                   data.monotonic_time_sec(),
                   data.receive_time_sec());
@@ -940,58 +1797,84 @@ static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Re
   case tkm::msg::monitor::Data_What_ProcInfo: {
     tkm::msg::monitor::ProcInfo procInfo;
     data.payload().UnpackTo(&procInfo);
-    writeProcInfo(rq.args.at(Defaults::Arg::SessionHash),
-                  procInfo,
+    const auto &changes = db->getChangeFilter().filter(
+        rq.args.at(Defaults::Arg::SessionHash), procInfo, data.system_time_sec());
+    rows = static_cast<uint64_t>(changes.entry_size());
+    writeProcInfo(changes,
                   data.system_time_sec(),
                   data.monotonic_time_sec(),
                   data.receive_time_sec());
+    // Processes gone since the previous sample
+    const auto &tombstones = db->getChangeFilter().getProcInfoTombstones();
+    if (status && (tombstones.entry_size() > 0)) {
+      writeProcInfo(tombstones, data.system_time_sec(), data.monotonic_time_sec(), 0);
+    }
+    if (status) {
+      db->getRollup().add(rq.args.at(Defaults::Arg::SessionHash), procInfo, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_ContextInfo: {
     tkm::msg::monitor::ContextInfo ctxInfo;
     data.payload().UnpackTo(&ctxInfo);
-    writeContextInfo(rq.args.at(Defaults::Arg::SessionHash),
-                     ctxInfo,
+    const auto &changes = db->getChangeFilter().filter(
+        rq.args.at(Defaults::Arg::SessionHash), ctxInfo, data.system_time_sec());
+    rows = static_cast<uint64_t>(changes.entry_size());
+    writeContextInfo(changes,
                      data.system_time_sec(),
                      data.monotonic_time_sec(),
                      data.receive_time_sec());
+    const auto &tombstones = db->getChangeFilter().getContextInfoTombstones();
+    if (status && (tombstones.entry_size() > 0)) {
+      writeContextInfo(tombstones, data.system_time_sec(), data.monotonic_time_sec(), 0);
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcStat: {
     tkm::msg::monitor::SysProcStat sysProcStat;
     data.payload().UnpackTo(&sysProcStat);
-    writeSysProcStat(rq.args.at(Defaults::Arg::SessionHash),
-                     sysProcStat,
+    rows = 1 + static_cast<uint64_t>(sysProcStat.core_size());
+    writeSysProcStat(sysProcStat,
                      data.system_time_sec(),
                      data.monotonic_time_sec(),
                      data.receive_time_sec());
+    if (status) {
+      db->getRollup().add(
+          rq.args.at(Defaults::Arg::SessionHash), sysProcStat, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcMemInfo: {
     tkm::msg::monitor::SysProcMemInfo sysProcMem;
     data.payload().UnpackTo(&sysProcMem);
-    writeSysProcMemInfo(rq.args.at(Defaults::Arg::SessionHash),
-                        sysProcMem,
+    writeSysProcMemInfo(sysProcMem,
                         data.system_time_sec(),
                         data.monotonic_time_sec(),
                         data.receive_time_sec());
+    if (status) {
+      db->getRollup().add(
+          rq.args.at(Defaults::Arg::SessionHash), sysProcMem, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcPressure: {
     tkm::msg::monitor::SysProcPressure sysProcPressure;
     data.payload().UnpackTo(&sysProcPressure);
-    writeSysProcPressure(rq.args.at(Defaults::Arg::SessionHash),
-                         sysProcPressure,
+    writeSysProcPressure(sysProcPressure,
                          data.system_time_sec(),
                          data.monotonic_time_sec(),
                          data.receive_time_sec());
+    if (status) {
+      db->getRollup().add(
+          rq.args.at(Defaults::Arg::SessionHash), sysProcPressure, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcDiskStats: {
     tkm::msg::monitor::SysProcDiskStats sysProcDiskStats;
     data.payload().UnpackTo(&sysProcDiskStats);
-    writeSysProcDiskStats(rq.args.at(Defaults::Arg::SessionHash),
-                          sysProcDiskStats,
+    rows = static_cast<uint64_t>(sysProcDiskStats.disk_size());
+    writeSysProcDiskStats(sysProcDiskStats,
                           data.system_time_sec(),
                           data.monotonic_time_sec(),
                           data.receive_time_sec());
@@ -1000,8 +1883,8 @@ static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Re
   case tkm::msg::monitor::Data_What_SysProcBuddyInfo: {
     tkm::msg::monitor::SysProcBuddyInfo sysProcBuddyInfo;
     data.payload().UnpackTo(&sysProcBuddyInfo);
-    writeSysProcBuddyInfo(rq.args.at(Defaults::Arg::SessionHash),
-                          sysProcBuddyInfo,
+    rows = static_cast<uint64_t>(sysProcBuddyInfo.node_size());
+    writeSysProcBuddyInfo(sysProcBuddyInfo,
                           data.system_time_sec(),
                           data.monotonic_time_sec(),
                           data.receive_time_sec());
@@ -1010,8 +1893,8 @@ static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Re
   case tkm::msg::monitor::Data_What_SysProcWireless: {
     tkm::msg::monitor::SysProcWireless sysProcWireless;
     data.payload().UnpackTo(&sysProcWireless);
-    writeSysProcWireless(rq.args.at(Defaults::Arg::SessionHash),
-                         sysProcWireless,
+    rows = static_cast<uint64_t>(sysProcWireless.ifw_size());
+    writeSysProcWireless(sysProcWireless,
                          data.system_time_sec(),
                          data.monotonic_time_sec(),
                          data.receive_time_sec());
@@ -1020,8 +1903,7 @@ static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Re
   case tkm::msg::monitor::Data_What_SysProcVMStat: {
     tkm::msg::monitor::SysProcVMStat sysProcVMStat;
     data.payload().UnpackTo(&sysProcVMStat);
-    writeSysProcVMStat(rq.args.at(Defaults::Arg::SessionHash),
-                       sysProcVMStat,
+    writeSysProcVMStat(sysProcVMStat,
                        data.system_time_sec(),
                        data.monotonic_time_sec(),
                        data.receive_time_sec());
@@ -1031,6 +1913,39 @@ static bool doAddData(const std::shared_ptr<PQDatabase> &db, const IDatabase::Re
     break;
   }
 
+  // The sample is kept if the connection dropped while writing it
+  if (!status && !db->isConnected() && (db->getSpool() != nullptr)) {
+    db->getSpool()->append(rq.args.at(Defaults::Arg::SessionHash), data);
+    return true;
+  }
+
+  writeRollups(db, rq.args.at(Defaults::Arg::SessionHash));
+
+  const auto commitTime = getMonotonicTimeNs();
+
+  // Sample latency from collector receive to database commit
+  if (status && (rq.args.count(Defaults::Arg::ReceiveTime) > 0)) {
+    db->getLatency().record(data.what(),
+                            std::stoull(rq.args.at(Defaults::Arg::ReceiveTime)),
+                            writeStart,
+                            commitTime);
+  }
+
+  // Account database cost to the source device
+  if (rq.args.count(Defaults::Arg::DeviceHash) > 0) {
+    auto device =
+        CollectorApp()->getDeviceManager()->getDevice(rq.args.at(Defaults::Arg::DeviceHash));
+    if (device != nullptr) {
+      auto &stats = device->getStats();
+
+      if (rq.args.count(Defaults::Arg::EnqueueTime) > 0) {
+        stats.queueTime += writeStart - std::stoull(rq.args.at(Defaults::Arg::EnqueueTime));
+      }
+      stats.dbTime += commitTime - writeStart;
+      stats.dbRows += status ? rows : 0;
+    }
+  }
+
   return true;
 }
 
@@ -1038,7 +1953,7 @@ static bool doConnect(const std::shared_ptr<PQDatabase> &db)
 {
   logDebug() << "Handling DB Connect request";
 
-  if (db->getConnection()->is_open()) {
+  if (db->isConnected()) {
     return true;
   }
 
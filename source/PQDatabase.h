@@ -14,8 +14,10 @@
 #include "IDatabase.h"
 #include "Logger.h"
 #include "Options.h"
+#include "Spool.h"
 
 #include <any>
+#include <functional>
 #include <pqxx/pqxx>
 
 using namespace bswi::log;
@@ -34,9 +36,29 @@ public:
   void enableEvents() final;
   auto getShared() -> std::shared_ptr<PQDatabase> { return shared_from_this(); }
   auto getConnection() -> const std::unique_ptr<pqxx::connection> & { return m_connection; }
+  bool isConnected() const { return (m_connection != nullptr) && m_connection->is_open(); }
+  // Configured layout for new tables and layout of the existing ones
+  bool usePartitions() const { return m_usePartitions; }
+  bool isPartitioned() const { return m_partitioned; }
+  void checkPartitioned();
+  bool usePacked() const { return m_usePacked; }
+  bool isPacked() const { return m_packed; }
+  void checkPacked();
+  // Tables not matching the ingest configuration keep their columns
+  void checkProjection();
+  // Null when the spool is disabled
+  auto getSpool() -> std::shared_ptr<Spool> { return m_spool; }
+  auto getSpoolBatch() const -> size_t { return m_spoolBatch; }
+  // Spool samples while the database is down or has queueLimit requests behind
+  bool shouldSpool();
   bool requestHandler(const IDatabase::Request &request) final;
 
   auto runTransaction(const std::string &sql) -> pqxx::result;
+  // Read the select result through a server side cursor, fetchSize rows at a
+  // time. Fetching stops when the consumer returns false.
+  void runCursor(const std::string &sql,
+                 uint32_t fetchSize,
+                 const std::function<bool(const pqxx::result &)> &consumer);
   bool reconnect();
 
 public:
@@ -45,6 +67,13 @@ public:
 
 private:
   std::unique_ptr<pqxx::connection> m_connection = nullptr;
+  std::shared_ptr<Spool> m_spool = nullptr;
+  bool m_usePartitions = false;
+  bool m_partitioned = false;
+  bool m_usePacked = false;
+  bool m_packed = false;
+  size_t m_spoolBatch = 0;
+  uint64_t m_spoolQueueLimit = 0;
 };
 
 } // namespace tkm::collector
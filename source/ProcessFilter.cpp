@@ -0,0 +1,130 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ProcessFilter Class
+ * @details   Top N process selection of ProcInfo and ProcAcct samples
+ *-
+ */
+
+#include <algorithm>
+#include <sstream>
+
+#include "ProcessFilter.h"
+
+namespace tkm::collector
+{
+
+ProcessFilter::ProcessFilter(bool enabled,
+                             size_t count,
+                             const std::string &order,
+                             const std::string &allow)
+: m_count(count)
+, m_order((order == "rss") ? Order::RSS : Order::CPU)
+, m_enabled(enabled)
+{
+  std::stringstream names(allow);
+  std::string name;
+
+  while (std::getline(names, name, ',')) {
+    name.erase(0, name.find_first_not_of(' '));
+    name.erase(name.find_last_not_of(' ') + 1);
+    if (!name.empty()) {
+      m_allow.insert(name);
+    }
+  }
+}
+
+bool ProcessFilter::filter(const tkm::msg::monitor::Data &data, std::any &bulkData)
+{
+  if (!m_enabled) {
+    return true;
+  }
+
+  switch (data.what()) {
+  case tkm::msg::monitor::Data_What_ProcInfo: {
+    data.payload().UnpackTo(&m_procInfo);
+    if (select(m_procInfo)) {
+      tkm::msg::monitor::Data selected;
+
+      selected.CopyFrom(data);
+      selected.mutable_payload()->PackFrom(m_procInfo);
+      bulkData = std::make_any<tkm::msg::monitor::Data>(std::move(selected));
+    }
+    break;
+  }
+  case tkm::msg::monitor::Data_What_ProcAcct: {
+    data.payload().UnpackTo(&m_procAcct);
+    if (!m_hasSelection || isAllowed(m_procAcct.ac_comm())) {
+      return true;
+    }
+    return std::binary_search(
+        m_selected.cbegin(), m_selected.cend(), static_cast<uint64_t>(m_procAcct.ac_pid()));
+  }
+  default:
+    break;
+  }
+
+  return true;
+}
+
+bool ProcessFilter::select(tkm::msg::monitor::ProcInfo &procInfo)
+{
+  auto *entries = procInfo.mutable_entry();
+  // Entries are reordered by swapping their pointers, nothing is copied
+  auto first = entries->pointer_begin();
+  auto last = entries->pointer_end();
+  auto heavy =
+      std::partition(first, last, [this](const auto *entry) { return isAllowed(entry->comm()); });
+  bool removed = false;
+
+  if (static_cast<size_t>(last - heavy) > m_count) {
+    auto other = heavy + static_cast<std::ptrdiff_t>(m_count);
+
+    if (m_order == Order::RSS) {
+      std::nth_element(heavy, other, last, [](const auto *a, const auto *b) {
+        return a->mem_rss() > b->mem_rss();
+      });
+    } else {
+      std::nth_element(heavy, other, last, [](const auto *a, const auto *b) {
+        return a->cpu_percent() > b->cpu_percent();
+      });
+    }
+
+    // The first unselected entry becomes the sum of all unselected entries
+    auto *sum = *other;
+    for (auto it = other + 1; it != last; ++it) {
+      sum->set_cpu_time(sum->cpu_time() + (*it)->cpu_time());
+      sum->set_cpu_percent(sum->cpu_percent() + (*it)->cpu_percent());
+      sum->set_mem_rss(sum->mem_rss() + (*it)->mem_rss());
+      sum->set_mem_pss(sum->mem_pss() + (*it)->mem_pss());
+      sum->set_fd_count(sum->fd_count() + (*it)->fd_count());
+    }
+    sum->set_comm("other");
+    sum->set_pid(0);
+    sum->set_ppid(0);
+    sum->set_ctx_id(0);
+    sum->set_ctx_name("");
+
+    const auto count = last - other - 1;
+    for (std::ptrdiff_t i = 0; i < count; i++) {
+      entries->RemoveLast();
+    }
+    removed = true;
+  }
+
+  m_hasSelection = true;
+  m_selected.clear();
+  for (const auto &entry : procInfo.entry()) {
+    if (entry.pid() != 0) {
+      m_selected.push_back(static_cast<uint64_t>(entry.pid()));
+    }
+  }
+  std::sort(m_selected.begin(), m_selected.end());
+
+  return removed;
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,64 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ProcessFilter Class
+ * @details   Top N process selection of ProcInfo and ProcAcct samples
+ *-
+ */
+
+#pragma once
+
+#include <any>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+#include <taskmonitor/taskmonitor.h>
+
+namespace tkm::collector
+{
+
+// ProcInfo samples keep the processes named in the allow list and the Count
+// heaviest other processes by CPU percent or RSS. The remaining processes are
+// summed in a single entry with comm "other" and pid 0. ProcAcct samples carry
+// one process each, they are kept if the process is allowed or was selected
+// in the last ProcInfo sample, all of them are kept until a ProcInfo sample
+// is seen.
+class ProcessFilter
+{
+public:
+  enum class Order { CPU, RSS };
+
+public:
+  ProcessFilter(bool enabled, size_t count, const std::string &order, const std::string &allow);
+  ~ProcessFilter() = default;
+
+  // False if the sample is dropped, bulkData is replaced when the sample changed
+  bool filter(const tkm::msg::monitor::Data &data, std::any &bulkData);
+
+  [[nodiscard]] bool isEnabled() const { return m_enabled; }
+
+public:
+  ProcessFilter(ProcessFilter const &) = delete;
+  void operator=(ProcessFilter const &) = delete;
+
+private:
+  // Reorder the entries in place, false if nothing was removed
+  bool select(tkm::msg::monitor::ProcInfo &procInfo);
+  bool isAllowed(const std::string &comm) const { return m_allow.count(comm) > 0; }
+
+private:
+  std::set<std::string> m_allow{};
+  std::vector<uint64_t> m_selected{}; // Sorted pids of the last ProcInfo sample
+  tkm::msg::monitor::ProcInfo m_procInfo{};
+  tkm::msg::monitor::ProcAcct m_procAcct{};
+  size_t m_count = 0;
+  Order m_order = Order::CPU;
+  bool m_hasSelection = false;
+  bool m_enabled = false;
+};
+
+} // namespace tkm::collector
@@ -11,10 +11,153 @@
 
 #include "Query.h"
 
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
 namespace tkm
 {
 
-auto Query::createTables(Query::Type type) -> std::string
+// Rows per INSERT statement, keeps large samples well below the SQL length limits
+constexpr int GQueryInsertRows = 500;
+
+// Tables without rowid get the Id written by the INSERT
+static bool isOrdinalInsert(Query::Type type, bool clustered)
+{
+  return clustered && (type == Query::Type::SQLite3);
+}
+
+// The INSERT statements of the rows of one sample, a new statement is started
+// every GQueryInsertRows rows. On clustered tables every row ends with its
+// ordinal in the statement, which the statement header turns into the Id.
+class DataInsert
+{
+public:
+  DataInsert(std::stringstream &out, Query::Type type, const std::string &header, bool clustered)
+  : m_out(out)
+  , m_header(header)
+  , m_type(type)
+  , m_ordinal(isOrdinalInsert(type, clustered))
+  {
+  }
+
+  // Write what goes before the row at index, returns the row ordinal or -1
+  auto row(int index) -> int64_t
+  {
+    if (index == 0) {
+      m_out << m_header;
+    } else if ((index % GQueryInsertRows) == 0) {
+      end();
+      m_out << m_header;
+    } else {
+      m_out << ", ";
+    }
+    return m_ordinal ? (index % GQueryInsertRows) : -1;
+  }
+  void end() { m_out << (m_ordinal ? ") AS v;" : ";"); }
+
+  auto getStream() -> std::stringstream & { return m_out; }
+  [[nodiscard]] auto getType() const -> Query::Type { return m_type; }
+
+private:
+  std::stringstream &m_out;
+  std::string m_header;
+  Query::Type m_type;
+  bool m_ordinal = false;
+};
+
+// Entries of one packed sample get consecutive Ids in the entry views
+constexpr int64_t GQueryPackedIdStride = 65536;
+
+// Append a number to the elements of a packed array column
+template <typename T>
+static void addArrayValue(std::string &array, const T &value)
+{
+  if (!array.empty()) {
+    array += ",";
+  }
+  array += std::to_string(value);
+}
+
+// Text elements are quoted for PostgreSQL arrays, as JSON strings on SQLite
+static void addArrayText(std::string &array, Query::Type type, const std::string &value)
+{
+  if (!array.empty()) {
+    array += ",";
+  }
+  if (type == Query::Type::PostgreSQL) {
+    array += "'" + value + "'";
+    return;
+  }
+  array += "\"";
+  for (const auto c : value) {
+    if ((c == '"') || (c == '\\')) {
+      array += '\\';
+    }
+    array += c;
+  }
+  array += "\"";
+}
+
+// Write the values of one data row in table order, the columns left out by the
+// table projection are skipped. SessionId is the last column of every table.
+class RowValues
+{
+public:
+  RowValues(DataInsert &insert, int index, const std::vector<bool> &stored)
+  : m_out(insert.getStream())
+  , m_stored(stored)
+  , m_type(insert.getType())
+  , m_ordinal(insert.row(index))
+  {
+    m_out << "(";
+  }
+
+  template <typename T>
+  auto add(const T &value) -> RowValues &
+  {
+    if (m_stored.at(m_column++)) {
+      m_out << "'" << value << "', ";
+    }
+    return *this;
+  }
+
+  // Array column of a packed row
+  auto addArray(const std::string &array) -> RowValues &
+  {
+    if (!m_stored.at(m_column++)) {
+      return *this;
+    }
+    if (m_type == Query::Type::PostgreSQL) {
+      m_out << "ARRAY[" << array << "], ";
+    } else {
+      m_out << "'[" << array << "]', ";
+    }
+    return *this;
+  }
+
+  void end(const std::string &sessionId)
+  {
+    m_out << sessionId;
+    if (m_ordinal >= 0) {
+      m_out << ", " << m_ordinal;
+    }
+    m_out << ")";
+  }
+
+private:
+  std::stringstream &m_out;
+  const std::vector<bool> &m_stored;
+  Query::Type m_type;
+  int64_t m_ordinal = -1;
+  size_t m_column = 0;
+};
+
+auto Query::createTables(Query::Type type,
+                         bool partitioned,
+                         bool clustered,
+                         bool packed,
+                         const Projection &projection) -> std::string
 {
   std::stringstream out;
 
@@ -53,558 +196,344 @@ auto Query::createTables(Query::Type type) -> std::string
     out << "CONSTRAINT KFDevice FOREIGN KEY(" << m_sessionColumn.at(SessionColumn::Device)
         << ") REFERENCES " << m_devicesTableName << "(" << m_deviceColumn.at(DeviceColumn::Id)
         << ") ON DELETE CASCADE);";
+  }
 
-    // ProcEvent table
-    out << "CREATE TABLE IF NOT EXISTS " << m_procEventTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_procEventColumn.at(ProcEventColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_procEventColumn.at(ProcEventColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ForkCount) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ExecCount) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ExitCount) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::UIdCount) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::GIdCount) << " INTEGER NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::SessionId) << " INTEGER NOT NULL, ";
-    } else {
-      out << m_procEventColumn.at(ProcEventColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_procEventColumn.at(ProcEventColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ForkCount) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ExecCount) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::ExitCount) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::UIdCount) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::GIdCount) << " BIGINT NOT NULL, "
-          << m_procEventColumn.at(ProcEventColumn::SessionId) << " INTEGER NOT NULL, ";
-    }
-    out << "CONSTRAINT KFSession FOREIGN KEY(" << m_procEventColumn.at(ProcEventColumn::SessionId)
-        << ") REFERENCES " << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+  out << createDataTables(type, partitioned, clustered, packed, projection);
 
-    // SysProcStat table
-    out << "CREATE TABLE IF NOT EXISTS " << m_sysProcStatTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_sysProcStatColumn.at(SysProcStatColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatName) << " TEXT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatAll) << " INTEGER NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatUsr) << " INTEGER NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatSys) << " INTEGER NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatIow) << " INTEGER NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::SessionId) << " INTEGER NOT NULL, ";
-    } else {
-      out << m_sysProcStatColumn.at(SysProcStatColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatName) << " TEXT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatAll) << " BIGINT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatUsr) << " BIGINT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatSys) << " BIGINT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatIow) << " BIGINT NOT NULL, "
-          << m_sysProcStatColumn.at(SysProcStatColumn::SessionId) << " INTEGER NOT NULL, ";
-    }
-    out << "CONSTRAINT KFSession FOREIGN KEY("
-        << m_sysProcStatColumn.at(SysProcStatColumn::SessionId) << ") REFERENCES "
-        << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+  // Rollups table
+  out << "CREATE TABLE IF NOT EXISTS " << m_rollupsTableName << " (";
+  if (type == Query::Type::SQLite3) {
+    out << m_rollupColumn.at(RollupColumn::Id) << " INTEGER PRIMARY KEY, "
+        << m_rollupColumn.at(RollupColumn::Source) << " TEXT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::Metric) << " TEXT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::Label) << " TEXT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::Width) << " INTEGER NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::BucketStart) << " INTEGER NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::MinValue) << " REAL NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::MaxValue) << " REAL NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::SumValue) << " REAL NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::SampleCount) << " INTEGER NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::SessionId) << " INTEGER NOT NULL, ";
+  } else {
+    out << m_rollupColumn.at(RollupColumn::Id) << " SERIAL PRIMARY KEY, "
+        << m_rollupColumn.at(RollupColumn::Source) << " TEXT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::Metric) << " TEXT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::Label) << " TEXT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::Width) << " BIGINT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::BucketStart) << " BIGINT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::MinValue) << " DOUBLE PRECISION NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::MaxValue) << " DOUBLE PRECISION NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::SumValue) << " DOUBLE PRECISION NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::SampleCount) << " BIGINT NOT NULL, "
+        << m_rollupColumn.at(RollupColumn::SessionId) << " INTEGER NOT NULL, ";
+  }
+  out << "CONSTRAINT KFSession FOREIGN KEY(" << m_rollupColumn.at(RollupColumn::SessionId)
+      << ") REFERENCES " << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
+      << ") ON DELETE CASCADE);";
 
-    // SysProcMemInfo table
-    out << "CREATE TABLE IF NOT EXISTS " << m_sysProcMemInfoTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_sysProcMemColumn.at(SysProcMemColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemTotal) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemFree) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemAvail) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemCached) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemAvailPercent) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::Active) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::Inactive) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::Slab) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::KReclaimable) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SReclaimable) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SUnreclaim) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::KernelStack) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapTotal) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapFree) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapCached) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapFreePercent) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::CmaTotal) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::CmaFree) << " INTEGER NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SessionId) << " INTEGER NOT NULL, ";
-    } else {
-      out << m_sysProcMemColumn.at(SysProcMemColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemTotal) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemFree) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemAvail) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemCached) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::MemAvailPercent) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::Active) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::Inactive) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::Slab) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::KReclaimable) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SReclaimable) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SUnreclaim) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::KernelStack) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapTotal) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapFree) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapCached) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SwapFreePercent) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::CmaTotal) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::CmaFree) << " BIGINT NOT NULL, "
-          << m_sysProcMemColumn.at(SysProcMemColumn::SessionId) << " INTEGER NOT NULL, ";
-    }
-    out << "CONSTRAINT KFSession FOREIGN KEY(" << m_sysProcMemColumn.at(SysProcMemColumn::SessionId)
-        << ") REFERENCES " << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+  // Charts read one series of one session at one resolution in time order
+  out << "CREATE INDEX IF NOT EXISTS " << m_rollupsTableName << "Series ON "
+      << m_rollupsTableName << " (" << m_rollupColumn.at(RollupColumn::SessionId) << ", "
+      << m_rollupColumn.at(RollupColumn::Source) << ", "
+      << m_rollupColumn.at(RollupColumn::Metric) << ", "
+      << m_rollupColumn.at(RollupColumn::Width) << ", "
+      << m_rollupColumn.at(RollupColumn::BucketStart) << ");";
 
-    // SysProcDiskStats table
-    out << "CREATE TABLE IF NOT EXISTS " << m_sysProcDiskStatsTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_sysProcDiskColumn.at(SysProcDiskColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Major) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Minor) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Name) << " TEXT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsCompleted) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsMerged) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsSpentMs) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesCompleted) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesMerged) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesSpentMs) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOInProgress) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOSpentMs) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOWeightedMs) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::SessionId) << " INTEGER NOT NULL, ";
-    } else {
-      out << m_sysProcDiskColumn.at(SysProcDiskColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Major) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Minor) << " INTEGER NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Name) << " TEXT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsCompleted) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsMerged) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsSpentMs) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesCompleted) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesMerged) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesSpentMs) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOInProgress) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOSpentMs) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOWeightedMs) << " BIGINT NOT NULL, "
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::SessionId) << " INTEGER NOT NULL, ";
-    }
-    out << "CONSTRAINT KFSession FOREIGN KEY("
-        << m_sysProcStatColumn.at(SysProcStatColumn::SessionId) << ") REFERENCES "
-        << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+  return out.str();
+}
 
-    // SysProcPressure table
-    out << "CREATE TABLE IF NOT EXISTS " << m_sysProcPressureTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_sysProcPressureColumn.at(SysProcPressureColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MonotonicTime)
-          << " INTEGER NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::ReceiveTime)
-          << " INTEGER NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg10) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg60) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg300) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeTotal)
-          << " INTEGER NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg10) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg60) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg300) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullTotal)
-          << " INTEGER NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg10) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg60) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg300) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeTotal)
-          << " INTEGER NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg10) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg60) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg300) << " REAL NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullTotal)
-          << " INTEGER NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeTotal)
-          << " INTEGER NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullTotal)
-          << " INTEGER NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::SessionId)
-          << " INTEGER NOT NULL, ";
-    } else {
-      out << m_sysProcPressureColumn.at(SysProcPressureColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_sysProcPressureColumn.at(SysProcPressureColumn::MonotonicTime)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::ReceiveTime)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeTotal)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullTotal)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeTotal)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullTotal)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeTotal)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg10)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg60)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg300)
-          << " REAL NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullTotal)
-          << " BIGINT NOT NULL, " << m_sysProcPressureColumn.at(SysProcPressureColumn::SessionId)
-          << " INTEGER NOT NULL, ";
+auto Query::createDataTables(Query::Type type,
+                             bool partitioned,
+                             bool clustered,
+                             bool packed,
+                             const Projection &projection) -> std::string
+{
+  const bool partition = partitioned && (type == Query::Type::PostgreSQL);
+  const bool cluster = clustered && (type == Query::Type::SQLite3);
+  const auto &dataIdColumn = m_procEventColumn.at(ProcEventColumn::Id);
+  const auto &dataTimeColumn = m_procEventColumn.at(ProcEventColumn::SystemTime);
+  const auto &dataSessionColumn = m_procEventColumn.at(ProcEventColumn::SessionId);
+  // The partition key has to be part of the primary key of a partitioned table
+  const std::string dataId = partition ? " SERIAL NOT NULL, " : " SERIAL PRIMARY KEY, ";
+  // Tables without rowid have no auto increment, the INSERT writes the entry
+  // ordinal in the sample so rows of one SystemTime keep their order
+  const std::string rowId = cluster ? " INTEGER NOT NULL, " : " INTEGER PRIMARY KEY, ";
+  std::string dataEnd = ") ON DELETE CASCADE);";
+  // Packed rows are already one per sample and keep their rowid when clustered
+  std::string packedEnd = dataEnd;
+  std::stringstream out;
+
+  if (partition) {
+    dataEnd = ") ON DELETE CASCADE, PRIMARY KEY (" + dataIdColumn + ", " + dataSessionColumn +
+              ")) PARTITION BY LIST (" + dataSessionColumn + ");";
+    packedEnd = dataEnd;
+  } else if (cluster) {
+    // The rows of a session are stored together in time order
+    dataEnd = ") ON DELETE CASCADE, PRIMARY KEY (" + dataSessionColumn + ", " + dataTimeColumn +
+              ", " + dataIdColumn + ")) WITHOUT ROWID;";
+  }
+
+  if ((type != Query::Type::SQLite3) && (type != Query::Type::PostgreSQL)) {
+    return out.str();
+  }
+
+  const std::set<std::string> timeColumns{
+      dataTimeColumn,
+      m_procEventColumn.at(ProcEventColumn::MonotonicTime),
+      m_procEventColumn.at(ProcEventColumn::ReceiveTime),
+  };
+  const std::set<std::string> textColumns{
+      m_sysProcStatColumn.at(SysProcStatColumn::CPUStatName),
+      m_sysProcDiskColumn.at(SysProcDiskColumn::Name),
+      m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Name),
+      m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Zone),
+      m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Data),
+      m_sysProcWirelessColumn.at(SysProcWirelessColumn::Name),
+      m_sysProcWirelessColumn.at(SysProcWirelessColumn::Status),
+      m_procAcctColumn.at(ProcAcctColumn::AcComm),
+      m_procInfoColumn.at(ProcInfoColumn::Comm),
+      m_procInfoColumn.at(ProcInfoColumn::CtxId),
+      m_procInfoColumn.at(ProcInfoColumn::CtxName),
+      m_contextInfoColumn.at(ContextInfoColumn::CtxId),
+      m_contextInfoColumn.at(ContextInfoColumn::CtxName),
+  };
+  const std::set<std::string> realColumns{
+      m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg10),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg60),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg300),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg10),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg60),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg300),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg10),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg60),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg300),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg10),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg60),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg300),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg10),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg60),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg300),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg10),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg60),
+      m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg300),
+  };
+  // The other data columns are integers
+  const std::string intType = (type == Query::Type::SQLite3) ? " INTEGER" : " BIGINT";
+
+  // Columns left out by the table projection are not created
+  for (const auto &[what, table] : m_dataTableName) {
+    const bool packedType = packed && (m_packedDataTypes.count(what) > 0);
+
+    out << "CREATE TABLE IF NOT EXISTS " << table << " (";
+    for (const auto &column : getDataColumns(what, projection)) {
+      out << column;
+      if (column == dataIdColumn) {
+        if (type == Query::Type::PostgreSQL) {
+          out << dataId;
+        } else {
+          out << (packedType ? " INTEGER PRIMARY KEY, " : rowId);
+        }
+      } else if (timeColumns.count(column) > 0) {
+        out << intType << " NOT NULL, ";
+      } else if (column == dataSessionColumn) {
+        out << " INTEGER NOT NULL, ";
+      } else if (packedType && (type == Query::Type::SQLite3)) {
+        // JSON arrays, decoded by json_each in the entry views
+        out << " JSON NOT NULL, ";
+      } else if (packedType) {
+        out << ((textColumns.count(column) > 0) ? " TEXT[] NOT NULL, " : " BIGINT[] NOT NULL, ");
+      } else if (textColumns.count(column) > 0) {
+        out << " TEXT NOT NULL, ";
+      } else if (realColumns.count(column) > 0) {
+        out << " REAL NOT NULL, ";
+      } else {
+        out << intType << " NOT NULL, ";
+      }
     }
-    out << "CONSTRAINT KFSession FOREIGN KEY("
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::SessionId) << ") REFERENCES "
+    out << "CONSTRAINT KFSession FOREIGN KEY(" << dataSessionColumn << ") REFERENCES "
         << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+        << (packedType ? packedEnd : dataEnd);
+  }
 
-    // SysProcVMStat table
-    out << "CREATE TABLE IF NOT EXISTS " << m_sysProcVMStatTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_sysProcVMStatColumn.at(SysProcVMStatColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGpgin) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGpgout) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PSwpin) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PSwpout) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGmajfault) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGreuse) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealKswapd) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealDirect) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealKhugepaged) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealAnon) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealFile) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanKswapd) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanDirect) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanKhugepaged) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanDirectThrottle) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanAnon) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanFile) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::OOMKill) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactStall) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactFail) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactSuccess) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFaultAlloc) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpCollapseAlloc) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpCollapseAllocFailed) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFileAlloc) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFileMapped) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSplitPage) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSplitPageFailed) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpZeroPageAlloc) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpZeroPageAllocFailed) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSwpout) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSwpoutFallback) << " INTEGER NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::SessionId) << " INTEGER NOT NULL, ";
-    } else {
-      out << m_sysProcVMStatColumn.at(SysProcVMStatColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGpgin) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGpgout) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PSwpin) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PSwpout) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGmajfault) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGreuse) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealKswapd) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealDirect) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealKhugepaged) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealAnon) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealFile) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanKswapd) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanDirect) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanKhugepaged) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanDirectThrottle) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanAnon) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanFile) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::OOMKill) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactStall) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactFail) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactSuccess) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFaultAlloc) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpCollapseAlloc) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpCollapseAllocFailed) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFileAlloc) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFileMapped) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSplitPage) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSplitPageFailed) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpZeroPageAlloc) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpZeroPageAllocFailed) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSwpout) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSwpoutFallback) << " BIGINT NOT NULL, "
-          << m_sysProcVMStatColumn.at(SysProcVMStatColumn::SessionId) << " BIGINT NOT NULL, ";
+  if (partition) {
+    // Rows of sessions without a partition yet, and time ranges inside one session
+    for (const auto &[what, table] : m_dataTableName) {
+      out << "CREATE TABLE IF NOT EXISTS " << table << "Default PARTITION OF " << table
+          << " DEFAULT;";
+      out << "CREATE INDEX IF NOT EXISTS " << table << "Time ON " << table << " ("
+          << m_procEventColumn.at(ProcEventColumn::SystemTime) << ");";
     }
-    out << "CONSTRAINT KFSession FOREIGN KEY(" << m_sysProcVMStatColumn.at(SysProcVMStatColumn::SessionId)
-        << ") REFERENCES " << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+  } else {
+    // Session scoped reads and the retention batches look rows up by session
+    for (const auto &[what, table] : m_dataTableName) {
+      if (!cluster || (packed && (m_packedDataTypes.count(what) > 0))) {
+        out << "CREATE INDEX IF NOT EXISTS " << table << "Session ON " << table << " ("
+            << m_procEventColumn.at(ProcEventColumn::SessionId) << ");";
+      }
+    }
+  }
 
-    // ProcAcct table
-    out << "CREATE TABLE IF NOT EXISTS " << m_procAcctTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_procAcctColumn.at(ProcAcctColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_procAcctColumn.at(ProcAcctColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcComm) << " TEXT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcUid) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcGid) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcPid) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcPPid) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcUTime) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcSTime) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuCount) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuRunRealTotal) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuRunVirtualTotal) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuDelayTotal) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuDelayAverage) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CoreMem) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::VirtMem) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::HiwaterRss) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::HiwaterVm) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::Nvcsw) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::Nivcsw) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SwapinCount) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SwapinDelayTotal) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SwapinDelayAverage) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::BlkIOCount) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::BlkIODelayTotal) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::BlkIODelayAverage) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOStorageReadBytes) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOStorageWriteBytes) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOReadChar) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOWriteChar) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOReadSyscalls) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOWriteSyscalls) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::FreePagesCount) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::FreePagesDelayTotal) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::FreePagesDelayAverage) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ThrashingCount) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ThrashingDelayTotal) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ThrashingDelayAverage) << " INTEGER NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SessionId) << " INTEGER NOT NULL, ";
+  return out.str();
+}
+
+auto Query::getClustered(Query::Type type) -> std::string
+{
+  std::stringstream out;
+
+  if (type == Query::Type::SQLite3) {
+    out << "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = '"
+        << m_procEventTableName << "' AND sql LIKE '%WITHOUT ROWID%';";
+  }
+
+  return out.str();
+}
+
+auto Query::migrateDataTables(Query::Type type,
+                              bool clustered,
+                              bool packed,
+                              const Projection &projection) -> std::string
+{
+  const auto &idColumn = m_procEventColumn.at(ProcEventColumn::Id);
+  std::stringstream out;
+
+  if (type != Query::Type::SQLite3) {
+    return out.str();
+  }
+
+  // Ids are not copied, new rowids follow the session order and new clustered
+  // rows are numbered in their sample
+  out << "BEGIN;";
+  for (const auto &what : m_packedDataTypes) {
+    out << "DROP VIEW IF EXISTS " << m_dataTableName.at(what) << "Entries;";
+  }
+  for (const auto &[what, table] : m_dataTableName) {
+    out << "DROP INDEX IF EXISTS " << table << "Session;";
+    out << "ALTER TABLE " << table << " RENAME TO " << table << "Migrate;";
+  }
+  out << createDataTables(type, false, clustered, packed, projection);
+  for (const auto &[what, table] : m_dataTableName) {
+    std::stringstream columns;
+
+    for (const auto &column : getDataColumns(what, projection)) {
+      if (column != idColumn) {
+        columns << ((columns.tellp() > 0) ? "," : "") << column;
+      }
+    }
+    const auto order = m_procEventColumn.at(ProcEventColumn::SessionId) + ", " +
+                       m_procEventColumn.at(ProcEventColumn::SystemTime);
+    if (clustered && !(packed && (m_packedDataTypes.count(what) > 0))) {
+      out << "INSERT INTO " << table << " (" << columns.str() << "," << idColumn << ") SELECT "
+          << columns.str() << ", ROW_NUMBER() OVER (PARTITION BY " << order << " ORDER BY "
+          << idColumn << ") - 1 FROM " << table << "Migrate ORDER BY " << order << ", "
+          << idColumn << ";";
     } else {
-      out << m_procAcctColumn.at(ProcAcctColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_procAcctColumn.at(ProcAcctColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcComm) << " TEXT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcUid) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcGid) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcPid) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcPPid) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcUTime) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::AcSTime) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuCount) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuRunRealTotal) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuRunVirtualTotal) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuDelayTotal) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CpuDelayAverage) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::CoreMem) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::VirtMem) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::HiwaterRss) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::HiwaterVm) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::Nvcsw) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::Nivcsw) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SwapinCount) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SwapinDelayTotal) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SwapinDelayAverage) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::BlkIOCount) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::BlkIODelayTotal) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::BlkIODelayAverage) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOStorageReadBytes) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOStorageWriteBytes) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOReadChar) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOWriteChar) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOReadSyscalls) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::IOWriteSyscalls) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::FreePagesCount) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::FreePagesDelayTotal) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::FreePagesDelayAverage) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ThrashingCount) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ThrashingDelayTotal) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::ThrashingDelayAverage) << " BIGINT NOT NULL, "
-          << m_procAcctColumn.at(ProcAcctColumn::SessionId) << " INTEGER NOT NULL, ";
+      out << "INSERT INTO " << table << " (" << columns.str() << ") SELECT " << columns.str()
+          << " FROM " << table << "Migrate ORDER BY " << order << ", " << idColumn << ";";
     }
-    out << "CONSTRAINT KFSession FOREIGN KEY(" << m_procAcctColumn.at(ProcAcctColumn::SessionId)
-        << ") REFERENCES " << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+    out << "DROP TABLE " << table << "Migrate;";
+  }
+  if (packed) {
+    out << createPackedViews(type, projection);
+  }
+  out << "COMMIT;";
+
+  return out.str();
+}
+
+auto Query::getPacked(Query::Type type) -> std::string
+{
+  std::string table = m_sysProcStatTableName;
+  std::stringstream out;
+
+  if (type == Query::Type::SQLite3) {
+    out << "SELECT COUNT(*) FROM pragma_table_info('" << table << "') WHERE type = 'JSON';";
+  } else if (type == Query::Type::PostgreSQL) {
+    std::transform(table.begin(), table.end(), table.begin(), ::tolower);
+    out << "SELECT COUNT(*) FROM information_schema.columns WHERE table_name = '" << table
+        << "' AND data_type = 'ARRAY';";
+  }
+
+  return out.str();
+}
+
+auto Query::createPackedViews(Query::Type type, const Projection &projection) -> std::string
+{
+  std::stringstream out;
+
+  for (const auto &what : m_packedDataTypes) {
+    const auto entries = getPackedEntries(type, what, projection);
 
-    // ProcInfo table
-    out << "CREATE TABLE IF NOT EXISTS " << m_procInfoTableName << " (";
+    // A table projected down to its row columns has no entries to list
+    if (entries.empty()) {
+      continue;
+    }
     if (type == Query::Type::SQLite3) {
-      out << m_procInfoColumn.at(ProcInfoColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_procInfoColumn.at(ProcInfoColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::Comm) << " TEXT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::Pid) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::PPid) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CtxId) << " TEXT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CtxName) << " TEXT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CpuTime) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CpuPercent) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::MemRSS) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::MemPSS) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::FDCount) << " INTEGER NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::SessionId) << " INTEGER NOT NULL, ";
-    } else {
-      out << m_procInfoColumn.at(ProcInfoColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_procInfoColumn.at(ProcInfoColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::Comm) << " TEXT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::Pid) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::PPid) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CtxId) << " TEXT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CtxName) << " TEXT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CpuTime) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::CpuPercent) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::MemRSS) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::MemPSS) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::FDCount) << " BIGINT NOT NULL, "
-          << m_procInfoColumn.at(ProcInfoColumn::SessionId) << " INTEGER NOT NULL, ";
+      out << "CREATE VIEW IF NOT EXISTS " << m_dataTableName.at(what) << "Entries AS " << entries
+          << ";";
+    } else if (type == Query::Type::PostgreSQL) {
+      out << "CREATE OR REPLACE VIEW " << m_dataTableName.at(what) << "Entries AS " << entries
+          << ";";
     }
-    out << "CONSTRAINT KFSession FOREIGN KEY(" << m_procInfoColumn.at(ProcInfoColumn::SessionId)
-        << ") REFERENCES " << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
+  }
 
-    // ContextInfo table
-    out << "CREATE TABLE IF NOT EXISTS " << m_contextInfoTableName << " (";
-    if (type == Query::Type::SQLite3) {
-      out << m_contextInfoColumn.at(ContextInfoColumn::Id) << " INTEGER PRIMARY KEY, "
-          << m_contextInfoColumn.at(ContextInfoColumn::SystemTime) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::MonotonicTime) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::ReceiveTime) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::CtxId) << " TEXT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::CtxName) << " TEXT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalCpuTime) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalCpuPercent) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalMemRSS) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalMemPSS) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalFDCount) << " INTEGER NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::SessionId) << " INTEGER NOT NULL, ";
+  return out.str();
+}
+
+auto Query::getPackedEntries(Query::Type type,
+                             tkm::msg::monitor::Data_What what,
+                             const Projection &projection) -> std::string
+{
+  const auto &idColumn = m_procEventColumn.at(ProcEventColumn::Id);
+  const std::set<std::string> rowColumns{
+      idColumn,
+      m_procEventColumn.at(ProcEventColumn::SystemTime),
+      m_procEventColumn.at(ProcEventColumn::MonotonicTime),
+      m_procEventColumn.at(ProcEventColumn::ReceiveTime),
+      m_procEventColumn.at(ProcEventColumn::SessionId),
+  };
+  const auto &table = m_dataTableName.at(what);
+  std::vector<std::string> arrays;
+  std::stringstream columns;
+  std::stringstream out;
+
+  // The entries take the row per entry columns in table order, the first array
+  // column drives the entry count
+  for (const auto &column : getDataColumns(what, projection)) {
+    if (column == idColumn) {
+      continue;
+    }
+    if (rowColumns.count(column) > 0) {
+      columns << ", p." << column;
+    } else if (type == Query::Type::PostgreSQL) {
+      columns << ", u." << column;
+      arrays.push_back(column);
+    } else if (arrays.empty()) {
+      columns << ", e.value AS " << column;
+      arrays.push_back(column);
     } else {
-      out << m_contextInfoColumn.at(ContextInfoColumn::Id) << " SERIAL PRIMARY KEY, "
-          << m_contextInfoColumn.at(ContextInfoColumn::SystemTime) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::MonotonicTime) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::ReceiveTime) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::CtxId) << " TEXT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::CtxName) << " TEXT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalCpuTime) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalCpuPercent) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalMemRSS) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalMemPSS) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalFDCount) << " BIGINT NOT NULL, "
-          << m_contextInfoColumn.at(ContextInfoColumn::SessionId) << " INTEGER NOT NULL, ";
+      columns << ", json_extract(p." << column << ", '$[' || e.key || ']') AS " << column;
+      arrays.push_back(column);
     }
-    out << "CONSTRAINT KFSession FOREIGN KEY("
-        << m_contextInfoColumn.at(ContextInfoColumn::SessionId) << ") REFERENCES "
-        << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-        << ") ON DELETE CASCADE);";
   }
 
-  // SysProcBuddyInfo table
-  out << "CREATE TABLE IF NOT EXISTS " << m_sysProcBuddyInfoTableName << " (";
+  if (arrays.empty()) {
+    return out.str();
+  }
   if (type == Query::Type::SQLite3) {
-    out << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Id) << " INTEGER PRIMARY KEY, "
-        << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::SystemTime) << " INTEGER NOT NULL, "
-        << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::MonotonicTime)
-        << " INTEGER NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::ReceiveTime)
-        << " INTEGER NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Name)
-        << " TEXT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Zone)
-        << " TEXT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Data)
-        << " TEXT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::SessionId)
-        << " INTEGER NOT NULL, ";
-  } else {
-    out << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Id) << " SERIAL PRIMARY KEY, "
-        << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::SystemTime) << " BIGINT NOT NULL, "
-        << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::MonotonicTime)
-        << " BIGINT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::ReceiveTime)
-        << " BIGINT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Name)
-        << " TEXT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Zone)
-        << " TEXT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Data)
-        << " TEXT NOT NULL, " << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::SessionId)
-        << " INTEGER NOT NULL, ";
-  }
-  out << "CONSTRAINT KFSession FOREIGN KEY("
-      << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::SessionId) << ") REFERENCES "
-      << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-      << ") ON DELETE CASCADE);";
+    out << "SELECT p." << idColumn << " * " << GQueryPackedIdStride << " + e.key AS " << idColumn
+        << columns.str() << " FROM " << table << " p, json_each(p." << arrays.front() << ") e";
+  } else if (type == Query::Type::PostgreSQL) {
+    std::stringstream unnest;
+    std::stringstream alias;
 
-  // SysProcWireless table
-  out << "CREATE TABLE IF NOT EXISTS " << m_sysProcWirelessTableName << " (";
-  if (type == Query::Type::SQLite3) {
-    out << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Id) << " INTEGER PRIMARY KEY, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::SystemTime) << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::MonotonicTime) << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::ReceiveTime) << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Name) << " TEXT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Status) << " TEXT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityLink) << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityLevel) << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityNoise) << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedNWId) << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedCrypt)
-        << " INTEGER NOT NULL, " << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedFrag)
-        << " INTEGER NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedRetry)
-        << " INTEGER NOT NULL, " << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedMisc)
-        << " INTEGER NOT NULL, " << m_sysProcWirelessColumn.at(SysProcWirelessColumn::MissedBeacon)
-        << " INTEGER NOT NULL, " << m_sysProcWirelessColumn.at(SysProcWirelessColumn::SessionId)
-        << " INTEGER NOT NULL, ";
-  } else {
-    out << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Id) << " SERIAL PRIMARY KEY, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::SystemTime) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::MonotonicTime) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::ReceiveTime) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Name) << " TEXT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Status) << " TEXT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityLink) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityLevel) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityNoise) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedNWId) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedCrypt) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedFrag) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedRetry) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedMisc) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::MissedBeacon) << " BIGINT NOT NULL, "
-        << m_sysProcWirelessColumn.at(SysProcWirelessColumn::SessionId) << " INTEGER NOT NULL, ";
-  }
-  out << "CONSTRAINT KFSession FOREIGN KEY("
-      << m_sysProcWirelessColumn.at(SysProcWirelessColumn::SessionId) << ") REFERENCES "
-      << m_sessionsTableName << "(" << m_sessionColumn.at(SessionColumn::Id)
-      << ") ON DELETE CASCADE);";
+    for (const auto &array : arrays) {
+      unnest << ((unnest.tellp() > 0) ? ", p." : "p.") << array;
+      alias << array << ", ";
+    }
+    out << "SELECT p." << idColumn << "::BIGINT * " << GQueryPackedIdStride << " + u.Entry AS "
+        << idColumn << columns.str() << " FROM " << table << " p, unnest(" << unnest.str()
+        << ") WITH ORDINALITY AS u(" << alias.str() << "Entry)";
+  }
 
   return out.str();
 }
@@ -613,6 +542,12 @@ auto Query::dropTables(Query::Type type) -> std::string
 {
   std::stringstream out;
 
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    for (const auto &what : m_packedDataTypes) {
+      out << "DROP VIEW IF EXISTS " << m_dataTableName.at(what) << "Entries;";
+    }
+  }
+
   if (type == Query::Type::SQLite3) {
     out << "DROP TABLE IF EXISTS " << m_devicesTableName << ";";
     out << "DROP TABLE IF EXISTS " << m_sessionsTableName << ";";
@@ -627,6 +562,7 @@ auto Query::dropTables(Query::Type type) -> std::string
     out << "DROP TABLE IF EXISTS " << m_procInfoTableName << ";";
     out << "DROP TABLE IF EXISTS " << m_procEventTableName << ";";
     out << "DROP TABLE IF EXISTS " << m_contextInfoTableName << ";";
+    out << "DROP TABLE IF EXISTS " << m_rollupsTableName << ";";
   } else if (type == Query::Type::PostgreSQL) {
     out << "DROP TABLE IF EXISTS " << m_devicesTableName << " CASCADE;";
     out << "DROP TABLE IF EXISTS " << m_sessionsTableName << " CASCADE;";
@@ -641,6 +577,7 @@ auto Query::dropTables(Query::Type type) -> std::string
     out << "DROP TABLE IF EXISTS " << m_procInfoTableName << " CASCADE;";
     out << "DROP TABLE IF EXISTS " << m_procEventTableName << " CASCADE;";
     out << "DROP TABLE IF EXISTS " << m_contextInfoTableName << " CASCADE;";
+    out << "DROP TABLE IF EXISTS " << m_rollupsTableName << " CASCADE;";
   }
 
   return out.str();
@@ -658,6 +595,24 @@ auto Query::getDevices(Query::Type type) -> std::string
   return out.str();
 }
 
+auto Query::listDevices(Query::Type type, const tkm::msg::ext::ListFilter &filter) -> std::string
+{
+  std::stringstream out;
+
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    out << "SELECT * FROM " << m_devicesTableName << " WHERE "
+        << m_deviceColumn.at(DeviceColumn::Id) << " > " << filter.after_id() << " ORDER BY "
+        << m_deviceColumn.at(DeviceColumn::Id);
+    // One extra row tells the reader if a next page exists
+    if (filter.limit() > 0) {
+      out << " LIMIT " << static_cast<uint64_t>(filter.limit()) + 1;
+    }
+    out << ";";
+  }
+
+  return out.str();
+}
+
 auto Query::addDevice(Query::Type type,
                       const std::string &hash,
                       const std::string &name,
@@ -761,6 +716,44 @@ auto Query::getSessions(Query::Type type, const std::string &deviceHash) -> std:
   return out.str();
 }
 
+auto Query::listSessions(Query::Type type, const tkm::msg::ext::ListFilter &filter)
+    -> std::string
+{
+  std::stringstream out;
+
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    out << "SELECT * FROM " << m_sessionsTableName << " WHERE "
+        << m_sessionColumn.at(SessionColumn::Id) << " > " << filter.after_id();
+    if (!filter.device_hash().empty()) {
+      out << " AND " << m_sessionColumn.at(SessionColumn::Device) << " = "
+          << "(SELECT " << m_deviceColumn.at(DeviceColumn::Id) << " FROM " << m_devicesTableName
+          << " WHERE " << m_deviceColumn.at(DeviceColumn::Hash) << " = "
+          << "'" << filter.device_hash() << "')";
+    }
+    if (filter.started_from() > 0) {
+      out << " AND " << m_sessionColumn.at(SessionColumn::StartTimestamp)
+          << " >= " << filter.started_from();
+    }
+    if (filter.started_to() > 0) {
+      out << " AND " << m_sessionColumn.at(SessionColumn::StartTimestamp)
+          << " <= " << filter.started_to();
+    }
+    if (filter.state() == tkm::msg::ext::ListFilter_State_Progress) {
+      out << " AND " << m_sessionColumn.at(SessionColumn::EndTimestamp) << " = 0";
+    } else if (filter.state() == tkm::msg::ext::ListFilter_State_Complete) {
+      out << " AND " << m_sessionColumn.at(SessionColumn::EndTimestamp) << " > 0";
+    }
+    out << " ORDER BY " << m_sessionColumn.at(SessionColumn::Id);
+    // One extra row tells the reader if a next page exists
+    if (filter.limit() > 0) {
+      out << " LIMIT " << static_cast<uint64_t>(filter.limit()) + 1;
+    }
+    out << ";";
+  }
+
+  return out.str();
+}
+
 auto Query::addSession(Query::Type type,
                        const tkm::msg::monitor::SessionInfo &sessionInfo,
                        const std::string &deviceHash,
@@ -832,6 +825,48 @@ auto Query::remSession(Query::Type type, const std::string &hash) -> std::string
   return out.str();
 }
 
+auto Query::addSessionPartitions(Query::Type type, int64_t sessionId) -> std::string
+{
+  std::stringstream out;
+
+  if (type == Query::Type::PostgreSQL) {
+    for (const auto &[what, table] : m_dataTableName) {
+      out << "CREATE TABLE IF NOT EXISTS " << table << "S" << sessionId << " PARTITION OF "
+          << table << " FOR VALUES IN (" << sessionId << ");";
+    }
+  }
+
+  return out.str();
+}
+
+auto Query::getPartitioned(Query::Type type) -> std::string
+{
+  std::stringstream out;
+
+  if (type == Query::Type::PostgreSQL) {
+    std::string table = m_procEventTableName;
+    std::transform(table.begin(), table.end(), table.begin(), ::tolower);
+    out << "SELECT COUNT(*) FROM pg_partitioned_table p JOIN pg_class c ON c.oid = p.partrelid"
+        << " WHERE c.relname = '" << table << "';";
+  }
+
+  return out.str();
+}
+
+auto Query::remSessionPartitions(Query::Type type, int64_t sessionId) -> std::string
+{
+  std::stringstream out;
+
+  // Dropping a partition is a file unlink, no dead tuples are left behind
+  if (type == Query::Type::PostgreSQL) {
+    for (const auto &[what, table] : m_dataTableName) {
+      out << "DROP TABLE IF EXISTS " << table << "S" << sessionId << ";";
+    }
+  }
+
+  return out.str();
+}
+
 auto Query::getSession(Query::Type type, const std::string &hash) -> std::string
 {
   std::stringstream out;
@@ -866,635 +901,1289 @@ auto Query::hasSession(Query::Type type, const std::string &hash) -> std::string
   return out.str();
 }
 
-auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::ProcEvent &procEvent,
-                    uint64_t systemTime,
-                    uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+auto Query::getOpenSession(Query::Type type, const std::string &hash) -> std::string
 {
   std::stringstream out;
 
-  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-    out << "INSERT INTO " << m_procEventTableName << " ("
-        << m_procEventColumn.at(ProcEventColumn::SystemTime) << ","
-        << m_procEventColumn.at(ProcEventColumn::MonotonicTime) << ","
-        << m_procEventColumn.at(ProcEventColumn::ReceiveTime) << ","
-        << m_procEventColumn.at(ProcEventColumn::ForkCount) << ","
-        << m_procEventColumn.at(ProcEventColumn::ExecCount) << ","
-        << m_procEventColumn.at(ProcEventColumn::ExitCount) << ","
-        << m_procEventColumn.at(ProcEventColumn::UIdCount) << ","
-        << m_procEventColumn.at(ProcEventColumn::GIdCount) << ",";
-    out << m_procEventColumn.at(ProcEventColumn::SessionId) << ") VALUES ('" << systemTime << "', '"
-        << monotonicTime << "', '" << receiveTime << "', '" << procEvent.fork_count() << "', '"
-        << procEvent.exec_count() << "', '" << procEvent.exit_count() << "', '"
-        << procEvent.uid_count() << "', '" << procEvent.gid_count() << "', ";
-  }
-
   if (type == Query::Type::SQLite3) {
-    out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
+    out << "SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
         << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-        << "'" << sessionHash << "' AND EndTimestamp = 0));";
-  } else {
-    out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
+        << "'" << hash << "' AND " << m_sessionColumn.at(SessionColumn::EndTimestamp)
+        << " = 0 LIMIT 1;";
+  } else if (type == Query::Type::PostgreSQL) {
+    out << "SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
         << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-        << "'" << sessionHash << "' AND EndTimestamp = 0));";
+        << "'" << hash << "' AND " << m_sessionColumn.at(SessionColumn::EndTimestamp)
+        << " = 0 LIMIT 1;";
   }
 
   return out.str();
 }
 
-auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::SysProcStat &sysProcStat,
-                    uint64_t systemTime,
-                    uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+auto Query::getExpiredSession(Query::Type type,
+                              uint64_t endedBefore,
+                              uint64_t deviceMaxSessions,
+                              bool overQuota) -> std::string
 {
+  const auto &idColumn = m_sessionColumn.at(SessionColumn::Id);
+  const auto &endColumn = m_sessionColumn.at(SessionColumn::EndTimestamp);
+  const auto &deviceColumn = m_sessionColumn.at(SessionColumn::Device);
   std::stringstream out;
 
-  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-    out << "INSERT INTO " << m_sysProcStatTableName << " ("
-        << m_sysProcStatColumn.at(SysProcStatColumn::SystemTime) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::MonotonicTime) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::ReceiveTime) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatName) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatAll) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatUsr) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatSys) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatIow) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::SessionId) << ") VALUES ('" << systemTime
-        << "', '" << monotonicTime << "', '" << receiveTime << "', '" << sysProcStat.cpu().name()
-        << "', '" << sysProcStat.cpu().all() << "', '" << sysProcStat.cpu().usr() << "', '"
-        << sysProcStat.cpu().sys() << "', '" << sysProcStat.cpu().iow() << "', ";
-
-    if (type == Query::Type::SQLite3) {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
-    } else {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
-    }
+  if ((endedBefore == 0) && (deviceMaxSessions == 0) && !overQuota) {
+    return out.str();
   }
 
-  for (const auto &cpuStat : sysProcStat.core()) {
-    if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-      out << "INSERT INTO " << m_sysProcStatTableName << " ("
-          << m_sysProcStatColumn.at(SysProcStatColumn::SystemTime) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::MonotonicTime) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::ReceiveTime) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatName) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatAll) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatUsr) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatSys) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::CPUStatIow) << ","
-          << m_sysProcStatColumn.at(SysProcStatColumn::SessionId) << ") VALUES ('" << systemTime
-          << "', '" << monotonicTime << "', '" << receiveTime << "', '" << cpuStat.name() << "', '"
-          << cpuStat.all() << "', '" << cpuStat.usr() << "', '" << cpuStat.sys() << "', '"
-          << cpuStat.iow() << "', ";
-
-      if (type == Query::Type::SQLite3) {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
-      } else {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash)
-            << " LIKE "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
+  // Oldest ended session breaking any of the policy limits
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    out << "SELECT * FROM " << m_sessionsTableName << " s WHERE s." << endColumn << " > 0 AND (";
+    if (overQuota) {
+      out << "1 = 1";
+    } else {
+      if (endedBefore > 0) {
+        out << "s." << endColumn << " < " << endedBefore;
+      }
+      if (deviceMaxSessions > 0) {
+        out << ((endedBefore > 0) ? " OR " : "") << "(SELECT COUNT(*) FROM "
+            << m_sessionsTableName << " n WHERE n." << deviceColumn << " = s." << deviceColumn
+            << " AND n." << endColumn << " > 0 AND n." << idColumn << " > s." << idColumn
+            << ") >= " << deviceMaxSessions;
       }
     }
+    out << ") ORDER BY s." << idColumn << " LIMIT 1;";
   }
 
   return out.str();
 }
 
-auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
-                    uint64_t systemTime,
-                    uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+auto Query::getRowEstimate(Query::Type type) -> std::string
 {
+  const auto &idColumn = m_procEventColumn.at(ProcEventColumn::Id);
   std::stringstream out;
 
-  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-    out << "INSERT INTO " << m_sysProcMemInfoTableName << " ("
-        << m_sysProcMemColumn.at(SysProcMemColumn::SystemTime) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::MonotonicTime) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::ReceiveTime) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::MemTotal) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::MemFree) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::MemAvail) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::MemCached) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::MemAvailPercent) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::Active) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::Inactive) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::Slab) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::KReclaimable) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::SReclaimable) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::SUnreclaim) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::KernelStack) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::SwapTotal) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::SwapFree) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::SwapCached) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::SwapFreePercent) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::CmaTotal) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::CmaFree) << ","
-        << m_sysProcMemColumn.at(SysProcMemColumn::SessionId) << ") VALUES ('" << systemTime
-        << "', '" << monotonicTime << "', '" << receiveTime << "', '" << sysProcMem.mem_total()
-        << "', '" << sysProcMem.mem_free() << "', '" << sysProcMem.mem_available() << "', '"
-        << sysProcMem.mem_cached() << "', '" << sysProcMem.mem_percent() << "', '"
-        << sysProcMem.active() << "', '" << sysProcMem.inactive() << "', '"
-        << sysProcMem.slab() << "', '" << sysProcMem.kreclaimable() << "', '"
-        << sysProcMem.sreclaimable() << "', '" << sysProcMem.sunreclaim() << "', '"
-        << sysProcMem.kernel_stack() << "', '"
-        << sysProcMem.swap_total() << "', '" << sysProcMem.swap_free() << "', '"
-        << sysProcMem.swap_cached() << "', '" << sysProcMem.swap_percent() << "', '"
-        << sysProcMem.cma_total() << "', '" << sysProcMem.cma_free() << "', ";
+  if (type == Query::Type::SQLite3) {
+    // Ids are rowids so the range is read from the ends of the table b-tree
+    out << "SELECT 0";
+    for (const auto &[what, table] : m_dataTableName) {
+      out << " + (SELECT IFNULL(MAX(" << idColumn << ") - MIN(" << idColumn << ") + 1, 0) FROM "
+          << table << ")";
+    }
+    out << " AS RowCount;";
+  } else if (type == Query::Type::PostgreSQL) {
+    std::stringstream tables;
 
-    if (type == Query::Type::SQLite3) {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
-    } else {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
+    for (auto it = m_dataTableName.cbegin(); it != m_dataTableName.cend(); ++it) {
+      std::string table = it->second;
+      std::transform(table.begin(), table.end(), table.begin(), ::tolower);
+      tables << ((it != m_dataTableName.cbegin()) ? ", " : "") << "'" << table << "'";
     }
+    // Rows of partitioned tables are counted on their partitions
+    out << "SELECT COALESCE(SUM(n_live_tup), 0) AS RowCount FROM pg_stat_user_tables"
+        << " WHERE relname IN (" << tables.str() << ") OR relid IN (SELECT inhrelid FROM"
+        << " pg_inherits WHERE inhparent::regclass::text IN (" << tables.str() << "));";
   }
 
   return out.str();
 }
 
-auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::SysProcDiskStats &sysDiskStats,
-                    uint64_t systemTime,
-                    uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+auto Query::getDatabaseSize(Query::Type type) -> std::string
 {
   std::stringstream out;
 
-  for (const auto &diskEntry : sysDiskStats.disk()) {
-    if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-      out << "INSERT INTO " << m_sysProcDiskStatsTableName << " ("
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::SystemTime) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::MonotonicTime) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReceiveTime) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Major) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Minor) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::Name) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsCompleted) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsMerged) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::ReadsSpentMs) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesCompleted) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesMerged) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::WritesSpentMs) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOInProgress) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOSpentMs) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::IOWeightedMs) << ","
-          << m_sysProcDiskColumn.at(SysProcDiskColumn::SessionId) << ") VALUES ('" << systemTime
-          << "', '" << monotonicTime << "', '" << receiveTime << "', '" << diskEntry.node_major()
-          << "', '" << diskEntry.node_minor() << "', '" << diskEntry.name() << "', '"
-          << diskEntry.reads_completed() << "', '" << diskEntry.reads_merged() << "', '"
-          << diskEntry.reads_spent_ms() << "', '" << diskEntry.writes_completed() << "', '"
-          << diskEntry.writes_merged() << "', '" << diskEntry.writes_spent_ms() << "', '"
-          << diskEntry.io_in_progress() << "', '" << diskEntry.io_spent_ms() << "', '"
-          << diskEntry.io_weighted_ms() << "', ";
+  // PostgreSQL files do not shrink before VACUUM FULL, row estimates are used instead
+  if (type == Query::Type::SQLite3) {
+    out << "SELECT (page_count - freelist_count) * page_size AS ByteCount"
+        << " FROM pragma_page_count(), pragma_freelist_count(), pragma_page_size();";
+  }
 
-      if (type == Query::Type::SQLite3) {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
-      } else {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash)
-            << " LIKE "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
+  return out.str();
+}
+
+auto Query::remSessionRows(Query::Type type,
+                           const std::string &table,
+                           int64_t sessionId,
+                           uint64_t limit,
+                           bool clustered) -> std::string
+{
+  const auto &idColumn = m_procEventColumn.at(ProcEventColumn::Id);
+  const auto &timeColumn = m_procEventColumn.at(ProcEventColumn::SystemTime);
+  const auto &sessionColumn = m_procEventColumn.at(ProcEventColumn::SessionId);
+  std::stringstream out;
+
+  if (clustered && (type == Query::Type::SQLite3)) {
+    // A key range from the oldest rows, whole seconds so a batch may be larger than limit
+    out << "DELETE FROM " << table << " WHERE " << sessionColumn << " = " << sessionId << " AND "
+        << timeColumn << " <= (SELECT MAX(" << timeColumn << ") FROM (SELECT " << timeColumn
+        << " FROM " << table << " WHERE " << sessionColumn << " = " << sessionId << " ORDER BY "
+        << timeColumn << " LIMIT " << limit << "));";
+  } else if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    out << "DELETE FROM " << table << " WHERE " << idColumn << " IN (SELECT " << idColumn
+        << " FROM " << table << " WHERE " << sessionColumn << " = " << sessionId << " LIMIT "
+        << limit << ");";
+  }
+
+  return out.str();
+}
+
+auto Query::releaseSpace(Query::Type type, uint64_t pages) -> std::string
+{
+  std::stringstream out;
+
+  // No-op unless the database was created with auto_vacuum = INCREMENTAL
+  if (type == Query::Type::SQLite3) {
+    out << "PRAGMA incremental_vacuum(" << pages << ");";
+  }
+
+  return out.str();
+}
+
+auto Query::exportData(Query::Type type,
+                       tkm::msg::monitor::Data_What what,
+                       const tkm::msg::ext::ExportFilter &filter,
+                       bool clustered,
+                       bool packed,
+                       const Projection &projection,
+                       int64_t cursor,
+                       int64_t bound) -> std::string
+{
+  std::stringstream out;
+
+  if (m_dataTableName.count(what) == 0) {
+    return out.str();
+  }
+
+  // All data tables share the Id, SystemTime and SessionId column names
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    const bool packedType = packed && (m_packedDataTypes.count(what) > 0);
+    const auto &idColumn = m_procEventColumn.at(ProcEventColumn::Id);
+    // Packed entries are selected from the table rows, the range applies to the rows
+    const std::string row = packedType ? "p." : "";
+
+    if (packedType) {
+      out << getPackedEntries(type, what, projection);
+    } else {
+      out << "SELECT * FROM " << m_dataTableName.at(what);
+    }
+    out << " WHERE " << getExportRange(filter, clustered, packedType, cursor, row);
+    if (bound >= 0) {
+      out << " AND " << row << getExportKey(clustered, packedType) << " <= " << bound;
+    }
+    // Clustered tables are read in key order, packed tables keep their rowid
+    if (clustered && !packedType) {
+      out << " ORDER BY " << m_procEventColumn.at(ProcEventColumn::SystemTime) << ", "
+          << idColumn << ";";
+    } else {
+      out << " ORDER BY " << idColumn << ";";
+    }
+  }
+
+  return out.str();
+}
+
+auto Query::getExportBound(Query::Type type,
+                           tkm::msg::monitor::Data_What what,
+                           const tkm::msg::ext::ExportFilter &filter,
+                           bool clustered,
+                           bool packed,
+                           int64_t cursor,
+                           uint64_t limit) -> std::string
+{
+  std::stringstream out;
+
+  if ((m_dataTableName.count(what) == 0) ||
+      ((type != Query::Type::SQLite3) && (type != Query::Type::PostgreSQL))) {
+    return out.str();
+  }
+
+  const bool packedType = packed && (m_packedDataTypes.count(what) > 0);
+  const auto &key = getExportKey(clustered, packedType);
+
+  // A SystemTime bound keeps the rows of one sample in the same step
+  out << "SELECT MAX(" << key << ") FROM (SELECT " << key << " FROM "
+      << m_dataTableName.at(what) << " WHERE "
+      << getExportRange(filter, clustered, packedType, cursor, "") << " ORDER BY " << key
+      << " LIMIT " << limit << ") AS r;";
+
+  return out.str();
+}
+
+auto Query::getExportKey(bool clustered, bool packedType) -> const std::string &
+{
+  return (clustered && !packedType) ? m_procEventColumn.at(ProcEventColumn::SystemTime)
+                                    : m_procEventColumn.at(ProcEventColumn::Id);
+}
+
+auto Query::getExportRange(const tkm::msg::ext::ExportFilter &filter,
+                           bool clustered,
+                           bool packedType,
+                           int64_t cursor,
+                           const std::string &row) -> std::string
+{
+  const auto &timeColumn = m_procEventColumn.at(ProcEventColumn::SystemTime);
+  std::stringstream out;
+
+  out << row << m_procEventColumn.at(ProcEventColumn::SessionId) << " = "
+      << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
+      << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " = "
+      << "'" << filter.session_hash() << "')";
+  if (filter.time_from() > 0) {
+    out << " AND " << row << timeColumn << " >= " << filter.time_from();
+  }
+  if (filter.time_to() > 0) {
+    out << " AND " << row << timeColumn << " <= " << filter.time_to();
+  }
+  if (cursor >= 0) {
+    out << " AND " << row << getExportKey(clustered, packedType) << " > " << cursor;
+  }
+
+  return out.str();
+}
+
+auto Query::hasChanges(tkm::msg::monitor::Data_What what, uint64_t keyframeInterval) -> bool
+{
+  return (keyframeInterval > 0) && ((what == tkm::msg::monitor::Data_What_ProcInfo) ||
+                                    (what == tkm::msg::monitor::Data_What_ContextInfo));
+}
+
+auto Query::getChangeKey(tkm::msg::monitor::Data_What what) -> const std::string &
+{
+  return (what == tkm::msg::monitor::Data_What_ProcInfo)
+             ? m_procInfoColumn.at(ProcInfoColumn::Pid)
+             : m_contextInfoColumn.at(ContextInfoColumn::CtxId);
+}
+
+auto Query::hasDataColumn(tkm::msg::monitor::Data_What what,
+                          const std::string &name,
+                          const Projection &projection) -> bool
+{
+  // Columns left out by the projection are not in the table
+  const auto stored = projection.find(what);
+  if ((stored != projection.cend()) && (stored->second.count(name) == 0)) {
+    return false;
+  }
+
+  const auto contains = [&name](const auto &columns) {
+    return std::any_of(columns.cbegin(), columns.cend(), [&name](const auto &entry) {
+      return entry.second == name;
+    });
+  };
+
+  switch (what) {
+  case tkm::msg::monitor::Data_What_SysProcStat:
+    return contains(m_sysProcStatColumn);
+  case tkm::msg::monitor::Data_What_SysProcMemInfo:
+    return contains(m_sysProcMemColumn);
+  case tkm::msg::monitor::Data_What_SysProcDiskStats:
+    return contains(m_sysProcDiskColumn);
+  case tkm::msg::monitor::Data_What_SysProcPressure:
+    return contains(m_sysProcPressureColumn);
+  case tkm::msg::monitor::Data_What_SysProcBuddyInfo:
+    return contains(m_sysProcBuddyInfoColumn);
+  case tkm::msg::monitor::Data_What_SysProcWireless:
+    return contains(m_sysProcWirelessColumn);
+  case tkm::msg::monitor::Data_What_SysProcVMStat:
+    return contains(m_sysProcVMStatColumn);
+  case tkm::msg::monitor::Data_What_ProcAcct:
+    return contains(m_procAcctColumn);
+  case tkm::msg::monitor::Data_What_ProcInfo:
+    return contains(m_procInfoColumn);
+  case tkm::msg::monitor::Data_What_ProcEvent:
+    return contains(m_procEventColumn);
+  case tkm::msg::monitor::Data_What_ContextInfo:
+    return contains(m_contextInfoColumn);
+  default:
+    break;
+  }
+
+  return false;
+}
+
+auto Query::getDataColumns(tkm::msg::monitor::Data_What what, const Projection &projection)
+    -> std::vector<std::string>
+{
+  const auto stored = projection.find(what);
+  std::vector<std::string> names;
+  const auto collect = [&names, &stored, &projection](const auto &columns) {
+    for (const auto &entry : columns) {
+      if ((stored == projection.cend()) || (stored->second.count(entry.second) > 0)) {
+        names.push_back(entry.second);
       }
     }
+  };
+
+  switch (what) {
+  case tkm::msg::monitor::Data_What_SysProcStat:
+    collect(m_sysProcStatColumn);
+    break;
+  case tkm::msg::monitor::Data_What_SysProcMemInfo:
+    collect(m_sysProcMemColumn);
+    break;
+  case tkm::msg::monitor::Data_What_SysProcDiskStats:
+    collect(m_sysProcDiskColumn);
+    break;
+  case tkm::msg::monitor::Data_What_SysProcPressure:
+    collect(m_sysProcPressureColumn);
+    break;
+  case tkm::msg::monitor::Data_What_SysProcBuddyInfo:
+    collect(m_sysProcBuddyInfoColumn);
+    break;
+  case tkm::msg::monitor::Data_What_SysProcWireless:
+    collect(m_sysProcWirelessColumn);
+    break;
+  case tkm::msg::monitor::Data_What_SysProcVMStat:
+    collect(m_sysProcVMStatColumn);
+    break;
+  case tkm::msg::monitor::Data_What_ProcAcct:
+    collect(m_procAcctColumn);
+    break;
+  case tkm::msg::monitor::Data_What_ProcInfo:
+    collect(m_procInfoColumn);
+    break;
+  case tkm::msg::monitor::Data_What_ProcEvent:
+    collect(m_procEventColumn);
+    break;
+  case tkm::msg::monitor::Data_What_ContextInfo:
+    collect(m_contextInfoColumn);
+    break;
+  default:
+    break;
+  }
+
+  return names;
+}
+
+auto Query::parseColumns(tkm::msg::monitor::Data_What what, const std::string &list)
+    -> std::set<std::string>
+{
+  const auto dataColumns = getDataColumns(what);
+  std::set<std::string> columns{
+      m_procEventColumn.at(ProcEventColumn::Id),
+      m_procEventColumn.at(ProcEventColumn::SystemTime),
+      m_procEventColumn.at(ProcEventColumn::MonotonicTime),
+      m_procEventColumn.at(ProcEventColumn::ReceiveTime),
+      m_procEventColumn.at(ProcEventColumn::SessionId),
+  };
+  std::stringstream names(list);
+  std::string name;
+
+  while (std::getline(names, name, ',')) {
+    name.erase(0, name.find_first_not_of(' '));
+    name.erase(name.find_last_not_of(' ') + 1);
+
+    const auto column =
+        std::find_if(dataColumns.cbegin(), dataColumns.cend(), [&name](const auto &entry) {
+          return std::equal(
+              entry.cbegin(), entry.cend(), name.cbegin(), name.cend(), [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) ==
+                       std::tolower(static_cast<unsigned char>(b));
+              });
+        });
+    if (column != dataColumns.cend()) {
+      columns.insert(*column);
+    }
+  }
+
+  return columns;
+}
+
+auto Query::getTableColumns(Query::Type type, tkm::msg::monitor::Data_What what) -> std::string
+{
+  std::string table = m_dataTableName.at(what);
+  std::stringstream out;
+
+  // NULL when the table does not exist yet
+  if (type == Query::Type::SQLite3) {
+    out << "SELECT group_concat(name, ',') FROM pragma_table_info('" << table << "');";
+  } else if (type == Query::Type::PostgreSQL) {
+    std::transform(table.begin(), table.end(), table.begin(), ::tolower);
+    out << "SELECT string_agg(column_name, ',') FROM information_schema.columns WHERE "
+        << "table_name = '" << table << "';";
   }
 
   return out.str();
 }
 
-auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::SysProcPressure &sysProcPressure,
-                    uint64_t systemTime,
-                    uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+auto Query::getInsertHeader(Query::Type type,
+                            tkm::msg::monitor::Data_What what,
+                            const Projection &projection,
+                            bool clustered,
+                            uint64_t systemTime,
+                            const std::string &sessionId) -> std::string
 {
+  const auto &idColumn = m_procEventColumn.at(ProcEventColumn::Id);
+  const auto &table = m_dataTableName.at(what);
+  std::stringstream columns;
+  std::stringstream values;
+  size_t count = 0;
+
+  for (const auto &column : getDataColumns(what, projection)) {
+    if (column != idColumn) {
+      columns << ((count > 0) ? "," : "") << column;
+      values << ((count > 0) ? ", " : "") << "v.column" << (count + 1);
+      count++;
+    }
+  }
+
+  if (!isOrdinalInsert(type, clustered)) {
+    return "INSERT INTO " + table + " (" + columns.str() + ") VALUES ";
+  }
+
+  // The rows of one SystemTime continue after the ones already stored
   std::stringstream out;
+  out << "INSERT INTO " << table << " (" << columns.str() << "," << idColumn << ") SELECT "
+      << values.str() << ", b.Base + v.column" << (count + 1) << " FROM (SELECT COALESCE(MAX("
+      << idColumn << ") + 1, 0) AS Base FROM " << table << " WHERE "
+      << m_procEventColumn.at(ProcEventColumn::SessionId) << " = " << sessionId << " AND "
+      << m_procEventColumn.at(ProcEventColumn::SystemTime) << " = " << systemTime
+      << ") AS b CROSS JOIN (VALUES ";
 
+  return out.str();
+}
+
+auto Query::getStoredColumns(tkm::msg::monitor::Data_What what, const Projection &projection)
+    -> std::vector<bool>
+{
+  const auto stored = projection.find(what);
+  std::vector<bool> mask;
+
+  for (const auto &column : getDataColumns(what)) {
+    if ((column == m_procEventColumn.at(ProcEventColumn::Id)) ||
+        (column == m_procEventColumn.at(ProcEventColumn::SessionId))) {
+      continue;
+    }
+    mask.push_back((stored == projection.cend()) || (stored->second.count(column) > 0));
+  }
+
+  return mask;
+}
+
+auto Query::checkAggregate(const tkm::msg::ext::AggregateFilter &filter,
+                           const Projection &projection) -> std::string
+{
+  const auto what = static_cast<tkm::msg::monitor::Data_What>(filter.what());
+
+  if (!tkm::msg::monitor::Data_What_IsValid(filter.what()) || (m_dataTableName.count(what) == 0) ||
+      (filter.column_size() == 0) || (filter.bucket_width() == 0)) {
+    return "Invalid aggregate request";
+  }
+
+  std::vector<std::string> columns(filter.column().cbegin(), filter.column().cend());
+  if (!filter.match_column().empty()) {
+    columns.push_back(filter.match_column());
+  }
+  for (const auto &column : columns) {
+    if (!hasDataColumn(what, column)) {
+      return "Unknown column " + column;
+    }
+    if (!hasDataColumn(what, column, projection)) {
+      return "Column " + column + " is not stored by the ingest projection";
+    }
+  }
+
+  return "";
+}
+
+auto Query::aggregateData(Query::Type type,
+                          const tkm::msg::ext::AggregateFilter &filter,
+                          bool clustered,
+                          bool packed,
+                          const Projection &projection) -> std::string
+{
+  const auto what = static_cast<tkm::msg::monitor::Data_What>(filter.what());
+  const auto &timeColumn = m_procEventColumn.at(ProcEventColumn::SystemTime);
+  const auto &idColumn = m_procEventColumn.at(ProcEventColumn::Id);
+  std::stringstream out;
+
+  // Column names are written into the statement so only stored columns are accepted
+  if (!checkAggregate(filter, projection).empty()) {
+    return out.str();
+  }
+
+  // The last value of a bucket is read from the row with the highest Id, or on
+  // clustered tables from the latest row found through the table key
   if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-    out << "INSERT INTO " << m_sysProcPressureTableName << " ("
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::SystemTime) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MonotonicTime) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::ReceiveTime) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg10) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg60) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeAvg300) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUSomeTotal) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg10) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg60) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullAvg300) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::CPUFullTotal) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg10) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg60) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeAvg300) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMSomeTotal) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg10) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg60) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullAvg300) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::MEMFullTotal) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg10) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg60) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeAvg300) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOSomeTotal) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg10) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg60) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullAvg300) << ","
-        << m_sysProcPressureColumn.at(SysProcPressureColumn::IOFullTotal) << ","
-        << m_sysProcStatColumn.at(SysProcStatColumn::SessionId) << ") VALUES ('" << systemTime
-        << "', '" << monotonicTime << "', '" << receiveTime << "', '"
-        << sysProcPressure.cpu_some().avg10() << "', '" << sysProcPressure.cpu_some().avg60()
-        << "', '" << sysProcPressure.cpu_some().avg300() << "', '"
-        << sysProcPressure.cpu_some().total() << "', '" << sysProcPressure.cpu_full().avg10()
-        << "', '" << sysProcPressure.cpu_full().avg60() << "', '"
-        << sysProcPressure.cpu_full().avg300() << "', '" << sysProcPressure.cpu_full().total()
-        << "', '" << sysProcPressure.mem_some().avg10() << "', '"
-        << sysProcPressure.mem_some().avg60() << "', '" << sysProcPressure.mem_some().avg300()
-        << "', '" << sysProcPressure.mem_some().total() << "', '"
-        << sysProcPressure.mem_full().avg10() << "', '" << sysProcPressure.mem_full().avg60()
-        << "', '" << sysProcPressure.mem_full().avg300() << "', '"
-        << sysProcPressure.mem_full().total() << "', '" << sysProcPressure.io_some().avg10()
-        << "', '" << sysProcPressure.io_some().avg60() << "', '"
-        << sysProcPressure.io_some().avg300() << "', '" << sysProcPressure.io_some().total()
-        << "', '" << sysProcPressure.io_full().avg10() << "', '"
-        << sysProcPressure.io_full().avg60() << "', '" << sysProcPressure.io_full().avg300()
-        << "', '" << sysProcPressure.io_full().total() << "', ";
+    // Packed tables are aggregated through their entry views
+    const bool packedType = packed && (m_packedDataTypes.count(what) > 0);
+    const bool cluster = clustered && (type == Query::Type::SQLite3) && !packedType;
+    const auto table = m_dataTableName.at(what) + (packedType ? "Entries" : "");
+    const auto &sessionColumn = m_procEventColumn.at(ProcEventColumn::SessionId);
+    const std::string sessionId = "(SELECT " + m_sessionColumn.at(SessionColumn::Id) + " FROM " +
+                                  m_sessionsTableName + " WHERE " +
+                                  m_sessionColumn.at(SessionColumn::Hash) + " = '" +
+                                  filter.session_hash() + "')";
+    std::string matchValue = filter.match_value();
+    // Tombstones of change only rows carry no values
+    const bool changes = (what == tkm::msg::monitor::Data_What_ProcInfo) ||
+                         (what == tkm::msg::monitor::Data_What_ContextInfo);
+    const std::string samples =
+        changes ? " AND " + m_procEventColumn.at(ProcEventColumn::ReceiveTime) + " > 0" : "";
+
+    for (size_t pos = matchValue.find('\''); pos != std::string::npos;
+         pos = matchValue.find('\'', pos + 2)) {
+      matchValue.insert(pos, 1, '\'');
+    }
 
-    if (type == Query::Type::SQLite3) {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
+    out << "SELECT g.Bucket, g.Samples";
+    for (int i = 0; i < filter.column_size(); i++) {
+      out << ", g.Min" << i << ", g.Max" << i << ", g.Avg" << i << ", t." << filter.column(i);
+    }
+    out << " FROM (SELECT (" << timeColumn << " / " << filter.bucket_width() << ") * "
+        << filter.bucket_width() << " AS Bucket, COUNT(*) AS Samples, MAX("
+        << (cluster ? timeColumn : idColumn) << ") AS Last";
+    for (int i = 0; i < filter.column_size(); i++) {
+      out << ", MIN(" << filter.column(i) << ") AS Min" << i << ", MAX(" << filter.column(i)
+          << ") AS Max" << i << ", AVG(" << filter.column(i) << ") AS Avg" << i;
+    }
+    out << " FROM " << table << " WHERE " << sessionColumn << " = " << sessionId << samples;
+    if (filter.time_from() > 0) {
+      out << " AND " << timeColumn << " >= " << filter.time_from();
+    }
+    if (filter.time_to() > 0) {
+      out << " AND " << timeColumn << " <= " << filter.time_to();
+    }
+    if (!filter.match_column().empty()) {
+      out << " AND " << filter.match_column() << " = '" << matchValue << "'";
+    }
+    out << " GROUP BY Bucket) g JOIN " << table << " t ON ";
+    if (cluster) {
+      out << "t." << sessionColumn << " = " << sessionId << " AND t." << timeColumn
+          << " = g.Last AND t." << idColumn << " = (SELECT MAX(" << idColumn << ") FROM " << table
+          << " WHERE " << sessionColumn << " = " << sessionId << samples << " AND "
+          << timeColumn << " = g.Last";
+      if (!filter.match_column().empty()) {
+        out << " AND " << filter.match_column() << " = '" << matchValue << "'";
+      }
+      out << ")";
     } else {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
+      out << "t." << idColumn << " = g.Last";
     }
+    out << " ORDER BY g.Bucket;";
   }
 
   return out.str();
 }
 
 auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::ProcAcct &procAcct,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::ProcEvent &procEvent,
+                    uint64_t systemTime,
+                    uint64_t monotonicTime,
+                    uint64_t receiveTime,
+                    const Projection &projection,
+                    bool clustered) -> std::string
+{
+  const auto what = tkm::msg::monitor::Data_What_ProcEvent;
+  std::stringstream out;
+
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    const auto stored = getStoredColumns(what, projection);
+
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    RowValues(insert, 0, stored)
+        .add(systemTime)
+        .add(monotonicTime)
+        .add(receiveTime)
+        .add(procEvent.fork_count())
+        .add(procEvent.exec_count())
+        .add(procEvent.exit_count())
+        .add(procEvent.uid_count())
+        .add(procEvent.gid_count())
+        .end(sessionId);
+    insert.end();
+  }
+
+  return out.str();
+}
+
+auto Query::addData(Query::Type type,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::SysProcStat &sysProcStat,
                     uint64_t systemTime,
                     uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+                    uint64_t receiveTime,
+                    bool packed,
+                    const Projection &projection,
+                    bool clustered) -> std::string
 {
+  const auto what = tkm::msg::monitor::Data_What_SysProcStat;
   std::stringstream out;
 
   if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-    out << "INSERT INTO " << m_procAcctTableName << " ("
-        << m_procAcctColumn.at(ProcAcctColumn::SystemTime) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::MonotonicTime) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::ReceiveTime) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::AcComm) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::AcUid) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::AcGid) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::AcPid) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::AcPPid) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::AcUTime) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::AcSTime) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::CpuCount) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::CpuRunRealTotal) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::CpuRunVirtualTotal) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::CpuDelayTotal) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::CpuDelayAverage) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::CoreMem) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::VirtMem) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::HiwaterRss) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::HiwaterVm) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::Nvcsw) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::Nivcsw) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::SwapinCount) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::SwapinDelayTotal) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::SwapinDelayAverage) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::BlkIOCount) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::BlkIODelayTotal) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::BlkIODelayAverage) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::IOStorageReadBytes) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::IOStorageWriteBytes) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::IOReadChar) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::IOWriteChar) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::IOReadSyscalls) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::IOWriteSyscalls) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::FreePagesCount) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::FreePagesDelayTotal) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::FreePagesDelayAverage) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::ThrashingCount) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::ThrashingDelayTotal) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::ThrashingDelayAverage) << ","
-        << m_procAcctColumn.at(ProcAcctColumn::SessionId) << ") VALUES ('" << systemTime << "', '"
-        << monotonicTime << "', '" << receiveTime << "', '" << procAcct.ac_comm() << "', '"
-        << procAcct.ac_uid() << "', '" << procAcct.ac_gid() << "', '" << procAcct.ac_pid() << "', '"
-        << procAcct.ac_ppid() << "', '" << procAcct.ac_utime() << "', '" << procAcct.ac_stime()
-        << "', '" << procAcct.cpu().cpu_count() << "', '" << procAcct.cpu().cpu_run_real_total()
-        << "', '" << procAcct.cpu().cpu_run_virtual_total() << "', '"
-        << procAcct.cpu().cpu_delay_total() << "', '" << procAcct.cpu().cpu_delay_average()
-        << "', '" << procAcct.mem().coremem() << "', '" << procAcct.mem().virtmem() << "', '"
-        << procAcct.mem().hiwater_rss() << "', '" << procAcct.mem().hiwater_vm() << "', '"
-        << procAcct.ctx().nvcsw() << "', '" << procAcct.ctx().nivcsw() << "', '"
-        << procAcct.swp().swapin_count() << "', '" << procAcct.swp().swapin_delay_total() << "', '"
-        << procAcct.swp().swapin_delay_average() << "', '" << procAcct.io().blkio_count() << "', '"
-        << procAcct.io().blkio_delay_total() << "', '" << procAcct.io().blkio_delay_average()
-        << "', '" << procAcct.io().read_bytes() << "', '" << procAcct.io().write_bytes() << "', '"
-        << procAcct.io().read_char() << "', '" << procAcct.io().write_char() << "', '"
-        << procAcct.io().read_syscalls() << "', '" << procAcct.io().write_syscalls() << "', '"
-        << procAcct.reclaim().freepages_count() << "', '"
-        << procAcct.reclaim().freepages_delay_total() << "', '"
-        << procAcct.reclaim().freepages_delay_average() << "', '"
-        << procAcct.thrashing().thrashing_count() << "', '"
-        << procAcct.thrashing().thrashing_delay_total() << "', '"
-        << procAcct.thrashing().thrashing_delay_average() << "', ";
+    const auto stored = getStoredColumns(what, projection);
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    // One row with the cpu totals as first array elements, then the cores
+    if (packed) {
+      std::vector<std::string> arrays(5);
+      const auto addEntry = [&arrays, type](const auto &cpuStat) {
+        addArrayText(arrays[0], type, cpuStat.name());
+        addArrayValue(arrays[1], cpuStat.all());
+        addArrayValue(arrays[2], cpuStat.usr());
+        addArrayValue(arrays[3], cpuStat.sys());
+        addArrayValue(arrays[4], cpuStat.iow());
+      };
+
+      addEntry(sysProcStat.cpu());
+      for (const auto &cpuStat : sysProcStat.core()) {
+        addEntry(cpuStat);
+      }
+      // Packed rows keep their rowid
+      DataInsert packedInsert(out,
+                              type,
+                              getInsertHeader(type, what, projection, false, systemTime, sessionId),
+                              false);
+      RowValues row(packedInsert, 0, stored);
+      row.add(systemTime).add(monotonicTime).add(receiveTime);
+      for (const auto &array : arrays) {
+        row.addArray(array);
+      }
+      row.end(sessionId);
+      packedInsert.end();
 
-    if (type == Query::Type::SQLite3) {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
-    } else {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
+      return out.str();
+    }
+
+    // The cpu totals row first, then one row per core
+    for (int i = 0; i <= sysProcStat.core_size(); i++) {
+      const auto &cpuStat = (i == 0) ? sysProcStat.cpu() : sysProcStat.core(i - 1);
+
+      RowValues(insert, i, stored)
+          .add(systemTime)
+          .add(monotonicTime)
+          .add(receiveTime)
+          .add(cpuStat.name())
+          .add(cpuStat.all())
+          .add(cpuStat.usr())
+          .add(cpuStat.sys())
+          .add(cpuStat.iow())
+          .end(sessionId);
     }
+    insert.end();
   }
 
   return out.str();
 }
 
 auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::ProcInfo &procInfo,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
+                    uint64_t systemTime,
+                    uint64_t monotonicTime,
+                    uint64_t receiveTime,
+                    const Projection &projection,
+                    bool clustered) -> std::string
+{
+  const auto what = tkm::msg::monitor::Data_What_SysProcMemInfo;
+  std::stringstream out;
+
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    const auto stored = getStoredColumns(what, projection);
+
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    RowValues(insert, 0, stored)
+        .add(systemTime)
+        .add(monotonicTime)
+        .add(receiveTime)
+        .add(sysProcMem.mem_total())
+        .add(sysProcMem.mem_free())
+        .add(sysProcMem.mem_available())
+        .add(sysProcMem.mem_cached())
+        .add(sysProcMem.mem_percent())
+        .add(sysProcMem.active())
+        .add(sysProcMem.inactive())
+        .add(sysProcMem.slab())
+        .add(sysProcMem.kreclaimable())
+        .add(sysProcMem.sreclaimable())
+        .add(sysProcMem.sunreclaim())
+        .add(sysProcMem.kernel_stack())
+        .add(sysProcMem.swap_total())
+        .add(sysProcMem.swap_free())
+        .add(sysProcMem.swap_cached())
+        .add(sysProcMem.swap_percent())
+        .add(sysProcMem.cma_total())
+        .add(sysProcMem.cma_free())
+        .end(sessionId);
+    insert.end();
+  }
+
+  return out.str();
+}
+
+auto Query::addData(Query::Type type,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::SysProcDiskStats &sysDiskStats,
                     uint64_t systemTime,
                     uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+                    uint64_t receiveTime,
+                    bool packed,
+                    const Projection &projection,
+                    bool clustered) -> std::string
 {
+  const auto what = tkm::msg::monitor::Data_What_SysProcDiskStats;
   std::stringstream out;
 
-  for (const auto &procEntry : procInfo.entry()) {
-    if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-      out << "INSERT INTO " << m_procInfoTableName << " ("
-          << m_procInfoColumn.at(ProcInfoColumn::SystemTime) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::MonotonicTime) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::ReceiveTime) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::Comm) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::Pid) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::PPid) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::CtxId) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::CtxName) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::CpuTime) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::CpuPercent) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::MemRSS) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::MemPSS) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::FDCount) << ","
-          << m_procInfoColumn.at(ProcInfoColumn::SessionId) << ") VALUES ('" << systemTime << "', '"
-          << monotonicTime << "', '" << receiveTime << "', '" << procEntry.comm() << "', '"
-          << procEntry.pid() << "', '" << procEntry.ppid() << "', '"
-          << std::to_string(procEntry.ctx_id()) << "', '" << procEntry.ctx_name() << "', '"
-          << procEntry.cpu_time() << "', '" << procEntry.cpu_percent() << "', '"
-          << procEntry.mem_rss() << "', '" << procEntry.mem_pss() << "', '"
-          << procEntry.fd_count() << "', ";
+  if (((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) &&
+      (sysDiskStats.disk_size() > 0)) {
+    const auto stored = getStoredColumns(what, projection);
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    if (packed) {
+      std::vector<std::string> arrays(12);
+
+      for (const auto &diskEntry : sysDiskStats.disk()) {
+        addArrayValue(arrays[0], diskEntry.node_major());
+        addArrayValue(arrays[1], diskEntry.node_minor());
+        addArrayText(arrays[2], type, diskEntry.name());
+        addArrayValue(arrays[3], diskEntry.reads_completed());
+        addArrayValue(arrays[4], diskEntry.reads_merged());
+        addArrayValue(arrays[5], diskEntry.reads_spent_ms());
+        addArrayValue(arrays[6], diskEntry.writes_completed());
+        addArrayValue(arrays[7], diskEntry.writes_merged());
+        addArrayValue(arrays[8], diskEntry.writes_spent_ms());
+        addArrayValue(arrays[9], diskEntry.io_in_progress());
+        addArrayValue(arrays[10], diskEntry.io_spent_ms());
+        addArrayValue(arrays[11], diskEntry.io_weighted_ms());
+      }
+      // Packed rows keep their rowid
+      DataInsert packedInsert(out,
+                              type,
+                              getInsertHeader(type, what, projection, false, systemTime, sessionId),
+                              false);
+      RowValues row(packedInsert, 0, stored);
+      row.add(systemTime).add(monotonicTime).add(receiveTime);
+      for (const auto &array : arrays) {
+        row.addArray(array);
+      }
+      row.end(sessionId);
+      packedInsert.end();
+
+      return out.str();
     }
 
-    if (type == Query::Type::SQLite3) {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
-    } else {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
+    for (int i = 0; i < sysDiskStats.disk_size(); i++) {
+      const auto &diskEntry = sysDiskStats.disk(i);
+
+      RowValues(insert, i, stored)
+          .add(systemTime)
+          .add(monotonicTime)
+          .add(receiveTime)
+          .add(diskEntry.node_major())
+          .add(diskEntry.node_minor())
+          .add(diskEntry.name())
+          .add(diskEntry.reads_completed())
+          .add(diskEntry.reads_merged())
+          .add(diskEntry.reads_spent_ms())
+          .add(diskEntry.writes_completed())
+          .add(diskEntry.writes_merged())
+          .add(diskEntry.writes_spent_ms())
+          .add(diskEntry.io_in_progress())
+          .add(diskEntry.io_spent_ms())
+          .add(diskEntry.io_weighted_ms())
+          .end(sessionId);
     }
+    insert.end();
   }
 
   return out.str();
 }
 
 auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
-                    const tkm::msg::monitor::ContextInfo &ctxInfo,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::SysProcPressure &sysProcPressure,
+                    uint64_t systemTime,
+                    uint64_t monotonicTime,
+                    uint64_t receiveTime,
+                    const Projection &projection,
+                    bool clustered) -> std::string
+{
+  const auto what = tkm::msg::monitor::Data_What_SysProcPressure;
+  std::stringstream out;
+
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    const auto stored = getStoredColumns(what, projection);
+
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    RowValues(insert, 0, stored)
+        .add(systemTime)
+        .add(monotonicTime)
+        .add(receiveTime)
+        .add(sysProcPressure.cpu_some().avg10())
+        .add(sysProcPressure.cpu_some().avg60())
+        .add(sysProcPressure.cpu_some().avg300())
+        .add(sysProcPressure.cpu_some().total())
+        .add(sysProcPressure.cpu_full().avg10())
+        .add(sysProcPressure.cpu_full().avg60())
+        .add(sysProcPressure.cpu_full().avg300())
+        .add(sysProcPressure.cpu_full().total())
+        .add(sysProcPressure.mem_some().avg10())
+        .add(sysProcPressure.mem_some().avg60())
+        .add(sysProcPressure.mem_some().avg300())
+        .add(sysProcPressure.mem_some().total())
+        .add(sysProcPressure.mem_full().avg10())
+        .add(sysProcPressure.mem_full().avg60())
+        .add(sysProcPressure.mem_full().avg300())
+        .add(sysProcPressure.mem_full().total())
+        .add(sysProcPressure.io_some().avg10())
+        .add(sysProcPressure.io_some().avg60())
+        .add(sysProcPressure.io_some().avg300())
+        .add(sysProcPressure.io_some().total())
+        .add(sysProcPressure.io_full().avg10())
+        .add(sysProcPressure.io_full().avg60())
+        .add(sysProcPressure.io_full().avg300())
+        .add(sysProcPressure.io_full().total())
+        .end(sessionId);
+    insert.end();
+  }
+
+  return out.str();
+}
+
+auto Query::addData(Query::Type type,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::ProcAcct &procAcct,
                     uint64_t systemTime,
                     uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+                    uint64_t receiveTime,
+                    const Projection &projection,
+                    bool clustered) -> std::string
 {
+  const auto what = tkm::msg::monitor::Data_What_ProcAcct;
   std::stringstream out;
 
-  for (const auto &ctxEntry : ctxInfo.entry()) {
-    if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-      out << "INSERT INTO " << m_contextInfoTableName << " ("
-          << m_contextInfoColumn.at(ContextInfoColumn::SystemTime) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::MonotonicTime) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::ReceiveTime) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::CtxId) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::CtxName) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalCpuTime) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalCpuPercent) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalMemRSS) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalMemPSS) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::TotalFDCount) << ","
-          << m_contextInfoColumn.at(ContextInfoColumn::SessionId) << ") VALUES ('" << systemTime
-          << "', '" << monotonicTime << "', '" << receiveTime << "', '"
-          << std::to_string(ctxEntry.ctx_id()) << "', '" << ctxEntry.ctx_name() << "', '"
-          << ctxEntry.total_cpu_time() << "', '" << ctxEntry.total_cpu_percent() << "', '"
-          << ctxEntry.total_mem_rss() << "', '" << ctxEntry.total_mem_pss() << "', '"
-          << ctxEntry.total_fd_count() << "', ";
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    const auto stored = getStoredColumns(what, projection);
+
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    RowValues(insert, 0, stored)
+        .add(systemTime)
+        .add(monotonicTime)
+        .add(receiveTime)
+        .add(procAcct.ac_comm())
+        .add(procAcct.ac_uid())
+        .add(procAcct.ac_gid())
+        .add(procAcct.ac_pid())
+        .add(procAcct.ac_ppid())
+        .add(procAcct.ac_utime())
+        .add(procAcct.ac_stime())
+        .add(procAcct.cpu().cpu_count())
+        .add(procAcct.cpu().cpu_run_real_total())
+        .add(procAcct.cpu().cpu_run_virtual_total())
+        .add(procAcct.cpu().cpu_delay_total())
+        .add(procAcct.cpu().cpu_delay_average())
+        .add(procAcct.mem().coremem())
+        .add(procAcct.mem().virtmem())
+        .add(procAcct.mem().hiwater_rss())
+        .add(procAcct.mem().hiwater_vm())
+        .add(procAcct.ctx().nvcsw())
+        .add(procAcct.ctx().nivcsw())
+        .add(procAcct.swp().swapin_count())
+        .add(procAcct.swp().swapin_delay_total())
+        .add(procAcct.swp().swapin_delay_average())
+        .add(procAcct.io().blkio_count())
+        .add(procAcct.io().blkio_delay_total())
+        .add(procAcct.io().blkio_delay_average())
+        .add(procAcct.io().read_bytes())
+        .add(procAcct.io().write_bytes())
+        .add(procAcct.io().read_char())
+        .add(procAcct.io().write_char())
+        .add(procAcct.io().read_syscalls())
+        .add(procAcct.io().write_syscalls())
+        .add(procAcct.reclaim().freepages_count())
+        .add(procAcct.reclaim().freepages_delay_total())
+        .add(procAcct.reclaim().freepages_delay_average())
+        .add(procAcct.thrashing().thrashing_count())
+        .add(procAcct.thrashing().thrashing_delay_total())
+        .add(procAcct.thrashing().thrashing_delay_average())
+        .end(sessionId);
+    insert.end();
+  }
+
+  return out.str();
+}
+
+auto Query::addData(Query::Type type,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::ProcInfo &procInfo,
+                    uint64_t systemTime,
+                    uint64_t monotonicTime,
+                    uint64_t receiveTime,
+                    const Projection &projection,
+                    bool clustered) -> std::string
+{
+  const auto what = tkm::msg::monitor::Data_What_ProcInfo;
+  std::stringstream out;
+
+  if (((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) &&
+      (procInfo.entry_size() > 0)) {
+    const auto stored = getStoredColumns(what, projection);
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    for (int i = 0; i < procInfo.entry_size(); i++) {
+      const auto &procEntry = procInfo.entry(i);
+
+      RowValues(insert, i, stored)
+          .add(systemTime)
+          .add(monotonicTime)
+          .add(receiveTime)
+          .add(procEntry.comm())
+          .add(procEntry.pid())
+          .add(procEntry.ppid())
+          .add(std::to_string(procEntry.ctx_id()))
+          .add(procEntry.ctx_name())
+          .add(procEntry.cpu_time())
+          .add(procEntry.cpu_percent())
+          .add(procEntry.mem_rss())
+          .add(procEntry.mem_pss())
+          .add(procEntry.fd_count())
+          .end(sessionId);
     }
+    insert.end();
+  }
 
-    if (type == Query::Type::SQLite3) {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
-    } else {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
+  return out.str();
+}
+
+auto Query::addData(Query::Type type,
+                    const std::string &sessionId,
+                    const tkm::msg::monitor::ContextInfo &ctxInfo,
+                    uint64_t systemTime,
+                    uint64_t monotonicTime,
+                    uint64_t receiveTime,
+                    const Projection &projection,
+                    bool clustered) -> std::string
+{
+  const auto what = tkm::msg::monitor::Data_What_ContextInfo;
+  std::stringstream out;
+
+  if (((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) &&
+      (ctxInfo.entry_size() > 0)) {
+    const auto stored = getStoredColumns(what, projection);
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    for (int i = 0; i < ctxInfo.entry_size(); i++) {
+      const auto &ctxEntry = ctxInfo.entry(i);
+
+      RowValues(insert, i, stored)
+          .add(systemTime)
+          .add(monotonicTime)
+          .add(receiveTime)
+          .add(std::to_string(ctxEntry.ctx_id()))
+          .add(ctxEntry.ctx_name())
+          .add(ctxEntry.total_cpu_time())
+          .add(ctxEntry.total_cpu_percent())
+          .add(ctxEntry.total_mem_rss())
+          .add(ctxEntry.total_mem_pss())
+          .add(ctxEntry.total_fd_count())
+          .end(sessionId);
     }
+    insert.end();
   }
 
   return out.str();
 }
 
 auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
+                    const std::string &sessionId,
                     const tkm::msg::monitor::SysProcBuddyInfo &sysProcBuddyInfo,
                     uint64_t systemTime,
                     uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+                    uint64_t receiveTime,
+                    bool packed,
+                    const Projection &projection,
+                    bool clustered) -> std::string
 {
+  const auto what = tkm::msg::monitor::Data_What_SysProcBuddyInfo;
   std::stringstream out;
 
-  for (const auto &buddyInfo : sysProcBuddyInfo.node()) {
-    if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-      out << "INSERT INTO " << m_sysProcBuddyInfoTableName << " ("
-          << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::SystemTime) << ","
-          << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::MonotonicTime) << ","
-          << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::ReceiveTime) << ","
-          << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Name) << ","
-          << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Zone) << ","
-          << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::Data) << ","
-          << m_sysProcBuddyInfoColumn.at(SysProcBuddyInfoColumn::SessionId) << ") VALUES ('"
-          << systemTime << "', '" << monotonicTime << "', '" << receiveTime << "', '"
-          << buddyInfo.name() << "', '" << buddyInfo.zone() << "', '" << buddyInfo.data() << "', ";
-
-      if (type == Query::Type::SQLite3) {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
-      } else {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash)
-            << " LIKE "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
+  if (((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) &&
+      (sysProcBuddyInfo.node_size() > 0)) {
+    const auto stored = getStoredColumns(what, projection);
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    if (packed) {
+      std::vector<std::string> arrays(3);
+
+      for (const auto &buddyInfo : sysProcBuddyInfo.node()) {
+        addArrayText(arrays[0], type, buddyInfo.name());
+        addArrayText(arrays[1], type, buddyInfo.zone());
+        addArrayText(arrays[2], type, buddyInfo.data());
       }
+      // Packed rows keep their rowid
+      DataInsert packedInsert(out,
+                              type,
+                              getInsertHeader(type, what, projection, false, systemTime, sessionId),
+                              false);
+      RowValues row(packedInsert, 0, stored);
+      row.add(systemTime).add(monotonicTime).add(receiveTime);
+      for (const auto &array : arrays) {
+        row.addArray(array);
+      }
+      row.end(sessionId);
+      packedInsert.end();
+
+      return out.str();
     }
+
+    for (int i = 0; i < sysProcBuddyInfo.node_size(); i++) {
+      const auto &buddyInfo = sysProcBuddyInfo.node(i);
+
+      RowValues(insert, i, stored)
+          .add(systemTime)
+          .add(monotonicTime)
+          .add(receiveTime)
+          .add(buddyInfo.name())
+          .add(buddyInfo.zone())
+          .add(buddyInfo.data())
+          .end(sessionId);
+    }
+    insert.end();
   }
 
   return out.str();
 }
 
 auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
+                    const std::string &sessionId,
                     const tkm::msg::monitor::SysProcWireless &sysProcWireless,
                     uint64_t systemTime,
                     uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+                    uint64_t receiveTime,
+                    bool packed,
+                    const Projection &projection,
+                    bool clustered) -> std::string
 {
+  const auto what = tkm::msg::monitor::Data_What_SysProcWireless;
   std::stringstream out;
 
-  for (const auto &ifw : sysProcWireless.ifw()) {
-    if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-      out << "INSERT INTO " << m_sysProcWirelessTableName << " ("
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::SystemTime) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::MonotonicTime) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::ReceiveTime) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Name) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::Status) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityLink) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityLevel) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::QualityNoise) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedNWId) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedCrypt) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedFrag) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedRetry) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::DiscardedMisc) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::MissedBeacon) << ","
-          << m_sysProcWirelessColumn.at(SysProcWirelessColumn::SessionId) << ") VALUES ('"
-          << systemTime << "', '" << monotonicTime << "', '" << receiveTime << "', '" << ifw.name()
-          << "', '" << ifw.status() << "', '" << ifw.quality_link() << "', '" << ifw.quality_level()
-          << "', '" << ifw.quality_noise() << "', '" << ifw.discarded_nwid() << "', '"
-          << ifw.discarded_crypt() << "', '" << ifw.discarded_frag() << "', '"
-          << ifw.discarded_retry() << "', '" << ifw.discarded_misc() << "', '"
-          << ifw.missed_beacon() << "', ";
-
-      if (type == Query::Type::SQLite3) {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
-      } else {
-        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
-            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash)
-            << " LIKE "
-            << "'" << sessionHash << "' AND EndTimestamp = 0));";
+  if (((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) &&
+      (sysProcWireless.ifw_size() > 0)) {
+    const auto stored = getStoredColumns(what, projection);
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    if (packed) {
+      std::vector<std::string> arrays(11);
+
+      for (const auto &ifw : sysProcWireless.ifw()) {
+        addArrayText(arrays[0], type, ifw.name());
+        addArrayText(arrays[1], type, ifw.status());
+        addArrayValue(arrays[2], ifw.quality_link());
+        addArrayValue(arrays[3], ifw.quality_level());
+        addArrayValue(arrays[4], ifw.quality_noise());
+        addArrayValue(arrays[5], ifw.discarded_nwid());
+        addArrayValue(arrays[6], ifw.discarded_crypt());
+        addArrayValue(arrays[7], ifw.discarded_frag());
+        addArrayValue(arrays[8], ifw.discarded_retry());
+        addArrayValue(arrays[9], ifw.discarded_misc());
+        addArrayValue(arrays[10], ifw.missed_beacon());
+      }
+      // Packed rows keep their rowid
+      DataInsert packedInsert(out,
+                              type,
+                              getInsertHeader(type, what, projection, false, systemTime, sessionId),
+                              false);
+      RowValues row(packedInsert, 0, stored);
+      row.add(systemTime).add(monotonicTime).add(receiveTime);
+      for (const auto &array : arrays) {
+        row.addArray(array);
       }
+      row.end(sessionId);
+      packedInsert.end();
+
+      return out.str();
+    }
+
+    for (int i = 0; i < sysProcWireless.ifw_size(); i++) {
+      const auto &ifw = sysProcWireless.ifw(i);
+
+      RowValues(insert, i, stored)
+          .add(systemTime)
+          .add(monotonicTime)
+          .add(receiveTime)
+          .add(ifw.name())
+          .add(ifw.status())
+          .add(ifw.quality_link())
+          .add(ifw.quality_level())
+          .add(ifw.quality_noise())
+          .add(ifw.discarded_nwid())
+          .add(ifw.discarded_crypt())
+          .add(ifw.discarded_frag())
+          .add(ifw.discarded_retry())
+          .add(ifw.discarded_misc())
+          .add(ifw.missed_beacon())
+          .end(sessionId);
     }
+    insert.end();
   }
 
   return out.str();
 }
 
 auto Query::addData(Query::Type type,
-                    const std::string &sessionHash,
+                    const std::string &sessionId,
                     const tkm::msg::monitor::SysProcVMStat &sysProcVMStat,
                     uint64_t systemTime,
                     uint64_t monotonicTime,
-                    uint64_t receiveTime) -> std::string
+                    uint64_t receiveTime,
+                    const Projection &projection,
+                    bool clustered) -> std::string
 {
+  const auto what = tkm::msg::monitor::Data_What_SysProcVMStat;
   std::stringstream out;
 
   if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
-    out << "INSERT INTO " << m_sysProcVMStatTableName << " ("
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::SystemTime) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::MonotonicTime) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ReceiveTime) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGpgin) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGpgout) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PSwpin) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PSwpout) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGmajfault) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGreuse) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealKswapd) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealDirect) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealKhugepaged) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealAnon) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGStealFile) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanKswapd) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanDirect) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanKhugepaged) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanDirectThrottle) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanAnon) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::PGScanFile) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::OOMKill) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactStall) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactFail) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::CompactSuccess) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFaultAlloc) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpCollapseAlloc) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpCollapseAllocFailed) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFileAlloc) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpFileMapped) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSplitPage) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSplitPageFailed) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpZeroPageAlloc) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpZeroPageAllocFailed) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSwpout) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::ThpSwpoutFallback) << ","
-        << m_sysProcVMStatColumn.at(SysProcVMStatColumn::SessionId) << ") VALUES ('" << systemTime
-        << "', '" << monotonicTime << "', '" << receiveTime << "', '" << sysProcVMStat.pgpgin()
-        << "', '" << sysProcVMStat.pgpgout() << "', '" << sysProcVMStat.pswpin() << "', '"
-        << sysProcVMStat.pswpout() << "', '" << sysProcVMStat.pgmajfault() << "', '"
-        << sysProcVMStat.pgreuse() << "', '" << sysProcVMStat.pgsteal_kswapd() << "', '"
-        << sysProcVMStat.pgsteal_direct() << "', '" << sysProcVMStat.pgsteal_khugepaged() << "', '"
-        << sysProcVMStat.pgsteal_anon() << "', '" << sysProcVMStat.pgsteal_file() << "', '"
-        << sysProcVMStat.pgscan_kswapd() << "', '"
-        << sysProcVMStat.pgscan_direct() << "', '" << sysProcVMStat.pgscan_khugepaged() << "', '"
-        << sysProcVMStat.pgscan_direct_throttle() << "', '" << sysProcVMStat.pgscan_anon() << "', '"
-        << sysProcVMStat.pgscan_file() << "', '" << sysProcVMStat.oom_kill() << "', '"
-        << sysProcVMStat.compact_stall() << "', '" << sysProcVMStat.compact_fail() << "', '"
-        << sysProcVMStat.compact_success() << "', '" << sysProcVMStat.thp_fault_alloc() << "', '"
-        << sysProcVMStat.thp_collapse_alloc() << "', '" << sysProcVMStat.thp_collapse_alloc_failed() << "', '"
-        << sysProcVMStat.thp_file_alloc() << "', '" << sysProcVMStat.thp_file_mapped() << "', '"
-        << sysProcVMStat.thp_split_page() << "', '" << sysProcVMStat.thp_split_page_failed() << "', '"
-        << sysProcVMStat.thp_zero_page_alloc() << "', '" << sysProcVMStat.thp_zero_page_alloc_failed() << "', '"
-        << sysProcVMStat.thp_swpout() << "', '" << sysProcVMStat.thp_swpout_fallback() << "', ";
+    const auto stored = getStoredColumns(what, projection);
+
+    DataInsert insert(out,
+                      type,
+                      getInsertHeader(type, what, projection, clustered, systemTime, sessionId),
+                      clustered);
+
+    RowValues(insert, 0, stored)
+        .add(systemTime)
+        .add(monotonicTime)
+        .add(receiveTime)
+        .add(sysProcVMStat.pgpgin())
+        .add(sysProcVMStat.pgpgout())
+        .add(sysProcVMStat.pswpin())
+        .add(sysProcVMStat.pswpout())
+        .add(sysProcVMStat.pgmajfault())
+        .add(sysProcVMStat.pgreuse())
+        .add(sysProcVMStat.pgsteal_kswapd())
+        .add(sysProcVMStat.pgsteal_direct())
+        .add(sysProcVMStat.pgsteal_khugepaged())
+        .add(sysProcVMStat.pgsteal_anon())
+        .add(sysProcVMStat.pgsteal_file())
+        .add(sysProcVMStat.pgscan_kswapd())
+        .add(sysProcVMStat.pgscan_direct())
+        .add(sysProcVMStat.pgscan_khugepaged())
+        .add(sysProcVMStat.pgscan_direct_throttle())
+        .add(sysProcVMStat.pgscan_anon())
+        .add(sysProcVMStat.pgscan_file())
+        .add(sysProcVMStat.oom_kill())
+        .add(sysProcVMStat.compact_stall())
+        .add(sysProcVMStat.compact_fail())
+        .add(sysProcVMStat.compact_success())
+        .add(sysProcVMStat.thp_fault_alloc())
+        .add(sysProcVMStat.thp_collapse_alloc())
+        .add(sysProcVMStat.thp_collapse_alloc_failed())
+        .add(sysProcVMStat.thp_file_alloc())
+        .add(sysProcVMStat.thp_file_mapped())
+        .add(sysProcVMStat.thp_split_page())
+        .add(sysProcVMStat.thp_split_page_failed())
+        .add(sysProcVMStat.thp_zero_page_alloc())
+        .add(sysProcVMStat.thp_zero_page_alloc_failed())
+        .add(sysProcVMStat.thp_swpout())
+        .add(sysProcVMStat.thp_swpout_fallback())
+        .end(sessionId);
+    insert.end();
+  }
 
-    if (type == Query::Type::SQLite3) {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
-    } else {
-      out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
-          << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
-          << "'" << sessionHash << "' AND EndTimestamp = 0));";
+  return out.str();
+}
+
+auto Query::getSessionId(Query::Type type, const std::string &sessionHash) -> std::string
+{
+  std::stringstream out;
+
+  if (type == Query::Type::SQLite3) {
+    out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
+        << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
+        << "'" << sessionHash << "' AND EndTimestamp = 0)";
+  } else {
+    out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM " << m_sessionsTableName
+        << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " LIKE "
+        << "'" << sessionHash << "' AND EndTimestamp = 0)";
+  }
+
+  return out.str();
+}
+
+auto Query::addRollups(Query::Type type,
+                       const std::string &sessionHash,
+                       const std::vector<collector::RollupBucket> &buckets) -> std::string
+{
+  std::stringstream out;
+
+  if (buckets.empty()) {
+    return out.str();
+  }
+
+  // Sums of large memory values need more than the default 6 digits
+  out.precision(std::numeric_limits<double>::max_digits10);
+
+  if ((type == Query::Type::SQLite3) || (type == Query::Type::PostgreSQL)) {
+    out << "INSERT INTO " << m_rollupsTableName << " (" << m_rollupColumn.at(RollupColumn::Source)
+        << "," << m_rollupColumn.at(RollupColumn::Metric) << ","
+        << m_rollupColumn.at(RollupColumn::Label) << "," << m_rollupColumn.at(RollupColumn::Width)
+        << "," << m_rollupColumn.at(RollupColumn::BucketStart) << ","
+        << m_rollupColumn.at(RollupColumn::MinValue) << ","
+        << m_rollupColumn.at(RollupColumn::MaxValue) << ","
+        << m_rollupColumn.at(RollupColumn::SumValue) << ","
+        << m_rollupColumn.at(RollupColumn::SampleCount) << ","
+        << m_rollupColumn.at(RollupColumn::SessionId) << ") VALUES ";
+
+    for (size_t i = 0; i < buckets.size(); i++) {
+      const auto &bucket = buckets[i];
+      std::string label = bucket.label;
+
+      for (size_t pos = label.find('\''); pos != std::string::npos;
+           pos = label.find('\'', pos + 2)) {
+        label.insert(pos, 1, '\'');
+      }
+
+      out << ((i > 0) ? ", " : "") << "('" << bucket.source << "', '" << bucket.metric << "', '"
+          << label << "', '" << bucket.width << "', '" << bucket.start << "', '" << bucket.min
+          << "', '" << bucket.max << "', '" << bucket.sum << "', '" << bucket.count << "', ";
+
+      if (type == Query::Type::SQLite3) {
+        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
+            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash) << " IS "
+            << "'" << sessionHash << "' AND EndTimestamp = 0))";
+      } else {
+        out << "(SELECT " << m_sessionColumn.at(SessionColumn::Id) << " FROM "
+            << m_sessionsTableName << " WHERE " << m_sessionColumn.at(SessionColumn::Hash)
+            << " LIKE "
+            << "'" << sessionHash << "' AND EndTimestamp = 0))";
+      }
     }
+    out << ";";
   }
 
   return out.str();
 }
+
 } // namespace tkm
@@ -12,11 +12,16 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <taskmonitor/taskmonitor.h>
 
+#include "Extension.pb.h"
+#include "Rollup.h"
+
 namespace tkm
 {
 
@@ -24,12 +29,46 @@ class Query
 {
 public:
   enum class Type { SQLite3, PostgreSQL };
+  // Stored columns of the projected data tables, the other tables store all
+  // their columns. Id, the time columns and SessionId are always stored.
+  typedef std::map<tkm::msg::monitor::Data_What, std::set<std::string>> Projection;
 
-  auto createTables(Query::Type type) -> std::string;
+  // Partitioned creates PostgreSQL data tables partitioned by session, clustered
+  // creates SQLite data tables without rowid keyed by session and time, packed
+  // stores the per entry data types one row per sample with array columns
+  auto createTables(Query::Type type,
+                    bool partitioned = false,
+                    bool clustered = false,
+                    bool packed = false,
+                    const Projection &projection = {}) -> std::string;
+  // Sample tables only, created in every session file of a sharded database
+  auto createDataTables(Query::Type type,
+                        bool partitioned = false,
+                        bool clustered = false,
+                        bool packed = false,
+                        const Projection &projection = {}) -> std::string;
+  // Data tables clustered when the count is not zero
+  auto getClustered(Query::Type type) -> std::string;
+  // Rebuild the data tables in the other layout, rows are copied in session order
+  auto migrateDataTables(Query::Type type,
+                         bool clustered,
+                         bool packed = false,
+                         const Projection &projection = {}) -> std::string;
+  // Per entry data types packed when the count is not zero
+  auto getPacked(Query::Type type) -> std::string;
+  // One row per entry views over the packed tables, only valid on packed tables
+  auto createPackedViews(Query::Type type, const Projection &projection = {}) -> std::string;
+  // Comma separated columns of an existing data table, lower case on PostgreSQL
+  auto getTableColumns(Query::Type type, tkm::msg::monitor::Data_What what) -> std::string;
+  // Projected columns of a table from a comma separated list, names are matched
+  // ignoring case and unknown names are skipped
+  auto parseColumns(tkm::msg::monitor::Data_What what, const std::string &list)
+      -> std::set<std::string>;
   auto dropTables(Query::Type type) -> std::string;
 
   // Device management
   auto getDevices(Query::Type type) -> std::string;
+  auto listDevices(Query::Type type, const tkm::msg::ext::ListFilter &filter) -> std::string;
   auto addDevice(Query::Type type,
                  const std::string &hash,
                  const std::string &name,
@@ -42,6 +81,7 @@ public:
   // Session management
   auto getSessions(Query::Type type) -> std::string;
   auto getSessions(Query::Type type, const std::string &deviceHash) -> std::string;
+  auto listSessions(Query::Type type, const tkm::msg::ext::ListFilter &filter) -> std::string;
   auto addSession(Query::Type type,
                   const tkm::msg::monitor::SessionInfo &sessionInfo,
                   const std::string &deviceHash,
@@ -50,74 +90,193 @@ public:
   auto remSession(Query::Type type, const std::string &hash) -> std::string;
   auto getSession(Query::Type type, const std::string &hash) -> std::string;
   auto hasSession(Query::Type type, const std::string &hash) -> std::string;
+  // Id of the open session with hash, no row when there is none
+  auto getOpenSession(Query::Type type, const std::string &hash) -> std::string;
+  // Data tables partitioned by session when the count is not zero
+  auto getPartitioned(Query::Type type) -> std::string;
+  auto addSessionPartitions(Query::Type type, int64_t sessionId) -> std::string;
+  auto remSessionPartitions(Query::Type type, int64_t sessionId) -> std::string;
+
+  // Retention, an empty string means nothing to run for the database type
+  auto getExpiredSession(Query::Type type,
+                         uint64_t endedBefore,
+                         uint64_t deviceMaxSessions,
+                         bool overQuota) -> std::string;
+  auto getRowEstimate(Query::Type type) -> std::string;
+  auto getDatabaseSize(Query::Type type) -> std::string;
+  auto remSessionRows(Query::Type type,
+                      const std::string &table,
+                      int64_t sessionId,
+                      uint64_t limit,
+                      bool clustered = false) -> std::string;
+  auto releaseSpace(Query::Type type, uint64_t pages) -> std::string;
+
+  // Data export, returns an empty string for unknown data types
+  // Packed data types are read through their entry views.
+  auto exportData(Query::Type type,
+                  tkm::msg::monitor::Data_What what,
+                  const tkm::msg::ext::ExportFilter &filter,
+                  bool clustered = false,
+                  bool packed = false,
+                  const Projection &projection = {},
+                  int64_t cursor = -1,
+                  int64_t bound = -1) -> std::string;
+  // Largest export key of the next limit rows after cursor, NULL when none is left.
+  // Exports page on the key range (cursor, bound], -1 leaves the range open. The
+  // key is SystemTime for clustered tables and Id otherwise.
+  auto getExportBound(Query::Type type,
+                      tkm::msg::monitor::Data_What what,
+                      const tkm::msg::ext::ExportFilter &filter,
+                      bool clustered,
+                      bool packed,
+                      int64_t cursor,
+                      uint64_t limit) -> std::string;
+  // Change only rows are rebuilt to full samples by the export stream
+  auto hasChanges(tkm::msg::monitor::Data_What what, uint64_t keyframeInterval) -> bool;
+  // Process or context column of change only rows
+  auto getChangeKey(tkm::msg::monitor::Data_What what) -> const std::string &;
+  // Bucket aggregation, returns an empty string for unknown tables or columns
+  // and for columns not stored by the projection
+  auto aggregateData(Query::Type type,
+                     const tkm::msg::ext::AggregateFilter &filter,
+                     bool clustered = false,
+                     bool packed = false,
+                     const Projection &projection = {}) -> std::string;
+  // Reason the aggregate request is rejected, empty if it is valid
+  auto checkAggregate(const tkm::msg::ext::AggregateFilter &filter,
+                      const Projection &projection = {}) -> std::string;
+  auto hasDataColumn(tkm::msg::monitor::Data_What what,
+                     const std::string &name,
+                     const Projection &projection = {}) -> bool;
+  // Column names of a data table in table order, empty for unknown data types
+  auto getDataColumns(tkm::msg::monitor::Data_What what, const Projection &projection = {})
+      -> std::vector<std::string>;
 
-  // Add device data
+  // Add device data, packed writes one row per sample for the per entry data types.
+  // Only the projected columns of a table are written. Rows of clustered tables
+  // get consecutive Ids in entry order. The sessionId is written as given, the
+  // session Id read once per sample or the getSessionId subquery.
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::SysProcStat &sysProcStat,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               bool packed = false,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::SysProcDiskStats &sysDiskStats,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               bool packed = false,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::SysProcPressure &sysProcPressure,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::SysProcBuddyInfo &sysProcBuddyInfo,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               bool packed = false,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::SysProcWireless &sysProcWireless,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               bool packed = false,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::SysProcVMStat &sysProcVMStat,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::ProcAcct &procAcct,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::ProcInfo &procInfo,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::ProcEvent &procEvent,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
   auto addData(Query::Type type,
-               const std::string &sessionHash,
+               const std::string &sessionId,
                const tkm::msg::monitor::ContextInfo &ctxInfo,
                uint64_t systemTime,
                uint64_t monotonicTime,
-               uint64_t receiveTime) -> std::string;
+               uint64_t receiveTime,
+               const Projection &projection = {},
+               bool clustered = false) -> std::string;
+
+  // Id of the open session with hash, as a subquery for inserts
+  auto getSessionId(Query::Type type, const std::string &sessionHash) -> std::string;
+  // Entry view body of a packed table, empty when no array column is stored
+  auto getPackedEntries(Query::Type type,
+                        tkm::msg::monitor::Data_What what,
+                        const Projection &projection) -> std::string;
+  auto getExportKey(bool clustered, bool packedType) -> const std::string &;
+  auto getExportRange(const tkm::msg::ext::ExportFilter &filter,
+                      bool clustered,
+                      bool packedType,
+                      int64_t cursor,
+                      const std::string &row) -> std::string;
+  // INSERT statement start with the projected columns of a data table. Clustered
+  // SQLite tables take the Id from the entry ordinal ending every row.
+  auto getInsertHeader(Query::Type type,
+                       tkm::msg::monitor::Data_What what,
+                       const Projection &projection,
+                       bool clustered,
+                       uint64_t systemTime,
+                       const std::string &sessionId) -> std::string;
+  // Projection of the data columns written by addData, Id and SessionId excluded
+  auto getStoredColumns(tkm::msg::monitor::Data_What what, const Projection &projection)
+      -> std::vector<bool>;
+
+  // Ingest time rollups, one multi row insert for all the closed buckets
+  auto addRollups(Query::Type type,
+                  const std::string &sessionHash,
+                  const std::vector<collector::RollupBucket> &buckets) -> std::string;
 
 public:
   enum class DeviceColumn {
@@ -644,6 +803,33 @@ public:
       std::make_pair(SysProcWirelessColumn::SessionId, "SessionId"),
   };
 
+  enum class RollupColumn {
+    Id,          // int: Primary key
+    Source,      // str: Data table name
+    Metric,      // str: Data column name
+    Label,       // str: CPU name or process comm:pid, empty for single row tables
+    Width,       // int: Bucket width in seconds
+    BucketStart, // int: Bucket start SystemTime
+    MinValue,    // real: Minimum sample value
+    MaxValue,    // real: Maximum sample value
+    SumValue,    // real: Sum of sample values
+    SampleCount, // int: Number of samples
+    SessionId,   // int: Session id key
+  };
+  const std::map<RollupColumn, std::string> m_rollupColumn{
+      std::make_pair(RollupColumn::Id, "Id"),
+      std::make_pair(RollupColumn::Source, "Source"),
+      std::make_pair(RollupColumn::Metric, "Metric"),
+      std::make_pair(RollupColumn::Label, "Label"),
+      std::make_pair(RollupColumn::Width, "Width"),
+      std::make_pair(RollupColumn::BucketStart, "BucketStart"),
+      std::make_pair(RollupColumn::MinValue, "MinValue"),
+      std::make_pair(RollupColumn::MaxValue, "MaxValue"),
+      std::make_pair(RollupColumn::SumValue, "SumValue"),
+      std::make_pair(RollupColumn::SampleCount, "SampleCount"),
+      std::make_pair(RollupColumn::SessionId, "SessionId"),
+  };
+
   const std::string m_devicesTableName = "tkmDevices";
   const std::string m_sessionsTableName = "tkmSessions";
   const std::string m_sysProcStatTableName = "tkmSysProcStat";
@@ -657,6 +843,28 @@ public:
   const std::string m_procInfoTableName = "tkmProcInfo";
   const std::string m_procEventTableName = "tkmProcEvent";
   const std::string m_contextInfoTableName = "tkmContextInfo";
+  const std::string m_rollupsTableName = "tkmRollups";
+
+  const std::map<tkm::msg::monitor::Data_What, std::string> m_dataTableName{
+      std::make_pair(tkm::msg::monitor::Data_What_SysProcStat, m_sysProcStatTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_SysProcMemInfo, m_sysProcMemInfoTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_SysProcDiskStats, m_sysProcDiskStatsTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_SysProcPressure, m_sysProcPressureTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_SysProcBuddyInfo, m_sysProcBuddyInfoTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_SysProcWireless, m_sysProcWirelessTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_SysProcVMStat, m_sysProcVMStatTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_ProcAcct, m_procAcctTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_ProcInfo, m_procInfoTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_ProcEvent, m_procEventTableName),
+      std::make_pair(tkm::msg::monitor::Data_What_ContextInfo, m_contextInfoTableName),
+  };
+  // Stored one row per sample when packed, the entry fields become array columns
+  const std::set<tkm::msg::monitor::Data_What> m_packedDataTypes{
+      tkm::msg::monitor::Data_What_SysProcStat,
+      tkm::msg::monitor::Data_What_SysProcDiskStats,
+      tkm::msg::monitor::Data_What_SysProcBuddyInfo,
+      tkm::msg::monitor::Data_What_SysProcWireless,
+  };
 };
 
 static Query tkmQuery{};
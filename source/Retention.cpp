@@ -0,0 +1,122 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Retention Class
+ * @details   Remove expired sessions in small batches
+ *-
+ */
+
+#include <algorithm>
+
+#include "Application.h"
+#include "Helpers.h"
+#include "IDatabase.h"
+#include "Query.h"
+#include "Retention.h"
+
+namespace tkm::collector
+{
+
+Retention::Retention(uint64_t interval, const Policy &policy)
+: m_policy(policy)
+, m_interval(interval)
+{
+  for (const auto &[what, table] : tkmQuery.m_dataTableName) {
+    m_tables.push_back(table);
+  }
+  m_tables.push_back(tkmQuery.m_rollupsTableName);
+
+  if (m_policy.batchRows == 0) {
+    m_policy.batchRows = 1;
+  }
+}
+
+void Retention::enableEvents()
+{
+  m_timer = std::make_shared<Timer>("RetentionTimer", [this]() { return update(); });
+  m_timer->start(m_interval, true);
+  CollectorApp()->addEventSource(m_timer);
+
+  logInfo() << "Retention enabled. MaxAge=" << m_policy.maxAge << " MaxRows=" << m_policy.maxRows
+            << " MaxBytes=" << m_policy.maxBytes
+            << " DeviceMaxSessions=" << m_policy.deviceMaxSessions
+            << " BatchRows=" << m_policy.batchRows;
+}
+
+bool Retention::update(void)
+{
+  auto database = CollectorApp()->getDatabase();
+
+  // Never compete with a busy ingest path, the step is retried on next tick
+  if (m_inFlight || (database == nullptr) ||
+      (database->getPendingCount() > GRetentionMaxPending)) {
+    return true;
+  }
+
+  IDatabase::Request rq{.client = nullptr,
+                        .action = IDatabase::Action::Retention,
+                        .args = std::map<Defaults::Arg, std::string>(),
+                        .bulkData = std::make_any<int>(0)};
+  m_inFlight = true;
+  if (!database->pushRequest(rq)) {
+    m_inFlight = false;
+  }
+
+  return true;
+}
+
+void Retention::schedule(const std::string &sessionHash)
+{
+  if ((m_job.hash == sessionHash) ||
+      (std::find(m_scheduled.cbegin(), m_scheduled.cend(), sessionHash) != m_scheduled.cend())) {
+    return;
+  }
+  m_scheduled.push_back(sessionHash);
+}
+
+bool Retention::takeScheduled(std::string &sessionHash)
+{
+  if (m_scheduled.empty()) {
+    return false;
+  }
+
+  sessionHash = m_scheduled.front();
+  m_scheduled.pop_front();
+
+  return true;
+}
+
+void Retention::startJob(int64_t sessionId,
+                         const std::string &sessionHash,
+                         const std::string &reason)
+{
+  m_job = Job{};
+  m_job.sessionId = sessionId;
+  m_job.hash = sessionHash;
+  m_job.reason = reason;
+  m_job.startTime = getMonotonicTimeNs();
+
+  logInfo() << "Retention removing session " << sessionHash << " (" << reason << ")";
+}
+
+void Retention::finishJob(bool status)
+{
+  const auto duration = (getMonotonicTimeNs() - m_job.startTime) / 1000000;
+
+  if (status) {
+    m_removed++;
+    logInfo() << "Retention removed session " << m_job.hash << ": " << m_job.rows << " rows in "
+              << duration << "ms, " << m_removed << " sessions removed so far, "
+              << m_scheduled.size() << " scheduled";
+  } else {
+    logError() << "Retention failed to remove session " << m_job.hash << " after " << m_job.rows
+               << " rows";
+  }
+
+  m_job = Job{};
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,93 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Retention Class
+ * @details   Remove expired sessions in small batches
+ *-
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../bswinfra/source/Timer.h"
+
+using namespace bswi::event;
+
+namespace tkm::collector
+{
+
+// Steps are skipped while the database queue is busy with more requests
+constexpr uint64_t GRetentionMaxPending = 128;
+// Free SQLite pages released by one idle step
+constexpr uint64_t GRetentionVacuumPages = 1024;
+
+// Every Interval microseconds one Retention request is queued to the database.
+// A step deletes at most BatchRows rows of one table of the session being
+// removed, so ingest requests are served between two steps. Once all data
+// tables are empty the session row itself is removed. Idle steps pick the
+// next session: sessions scheduled by RemSession first, then the oldest ended
+// session breaking the policy.
+class Retention : public std::enable_shared_from_this<Retention>
+{
+public:
+  typedef struct Policy {
+    uint64_t maxAge = 0;            // Seconds since the session ended
+    uint64_t maxRows = 0;           // Estimated rows over all data tables
+    uint64_t maxBytes = 0;          // Database size, SQLite only
+    uint64_t deviceMaxSessions = 0; // Ended sessions kept per device
+    uint64_t batchRows = 0;
+  } Policy;
+
+  typedef struct Job {
+    int64_t sessionId = 0;
+    std::string hash{};
+    std::string reason{};
+    size_t table = 0;
+    uint64_t rows = 0;
+    uint64_t startTime = 0;
+  } Job;
+
+public:
+  Retention(uint64_t interval, const Policy &policy);
+  ~Retention() = default;
+
+  void enableEvents();
+
+  // Database side, called from the database request handlers
+  auto getPolicy() const -> const Policy & { return m_policy; }
+  auto getJob() -> Job & { return m_job; }
+  auto getTables() const -> const std::vector<std::string> & { return m_tables; }
+  void schedule(const std::string &sessionHash);
+  bool takeScheduled(std::string &sessionHash);
+  void startJob(int64_t sessionId, const std::string &sessionHash, const std::string &reason);
+  void finishJob(bool status);
+  void stepDone() { m_inFlight = false; }
+
+public:
+  Retention(Retention const &) = delete;
+  void operator=(Retention const &) = delete;
+
+private:
+  bool update(void);
+
+private:
+  std::shared_ptr<Timer> m_timer = nullptr;
+  std::vector<std::string> m_tables{};
+  std::deque<std::string> m_scheduled{};
+  Policy m_policy{};
+  Job m_job{};
+  uint64_t m_interval = 0;
+  uint64_t m_removed = 0;
+  std::atomic<bool> m_inFlight{false};
+};
+
+} // namespace tkm::collector
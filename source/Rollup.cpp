@@ -0,0 +1,230 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Rollup Class
+ * @details   Per session minute and hour aggregates maintained at ingest time
+ *-
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "Query.h"
+#include "Rollup.h"
+
+namespace tkm::collector
+{
+
+void Rollup::add(const std::string &sessionHash,
+                 const tkm::msg::monitor::SysProcStat &sysProcStat,
+                 uint64_t systemTime)
+{
+  using Column = Query::SysProcStatColumn;
+
+  if (!m_enabled) {
+    return;
+  }
+
+  auto &table = getTable(sessionHash, tkm::msg::monitor::Data_What_SysProcStat, systemTime);
+  const auto &columns = tkmQuery.m_sysProcStatColumn;
+
+  auto updateCPU = [this, &table, &columns](const auto &cpuStat) {
+    update(table, columns.at(Column::CPUStatAll), cpuStat.name(), cpuStat.all());
+    update(table, columns.at(Column::CPUStatUsr), cpuStat.name(), cpuStat.usr());
+    update(table, columns.at(Column::CPUStatSys), cpuStat.name(), cpuStat.sys());
+    update(table, columns.at(Column::CPUStatIow), cpuStat.name(), cpuStat.iow());
+  };
+
+  updateCPU(sysProcStat.cpu());
+  for (const auto &cpuStat : sysProcStat.core()) {
+    updateCPU(cpuStat);
+  }
+}
+
+void Rollup::add(const std::string &sessionHash,
+                 const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
+                 uint64_t systemTime)
+{
+  using Column = Query::SysProcMemColumn;
+
+  if (!m_enabled) {
+    return;
+  }
+
+  auto &table = getTable(sessionHash, tkm::msg::monitor::Data_What_SysProcMemInfo, systemTime);
+  const auto &columns = tkmQuery.m_sysProcMemColumn;
+  const std::string label{};
+
+  update(table, columns.at(Column::MemFree), label, sysProcMem.mem_free());
+  update(table, columns.at(Column::MemAvail), label, sysProcMem.mem_available());
+  update(table, columns.at(Column::MemCached), label, sysProcMem.mem_cached());
+  update(table, columns.at(Column::MemAvailPercent), label, sysProcMem.mem_percent());
+  update(table, columns.at(Column::Active), label, sysProcMem.active());
+  update(table, columns.at(Column::Inactive), label, sysProcMem.inactive());
+  update(table, columns.at(Column::Slab), label, sysProcMem.slab());
+  update(table, columns.at(Column::SwapFree), label, sysProcMem.swap_free());
+  update(table, columns.at(Column::SwapCached), label, sysProcMem.swap_cached());
+  update(table, columns.at(Column::SwapFreePercent), label, sysProcMem.swap_percent());
+  update(table, columns.at(Column::CmaFree), label, sysProcMem.cma_free());
+}
+
+void Rollup::add(const std::string &sessionHash,
+                 const tkm::msg::monitor::SysProcPressure &sysProcPressure,
+                 uint64_t systemTime)
+{
+  using Column = Query::SysProcPressureColumn;
+
+  if (!m_enabled) {
+    return;
+  }
+
+  auto &table = getTable(sessionHash, tkm::msg::monitor::Data_What_SysProcPressure, systemTime);
+  const auto &columns = tkmQuery.m_sysProcPressureColumn;
+  const std::string label{};
+
+  // The avg60 and avg300 values are already smoothed by the kernel
+  update(table, columns.at(Column::CPUSomeAvg10), label, sysProcPressure.cpu_some().avg10());
+  update(table, columns.at(Column::CPUFullAvg10), label, sysProcPressure.cpu_full().avg10());
+  update(table, columns.at(Column::MEMSomeAvg10), label, sysProcPressure.mem_some().avg10());
+  update(table, columns.at(Column::MEMFullAvg10), label, sysProcPressure.mem_full().avg10());
+  update(table, columns.at(Column::IOSomeAvg10), label, sysProcPressure.io_some().avg10());
+  update(table, columns.at(Column::IOFullAvg10), label, sysProcPressure.io_full().avg10());
+}
+
+void Rollup::add(const std::string &sessionHash,
+                 const tkm::msg::monitor::ProcInfo &procInfo,
+                 uint64_t systemTime)
+{
+  using Column = Query::ProcInfoColumn;
+
+  if (!m_enabled) {
+    return;
+  }
+
+  auto &table = getTable(sessionHash, tkm::msg::monitor::Data_What_ProcInfo, systemTime);
+  const auto &columns = tkmQuery.m_procInfoColumn;
+
+  for (const auto &procEntry : procInfo.entry()) {
+    // Pids are reused, the label keeps the process name next to it
+    const auto label = procEntry.comm() + ":" + std::to_string(procEntry.pid());
+
+    update(table, columns.at(Column::CpuPercent), label, procEntry.cpu_percent());
+    update(table, columns.at(Column::MemRSS), label, procEntry.mem_rss());
+    update(table, columns.at(Column::MemPSS), label, procEntry.mem_pss());
+    update(table, columns.at(Column::FDCount), label, procEntry.fd_count());
+  }
+}
+
+void Rollup::endSession(const std::string &sessionHash)
+{
+  auto session = m_sessions.find(sessionHash);
+
+  if (session == m_sessions.end()) {
+    return;
+  }
+
+  for (auto &[what, table] : session->second) {
+    table.start.fill(std::numeric_limits<uint64_t>::max());
+    close(what, table);
+  }
+
+  m_sessions.erase(session);
+}
+
+auto Rollup::takeClosed() -> std::vector<RollupBucket>
+{
+  std::vector<RollupBucket> closed{};
+
+  closed.swap(m_closed);
+  return closed;
+}
+
+auto Rollup::getTable(const std::string &sessionHash,
+                      tkm::msg::monitor::Data_What what,
+                      uint64_t systemTime) -> Table &
+{
+  auto &table = m_sessions[sessionHash][what];
+  bool advanced = false;
+
+  for (size_t i = 0; i < Widths.size(); i++) {
+    const auto start = systemTime - (systemTime % Widths[i]);
+    if (start > table.start[i]) {
+      table.start[i] = start;
+      advanced = true;
+    }
+  }
+
+  if (advanced) {
+    close(what, table);
+  }
+
+  return table;
+}
+
+void Rollup::update(Table &table,
+                    const std::string &metric,
+                    const std::string &label,
+                    double value)
+{
+  auto key = metric;
+  key.push_back('/');
+  key.append(label);
+
+  auto &series = table.series[key];
+  if (series.metric.empty()) {
+    series.metric = metric;
+    series.label = label;
+  }
+
+  for (size_t i = 0; i < Widths.size(); i++) {
+    auto &acc = series.acc[i];
+
+    if (acc.count == 0) {
+      acc.start = table.start[i];
+      acc.min = value;
+      acc.max = value;
+      acc.sum = 0;
+    } else {
+      acc.min = std::min(acc.min, value);
+      acc.max = std::max(acc.max, value);
+    }
+    acc.sum += value;
+    acc.count++;
+  }
+}
+
+void Rollup::close(tkm::msg::monitor::Data_What what, Table &table)
+{
+  const auto &source = tkmQuery.m_dataTableName.at(what);
+
+  for (auto it = table.series.begin(); it != table.series.end();) {
+    auto &series = it->second;
+    bool empty = true;
+
+    for (size_t i = 0; i < Widths.size(); i++) {
+      auto &acc = series.acc[i];
+
+      if ((acc.count > 0) && (acc.start < table.start[i])) {
+        m_closed.push_back(RollupBucket{.source = source,
+                                        .metric = series.metric,
+                                        .label = series.label,
+                                        .width = Widths[i],
+                                        .start = acc.start,
+                                        .min = acc.min,
+                                        .max = acc.max,
+                                        .sum = acc.sum,
+                                        .count = acc.count});
+        acc.count = 0;
+      }
+      empty = empty && (acc.count == 0);
+    }
+
+    it = empty ? table.series.erase(it) : std::next(it);
+  }
+}
+
+} // namespace tkm::collector
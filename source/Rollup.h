@@ -0,0 +1,111 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Rollup Class
+ * @details   Per session minute and hour aggregates maintained at ingest time
+ *-
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <taskmonitor/taskmonitor.h>
+
+namespace tkm::collector
+{
+
+// Closed bucket of one series, written as one row of the rollups table
+typedef struct RollupBucket {
+  std::string source{}; // Data table name
+  std::string metric{}; // Data column name
+  std::string label{};  // CPU name or process, empty for single row tables
+  uint64_t width = 0;
+  uint64_t start = 0;
+  double min = 0;
+  double max = 0;
+  double sum = 0;
+  uint64_t count = 0;
+} RollupBucket;
+
+// Buckets are aligned on the sample SystemTime. All buckets of a table are
+// closed when a sample of the same table falls in a later bucket, the
+// remaining ones are closed when the session ends. Late samples are counted
+// in the open bucket. Series without samples in the closed bucket are dropped
+// so exited processes do not keep accumulators alive.
+class Rollup
+{
+public:
+  static constexpr std::array<uint64_t, 2> Widths{60, 3600};
+
+public:
+  explicit Rollup(bool enabled)
+  : m_enabled(enabled)
+  {
+  }
+  ~Rollup() = default;
+
+  void add(const std::string &sessionHash,
+           const tkm::msg::monitor::SysProcStat &sysProcStat,
+           uint64_t systemTime);
+  void add(const std::string &sessionHash,
+           const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
+           uint64_t systemTime);
+  void add(const std::string &sessionHash,
+           const tkm::msg::monitor::SysProcPressure &sysProcPressure,
+           uint64_t systemTime);
+  void add(const std::string &sessionHash,
+           const tkm::msg::monitor::ProcInfo &procInfo,
+           uint64_t systemTime);
+  // Close all open buckets of the session and forget it
+  void endSession(const std::string &sessionHash);
+  // Buckets closed by the previous add or endSession call
+  auto takeClosed() -> std::vector<RollupBucket>;
+
+  [[nodiscard]] bool isEnabled() const { return m_enabled; }
+
+public:
+  Rollup(Rollup const &) = delete;
+  void operator=(Rollup const &) = delete;
+
+private:
+  typedef struct Accumulator {
+    uint64_t start = 0;
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    uint64_t count = 0;
+  } Accumulator;
+
+  typedef struct Series {
+    std::string metric{};
+    std::string label{};
+    std::array<Accumulator, Widths.size()> acc{};
+  } Series;
+
+  typedef struct Table {
+    std::array<uint64_t, Widths.size()> start{};
+    std::unordered_map<std::string, Series> series{};
+  } Table;
+
+  auto getTable(const std::string &sessionHash,
+                tkm::msg::monitor::Data_What what,
+                uint64_t systemTime) -> Table &;
+  void update(Table &table, const std::string &metric, const std::string &label, double value);
+  // Close the buckets started before the current table buckets
+  void close(tkm::msg::monitor::Data_What what, Table &table);
+
+private:
+  std::map<std::string, std::map<tkm::msg::monitor::Data_What, Table>> m_sessions{};
+  std::vector<RollupBucket> m_closed{};
+  bool m_enabled = false;
+};
+
+} // namespace tkm::collector
@@ -10,13 +10,19 @@
  */
 
 #include "SQLiteDatabase.h"
+#include "AggregateStream.h"
 #include "Application.h"
 #include "Defaults.h"
+#include "ExportStream.h"
+#include "ListStream.h"
 #include "Query.h"
 
 #include <Helpers.h>
 #include <any>
 #include <filesystem>
+#include <functional>
+#include <iterator>
+#include <set>
 #include <string>
 #include <taskmonitor/taskmonitor.h>
 #include <vector>
@@ -25,6 +31,8 @@ namespace tkm::collector
 {
 
 static auto sqlite_callback(void *data, int argc, char **argv, char **colname) -> int;
+static bool execQuery(sqlite3 *handle, const std::string &sql, SQLiteDatabase::Query &query);
+static auto quoteLiteral(const std::string &text) -> std::string;
 static bool doCheckDatabase(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq);
 static bool doInitDatabase(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq);
 static bool doLoadDevices(const std::shared_ptr<SQLiteDatabase> db);
@@ -43,7 +51,21 @@ static bool doAddSession(const std::shared_ptr<SQLiteDatabase> db, const IDataba
 static bool doRemSession(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq);
 static bool doEndSession(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq);
 static bool doCleanSessions(const std::shared_ptr<SQLiteDatabase> db);
+static bool doExportSession(const std::shared_ptr<SQLiteDatabase> db,
+                            const IDatabase::Request &rq);
+static bool doArchiveSession(const std::shared_ptr<SQLiteDatabase> db,
+                             const IDatabase::Request &rq);
+static bool doAggregate(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq);
+static bool doRetention(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq);
 static bool doAddData(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq);
+static void writeRollups(const std::shared_ptr<SQLiteDatabase> db, const std::string &sessionHash);
+static void accountData(const std::shared_ptr<SQLiteDatabase> db,
+                        tkm::msg::monitor::Data_What what,
+                        const std::map<Defaults::Arg, std::string> &args,
+                        uint64_t writeStart,
+                        uint64_t commitTime,
+                        uint64_t rows,
+                        bool status);
 
 SQLiteDatabase::SQLiteDatabase(std::shared_ptr<Options> options)
 : IDatabase(options)
@@ -54,10 +76,44 @@ SQLiteDatabase::SQLiteDatabase(std::shared_ptr<Options> options)
     sqlite3_close(m_db);
     throw std::runtime_error(sqlite3_errmsg(m_db));
   }
+
+  // Only applies to new database files, lets retention give pages back in steps
+  if (sqlite3_exec(m_db, "PRAGMA auto_vacuum = INCREMENTAL;", nullptr, nullptr, nullptr) !=
+      SQLITE_OK) {
+    logWarn() << "Fail to set incremental auto vacuum";
+  }
+
+  m_path = addr;
+  m_useClustered = (CollectorApp()->getOptions()->getFor(Options::Key::DBLayout) == "clustered");
+  checkClustered();
+  m_usePacked = (CollectorApp()->getOptions()->getFor(Options::Key::DBPackedArrays) == "true");
+  checkPacked();
+  checkProjection();
+
+  m_sharded = (CollectorApp()->getOptions()->getFor(Options::Key::DBSharding) == "session");
+  if (m_sharded) {
+    std::error_code ec;
+
+    m_shardDirectory = addr.parent_path() / "sessions";
+    std::filesystem::create_directories(m_shardDirectory, ec);
+    if (ec) {
+      throw std::runtime_error("Fail to create session directory " + m_shardDirectory.string());
+    }
+    logInfo() << "Session data files in " << m_shardDirectory.string();
+  }
+
+  // Rows are estimated from the rowid range of the main file data tables
+  if ((m_clustered || m_sharded) &&
+      (CollectorApp()->getOptions()->getFor(Options::Key::RetentionEnabled) == "true") &&
+      (std::stoull(CollectorApp()->getOptions()->getFor(Options::Key::RetentionMaxRows)) > 0)) {
+    logWarn() << "Retention MaxRows is ignored with " << (m_sharded ? "sharded" : "clustered")
+              << " data tables, use MaxBytes instead";
+  }
 }
 
 SQLiteDatabase::~SQLiteDatabase()
 {
+  m_shards.clear();
   sqlite3_close(m_db);
 }
 
@@ -73,11 +129,236 @@ void SQLiteDatabase::enableEvents()
 }
 
 bool SQLiteDatabase::runQuery(const std::string &sql, SQLiteDatabase::Query &query)
+{
+  return execQuery(m_db, sql, query);
+}
+
+bool SQLiteDatabase::runQuery(const std::string &sql,
+                              SQLiteDatabase::Query &query,
+                              const std::string &sessionHash,
+                              bool create)
+{
+  if (!m_sharded) {
+    return execQuery(m_db, sql, query);
+  }
+
+  if (!create && !isShardOpen(sessionHash)) {
+    std::error_code ec;
+    if (!std::filesystem::exists(getShardPath(sessionHash), ec)) {
+      return execQuery(m_db, sql, query);
+    }
+  }
+
+  auto shard = getShard(sessionHash, create);
+  if (shard == nullptr) {
+    return false;
+  }
+
+  return shard->run([&sql, &query](sqlite3 *handle) { return execQuery(handle, sql, query); });
+}
+
+void SQLiteDatabase::checkClustered()
+{
+  uint64_t count = 0;
+  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::Layout, .raw = &count};
+
+  m_clustered = runQuery(tkmQuery.getClustered(tkm::Query::Type::SQLite3), query) && (count > 0);
+  if (m_clustered != m_useClustered) {
+    logWarn() << "Data tables are " << (m_clustered ? "" : "not ")
+              << "clustered, database init is needed to change the layout";
+  }
+}
+
+void SQLiteDatabase::checkPacked()
+{
+  uint64_t count = 0;
+  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::Layout, .raw = &count};
+
+  m_packed = runQuery(tkmQuery.getPacked(tkm::Query::Type::SQLite3), query) && (count > 0);
+  if (m_packed != m_usePacked) {
+    logWarn() << "Data tables are " << (m_packed ? "" : "not ")
+              << "packed, forced database init is needed to change the layout";
+  }
+}
+
+void SQLiteDatabase::checkProjection()
+{
+  for (const auto &[what, table] : tkmQuery.m_dataTableName) {
+    std::string columns;
+    SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::Columns, .raw = &columns};
+
+    if (!runQuery(tkmQuery.getTableColumns(tkm::Query::Type::SQLite3, what), query) ||
+        columns.empty()) {
+      continue;
+    }
+
+    const auto stored = tkmQuery.parseColumns(what, columns);
+    const auto configured = tkmQuery.getDataColumns(what, getProjection());
+    if (stored != std::set<std::string>(configured.cbegin(), configured.cend())) {
+      logWarn() << "Table " << table << " columns do not match the ingest configuration, "
+                << "forced database init is needed to change them";
+      setProjection(what, stored);
+    }
+  }
+}
+
+auto SQLiteDatabase::getShardPath(const std::string &sessionHash) const -> std::filesystem::path
+{
+  return m_shardDirectory / (sessionHash + ".db");
+}
+
+auto SQLiteDatabase::getShard(const std::string &sessionHash, bool create) -> ShardWriter *
+{
+  auto it = m_shards.find(sessionHash);
+  if (it != m_shards.end()) {
+    return it->second.get();
+  }
+
+  // The hash names the file
+  if (!isValidHash(sessionHash)) {
+    logError() << "Invalid session hash for session file: " << sessionHash;
+    return nullptr;
+  }
+
+  const auto path = getShardPath(sessionHash);
+  const int flags = SQLITE_OPEN_READWRITE | (create ? SQLITE_OPEN_CREATE : 0);
+  sqlite3 *shard = nullptr;
+
+  if (sqlite3_open_v2(path.c_str(), &shard, flags, nullptr) != SQLITE_OK) {
+    logError() << "Fail to open session file " << path.string() << ": " << sqlite3_errmsg(shard);
+    sqlite3_close(shard);
+    return nullptr;
+  }
+
+  // Unqualified names look in the session file first, the sessions table is
+  // only found in the attached main file
+  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::Create, .raw = nullptr};
+  const auto sql = "ATTACH DATABASE " + quoteLiteral(m_path.string()) + " AS catalog;" +
+                   tkmQuery.createDataTables(tkm::Query::Type::SQLite3,
+                                             false,
+                                             m_clustered,
+                                             m_packed,
+                                             getProjection()) +
+                   (m_packed ? tkmQuery.createPackedViews(tkm::Query::Type::SQLite3,
+                                                          getProjection())
+                             : "");
+  if (!execQuery(shard, sql, query)) {
+    sqlite3_close(shard);
+    return nullptr;
+  }
+
+  // The writer thread may wait on the main file while a catalog update runs
+  sqlite3_busy_timeout(shard, 1000);
+
+  logDebug() << "Open session file " << path.string();
+  auto writer = std::make_unique<ShardWriter>(shard);
+  auto ptr = writer.get();
+  m_shards.emplace(sessionHash, std::move(writer));
+
+  return ptr;
+}
+
+bool SQLiteDatabase::writeShard(const std::string &sessionHash, ShardWriter::Sample &&sample)
+{
+  auto shard = getShard(sessionHash, true);
+  if (shard == nullptr) {
+    return false;
+  }
+
+  shard->write(std::move(sample));
+  return true;
+}
+
+auto SQLiteDatabase::takeWritten() -> std::vector<ShardWriter::Sample>
+{
+  std::vector<ShardWriter::Sample> written{};
+
+  written.swap(m_written);
+  for (auto &[hash, shard] : m_shards) {
+    auto samples = shard->takeWritten();
+    written.insert(written.end(),
+                   std::make_move_iterator(samples.begin()),
+                   std::make_move_iterator(samples.end()));
+  }
+
+  return written;
+}
+
+void SQLiteDatabase::closeShard(const std::string &sessionHash)
+{
+  auto it = m_shards.find(sessionHash);
+
+  if (it != m_shards.end()) {
+    // Keep the last samples of the session for accounting
+    it->second->run([](sqlite3 *) { return true; });
+    auto samples = it->second->takeWritten();
+    m_written.insert(m_written.end(),
+                     std::make_move_iterator(samples.begin()),
+                     std::make_move_iterator(samples.end()));
+    m_shards.erase(it);
+  }
+}
+
+bool SQLiteDatabase::removeShard(const std::string &sessionHash)
+{
+  std::error_code ec;
+
+  closeShard(sessionHash);
+  std::filesystem::remove(getShardPath(sessionHash), ec);
+  if (ec) {
+    logError() << "Fail to remove session file for " << sessionHash << ": " << ec.message();
+    return false;
+  }
+
+  return true;
+}
+
+void SQLiteDatabase::removeAllShards()
+{
+  std::error_code ec;
+
+  m_shards.clear();
+
+  for (const auto &entry : std::filesystem::directory_iterator(m_shardDirectory, ec)) {
+    if (entry.path().extension() == ".db") {
+      std::filesystem::remove(entry.path(), ec);
+    }
+  }
+}
+
+auto SQLiteDatabase::getShardsSize() -> uint64_t
+{
+  std::error_code ec;
+  uint64_t size = 0;
+
+  for (const auto &entry : std::filesystem::directory_iterator(m_shardDirectory, ec)) {
+    if (entry.path().extension() == ".db") {
+      const auto fileSize = entry.file_size(ec);
+      size += ec ? 0 : fileSize;
+    }
+  }
+
+  return size;
+}
+
+// Single quotes are doubled in SQL string literals
+static auto quoteLiteral(const std::string &text) -> std::string
+{
+  std::string quoted = "'";
+
+  for (const auto c : text) {
+    quoted += (c == '\'') ? "''" : std::string(1, c);
+  }
+
+  return quoted + "'";
+}
+
+static bool execQuery(sqlite3 *handle, const std::string &sql, SQLiteDatabase::Query &query)
 {
   char *queryError = nullptr;
 
   logDebug() << "Run query: " << sql;
-  if (::sqlite3_exec(m_db, sql.c_str(), sqlite_callback, &query, &queryError) != SQLITE_OK) {
+  if (::sqlite3_exec(handle, sql.c_str(), sqlite_callback, &query, &queryError) != SQLITE_OK) {
     logError() << "SQLiteDatabase query error: " << queryError;
     sqlite3_free(queryError);
     return false;
@@ -86,6 +367,67 @@ bool SQLiteDatabase::runQuery(const std::string &sql, SQLiteDatabase::Query &que
   return true;
 }
 
+static auto parseDeviceRow(int argc, char **argv, char **colname) -> tkm::msg::control::DeviceData
+{
+  tkm::msg::control::DeviceData device{};
+
+  for (int i = 0; i < argc; i++) {
+    if (strncmp(colname[i], tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Id).c_str(), 60) ==
+        0) {
+      device.set_id(std::stol(argv[i]));
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Hash).c_str(),
+                       60) == 0) {
+      device.set_hash(argv[i]);
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Name).c_str(),
+                       60) == 0) {
+      device.set_name(argv[i]);
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Address).c_str(),
+                       60) == 0) {
+      device.set_address(argv[i]);
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Port).c_str(),
+                       60) == 0) {
+      device.set_port(std::stoi(argv[i]));
+    }
+  }
+
+  return device;
+}
+
+static auto parseSessionRow(int argc, char **argv, char **colname)
+    -> tkm::msg::control::SessionData
+{
+  tkm::msg::control::SessionData session{};
+
+  for (int i = 0; i < argc; i++) {
+    if (strncmp(colname[i], tkmQuery.m_sessionColumn.at(Query::SessionColumn::Id).c_str(), 60) ==
+        0) {
+      session.set_id(std::stol(argv[i]));
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_sessionColumn.at(Query::SessionColumn::Hash).c_str(),
+                       60) == 0) {
+      session.set_hash(argv[i]);
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_sessionColumn.at(Query::SessionColumn::Name).c_str(),
+                       60) == 0) {
+      session.set_name(argv[i]);
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_sessionColumn.at(Query::SessionColumn::StartTimestamp).c_str(),
+                       60) == 0) {
+      session.set_started(std::stoul(argv[i]));
+    } else if (strncmp(colname[i],
+                       tkmQuery.m_sessionColumn.at(Query::SessionColumn::EndTimestamp).c_str(),
+                       60) == 0) {
+      session.set_ended(std::stoul(argv[i]));
+    }
+  }
+
+  return session;
+}
+
 static auto sqlite_callback(void *data, int argc, char **argv, char **colname) -> int
 {
   auto *query = static_cast<SQLiteDatabase::Query *>(data);
@@ -104,32 +446,16 @@ static auto sqlite_callback(void *data, int argc, char **argv, char **colname) -
   case SQLiteDatabase::QueryType::LoadDevices:
   case SQLiteDatabase::QueryType::GetDevices: {
     auto pld = static_cast<std::vector<tkm::msg::control::DeviceData> *>(query->raw);
-    tkm::msg::control::DeviceData device{};
-    for (int i = 0; i < argc; i++) {
-      if (strncmp(colname[i], tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Id).c_str(), 60) ==
-          0) {
-        device.set_id(std::stol(argv[i]));
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Hash).c_str(),
-                         60) == 0) {
-        device.set_hash(argv[i]);
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Name).c_str(),
-                         60) == 0) {
-        device.set_name(argv[i]);
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Address).c_str(),
-                         60) == 0) {
-        device.set_address(argv[i]);
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_deviceColumn.at(Query::DeviceColumn::Port).c_str(),
-                         60) == 0) {
-        device.set_port(std::stoi(argv[i]));
-      }
-    }
-    pld->emplace_back(device);
+    pld->emplace_back(parseDeviceRow(argc, argv, colname));
     break;
   }
+  case SQLiteDatabase::QueryType::ListDevices: {
+    auto stream = static_cast<ListStream *>(query->raw);
+    auto device = parseDeviceRow(argc, argv, colname);
+    stream->add(device);
+    // Abort the statement if the client went away
+    return stream->hasError() ? 1 : 0;
+  }
   case SQLiteDatabase::QueryType::HasDevice: {
     auto pld = static_cast<int *>(query->raw);
     for (int i = 0; i < argc; i++) {
@@ -153,30 +479,54 @@ static auto sqlite_callback(void *data, int argc, char **argv, char **colname) -
   case SQLiteDatabase::QueryType::CleanSessions:
   case SQLiteDatabase::QueryType::GetSessions: {
     auto pld = static_cast<std::vector<tkm::msg::control::SessionData> *>(query->raw);
-    tkm::msg::control::SessionData session{};
-    for (int i = 0; i < argc; i++) {
-      if (strncmp(colname[i], tkmQuery.m_sessionColumn.at(Query::SessionColumn::Id).c_str(), 60) ==
-          0) {
-        session.set_id(std::stol(argv[i]));
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_sessionColumn.at(Query::SessionColumn::Hash).c_str(),
-                         60) == 0) {
-        session.set_hash(argv[i]);
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_sessionColumn.at(Query::SessionColumn::Name).c_str(),
-                         60) == 0) {
-        session.set_name(argv[i]);
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_sessionColumn.at(Query::SessionColumn::StartTimestamp).c_str(),
-                         60) == 0) {
-        session.set_started(std::stoul(argv[i]));
-      } else if (strncmp(colname[i],
-                         tkmQuery.m_sessionColumn.at(Query::SessionColumn::EndTimestamp).c_str(),
-                         60) == 0) {
-        session.set_ended(std::stoul(argv[i]));
+    pld->emplace_back(parseSessionRow(argc, argv, colname));
+    break;
+  }
+  case SQLiteDatabase::QueryType::ListSessions: {
+    auto stream = static_cast<ListStream *>(query->raw);
+    auto session = parseSessionRow(argc, argv, colname);
+    stream->add(session);
+    // Abort the statement if the client went away
+    return stream->hasError() ? 1 : 0;
+  }
+  case SQLiteDatabase::QueryType::ExportData: {
+    auto stream = static_cast<ExportStream *>(query->raw);
+    if (!stream->hasColumns()) {
+      for (int i = 0; i < argc; i++) {
+        stream->addColumn(colname[i]);
       }
     }
-    pld->emplace_back(session);
+    auto row = stream->addRow();
+    for (int i = 0; i < argc; i++) {
+      row->add_value((argv[i] != nullptr) ? argv[i] : "");
+    }
+    // Abort the statement if the client went away
+    return stream->commitRow() ? 0 : 1;
+  }
+  case SQLiteDatabase::QueryType::ExportBound: {
+    auto pld = static_cast<int64_t *>(query->raw);
+    if ((argc > 0) && (argv[0] != nullptr)) {
+      *pld = std::stoll(argv[0]);
+    }
+    break;
+  }
+  case SQLiteDatabase::QueryType::Aggregate: {
+    auto stream = static_cast<AggregateStream *>(query->raw);
+    return stream->addRow(argv, static_cast<size_t>(argc)) ? 0 : 1;
+  }
+  case SQLiteDatabase::QueryType::Retention:
+  case SQLiteDatabase::QueryType::Layout: {
+    auto pld = static_cast<uint64_t *>(query->raw);
+    if ((argc > 0) && (argv[0] != nullptr)) {
+      *pld = std::stoull(argv[0]);
+    }
+    break;
+  }
+  case SQLiteDatabase::QueryType::Columns: {
+    auto pld = static_cast<std::string *>(query->raw);
+    if ((argc > 0) && (argv[0] != nullptr)) {
+      *pld = argv[0];
+    }
     break;
   }
   default:
@@ -216,6 +566,14 @@ bool SQLiteDatabase::requestHandler(const Request &rq)
     return doEndSession(getShared(), rq);
   case IDatabase::Action::CleanSessions:
     return doCleanSessions(getShared());
+  case IDatabase::Action::ExportSession:
+    return doExportSession(getShared(), rq);
+  case IDatabase::Action::ArchiveSession:
+    return doArchiveSession(getShared(), rq);
+  case IDatabase::Action::Aggregate:
+    return doAggregate(getShared(), rq);
+  case IDatabase::Action::Retention:
+    return doRetention(getShared(), rq);
   case IDatabase::Action::AddData:
     return doAddData(getShared(), rq);
   default:
@@ -248,11 +606,45 @@ static bool doInitDatabase(const std::shared_ptr<SQLiteDatabase> db,
     if (rq.args.at(Defaults::Arg::Forced) == tkmDefaults.valFor(Defaults::Val::True)) {
       SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::DropTables, .raw = nullptr};
       db->runQuery(tkmQuery.dropTables(Query::Type::SQLite3), query);
+      if (db->isSharded()) {
+        db->removeAllShards();
+      }
+      db->resetProjection();
     }
   }
 
   SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::Create, .raw = nullptr};
-  auto status = db->runQuery(tkmQuery.createTables(Query::Type::SQLite3), query);
+  auto status = db->runQuery(tkmQuery.createTables(Query::Type::SQLite3,
+                                                   false,
+                                                   db->useClustered(),
+                                                   db->usePacked(),
+                                                   db->getProjection()),
+                             query);
+
+  // Existing tables keep their columns until a forced init
+  db->checkProjection();
+
+  // Entry views only go on tables that were created packed
+  db->checkPacked();
+  if (status && db->isPacked()) {
+    status = db->runQuery(
+        tkmQuery.createPackedViews(Query::Type::SQLite3, db->getProjection()), query);
+  }
+
+  // Existing tables in the other layout are rebuilt
+  db->checkClustered();
+  if (status && (db->isClustered() != db->useClustered())) {
+    logInfo() << "Migrate data tables to " << (db->useClustered() ? "clustered" : "rowid")
+              << " layout";
+    status = db->runQuery(
+        tkmQuery.migrateDataTables(
+            Query::Type::SQLite3, db->useClustered(), db->isPacked(), db->getProjection()),
+        query);
+    if (!status) {
+      db->runQuery("ROLLBACK;", query);
+    }
+    db->checkClustered();
+  }
 
   if (rq.args.count(Defaults::Arg::RequestId)) {
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
@@ -277,13 +669,7 @@ static bool doLoadDevices(const std::shared_ptr<SQLiteDatabase> db)
   auto status = db->runQuery(tkmQuery.getDevices(Query::Type::SQLite3), query);
   if (status) {
     for (auto &deviceData : queryDeviceList) {
-      if (CollectorApp()->getDeviceManager()->getDevice(deviceData.hash()) != nullptr)
-        continue;
-
-      auto newDevice = std::make_shared<MonitorDevice>(deviceData);
-      CollectorApp()->getDeviceManager()->addDevice(newDevice);
-      newDevice->getDeviceData().set_state(tkm::msg::control::DeviceData_State_Loaded);
-      newDevice->enableEvents();
+      CollectorApp()->getDeviceManager()->loadDevice(deviceData);
     }
   } else {
     logError() << "Failed to load devices";
@@ -319,55 +705,109 @@ static bool doCleanSessions(const std::shared_ptr<SQLiteDatabase> db)
   return true;
 }
 
+// Queue the next list step behind the pending requests
+static bool queueList(const std::shared_ptr<SQLiteDatabase> db,
+                      const IDatabase::Request &rq,
+                      const std::shared_ptr<ListStream> &stream)
+{
+  IDatabase::Request dbrq{.client = rq.client,
+                          .action = rq.action,
+                          .args = rq.args,
+                          .bulkData = std::make_any<std::shared_ptr<ListStream>>(stream)};
+  return db->pushRequest(dbrq);
+}
+
 static bool doGetDevices(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
 {
   Dispatcher::Request mrq{.client = rq.client,
                           .action = Dispatcher::Action::SendStatus,
                           .args = std::map<Defaults::Arg, std::string>(),
                           .bulkData = std::make_any<int>(0)};
+  std::shared_ptr<ListStream> stream = nullptr;
 
   if (rq.args.count(Defaults::Arg::RequestId)) {
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
   }
 
-  logDebug() << "Handling DB GetDevices request from client: " << rq.client->getName();
+  if (rq.bulkData.type() == typeid(std::shared_ptr<ListStream>)) {
+    stream = std::any_cast<std::shared_ptr<ListStream>>(rq.bulkData);
+  } else {
+    logDebug() << "Handling DB GetDevices request from client: " << rq.client->getName();
+    const auto &filter = std::any_cast<tkm::msg::ext::ListFilter>(rq.bulkData);
+    stream = std::make_shared<ListStream>(
+        rq.client, ListStream::Kind::Devices, filter, rq.args.count(Defaults::Arg::Paged) > 0);
+  }
 
-  auto queryDevList = std::vector<tkm::msg::control::DeviceData>();
-  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::GetDevices, .raw = &queryDevList};
+  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::ListDevices, .raw = stream.get()};
+  auto status =
+      db->runQuery(tkmQuery.listDevices(Query::Type::SQLite3, stream->getStepFilter()), query);
+  if (status) {
+    status = stream->endStep();
+  }
+  if (status && !stream->isDone()) {
+    return queueList(db, rq, stream);
+  }
+  if (status) {
+    status = stream->finish();
+  }
 
-  auto status = db->runQuery(tkmQuery.getDevices(Query::Type::SQLite3), query);
   if (status) {
-    tkm::msg::Envelope envelope;
-    tkm::msg::control::Message message;
-    tkm::msg::control::DeviceList devList;
+    mrq.args.emplace(Defaults::Arg::Reason, "List provided");
+  } else if (stream->hasError()) {
+    mrq.args.emplace(Defaults::Arg::Reason, "Failed to send device list");
+  } else {
+    mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
+    logError() << "Query error for getDevices";
+  }
 
-    for (auto &dev : queryDevList) {
-      auto activeDevice = CollectorApp()->getDeviceManager()->getDevice(dev.hash());
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
 
-      if (activeDevice != nullptr) {
-        dev.set_state(activeDevice->getDeviceData().state());
-      }
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
 
-      auto tmpDev = devList.add_device();
-      tmpDev->CopyFrom(dev);
-    }
+static bool doGetSessions(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  std::shared_ptr<ListStream> stream = nullptr;
 
-    message.set_type(tkm::msg::control::Message_Type_DeviceList);
-    message.mutable_data()->PackFrom(devList);
-    envelope.mutable_mesg()->PackFrom(message);
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
 
-    envelope.set_target(msg::Envelope_Recipient_Any);
-    envelope.set_origin(msg::Envelope_Recipient_Collector);
+  if (rq.bulkData.type() == typeid(std::shared_ptr<ListStream>)) {
+    stream = std::any_cast<std::shared_ptr<ListStream>>(rq.bulkData);
+  } else {
+    logDebug() << "Handling DB GetSessions request from client: " << rq.client->getName();
+    const auto &filter = std::any_cast<tkm::msg::ext::ListFilter>(rq.bulkData);
+    stream = std::make_shared<ListStream>(
+        rq.client, ListStream::Kind::Sessions, filter, rq.args.count(Defaults::Arg::Paged) > 0);
+  }
 
-    if (!rq.client->writeEnvelope(envelope)) {
-      logWarn() << "Fail to send device list to client " << rq.client->getFD();
-      mrq.args.emplace(Defaults::Arg::Reason, "Failed to send device list");
-    } else {
-      mrq.args.emplace(Defaults::Arg::Reason, "List provided");
-    }
+  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::ListSessions, .raw = stream.get()};
+  auto status =
+      db->runQuery(tkmQuery.listSessions(Query::Type::SQLite3, stream->getStepFilter()), query);
+  if (status) {
+    status = stream->endStep();
+  }
+  if (status && !stream->isDone()) {
+    return queueList(db, rq, stream);
+  }
+  if (status) {
+    status = stream->finish();
+  }
+
+  if (status) {
+    mrq.args.emplace(Defaults::Arg::Reason, "List provided");
+  } else if (stream->hasError()) {
+    mrq.args.emplace(Defaults::Arg::Reason, "Failed to send session list");
   } else {
     mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
-    logError() << "Query error for getUsers";
+    logError() << "Query error for getSessions";
   }
 
   mrq.args.emplace(Defaults::Arg::Status,
@@ -377,62 +817,285 @@ static bool doGetDevices(const std::shared_ptr<SQLiteDatabase> db, const IDataba
   return CollectorApp()->getDispatcher()->pushRequest(mrq);
 }
 
-static bool doGetSessions(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
+// Check the session and start an export job, reason is set if the session is unknown.
+// The stream is created once the session is known.
+static auto startExport(const std::shared_ptr<SQLiteDatabase> db,
+                        const tkm::msg::ext::ExportFilter &filter,
+                        const std::function<std::shared_ptr<ExportStream>()> &makeStream,
+                        std::string &reason) -> std::shared_ptr<ExportJob>
+{
+  if (!isValidHash(filter.session_hash())) {
+    reason = "Invalid session hash";
+    return nullptr;
+  }
+
+  auto sesId = -1;
+  SQLiteDatabase::Query queryCheckExisting{.type = SQLiteDatabase::QueryType::HasSession,
+                                           .raw = &sesId};
+
+  auto status = db->runQuery(tkmQuery.hasSession(Query::Type::SQLite3, filter.session_hash()),
+                             queryCheckExisting);
+  if (!status) {
+    reason = "Query failed";
+    return nullptr;
+  }
+  if (sesId == -1) {
+    reason = "No such session";
+    return nullptr;
+  }
+
+  auto job = std::make_shared<ExportJob>(filter, makeStream());
+  job->setShardOpen(db->isShardOpen(filter.session_hash()));
+
+  return job;
+}
+
+// Send the rows of the next key range of the current table, done is set once
+// every table is sent
+static bool exportStep(const std::shared_ptr<SQLiteDatabase> db, ExportJob &job, bool &done)
+{
+  const auto &filter = job.getFilter();
+
+  done = job.isDone();
+  if (done) {
+    return true;
+  }
+
+  const auto what = job.getType();
+  const auto keyframeInterval = db->getChangeFilter().getKeyframeInterval();
+  const bool packedType = db->isPacked() && (tkmQuery.m_packedDataTypes.count(what) > 0);
+  int64_t bound = -1;
+
+  auto status = job.startTable(keyframeInterval);
+  if (status) {
+    SQLiteDatabase::Query queryBound{.type = SQLiteDatabase::QueryType::ExportBound,
+                                     .raw = &bound};
+    status = db->runQuery(tkmQuery.getExportBound(Query::Type::SQLite3,
+                                                  what,
+                                                  job.getRange(),
+                                                  db->isClustered(),
+                                                  db->isPacked(),
+                                                  job.getCursor(),
+                                                  job.getStepRows(packedType)),
+                          queryBound,
+                          filter.session_hash(),
+                          false);
+    if (status && (bound < 0)) {
+      job.nextTable();
+      done = job.isDone();
+      return true;
+    }
+  }
+
+  if (status) {
+    SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::ExportData,
+                                .raw = &job.getStream()};
+    status = db->runQuery(tkmQuery.exportData(Query::Type::SQLite3,
+                                              what,
+                                              job.getRange(),
+                                              db->isClustered(),
+                                              db->isPacked(),
+                                              db->getProjection(),
+                                              job.getCursor(),
+                                              bound),
+                          query,
+                          filter.session_hash(),
+                          false);
+  }
+
+  if (bound < 0) {
+    job.nextTable();
+  } else {
+    job.setCursor(bound);
+  }
+  done = job.isDone();
+
+  return status;
+}
+
+// Queue the next step behind the pending requests
+static bool queueExport(const std::shared_ptr<SQLiteDatabase> db,
+                        const IDatabase::Request &rq,
+                        const std::shared_ptr<ExportJob> &job)
+{
+  IDatabase::Request dbrq{.client = rq.client,
+                          .action = rq.action,
+                          .args = rq.args,
+                          .bulkData = std::make_any<std::shared_ptr<ExportJob>>(job)};
+  return db->pushRequest(dbrq);
+}
+
+static bool finishExport(const std::shared_ptr<SQLiteDatabase> db,
+                         ExportJob &job,
+                         bool status,
+                         std::string &reason)
+{
+  // Files of ended sessions are only opened for the export
+  if (!job.isShardOpen()) {
+    db->closeShard(job.getFilter().session_hash());
+  }
+
+  if (status) {
+    status = job.getStream().finish();
+  }
+
+  if (!status && !job.getStream().hasError()) {
+    reason = "Query failed";
+    logError() << "Query error for export session " << job.getFilter().session_hash();
+  }
+
+  return status;
+}
+
+static bool doExportSession(const std::shared_ptr<SQLiteDatabase> db,
+                            const IDatabase::Request &rq)
 {
   Dispatcher::Request mrq{.client = rq.client,
                           .action = Dispatcher::Action::SendStatus,
                           .args = std::map<Defaults::Arg, std::string>(),
                           .bulkData = std::make_any<int>(0)};
+  std::string reason = "Failed to send session data";
+  std::shared_ptr<ExportJob> job = nullptr;
   bool status = false;
+  bool done = false;
 
   if (rq.args.count(Defaults::Arg::RequestId)) {
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
   }
 
-  logDebug() << "Handling DB GetSessions request from client: " << rq.client->getName();
-  const auto &deviceData = std::any_cast<tkm::msg::control::DeviceData>(rq.bulkData);
-
-  auto querySessionList = std::vector<tkm::msg::control::SessionData>();
-  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::GetSessions,
-                              .raw = &querySessionList};
-
-  if (deviceData.hash().empty()) {
-    status = db->runQuery(tkmQuery.getSessions(Query::Type::SQLite3), query);
+  if (rq.bulkData.type() == typeid(std::shared_ptr<ExportJob>)) {
+    job = std::any_cast<std::shared_ptr<ExportJob>>(rq.bulkData);
   } else {
-    status = db->runQuery(tkmQuery.getSessions(Query::Type::SQLite3, deviceData.hash()), query);
+    logDebug() << "Handling DB ExportSession request from client: " << rq.client->getName();
+    const auto &filter = std::any_cast<tkm::msg::ext::ExportFilter>(rq.bulkData);
+    job = startExport(
+        db, filter, [&rq]() { return std::make_shared<ExportStream>(rq.client); }, reason);
+  }
+
+  if (job != nullptr) {
+    status = exportStep(db, *job, done);
+    if (status && !done) {
+      return queueExport(db, rq, job);
+    }
+    status = finishExport(db, *job, status, reason);
   }
 
   if (status) {
-    tkm::msg::Envelope envelope;
-    tkm::msg::control::Message message;
-    tkm::msg::control::SessionList sessionList;
+    reason = "Exported " + std::to_string(job->getStream().getRowCount()) + " rows";
+  }
 
-    for (auto &session : querySessionList) {
-      if (session.ended() == 0) {
-        session.set_state(tkm::msg::control::SessionData_State_Progress);
+  mrq.args.emplace(Defaults::Arg::Reason, reason);
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doArchiveSession(const std::shared_ptr<SQLiteDatabase> db,
+                             const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  std::string reason = "Failed to write archive";
+  std::shared_ptr<ExportJob> job = nullptr;
+  bool status = false;
+  bool done = false;
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  try {
+    if (rq.bulkData.type() == typeid(std::shared_ptr<ExportJob>)) {
+      job = std::any_cast<std::shared_ptr<ExportJob>>(rq.bulkData);
+    } else {
+      const auto &filter = std::any_cast<tkm::msg::ext::ExportFilter>(rq.bulkData);
+      logDebug() << "Handling DB ArchiveSession request for session " << filter.session_hash();
+      // A second job would write the same temporary file
+      if (ExportStream::isArchiving(filter.session_hash())) {
+        reason = "Session archive already in progress";
       } else {
-        session.set_state(tkm::msg::control::SessionData_State_Complete);
+        job = startExport(
+            db,
+            filter,
+            [&filter]() {
+              return std::make_shared<ExportStream>(
+                  ExportStream::getArchivePath(filter.session_hash()));
+            },
+            reason);
       }
-      auto tmpSession = sessionList.add_session();
-      tmpSession->CopyFrom(session);
     }
 
-    message.set_type(tkm::msg::control::Message_Type_SessionList);
-    message.mutable_data()->PackFrom(sessionList);
-    envelope.mutable_mesg()->PackFrom(message);
+    if (job != nullptr) {
+      status = exportStep(db, *job, done);
+      if (status && !done) {
+        return queueExport(db, rq, job);
+      }
+      status = finishExport(db, *job, status, reason);
+    }
+    if (status) {
+      reason = "Archived " + std::to_string(job->getStream().getRowCount()) + " rows to " +
+               job->getStream().getArchivePath().string();
+      logInfo() << reason;
+    }
+  } catch (std::exception &e) {
+    logError() << "Fail to create session archive. Reason: " << e.what();
+    status = false;
+  }
 
-    envelope.set_target(msg::Envelope_Recipient_Any);
-    envelope.set_origin(msg::Envelope_Recipient_Collector);
+  mrq.args.emplace(Defaults::Arg::Reason, reason);
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
 
-    if (!rq.client->writeEnvelope(envelope)) {
-      logWarn() << "Fail to send session list to client " << rq.client->getFD();
-      mrq.args.emplace(Defaults::Arg::Reason, "Failed to send session list");
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doAggregate(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  bool status = false;
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  logDebug() << "Handling DB Aggregate request from client: " << rq.client->getName();
+  const auto &filter = std::any_cast<tkm::msg::ext::AggregateFilter>(rq.bulkData);
+  const auto sql = tkmQuery.aggregateData(
+      Query::Type::SQLite3, filter, db->isClustered(), db->isPacked(), db->getProjection());
+
+  if (sql.empty()) {
+    mrq.args.emplace(Defaults::Arg::Reason,
+                     tkmQuery.checkAggregate(filter, db->getProjection()));
+  } else {
+    AggregateStream stream(rq.client, filter);
+    SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::Aggregate, .raw = &stream};
+    const bool shardOpen = db->isShardOpen(filter.session_hash());
+
+    status = db->runQuery(sql, query, filter.session_hash(), false);
+    if (!shardOpen) {
+      db->closeShard(filter.session_hash());
+    }
+    if (status) {
+      status = stream.finish();
+    }
+
+    if (status) {
+      mrq.args.emplace(Defaults::Arg::Reason,
+                       "Aggregated " + std::to_string(stream.getBucketCount()) + " buckets");
+    } else if (stream.hasError()) {
+      mrq.args.emplace(Defaults::Arg::Reason, "Failed to send aggregate data");
     } else {
-      mrq.args.emplace(Defaults::Arg::Reason, "List provided");
+      mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
+      logError() << "Query error for aggregate";
     }
-  } else {
-    mrq.args.emplace(Defaults::Arg::Reason, "Query failed");
-    logError() << "Query error for getUsers";
   }
 
   mrq.args.emplace(Defaults::Arg::Status,
@@ -442,6 +1105,115 @@ static bool doGetSessions(const std::shared_ptr<SQLiteDatabase> db, const IDatab
   return CollectorApp()->getDispatcher()->pushRequest(mrq);
 }
 
+static bool doRetention(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
+{
+  static_cast<void>(rq); // UNUSED
+  auto retention = CollectorApp()->getRetention();
+  bool status = true;
+
+  if (retention == nullptr) {
+    return true;
+  }
+
+  auto &job = retention->getJob();
+  const auto &policy = retention->getPolicy();
+
+  // Pick the next session to remove
+  if (job.sessionId == 0) {
+    auto sessionList = std::vector<tkm::msg::control::SessionData>();
+    SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::GetSessions,
+                                .raw = &sessionList};
+    std::string sessionHash;
+    std::string reason;
+
+    if (retention->takeScheduled(sessionHash)) {
+      reason = "removal request";
+      db->runQuery(tkmQuery.getSession(Query::Type::SQLite3, sessionHash), query);
+    } else {
+      uint64_t rows = 0;
+      uint64_t bytes = 0;
+      SQLiteDatabase::Query rowsQuery{.type = SQLiteDatabase::QueryType::Retention, .raw = &rows};
+      SQLiteDatabase::Query bytesQuery{.type = SQLiteDatabase::QueryType::Retention,
+                                       .raw = &bytes};
+
+      // Clustered tables have no rowid range to estimate rows from
+      if ((policy.maxRows > 0) && !db->isClustered()) {
+        db->runQuery(tkmQuery.getRowEstimate(Query::Type::SQLite3), rowsQuery);
+      }
+      if (policy.maxBytes > 0) {
+        db->runQuery(tkmQuery.getDatabaseSize(Query::Type::SQLite3), bytesQuery);
+        if (db->isSharded()) {
+          bytes += db->getShardsSize();
+        }
+      }
+
+      const bool overQuota = ((policy.maxRows > 0) && (rows > policy.maxRows)) ||
+                             ((policy.maxBytes > 0) && (bytes > policy.maxBytes));
+      const uint64_t now = static_cast<uint64_t>(time(NULL));
+      const uint64_t endedBefore =
+          ((policy.maxAge > 0) && (now > policy.maxAge)) ? now - policy.maxAge : 0;
+      const auto sql = tkmQuery.getExpiredSession(
+          Query::Type::SQLite3, endedBefore, policy.deviceMaxSessions, overQuota);
+
+      reason = overQuota ? "over quota" : "policy";
+      if (!sql.empty()) {
+        db->runQuery(sql, query);
+      }
+    }
+
+    if (sessionList.empty()) {
+      // Nothing to remove, give free pages back to the file system
+      SQLiteDatabase::Query vacuumQuery{.type = SQLiteDatabase::QueryType::RemSession,
+                                        .raw = nullptr};
+      db->runQuery(tkmQuery.releaseSpace(Query::Type::SQLite3, GRetentionVacuumPages),
+                   vacuumQuery);
+      retention->stepDone();
+      return true;
+    }
+
+    const auto &sessionData = sessionList.front();
+    retention->startJob(sessionData.id(), sessionData.hash(), reason);
+  }
+
+  // One batch of one table per step
+  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::RemSession, .raw = nullptr};
+  const auto &tables = retention->getTables();
+
+  if (db->isSharded()) {
+    // The samples go with the session file, no batches needed
+    status = db->runQuery(tkmQuery.remSession(Query::Type::SQLite3, job.hash), query);
+    if (status) {
+      status = db->removeShard(job.hash);
+    }
+    retention->finishJob(status);
+  } else if (job.table < tables.size()) {
+    status = db->runQuery(tkmQuery.remSessionRows(Query::Type::SQLite3,
+                                                  tables.at(job.table),
+                                                  job.sessionId,
+                                                  policy.batchRows,
+                                                  db->isClustered()),
+                          query);
+    if (status) {
+      const auto changes = db->getChanges();
+
+      job.rows += changes;
+      if (changes < policy.batchRows) {
+        job.table++;
+      }
+      logDebug() << "Retention session " << job.hash << " removed " << job.rows << " rows, table "
+                 << job.table << "/" << tables.size();
+    } else {
+      retention->finishJob(false);
+    }
+  } else {
+    status = db->runQuery(tkmQuery.remSession(Query::Type::SQLite3, job.hash), query);
+    retention->finishJob(status);
+  }
+
+  retention->stepDone();
+  return true;
+}
+
 static bool doAddDevice(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
 {
   Dispatcher::Request mrq{.client = rq.client,
@@ -453,7 +1225,8 @@ static bool doAddDevice(const std::shared_ptr<SQLiteDatabase> db, const IDatabas
     mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
   }
 
-  logDebug() << "Handling DB AddDevice request from client: " << rq.client->getName();
+  logDebug() << "Handling DB AddDevice request from client: "
+             << ((rq.client != nullptr) ? rq.client->getName() : "collector");
   const auto &deviceData = std::any_cast<tkm::msg::control::DeviceData>(rq.bulkData);
 
   auto devId = -1;
@@ -484,7 +1257,16 @@ static bool doAddDevice(const std::shared_ptr<SQLiteDatabase> db, const IDatabas
       mrq.args.emplace(Defaults::Arg::Reason, "Failed to add device");
     } else {
       mrq.args.emplace(Defaults::Arg::Reason, "Device added");
-      CollectorApp()->getDeviceManager()->loadDevices();
+
+      // Only the new entry is read back for its database id
+      auto deviceList = std::vector<tkm::msg::control::DeviceData>();
+      SQLiteDatabase::Query loadQuery{.type = SQLiteDatabase::QueryType::LoadDevices,
+                                      .raw = &deviceList};
+      if (db->runQuery(tkmQuery.getDevice(Query::Type::SQLite3, deviceData.hash()), loadQuery)) {
+        for (auto &newDeviceData : deviceList) {
+          CollectorApp()->getDeviceManager()->loadDevice(newDeviceData);
+        }
+      }
     }
   } else {
     mrq.args.emplace(Defaults::Arg::Reason, "Cannot check existing device");
@@ -563,6 +1345,9 @@ static bool doAddSession(const std::shared_ptr<SQLiteDatabase> db, const IDataba
       logError() << "Session hash collision detected. Remove old session " << sessionInfo.hash();
       SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::RemSession, .raw = nullptr};
       status = db->runQuery(tkmQuery.remSession(Query::Type::SQLite3, sessionInfo.hash()), query);
+      if (status && db->isSharded()) {
+        status = db->removeShard(sessionInfo.hash());
+      }
       if (!status) {
         logError() << "Failed to remove existing session";
       }
@@ -610,13 +1395,24 @@ static bool doRemSession(const std::shared_ptr<SQLiteDatabase> db, const IDataba
       mrq.args.emplace(Defaults::Arg::Reason, "No such session");
     }
 
-    SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::RemSession, .raw = nullptr};
-    status = db->runQuery(tkmQuery.remSession(Query::Type::SQLite3, sessionData.hash()), query);
-
-    if (!status) {
-      mrq.args.emplace(Defaults::Arg::Reason, "Failed to remove session");
+    if ((sesId != -1) && (CollectorApp()->getRetention() != nullptr)) {
+      // Deleted in batches by the retention job
+      CollectorApp()->getRetention()->schedule(sessionData.hash());
+      mrq.args.emplace(Defaults::Arg::Reason, "Session removal scheduled");
     } else {
-      mrq.args.emplace(Defaults::Arg::Reason, "Session removed");
+      SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::RemSession,
+                                  .raw = nullptr};
+      status =
+          db->runQuery(tkmQuery.remSession(Query::Type::SQLite3, sessionData.hash()), query);
+      if (status && db->isSharded()) {
+        status = db->removeShard(sessionData.hash());
+      }
+
+      if (!status) {
+        mrq.args.emplace(Defaults::Arg::Reason, "Failed to remove session");
+      } else {
+        mrq.args.emplace(Defaults::Arg::Reason, "Session removed");
+      }
     }
   } else {
     mrq.args.emplace(Defaults::Arg::Reason, "Cannot check existing session");
@@ -636,6 +1432,11 @@ static bool doEndSession(const std::shared_ptr<SQLiteDatabase> db, const IDataba
     throw std::runtime_error("Invalid arguments");
   }
 
+  // Rollup rows need the session to be still open
+  db->getRollup().endSession(rq.args.at(Defaults::Arg::SessionHash));
+  writeRollups(db, rq.args.at(Defaults::Arg::SessionHash));
+  db->getChangeFilter().endSession(rq.args.at(Defaults::Arg::SessionHash));
+
   SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::EndSession, .raw = nullptr};
   auto status = db->runQuery(
       tkmQuery.endSession(Query::Type::SQLite3, rq.args.at(Defaults::Arg::SessionHash)), query);
@@ -643,159 +1444,253 @@ static bool doEndSession(const std::shared_ptr<SQLiteDatabase> db, const IDataba
     logError() << "Query failed to mark end session";
   }
 
+  if (db->isSharded()) {
+    db->closeShard(rq.args.at(Defaults::Arg::SessionHash));
+  }
+
   return true;
 }
 
+static void writeRollups(const std::shared_ptr<SQLiteDatabase> db, const std::string &sessionHash)
+{
+  const auto buckets = db->getRollup().takeClosed();
+
+  if (buckets.empty()) {
+    return;
+  }
+
+  SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::AddData, .raw = nullptr};
+  if (!db->runQuery(tkmQuery.addRollups(Query::Type::SQLite3, sessionHash, buckets), query)) {
+    logError() << "Query failed to add " << buckets.size() << " rollup buckets";
+  }
+}
+
 static bool doAddData(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
 {
   SQLiteDatabase::Query query{.type = SQLiteDatabase::QueryType::AddData, .raw = nullptr};
   const auto &data = std::any_cast<tkm::msg::monitor::Data>(rq.bulkData);
+  const auto writeStart = getMonotonicTimeNs();
   bool status = true;
+  uint64_t rows = 1;
 
   if ((rq.args.count(Defaults::Arg::SessionHash) == 0)) {
     logError() << "Invalid session data";
     throw std::runtime_error("Invalid arguments");
   }
 
-  auto writeProcAcct = [&db, &status, &query](const std::string &sessionHash,
-                                              const tkm::msg::monitor::ProcAcct &acct,
-                                              uint64_t systemTime,
-                                              uint64_t monotonicTime,
-                                              uint64_t receiveTime) {
-    status = db->runQuery(
-        tkmQuery.addData(
-            Query::Type::SQLite3, sessionHash, acct, systemTime, monotonicTime, receiveTime),
-        query);
-  };
-
-  auto writeProcInfo = [&db, &status, &query](const std::string &sessionHash,
-                                              const tkm::msg::monitor::ProcInfo &info,
-                                              uint64_t systemTime,
-                                              uint64_t monotonicTime,
-                                              uint64_t receiveTime) {
-    status = db->runQuery(
-        tkmQuery.addData(
-            Query::Type::SQLite3, sessionHash, info, systemTime, monotonicTime, receiveTime),
-        query);
+  // The open session is read once per sample, the inserts write its Id
+  int sesId = -1;
+  SQLiteDatabase::Query sessionQuery{.type = SQLiteDatabase::QueryType::HasSession,
+                                     .raw = &sesId};
+  if (!db->runQuery(
+          tkmQuery.getOpenSession(Query::Type::SQLite3, rq.args.at(Defaults::Arg::SessionHash)),
+          sessionQuery) ||
+      (sesId == -1)) {
+    logError() << "No open session " << rq.args.at(Defaults::Arg::SessionHash) << " for data";
+    return true;
+  }
+  const auto sessionId = std::to_string(sesId);
+
+  // Session file inserts are collected and handed to its writer as one sample
+  std::string statements{};
+  auto store = [&db, &query, &statements](const std::string &sql,
+                                          const std::string &sessionHash) -> bool {
+    if (db->isSharded()) {
+      statements += sql;
+      return true;
+    }
+    return db->runQuery(sql, query, sessionHash);
   };
 
-  auto writeContextInfo = [&db, &status, &query](const std::string &sessionHash,
-                                                 const tkm::msg::monitor::ContextInfo &info,
-                                                 uint64_t systemTime,
-                                                 uint64_t monotonicTime,
-                                                 uint64_t receiveTime) {
-    status = db->runQuery(
-        tkmQuery.addData(
-            Query::Type::SQLite3, sessionHash, info, systemTime, monotonicTime, receiveTime),
-        query);
+  auto writeProcAcct = [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                                          const tkm::msg::monitor::ProcAcct &acct,
+                                                          uint64_t systemTime,
+                                                          uint64_t monotonicTime,
+                                                          uint64_t receiveTime) {
+    status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                    sessionId,
+                                    acct,
+                                    systemTime,
+                                    monotonicTime,
+                                    receiveTime,
+                                    db->getProjection(),
+                                    db->isClustered()),
+                   sessionHash);
   };
 
-  auto writeSysProcStat = [&db, &status, &query](const std::string &sessionHash,
-                                                 const tkm::msg::monitor::SysProcStat &sysProcStat,
-                                                 uint64_t systemTime,
-                                                 uint64_t monotonicTime,
-                                                 uint64_t receiveTime) {
-    status = db->runQuery(
-        tkmQuery.addData(
-            Query::Type::SQLite3, sessionHash, sysProcStat, systemTime, monotonicTime, receiveTime),
-        query);
+  auto writeProcInfo = [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                                          const tkm::msg::monitor::ProcInfo &info,
+                                                          uint64_t systemTime,
+                                                          uint64_t monotonicTime,
+                                                          uint64_t receiveTime) {
+    status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                    sessionId,
+                                    info,
+                                    systemTime,
+                                    monotonicTime,
+                                    receiveTime,
+                                    db->getProjection(),
+                                    db->isClustered()),
+                   sessionHash);
   };
 
-  auto writeSysProcBuddyInfo =
-      [&db, &status, &query](const std::string &sessionHash,
-                             const tkm::msg::monitor::SysProcBuddyInfo &sysProcBuddyInfo,
-                             uint64_t systemTime,
-                             uint64_t monotonicTime,
-                             uint64_t receiveTime) {
-        status = db->runQuery(tkmQuery.addData(Query::Type::SQLite3,
-                                               sessionHash,
-                                               sysProcBuddyInfo,
-                                               systemTime,
-                                               monotonicTime,
-                                               receiveTime),
-                              query);
+  auto writeContextInfo =
+      [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                         const tkm::msg::monitor::ContextInfo &info,
+                                         uint64_t systemTime,
+                                         uint64_t monotonicTime,
+                                         uint64_t receiveTime) {
+        status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                        sessionId,
+                                        info,
+                                        systemTime,
+                                        monotonicTime,
+                                        receiveTime,
+                                        db->getProjection(),
+                                        db->isClustered()),
+                       sessionHash);
       };
 
-  auto writeSysProcWireless =
-      [&db, &status, &query](const std::string &sessionHash,
-                             const tkm::msg::monitor::SysProcWireless &sysProcWireless,
-                             uint64_t systemTime,
-                             uint64_t monotonicTime,
-                             uint64_t receiveTime) {
-        status = db->runQuery(tkmQuery.addData(Query::Type::SQLite3,
-                                               sessionHash,
-                                               sysProcWireless,
-                                               systemTime,
-                                               monotonicTime,
-                                               receiveTime),
-                              query);
+  auto writeSysProcStat =
+      [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                         const tkm::msg::monitor::SysProcStat &sysProcStat,
+                                         uint64_t systemTime,
+                                         uint64_t monotonicTime,
+                                         uint64_t receiveTime) {
+        status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                        sessionId,
+                                        sysProcStat,
+                                        systemTime,
+                                        monotonicTime,
+                                        receiveTime,
+                                        db->isPacked(),
+                                        db->getProjection(),
+                                        db->isClustered()),
+                       sessionHash);
       };
 
-  auto writeSysProcMemInfo = [&db, &status, &query](
-                                 const std::string &sessionHash,
-                                 const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
-                                 uint64_t systemTime,
-                                 uint64_t monotonicTime,
-                                 uint64_t receiveTime) {
-    status = db->runQuery(
-        tkmQuery.addData(
-            Query::Type::SQLite3, sessionHash, sysProcMem, systemTime, monotonicTime, receiveTime),
-        query);
+  auto writeSysProcBuddyInfo = [&db, &status, &store, &sessionId](
+                                   const std::string &sessionHash,
+                                   const tkm::msg::monitor::SysProcBuddyInfo &sysProcBuddyInfo,
+                                   uint64_t systemTime,
+                                   uint64_t monotonicTime,
+                                   uint64_t receiveTime) {
+    status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                    sessionId,
+                                    sysProcBuddyInfo,
+                                    systemTime,
+                                    monotonicTime,
+                                    receiveTime,
+                                    db->isPacked(),
+                                    db->getProjection(),
+                                    db->isClustered()),
+                   sessionHash);
   };
 
-  auto writeSysProcPressure =
-      [&db, &status, &query](const std::string &sessionHash,
-                             const tkm::msg::monitor::SysProcPressure &sysProcPressure,
-                             uint64_t systemTime,
-                             uint64_t monotonicTime,
-                             uint64_t receiveTime) {
-        status = db->runQuery(tkmQuery.addData(Query::Type::SQLite3,
-                                               sessionHash,
-                                               sysProcPressure,
-                                               systemTime,
-                                               monotonicTime,
-                                               receiveTime),
-                              query);
+  auto writeSysProcWireless =
+      [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                         const tkm::msg::monitor::SysProcWireless &sysProcWireless,
+                                         uint64_t systemTime,
+                                         uint64_t monotonicTime,
+                                         uint64_t receiveTime) {
+        status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                        sessionId,
+                                        sysProcWireless,
+                                        systemTime,
+                                        monotonicTime,
+                                        receiveTime,
+                                        db->isPacked(),
+                                        db->getProjection(),
+                                        db->isClustered()),
+                       sessionHash);
       };
 
-  auto writeSysProcDiskStats =
-      [&db, &status, &query](const std::string &sessionHash,
-                             const tkm::msg::monitor::SysProcDiskStats &sysProcDiskStats,
-                             uint64_t systemTime,
-                             uint64_t monotonicTime,
-                             uint64_t receiveTime) {
-        status = db->runQuery(tkmQuery.addData(Query::Type::SQLite3,
-                                               sessionHash,
-                                               sysProcDiskStats,
-                                               systemTime,
-                                               monotonicTime,
-                                               receiveTime),
-                              query);
+  auto writeSysProcMemInfo =
+      [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                         const tkm::msg::monitor::SysProcMemInfo &sysProcMem,
+                                         uint64_t systemTime,
+                                         uint64_t monotonicTime,
+                                         uint64_t receiveTime) {
+        status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                        sessionId,
+                                        sysProcMem,
+                                        systemTime,
+                                        monotonicTime,
+                                        receiveTime,
+                                        db->getProjection(),
+                                        db->isClustered()),
+                       sessionHash);
       };
 
-  auto writeProcEvent = [&db, &status, &query](const std::string &sessionHash,
-                                               const tkm::msg::monitor::ProcEvent &procEvent,
-                                               uint64_t systemTime,
-                                               uint64_t monotonicTime,
-                                               uint64_t receiveTime) {
-    status = db->runQuery(
-        tkmQuery.addData(
-            Query::Type::SQLite3, sessionHash, procEvent, systemTime, monotonicTime, receiveTime),
-        query);
-  };
+  auto writeSysProcPressure =
+      [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                         const tkm::msg::monitor::SysProcPressure &sysProcPressure,
+                                         uint64_t systemTime,
+                                         uint64_t monotonicTime,
+                                         uint64_t receiveTime) {
+        status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                        sessionId,
+                                        sysProcPressure,
+                                        systemTime,
+                                        monotonicTime,
+                                        receiveTime,
+                                        db->getProjection(),
+                                        db->isClustered()),
+                       sessionHash);
+      };
 
-  auto writeSysProcVMStat = [&db, &status, &query](
-                                 const std::string &sessionHash,
-                                 const tkm::msg::monitor::SysProcVMStat &sysProcVMStat,
-                                 uint64_t systemTime,
-                                 uint64_t monotonicTime,
-                                 uint64_t receiveTime) {
-    status = db->runQuery(
-        tkmQuery.addData(
-            Query::Type::SQLite3, sessionHash, sysProcVMStat, systemTime, monotonicTime, receiveTime),
-        query);
+  auto writeSysProcDiskStats = [&db, &status, &store, &sessionId](
+                                   const std::string &sessionHash,
+                                   const tkm::msg::monitor::SysProcDiskStats &sysProcDiskStats,
+                                   uint64_t systemTime,
+                                   uint64_t monotonicTime,
+                                   uint64_t receiveTime) {
+    status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                    sessionId,
+                                    sysProcDiskStats,
+                                    systemTime,
+                                    monotonicTime,
+                                    receiveTime,
+                                    db->isPacked(),
+                                    db->getProjection(),
+                                    db->isClustered()),
+                   sessionHash);
   };
 
+  auto writeProcEvent =
+      [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                         const tkm::msg::monitor::ProcEvent &procEvent,
+                                         uint64_t systemTime,
+                                         uint64_t monotonicTime,
+                                         uint64_t receiveTime) {
+        status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                        sessionId,
+                                        procEvent,
+                                        systemTime,
+                                        monotonicTime,
+                                        receiveTime,
+                                        db->getProjection(),
+                                        db->isClustered()),
+                       sessionHash);
+      };
+
+  auto writeSysProcVMStat =
+      [&db, &status, &store, &sessionId](const std::string &sessionHash,
+                                         const tkm::msg::monitor::SysProcVMStat &sysProcVMStat,
+                                         uint64_t systemTime,
+                                         uint64_t monotonicTime,
+                                         uint64_t receiveTime) {
+        status = store(tkmQuery.addData(Query::Type::SQLite3,
+                                        sessionId,
+                                        sysProcVMStat,
+                                        systemTime,
+                                        monotonicTime,
+                                        receiveTime,
+                                        db->getProjection(),
+                                        db->isClustered()),
+                       sessionHash);
+      };
+
   switch (data.what()) {
   case tkm::msg::monitor::Data_What_ProcEvent: {
     tkm::msg::monitor::ProcEvent procEvent;
@@ -820,36 +1715,68 @@ static bool doAddData(const std::shared_ptr<SQLiteDatabase> db, const IDatabase:
   case tkm::msg::monitor::Data_What_ProcInfo: {
     tkm::msg::monitor::ProcInfo procInfo;
     data.payload().UnpackTo(&procInfo);
+    const auto &changes = db->getChangeFilter().filter(
+        rq.args.at(Defaults::Arg::SessionHash), procInfo, data.system_time_sec());
+    rows = static_cast<uint64_t>(changes.entry_size());
     writeProcInfo(rq.args.at(Defaults::Arg::SessionHash),
-                  procInfo,
+                  changes,
                   data.system_time_sec(),
                   data.monotonic_time_sec(),
                   data.receive_time_sec());
+    // Processes gone since the previous sample
+    const auto &tombstones = db->getChangeFilter().getProcInfoTombstones();
+    if (status && (tombstones.entry_size() > 0)) {
+      writeProcInfo(rq.args.at(Defaults::Arg::SessionHash),
+                    tombstones,
+                    data.system_time_sec(),
+                    data.monotonic_time_sec(),
+                    0);
+    }
+    if (status) {
+      db->getRollup().add(rq.args.at(Defaults::Arg::SessionHash), procInfo, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_ContextInfo: {
     tkm::msg::monitor::ContextInfo ctxInfo;
     data.payload().UnpackTo(&ctxInfo);
+    const auto &changes = db->getChangeFilter().filter(
+        rq.args.at(Defaults::Arg::SessionHash), ctxInfo, data.system_time_sec());
+    rows = static_cast<uint64_t>(changes.entry_size());
     writeContextInfo(rq.args.at(Defaults::Arg::SessionHash),
-                     ctxInfo,
+                     changes,
                      data.system_time_sec(),
                      data.monotonic_time_sec(),
                      data.receive_time_sec());
+    const auto &tombstones = db->getChangeFilter().getContextInfoTombstones();
+    if (status && (tombstones.entry_size() > 0)) {
+      writeContextInfo(rq.args.at(Defaults::Arg::SessionHash),
+                       tombstones,
+                       data.system_time_sec(),
+                       data.monotonic_time_sec(),
+                       0);
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcStat: {
     tkm::msg::monitor::SysProcStat sysProcStat;
     data.payload().UnpackTo(&sysProcStat);
+    rows = 1 + static_cast<uint64_t>(sysProcStat.core_size());
     writeSysProcStat(rq.args.at(Defaults::Arg::SessionHash),
                      sysProcStat,
                      data.system_time_sec(),
                      data.monotonic_time_sec(),
                      data.receive_time_sec());
+    if (status) {
+      db->getRollup().add(
+          rq.args.at(Defaults::Arg::SessionHash), sysProcStat, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcBuddyInfo: {
     tkm::msg::monitor::SysProcBuddyInfo sysProcBuddyInfo;
     data.payload().UnpackTo(&sysProcBuddyInfo);
+    rows = static_cast<uint64_t>(sysProcBuddyInfo.node_size());
     writeSysProcBuddyInfo(rq.args.at(Defaults::Arg::SessionHash),
                           sysProcBuddyInfo,
                           data.system_time_sec(),
@@ -860,6 +1787,7 @@ static bool doAddData(const std::shared_ptr<SQLiteDatabase> db, const IDatabase:
   case tkm::msg::monitor::Data_What_SysProcWireless: {
     tkm::msg::monitor::SysProcWireless sysProcWireless;
     data.payload().UnpackTo(&sysProcWireless);
+    rows = static_cast<uint64_t>(sysProcWireless.ifw_size());
     writeSysProcWireless(rq.args.at(Defaults::Arg::SessionHash),
                          sysProcWireless,
                          data.system_time_sec(),
@@ -875,6 +1803,10 @@ static bool doAddData(const std::shared_ptr<SQLiteDatabase> db, const IDatabase:
                         data.system_time_sec(),
                         data.monotonic_time_sec(),
                         data.receive_time_sec());
+    if (status) {
+      db->getRollup().add(
+          rq.args.at(Defaults::Arg::SessionHash), sysProcMem, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcPressure: {
@@ -885,11 +1817,16 @@ static bool doAddData(const std::shared_ptr<SQLiteDatabase> db, const IDatabase:
                          data.system_time_sec(),
                          data.monotonic_time_sec(),
                          data.receive_time_sec());
+    if (status) {
+      db->getRollup().add(
+          rq.args.at(Defaults::Arg::SessionHash), sysProcPressure, data.system_time_sec());
+    }
     break;
   }
   case tkm::msg::monitor::Data_What_SysProcDiskStats: {
     tkm::msg::monitor::SysProcDiskStats sysProcDiskStats;
     data.payload().UnpackTo(&sysProcDiskStats);
+    rows = static_cast<uint64_t>(sysProcDiskStats.disk_size());
     writeSysProcDiskStats(rq.args.at(Defaults::Arg::SessionHash),
                           sysProcDiskStats,
                           data.system_time_sec(),
@@ -911,9 +1848,67 @@ static bool doAddData(const std::shared_ptr<SQLiteDatabase> db, const IDatabase:
     break;
   }
 
+  writeRollups(db, rq.args.at(Defaults::Arg::SessionHash));
+
+  // Samples are accounted once their writer committed them
+  if (db->isSharded()) {
+    if (!db->writeShard(rq.args.at(Defaults::Arg::SessionHash),
+                        ShardWriter::Sample{.what = data.what(),
+                                            .args = rq.args,
+                                            .sql = std::move(statements),
+                                            .writeStart = writeStart,
+                                            .rows = rows})) {
+      logError() << "Fail to write data for session " << rq.args.at(Defaults::Arg::SessionHash);
+    }
+    for (const auto &sample : db->takeWritten()) {
+      if (!sample.status) {
+        logError() << "SQLiteDatabase query error: " << sample.error;
+      }
+      accountData(db,
+                  sample.what,
+                  sample.args,
+                  sample.writeStart,
+                  sample.commitTime,
+                  sample.rows,
+                  sample.status);
+    }
+    return true;
+  }
+
+  accountData(db, data.what(), rq.args, writeStart, getMonotonicTimeNs(), rows, status);
+
   return true;
 }
 
+static void accountData(const std::shared_ptr<SQLiteDatabase> db,
+                        tkm::msg::monitor::Data_What what,
+                        const std::map<Defaults::Arg, std::string> &args,
+                        uint64_t writeStart,
+                        uint64_t commitTime,
+                        uint64_t rows,
+                        bool status)
+{
+  // Sample latency from collector receive to database commit
+  if (status && (args.count(Defaults::Arg::ReceiveTime) > 0)) {
+    db->getLatency().record(
+        what, std::stoull(args.at(Defaults::Arg::ReceiveTime)), writeStart, commitTime);
+  }
+
+  // Account database cost to the source device
+  if (args.count(Defaults::Arg::DeviceHash) > 0) {
+    auto device = CollectorApp()->getDeviceManager()->getDevice(args.at(Defaults::Arg::DeviceHash));
+    if (device != nullptr) {
+      auto &stats = device->getStats();
+
+      if (args.count(Defaults::Arg::EnqueueTime) > 0) {
+        stats.queueTime += writeStart - std::stoull(args.at(Defaults::Arg::EnqueueTime));
+      }
+      stats.dbTime += commitTime - writeStart;
+      stats.dbRows += status ? rows : 0;
+    }
+  }
+}
+
 static bool doConnect(const std::shared_ptr<SQLiteDatabase> db, const IDatabase::Request &rq)
 {
   // No need for DB connect with SQLite
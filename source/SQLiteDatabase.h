@@ -14,9 +14,15 @@
 #include "IDatabase.h"
 #include "Logger.h"
 #include "Options.h"
+#include "ShardWriter.h"
 
 #include <any>
+#include <filesystem>
+#include <map>
+#include <memory>
 #include <sqlite3.h>
+#include <string>
+#include <vector>
 
 using namespace bswi::log;
 using namespace bswi::event;
@@ -24,6 +30,12 @@ using namespace bswi::event;
 namespace tkm::collector
 {
 
+// With session sharding the main file keeps devices, sessions and rollups and
+// the samples of every session go to their own file in the sessions directory.
+// Session files attach the main file as catalog so the data queries resolve the
+// sessions table there unchanged. A session file stays open while the session
+// is running and removing a session deletes its file. The samples of an open
+// session file are written by its own writer thread.
 class SQLiteDatabase : public IDatabase, public std::enable_shared_from_this<SQLiteDatabase>
 {
 public:
@@ -34,6 +46,12 @@ public:
     LoadDevices,
     GetDevices,
     GetSessions,
+    ListDevices,
+    ListSessions,
+    ExportData,
+    ExportBound,
+    Aggregate,
+    Retention,
     AddDevice,
     RemDevice,
     HasDevice,
@@ -43,6 +61,8 @@ public:
     EndSession,
     CleanSessions,
     AddData,
+    Layout,
+    Columns,
   };
 
   typedef struct Query {
@@ -60,13 +80,60 @@ public:
   bool requestHandler(const IDatabase::Request &request) final;
 
   bool runQuery(const std::string &sql, Query &query);
+  // Run on the session file when sharded. Without create a session with no file
+  // runs on the main file, its data tables are empty in sharded mode.
+  bool runQuery(const std::string &sql,
+                Query &query,
+                const std::string &sessionHash,
+                bool create = true);
+  // Rows changed by the last INSERT, UPDATE or DELETE
+  auto getChanges() -> uint64_t { return static_cast<uint64_t>(sqlite3_changes(m_db)); }
+
+  [[nodiscard]] bool useClustered() const { return m_useClustered; }
+  [[nodiscard]] bool isClustered() const { return m_clustered; }
+  void checkClustered();
+
+  [[nodiscard]] bool usePacked() const { return m_usePacked; }
+  [[nodiscard]] bool isPacked() const { return m_packed; }
+  void checkPacked();
+  // Tables not matching the ingest configuration keep their columns
+  void checkProjection();
+
+  [[nodiscard]] bool isSharded() const { return m_sharded; }
+  [[nodiscard]] bool isShardOpen(const std::string &sessionHash) const
+  {
+    return m_shards.count(sessionHash) > 0;
+  }
+  // Hand the sample to the session file writer
+  bool writeShard(const std::string &sessionHash, ShardWriter::Sample &&sample);
+  // Samples written by the session file writers since the last call
+  auto takeWritten() -> std::vector<ShardWriter::Sample>;
+  void closeShard(const std::string &sessionHash);
+  // Close and delete the session file
+  bool removeShard(const std::string &sessionHash);
+  void removeAllShards();
+  // Bytes used by all session files
+  auto getShardsSize() -> uint64_t;
 
 public:
   SQLiteDatabase();
   ~SQLiteDatabase();
 
+private:
+  auto getShard(const std::string &sessionHash, bool create) -> ShardWriter *;
+  auto getShardPath(const std::string &sessionHash) const -> std::filesystem::path;
+
 private:
   sqlite3 *m_db = nullptr;
+  std::filesystem::path m_path{};
+  std::filesystem::path m_shardDirectory{};
+  std::map<std::string, std::unique_ptr<ShardWriter>> m_shards{};
+  std::vector<ShardWriter::Sample> m_written{};
+  bool m_sharded = false;
+  bool m_useClustered = false;
+  bool m_clustered = false;
+  bool m_usePacked = false;
+  bool m_packed = false;
 };
 
 } // namespace tkm::collector
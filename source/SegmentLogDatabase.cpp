@@ -0,0 +1,915 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SegmentLogDatabase Class
+ * @details   Append only segment log database implementation
+ *-
+ */
+
+#include "SegmentLogDatabase.h"
+#include "Application.h"
+#include "Archive.h"
+#include "Defaults.h"
+#include "ExportStream.h"
+#include "ListStream.h"
+#include "Query.h"
+
+#include <Helpers.h>
+#include <algorithm>
+#include <fstream>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/dynamic_message.h>
+#include <sstream>
+#include <taskmonitor/taskmonitor.h>
+#include <vector>
+
+// Device and session metadata file in the segment log directory
+constexpr const char *GSegmentMetaFile = "segmentlog.meta";
+
+namespace tkm::collector
+{
+
+static bool doInitDatabase(const std::shared_ptr<SegmentLogDatabase> db,
+                           const IDatabase::Request &rq);
+static bool doLoadDevices(const std::shared_ptr<SegmentLogDatabase> db);
+static bool doGetDevices(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq);
+static bool doGetSessions(const std::shared_ptr<SegmentLogDatabase> db,
+                          const IDatabase::Request &rq);
+static bool doAddDevice(const std::shared_ptr<SegmentLogDatabase> db,
+                        const IDatabase::Request &rq);
+static bool doRemoveDevice(const std::shared_ptr<SegmentLogDatabase> db,
+                           const IDatabase::Request &rq);
+static bool doAddSession(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq);
+static bool doRemSession(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq);
+static bool doEndSession(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq);
+static bool doCleanSessions(const std::shared_ptr<SegmentLogDatabase> db);
+static bool doExportSession(const std::shared_ptr<SegmentLogDatabase> db,
+                            const IDatabase::Request &rq);
+static bool doArchiveSession(const std::shared_ptr<SegmentLogDatabase> db,
+                             const IDatabase::Request &rq);
+static bool doNotSupported(const IDatabase::Request &rq);
+static bool doRetention(const std::shared_ptr<SegmentLogDatabase> db);
+static bool doAddData(const std::shared_ptr<SegmentLogDatabase> db, const IDatabase::Request &rq);
+
+SegmentLogDatabase::SegmentLogDatabase(std::shared_ptr<Options> options)
+: IDatabase(options)
+{
+  m_directory = CollectorApp()->getOptions()->getFor(Options::Key::SegmentLogDirectory);
+  logDebug() << "Using segment log directory: " << m_directory.string();
+
+  m_writer = std::make_unique<SegmentWriter>(
+      m_directory,
+      std::stoull(CollectorApp()->getOptions()->getFor(Options::Key::SegmentLogSegmentSize)),
+      static_cast<uint32_t>(
+          std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::SegmentLogIndexStride))));
+  loadMeta();
+}
+
+SegmentLogDatabase::~SegmentLogDatabase()
+{
+  if (m_syncTimer != nullptr) {
+    m_syncTimer->stop();
+  }
+}
+
+void SegmentLogDatabase::enableEvents()
+{
+  CollectorApp()->addEventSource(m_queue);
+
+  // Written records are made durable in batches instead of once per sample
+  m_syncTimer = std::make_shared<Timer>("SegmentSyncTimer", [this]() {
+    if (!m_writer->sync()) {
+      logError() << "Fail to sync segment log";
+    }
+    return true;
+  });
+  m_syncTimer->start(
+      std::stoull(CollectorApp()->getOptions()->getFor(Options::Key::SegmentLogSyncInterval)),
+      true);
+  CollectorApp()->addEventSource(m_syncTimer);
+}
+
+// One entry per line, fields separated by tabs and the name last:
+//   D <id> <hash> <port> <address> <name>
+//   S <id> <hash> <device hash> <started> <ended> <name>
+//   H <highest session id ever used>
+// Records of removed sessions stay in the segments until they are pruned, so
+// session ids are never reused.
+void SegmentLogDatabase::loadMeta()
+{
+  std::ifstream stream(m_directory / GSegmentMetaFile);
+  std::string line;
+
+  while (std::getline(stream, line)) {
+    std::stringstream fields(line);
+    std::string kind, id, hash, name;
+
+    std::getline(fields, kind, '\t');
+    std::getline(fields, id, '\t');
+    std::getline(fields, hash, '\t');
+
+    try {
+      if (kind == "D") {
+        tkm::msg::control::DeviceData device;
+        std::string port, address;
+
+        std::getline(fields, port, '\t');
+        std::getline(fields, address, '\t');
+        std::getline(fields, name);
+
+        device.set_id(std::stol(id));
+        device.set_hash(hash);
+        device.set_port(std::stoi(port));
+        device.set_address(address);
+        device.set_name(name);
+        m_lastDeviceId = std::max(m_lastDeviceId, device.id());
+        m_devices[hash] = device;
+      } else if (kind == "S") {
+        Session session;
+        std::string started, ended;
+
+        std::getline(fields, session.device, '\t');
+        std::getline(fields, started, '\t');
+        std::getline(fields, ended, '\t');
+        std::getline(fields, name);
+
+        session.data.set_id(std::stol(id));
+        session.data.set_hash(hash);
+        session.data.set_started(std::stoul(started));
+        session.data.set_ended(std::stoul(ended));
+        session.data.set_name(name);
+        m_lastSessionId = std::max(m_lastSessionId, session.data.id());
+        m_sessions[hash] = session;
+      } else if (kind == "H") {
+        m_lastSessionId = std::max(m_lastSessionId, static_cast<int64_t>(std::stoll(id)));
+      }
+    } catch (std::exception &e) {
+      logWarn() << "Skip invalid segment log metadata entry: " << line;
+    }
+  }
+
+  // Metadata written before the high water entry, sessions of the indexed segments
+  for (const auto &segment : SegmentReader(m_directory).getSegments()) {
+    std::set<uint32_t> sessions;
+
+    if (SegmentReader::getIndexSessions(segment, sessions) && !sessions.empty()) {
+      m_lastSessionId = std::max(m_lastSessionId, static_cast<int64_t>(*sessions.rbegin()));
+    }
+  }
+
+  logInfo() << "Segment log loaded " << m_devices.size() << " devices and " << m_sessions.size()
+            << " sessions";
+}
+
+bool SegmentLogDatabase::saveMeta()
+{
+  const auto path = m_directory / GSegmentMetaFile;
+  auto tmpPath = path;
+  tmpPath += ".tmp";
+
+  {
+    std::ofstream stream(tmpPath, std::ios::out | std::ios::trunc);
+
+    for (const auto &[hash, device] : m_devices) {
+      stream << "D\t" << device.id() << "\t" << hash << "\t" << device.port() << "\t"
+             << device.address() << "\t" << device.name() << "\n";
+    }
+    for (const auto &[hash, session] : m_sessions) {
+      stream << "S\t" << session.data.id() << "\t" << hash << "\t" << session.device << "\t"
+             << session.data.started() << "\t" << session.data.ended() << "\t"
+             << session.data.name() << "\n";
+    }
+    stream << "H\t" << m_lastSessionId << "\n";
+
+    stream.flush();
+    if (!stream.good()) {
+      logError() << "Fail to write segment log metadata";
+      return false;
+    }
+  }
+
+  // Replaced at once so a crash never leaves a partial file
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, path, ec);
+  if (ec) {
+    logError() << "Fail to save segment log metadata. Reason: " << ec.message();
+    return false;
+  }
+
+  return true;
+}
+
+void SegmentLogDatabase::reset()
+{
+  m_writer.reset();
+  for (const auto &segment : SegmentReader(m_directory).getSegments()) {
+    std::filesystem::remove(segment);
+    std::filesystem::remove(std::filesystem::path(segment).replace_extension(
+        GSegmentIndexExtension));
+  }
+
+  m_devices.clear();
+  m_sessions.clear();
+  m_lastDeviceId = 0;
+  m_lastSessionId = 0;
+  saveMeta();
+
+  m_writer = std::make_unique<SegmentWriter>(
+      m_directory,
+      std::stoull(CollectorApp()->getOptions()->getFor(Options::Key::SegmentLogSegmentSize)),
+      static_cast<uint32_t>(
+          std::stoul(CollectorApp()->getOptions()->getFor(Options::Key::SegmentLogIndexStride))));
+}
+
+void SegmentLogDatabase::pruneSegments()
+{
+  std::set<uint32_t> known;
+
+  for (const auto &[hash, session] : m_sessions) {
+    known.insert(static_cast<uint32_t>(session.data.id()));
+  }
+
+  for (const auto &segment : SegmentReader(m_directory).getSegments()) {
+    std::set<uint32_t> sessions;
+
+    // The segment being written has no index and is kept
+    if (!SegmentReader::getIndexSessions(segment, sessions)) {
+      continue;
+    }
+    if (std::any_of(sessions.cbegin(), sessions.cend(), [&known](uint32_t session) {
+          return known.count(session) > 0;
+        })) {
+      continue;
+    }
+
+    logInfo() << "Remove segment " << segment.filename().string();
+    std::filesystem::remove(segment);
+    std::filesystem::remove(std::filesystem::path(segment).replace_extension(
+        GSegmentIndexExtension));
+  }
+}
+
+bool SegmentLogDatabase::requestHandler(const Request &rq)
+{
+  switch (rq.action) {
+  case IDatabase::Action::CheckDatabase:
+  case IDatabase::Action::Connect:
+  case IDatabase::Action::Disconnect:
+    // Nothing to check or connect for local files
+    return true;
+  case IDatabase::Action::InitDatabase:
+    return doInitDatabase(getShared(), rq);
+  case IDatabase::Action::LoadDevices:
+    return doLoadDevices(getShared());
+  case IDatabase::Action::GetDevices:
+    return doGetDevices(getShared(), rq);
+  case IDatabase::Action::AddDevice:
+    return doAddDevice(getShared(), rq);
+  case IDatabase::Action::RemoveDevice:
+    return doRemoveDevice(getShared(), rq);
+  case IDatabase::Action::GetSessions:
+    return doGetSessions(getShared(), rq);
+  case IDatabase::Action::AddSession:
+    return doAddSession(getShared(), rq);
+  case IDatabase::Action::RemSession:
+    return doRemSession(getShared(), rq);
+  case IDatabase::Action::EndSession:
+    return doEndSession(getShared(), rq);
+  case IDatabase::Action::CleanSessions:
+    return doCleanSessions(getShared());
+  case IDatabase::Action::ExportSession:
+    return doExportSession(getShared(), rq);
+  case IDatabase::Action::ArchiveSession:
+    return doArchiveSession(getShared(), rq);
+  case IDatabase::Action::Aggregate:
+    return doNotSupported(rq);
+  case IDatabase::Action::Retention:
+    return doRetention(getShared());
+  case IDatabase::Action::AddData:
+    return doAddData(getShared(), rq);
+  default:
+    break;
+  }
+  logError() << "Unknown action request";
+  return false;
+}
+
+static bool doInitDatabase(const std::shared_ptr<SegmentLogDatabase> db,
+                           const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  bool status = true;
+
+  logDebug() << "Handling DB init request";
+
+  if (rq.args.count(Defaults::Arg::Forced)) {
+    if (rq.args.at(Defaults::Arg::Forced) == tkmDefaults.valFor(Defaults::Val::True)) {
+      try {
+        db->reset();
+      } catch (std::exception &e) {
+        logError() << "Fail to reset segment log. Reason: " << e.what();
+        status = false;
+      }
+    }
+  }
+  status = status && db->saveMeta();
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+  mrq.args.emplace(Defaults::Arg::Reason,
+                   status == true ? "Database init complete" : "Database init failed");
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+// Entries ordered by id as the SQL backends list them
+template <typename T>
+static auto sortedById(std::map<std::string, T> &entries,
+                       const std::function<int64_t(const T &)> &getId) -> std::vector<T *>
+{
+  std::vector<T *> sorted;
+
+  for (auto &[hash, entry] : entries) {
+    sorted.push_back(&entry);
+  }
+  std::sort(sorted.begin(), sorted.end(), [&getId](const T *a, const T *b) {
+    return getId(*a) < getId(*b);
+  });
+
+  return sorted;
+}
+
+static bool doLoadDevices(const std::shared_ptr<SegmentLogDatabase> db)
+{
+  logDebug() << "Handling DB LoadDevices";
+
+  for (auto *deviceData : sortedById<tkm::msg::control::DeviceData>(
+           db->getDevices(),
+           [](const tkm::msg::control::DeviceData &device) { return device.id(); })) {
+    CollectorApp()->getDeviceManager()->loadDevice(*deviceData);
+  }
+
+  return true;
+}
+
+static bool doCleanSessions(const std::shared_ptr<SegmentLogDatabase> db)
+{
+  const auto timeNow = static_cast<uint64_t>(time(NULL));
+  bool changed = false;
+
+  logDebug() << "Handling DB CleanSessions";
+
+  for (auto &[hash, session] : db->getSessions()) {
+    if (session.data.ended() == 0) {
+      session.data.set_ended(timeNow);
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    db->saveMeta();
+  }
+
+  return true;
+}
+
+static bool doGetDevices(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  logDebug() << "Handling DB GetDevices request from client: " << rq.client->getName();
+  const auto &filter = std::any_cast<tkm::msg::ext::ListFilter>(rq.bulkData);
+
+  ListStream stream(
+      rq.client, ListStream::Kind::Devices, filter, rq.args.count(Defaults::Arg::Paged) > 0);
+  const auto devices = sortedById<tkm::msg::control::DeviceData>(
+      db->getDevices(), [](const tkm::msg::control::DeviceData &device) { return device.id(); });
+  bool status = true;
+
+  // The list is held in memory, all steps are sent at once
+  while (status && !stream.isDone()) {
+    const auto stepFilter = stream.getStepFilter();
+    for (auto *deviceData : devices) {
+      if (deviceData->id() <= stepFilter.after_id()) {
+        continue;
+      }
+      auto device = *deviceData;
+      if (!stream.add(device)) {
+        break;
+      }
+    }
+    status = stream.endStep();
+  }
+
+  if (status) {
+    status = stream.finish();
+  }
+
+  mrq.args.emplace(Defaults::Arg::Reason, status ? "List provided" : "Failed to send device list");
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doGetSessions(const std::shared_ptr<SegmentLogDatabase> db,
+                          const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  logDebug() << "Handling DB GetSessions request from client: " << rq.client->getName();
+  const auto &filter = std::any_cast<tkm::msg::ext::ListFilter>(rq.bulkData);
+
+  ListStream stream(
+      rq.client, ListStream::Kind::Sessions, filter, rq.args.count(Defaults::Arg::Paged) > 0);
+  const auto sessions = sortedById<SegmentLogDatabase::Session>(
+      db->getSessions(),
+      [](const SegmentLogDatabase::Session &entry) { return entry.data.id(); });
+  bool status = true;
+
+  // The list is held in memory, all steps are sent at once
+  while (status && !stream.isDone()) {
+    const auto stepFilter = stream.getStepFilter();
+    for (auto *session : sessions) {
+      const auto &data = session->data;
+
+      if ((data.id() <= stepFilter.after_id()) ||
+          (!filter.device_hash().empty() && (session->device != filter.device_hash())) ||
+          ((filter.started_from() > 0) && (data.started() < filter.started_from())) ||
+          ((filter.started_to() > 0) && (data.started() > filter.started_to())) ||
+          ((filter.state() == tkm::msg::ext::ListFilter_State_Progress) && (data.ended() > 0)) ||
+          ((filter.state() == tkm::msg::ext::ListFilter_State_Complete) && (data.ended() == 0))) {
+        continue;
+      }
+      auto sessionData = data;
+      if (!stream.add(sessionData)) {
+        break;
+      }
+    }
+    status = stream.endStep();
+  }
+
+  if (status) {
+    status = stream.finish();
+  }
+
+  mrq.args.emplace(Defaults::Arg::Reason,
+                   status ? "List provided" : "Failed to send session list");
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+// Stream the requested types of a session, reason is set if the session is unknown
+static bool exportTables(const std::shared_ptr<SegmentLogDatabase> db,
+                         const tkm::msg::ext::ExportFilter &filter,
+                         ExportStream &stream,
+                         std::string &reason)
+{
+  auto it = db->getSessions().find(filter.session_hash());
+  if (it == db->getSessions().end()) {
+    reason = "No such session";
+    return false;
+  }
+
+  // Buffered records of the current segment must be visible to the reader
+  const auto sessionId = static_cast<uint32_t>(it->second.data.id());
+  auto status = db->getWriter().flush();
+  SegmentReader reader(db->getDirectory());
+
+  for (const auto what : ExportStream::getTypes(filter)) {
+    if (!status) {
+      break;
+    }
+
+    const auto *descriptor = google::protobuf::DescriptorPool::generated_pool()
+                                 ->FindMessageTypeByName(getSegmentTypeName(what));
+    if (descriptor == nullptr) {
+      continue;
+    }
+    std::unique_ptr<google::protobuf::Message> message(
+        google::protobuf::MessageFactory::generated_factory()->GetPrototype(descriptor)->New());
+
+    // Samples are exported as stored, the payload in protobuf text format
+    stream.startTable(tkmQuery.m_dataTableName.at(what));
+    stream.addColumn(GArchiveTimeColumn);
+    stream.addColumn("MonotonicTime");
+    stream.addColumn("ReceiveTime");
+    stream.addColumn("Payload");
+
+    status = reader.read(sessionId,
+                         filter.time_from(),
+                         filter.time_to(),
+                         [&stream, &message, what](const SegmentRecord &record,
+                                                   const std::string &payload) {
+                           if (record.what != what) {
+                             return true;
+                           }
+                           message->ParseFromString(payload);
+
+                           auto row = stream.addRow();
+                           row->add_value(std::to_string(record.systemTime));
+                           row->add_value(std::to_string(record.monotonicTime));
+                           row->add_value(std::to_string(record.receiveTime));
+                           row->add_value(message->ShortDebugString());
+                           return stream.commitRow();
+                         });
+  }
+
+  if (status) {
+    status = stream.finish();
+  }
+
+  if (!status && !stream.hasError()) {
+    reason = "Segment log read failed";
+    logError() << "Read error for export session " << filter.session_hash();
+  }
+
+  return status;
+}
+
+static bool doExportSession(const std::shared_ptr<SegmentLogDatabase> db,
+                            const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  std::string reason = "Failed to send session data";
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  logDebug() << "Handling DB ExportSession request from client: " << rq.client->getName();
+  const auto &filter = std::any_cast<tkm::msg::ext::ExportFilter>(rq.bulkData);
+  ExportStream stream(rq.client);
+
+  auto status = exportTables(db, filter, stream, reason);
+  if (status) {
+    reason = "Exported " + std::to_string(stream.getRowCount()) + " rows";
+  }
+
+  mrq.args.emplace(Defaults::Arg::Reason, reason);
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doArchiveSession(const std::shared_ptr<SegmentLogDatabase> db,
+                             const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  std::string reason = "Failed to write archive";
+  bool status = false;
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  const auto &filter = std::any_cast<tkm::msg::ext::ExportFilter>(rq.bulkData);
+  logDebug() << "Handling DB ArchiveSession request for session " << filter.session_hash();
+
+  // The hash names the archive file, unknown sessions never create one
+  if (!isValidHash(filter.session_hash()) ||
+      (db->getSessions().count(filter.session_hash()) == 0)) {
+    reason = "No such session";
+  } else {
+    try {
+      ExportStream stream(ExportStream::getArchivePath(filter.session_hash()));
+
+      status = exportTables(db, filter, stream, reason);
+      if (status) {
+        reason = "Archived " + std::to_string(stream.getRowCount()) + " rows to " +
+                 stream.getArchivePath().string();
+        logInfo() << reason;
+      }
+    } catch (std::exception &e) {
+      logError() << "Fail to create session archive. Reason: " << e.what();
+    }
+  }
+
+  mrq.args.emplace(Defaults::Arg::Reason, reason);
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doNotSupported(const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+  mrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+  mrq.args.emplace(Defaults::Arg::Reason, "Not supported by segmentlog database");
+
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static void removeSession(const std::shared_ptr<SegmentLogDatabase> db,
+                          const std::string &sessionHash)
+{
+  db->getSessions().erase(sessionHash);
+  db->saveMeta();
+  db->pruneSegments();
+}
+
+static bool doRetention(const std::shared_ptr<SegmentLogDatabase> db)
+{
+  auto retention = CollectorApp()->getRetention();
+  std::string sessionHash;
+
+  if (retention == nullptr) {
+    return true;
+  }
+
+  // Only removal requests are handled, removing a session is a metadata update
+  if (retention->takeScheduled(sessionHash)) {
+    auto it = db->getSessions().find(sessionHash);
+    if (it != db->getSessions().end()) {
+      retention->startJob(it->second.data.id(), sessionHash, "removal request");
+      removeSession(db, sessionHash);
+      retention->finishJob(true);
+    }
+  }
+
+  retention->stepDone();
+  return true;
+}
+
+static bool doAddDevice(const std::shared_ptr<SegmentLogDatabase> db,
+                        const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  logDebug() << "Handling DB AddDevice request from client: "
+             << ((rq.client != nullptr) ? rq.client->getName() : "collector");
+  auto deviceData = std::any_cast<tkm::msg::control::DeviceData>(rq.bulkData);
+  const bool forced =
+      (rq.args.count(Defaults::Arg::Forced) > 0) &&
+      (rq.args.at(Defaults::Arg::Forced) == tkmDefaults.valFor(Defaults::Val::True));
+
+  if ((db->getDevices().count(deviceData.hash()) > 0) && !forced) {
+    mrq.args.emplace(Defaults::Arg::Status, tkmDefaults.valFor(Defaults::Val::StatusError));
+    mrq.args.emplace(Defaults::Arg::Reason, "Device already exists");
+    return CollectorApp()->getDispatcher()->pushRequest(mrq);
+  }
+
+  deviceData.set_id(db->nextDeviceId());
+  db->getDevices()[deviceData.hash()] = deviceData;
+
+  auto status = db->saveMeta();
+  if (!status) {
+    mrq.args.emplace(Defaults::Arg::Reason, "Failed to add device");
+  } else {
+    mrq.args.emplace(Defaults::Arg::Reason, "Device added");
+    CollectorApp()->getDeviceManager()->loadDevice(deviceData);
+  }
+
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doRemoveDevice(const std::shared_ptr<SegmentLogDatabase> db,
+                           const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  bool status = false;
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  logDebug() << "Handling DB RemoveDevice request from client: " << rq.client->getName();
+  const auto &deviceData = std::any_cast<tkm::msg::control::DeviceData>(rq.bulkData);
+
+  if (db->getDevices().erase(deviceData.hash()) == 0) {
+    mrq.args.emplace(Defaults::Arg::Reason, "No such device");
+  } else if (!db->saveMeta()) {
+    mrq.args.emplace(Defaults::Arg::Reason, "Failed to remove device");
+  } else {
+    mrq.args.emplace(Defaults::Arg::Reason, "Device removed");
+    status = true;
+  }
+
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doAddSession(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq)
+{
+  const auto &sessionInfo = std::any_cast<tkm::msg::monitor::SessionInfo>(rq.bulkData);
+
+  logDebug() << "Handling DB AddSession request";
+  if (rq.args.count(Defaults::Arg::DeviceHash) == 0) {
+    logError() << "Invalid session data";
+    throw std::runtime_error("Invalid arguments");
+  }
+
+  if (db->getSessions().count(sessionInfo.hash()) > 0) {
+    logError() << "Session hash collision detected. Remove old session " << sessionInfo.hash();
+    removeSession(db, sessionInfo.hash());
+  }
+
+  SegmentLogDatabase::Session session;
+  session.device = rq.args.at(Defaults::Arg::DeviceHash);
+  session.data.set_id(db->nextSessionId());
+  session.data.set_hash(sessionInfo.hash());
+  session.data.set_name(sessionInfo.name());
+  session.data.set_started(static_cast<uint64_t>(time(NULL)));
+  session.data.set_ended(0);
+
+  // The log keeps the session info so it can be replayed without metadata
+  const SegmentRecord record{.size = 0,
+                             .session = static_cast<uint32_t>(session.data.id()),
+                             .what = GSegmentSessionRecord,
+                             .reserved = 0,
+                             .systemTime = session.data.started(),
+                             .monotonicTime = 0,
+                             .receiveTime = session.data.started()};
+  if (!db->getWriter().append(record, sessionInfo.SerializeAsString())) {
+    logError() << "Failed to log session info";
+  }
+
+  db->getSessions()[sessionInfo.hash()] = session;
+  if (!db->saveMeta()) {
+    logError() << "Failed to add session";
+  }
+
+  return true;
+}
+
+static bool doRemSession(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq)
+{
+  Dispatcher::Request mrq{.client = rq.client,
+                          .action = Dispatcher::Action::SendStatus,
+                          .args = std::map<Defaults::Arg, std::string>(),
+                          .bulkData = std::make_any<int>(0)};
+  bool status = true;
+
+  if (rq.args.count(Defaults::Arg::RequestId)) {
+    mrq.args.emplace(Defaults::Arg::RequestId, rq.args.at(Defaults::Arg::RequestId));
+  }
+
+  logDebug() << "Handling DB RemSession request from client: " << rq.client->getName();
+  const auto &sessionData = std::any_cast<tkm::msg::control::SessionData>(rq.bulkData);
+
+  if (db->getSessions().count(sessionData.hash()) == 0) {
+    status = false;
+    mrq.args.emplace(Defaults::Arg::Reason, "No such session");
+  } else if (CollectorApp()->getRetention() != nullptr) {
+    // Removed by the retention job
+    CollectorApp()->getRetention()->schedule(sessionData.hash());
+    mrq.args.emplace(Defaults::Arg::Reason, "Session removal scheduled");
+  } else {
+    removeSession(db, sessionData.hash());
+    mrq.args.emplace(Defaults::Arg::Reason, "Session removed");
+  }
+
+  mrq.args.emplace(Defaults::Arg::Status,
+                   status == true ? tkmDefaults.valFor(Defaults::Val::StatusOkay)
+                                  : tkmDefaults.valFor(Defaults::Val::StatusError));
+  return CollectorApp()->getDispatcher()->pushRequest(mrq);
+}
+
+static bool doEndSession(const std::shared_ptr<SegmentLogDatabase> db,
+                         const IDatabase::Request &rq)
+{
+  logDebug() << "Handling DB EndSession request";
+  if ((rq.args.count(Defaults::Arg::SessionHash) == 0)) {
+    logError() << "Invalid session data";
+    throw std::runtime_error("Invalid arguments");
+  }
+
+  auto it = db->getSessions().find(rq.args.at(Defaults::Arg::SessionHash));
+  if (it == db->getSessions().end()) {
+    logError() << "End of unknown session";
+    return true;
+  }
+
+  it->second.data.set_ended(static_cast<uint64_t>(time(NULL)));
+  if (!db->saveMeta()) {
+    logError() << "Failed to mark end session";
+  }
+
+  return true;
+}
+
+static bool doAddData(const std::shared_ptr<SegmentLogDatabase> db, const IDatabase::Request &rq)
+{
+  const auto &data = std::any_cast<const tkm::msg::monitor::Data &>(rq.bulkData);
+  const auto writeStart = getMonotonicTimeNs();
+
+  if ((rq.args.count(Defaults::Arg::SessionHash) == 0)) {
+    logError() << "Invalid session data";
+    throw std::runtime_error("Invalid arguments");
+  }
+
+  auto it = db->getSessions().find(rq.args.at(Defaults::Arg::SessionHash));
+  if (it == db->getSessions().end()) {
+    logError() << "Data for unknown session";
+    return true;
+  }
+
+  // The payload is stored as received, no decoding on the ingest path
+  const SegmentRecord record{.size = 0,
+                             .session = static_cast<uint32_t>(it->second.data.id()),
+                             .what = static_cast<int32_t>(data.what()),
+                             .reserved = 0,
+                             .systemTime = data.system_time_sec(),
+                             .monotonicTime = data.monotonic_time_sec(),
+                             .receiveTime = data.receive_time_sec()};
+  const auto status = db->getWriter().append(record, data.payload().value());
+  if (!status) {
+    logError() << "Failed to append sample to segment log";
+  }
+
+  const auto commitTime = getMonotonicTimeNs();
+
+  // Sample latency from collector receive to segment write
+  if (status && (rq.args.count(Defaults::Arg::ReceiveTime) > 0)) {
+    db->getLatency().record(data.what(),
+                            std::stoull(rq.args.at(Defaults::Arg::ReceiveTime)),
+                            writeStart,
+                            commitTime);
+  }
+
+  // Account write cost to the source device, one record per sample
+  if (rq.args.count(Defaults::Arg::DeviceHash) > 0) {
+    auto device =
+        CollectorApp()->getDeviceManager()->getDevice(rq.args.at(Defaults::Arg::DeviceHash));
+    if (device != nullptr) {
+      auto &stats = device->getStats();
+
+      if (rq.args.count(Defaults::Arg::EnqueueTime) > 0) {
+        stats.queueTime += writeStart - std::stoull(rq.args.at(Defaults::Arg::EnqueueTime));
+      }
+      stats.dbTime += commitTime - writeStart;
+      stats.dbRows += status ? 1 : 0;
+    }
+  }
+
+  return true;
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,87 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SegmentLogDatabase Class
+ * @details   Append only segment log database implementation
+ *-
+ */
+
+#pragma once
+
+#include "IDatabase.h"
+#include "Logger.h"
+#include "Options.h"
+#include "SegmentLog.h"
+
+#include <any>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "../bswinfra/source/Timer.h"
+
+using namespace bswi::log;
+using namespace bswi::event;
+
+namespace tkm::collector
+{
+
+// Samples are appended to the segment log without decoding, there is no SQL
+// layer. Devices and sessions are kept in memory and saved to the sidecar
+// file in the log directory on every change. Sessions are exported with the
+// raw sample payload and can be replayed into a SQL database with tkmsim.
+// Aggregate requests and policy based retention need SQL and are not
+// supported, removed sessions release the segments holding only them.
+class SegmentLogDatabase : public IDatabase,
+                           public std::enable_shared_from_this<SegmentLogDatabase>
+{
+public:
+  typedef struct Session {
+    tkm::msg::control::SessionData data;
+    std::string device;
+  } Session;
+
+public:
+  explicit SegmentLogDatabase(std::shared_ptr<Options> options);
+  SegmentLogDatabase(SegmentLogDatabase const &) = delete;
+  void operator=(SegmentLogDatabase const &) = delete;
+
+  void enableEvents() final;
+  auto getShared() -> std::shared_ptr<SegmentLogDatabase> { return shared_from_this(); }
+  bool requestHandler(const IDatabase::Request &request) final;
+
+  auto getWriter() -> SegmentWriter & { return *m_writer; }
+  auto getDirectory() -> const std::filesystem::path & { return m_directory; }
+  // Keyed by hash
+  auto getDevices() -> std::map<std::string, tkm::msg::control::DeviceData> & { return m_devices; }
+  auto getSessions() -> std::map<std::string, Session> & { return m_sessions; }
+  auto nextDeviceId() -> int64_t { return ++m_lastDeviceId; }
+  auto nextSessionId() -> int64_t { return ++m_lastSessionId; }
+
+  bool saveMeta();
+  // Drop all segments and metadata
+  void reset();
+  // Delete the closed segments not holding records of a known session
+  void pruneSegments();
+
+public:
+  ~SegmentLogDatabase();
+
+private:
+  void loadMeta();
+
+private:
+  std::filesystem::path m_directory{};
+  std::unique_ptr<SegmentWriter> m_writer = nullptr;
+  std::shared_ptr<Timer> m_syncTimer = nullptr;
+  std::map<std::string, tkm::msg::control::DeviceData> m_devices{};
+  std::map<std::string, Session> m_sessions{};
+  int64_t m_lastDeviceId = 0;
+  int64_t m_lastSessionId = 0;
+};
+
+} // namespace tkm::collector
@@ -0,0 +1,221 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SelfMonitor Class
+ * @details   Collector resource usage pseudo-device
+ *-
+ */
+
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#include "Application.h"
+#include "Defaults.h"
+#include "Helpers.h"
+#include "IDatabase.h"
+#include "SelfMonitor.h"
+
+#include <taskmonitor/Helpers.h>
+
+namespace tkm::collector
+{
+
+SelfMonitor::SelfMonitor(uint64_t interval)
+: m_interval(interval)
+{
+  const std::string sessionId =
+      "Self." + std::to_string(getpid()) + "." + std::to_string(time(NULL));
+
+  m_sessionInfo.set_hash(std::to_string(jnkHsh(sessionId.c_str())));
+  m_sessionInfo.set_name("Collector." + std::to_string(getpid()) + "." +
+                         std::to_string(time(NULL)));
+  m_sessionInfo.set_core_count(static_cast<uint32_t>(sysconf(_SC_NPROCESSORS_ONLN)));
+  m_sessionInfo.set_fast_lane_interval(m_interval);
+  m_sessionInfo.set_pace_lane_interval(m_interval);
+  m_sessionInfo.set_slow_lane_interval(m_interval);
+}
+
+void SelfMonitor::enableEvents()
+{
+  tkm::msg::control::DeviceData deviceData;
+
+  deviceData.set_hash(GSelfDeviceHash);
+  deviceData.set_name("tkmcollector");
+  deviceData.set_address("localhost");
+  deviceData.set_port(0);
+
+  // Register the pseudo-device, existing entries are kept and loaded at startup
+  IDatabase::Request devrq{.client = nullptr,
+                           .action = IDatabase::Action::AddDevice,
+                           .args = std::map<Defaults::Arg, std::string>(),
+                           .bulkData = std::make_any<tkm::msg::control::DeviceData>(deviceData)};
+  CollectorApp()->getDatabase()->pushRequest(devrq);
+
+  IDatabase::Request sesrq{.client = nullptr,
+                           .action = IDatabase::Action::AddSession,
+                           .args = std::map<Defaults::Arg, std::string>(),
+                           .bulkData = m_sessionInfo};
+  sesrq.args.emplace(Defaults::Arg::DeviceHash, GSelfDeviceHash);
+  CollectorApp()->getDatabase()->pushRequest(sesrq);
+
+  m_timer = std::make_shared<Timer>("SelfMonitorTimer", [this]() { return update(); });
+  m_timer->start(m_interval, true);
+  CollectorApp()->addEventSource(m_timer);
+
+  logInfo() << "Self monitor enabled with session " << m_sessionInfo.hash();
+}
+
+bool SelfMonitor::update(void)
+{
+  auto device = CollectorApp()->getDeviceManager()->getDevice(GSelfDeviceHash);
+
+  // The device entry is created by the database once registered
+  if (device == nullptr) {
+    return true;
+  }
+
+  if (!m_attached) {
+    device->getSessionInfo().CopyFrom(m_sessionInfo);
+    device->getSessionData().set_hash(m_sessionInfo.hash());
+    device->getDeviceData().set_state(tkm::msg::control::DeviceData_State_Collecting);
+    m_attached = true;
+  }
+
+  struct timespec monotonicTime {
+  };
+  clock_gettime(CLOCK_MONOTONIC, &monotonicTime);
+
+  const auto pushData = [&device, &monotonicTime](tkm::msg::monitor::Data_What what,
+                                                   const google::protobuf::Message &payload) {
+    tkm::msg::monitor::Data data;
+
+    data.set_what(what);
+    data.set_system_time_sec(static_cast<uint64_t>(time(NULL)));
+    data.set_monotonic_time_sec(static_cast<uint64_t>(monotonicTime.tv_sec));
+    data.set_receive_time_sec(static_cast<uint64_t>(time(NULL)));
+    data.mutable_payload()->PackFrom(payload);
+
+    IDevice::Request rq{.client = nullptr,
+                        .action = IDevice::Action::ProcessData,
+                        .args = std::map<Defaults::Arg, std::string>(),
+                        .bulkData = std::make_any<tkm::msg::monitor::Data>(data)};
+    rq.args.emplace(Defaults::Arg::ReceiveTime, std::to_string(getMonotonicTimeNs()));
+    rq.args.emplace(Defaults::Arg::EnqueueTime, std::to_string(getMonotonicTimeNs()));
+    device->pushRequest(rq);
+  };
+
+  tkm::msg::monitor::ProcInfo procInfo;
+  sampleProcess(procInfo);
+  pushData(tkm::msg::monitor::Data_What_ProcInfo, procInfo);
+
+  tkm::msg::monitor::ContextInfo ctxInfo;
+  sampleQueues(ctxInfo);
+  pushData(tkm::msg::monitor::Data_What_ContextInfo, ctxInfo);
+
+  return true;
+}
+
+void SelfMonitor::sampleProcess(tkm::msg::monitor::ProcInfo &procInfo)
+{
+  static const auto clockTicks = static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+  static const auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  auto entry = procInfo.add_entry();
+  uint64_t cpuTicks = 0;
+  uint64_t memRSS = 0;
+  uint64_t memPSS = 0;
+  uint64_t fdCount = 0;
+
+  // Fields after the command name start with state (3), utime is 14 and stime is 15
+  std::ifstream statFile("/proc/self/stat");
+  std::string line;
+  if (std::getline(statFile, line)) {
+    const auto pos = line.rfind(')');
+    if (pos != std::string::npos) {
+      std::istringstream stat(line.substr(pos + 1));
+      std::vector<std::string> fields{std::istream_iterator<std::string>(stat), {}};
+
+      if (fields.size() > 12) {
+        cpuTicks = std::stoull(fields.at(11)) + std::stoull(fields.at(12));
+      }
+    }
+  }
+
+  std::ifstream statmFile("/proc/self/statm");
+  uint64_t memVirt = 0;
+  if (statmFile >> memVirt >> memRSS) {
+    memRSS = memRSS * pageSize / 1024;
+  }
+
+  std::ifstream smapsFile("/proc/self/smaps_rollup");
+  while (std::getline(smapsFile, line)) {
+    if (line.rfind("Pss:", 0) == 0) {
+      std::istringstream pss(line.substr(4));
+      pss >> memPSS;
+      break;
+    }
+  }
+
+  std::error_code ec;
+  for (auto it = std::filesystem::directory_iterator("/proc/self/fd", ec);
+       !ec && it != std::filesystem::directory_iterator();
+       it.increment(ec)) {
+    fdCount++;
+  }
+
+  const auto timeNow = getMonotonicTime();
+  uint64_t cpuPercent = 0;
+  if ((m_lastSampleTime > 0) && (timeNow > m_lastSampleTime) && (clockTicks > 0)) {
+    const auto cpuUsec = (cpuTicks - m_lastCpuTicks) * 1000000 / clockTicks;
+    cpuPercent = cpuUsec * 100 / (timeNow - m_lastSampleTime);
+  }
+  m_lastCpuTicks = cpuTicks;
+  m_lastSampleTime = timeNow;
+
+  entry->set_comm("tkmcollector");
+  entry->set_pid(static_cast<uint32_t>(getpid()));
+  entry->set_ppid(static_cast<uint32_t>(getppid()));
+  entry->set_ctx_id(0);
+  entry->set_ctx_name("collector");
+  entry->set_cpu_time((clockTicks > 0) ? cpuTicks / clockTicks : 0);
+  entry->set_cpu_percent(static_cast<uint32_t>(cpuPercent));
+  entry->set_mem_rss(memRSS);
+  entry->set_mem_pss(memPSS);
+  entry->set_fd_count(static_cast<uint32_t>(fdCount));
+}
+
+void SelfMonitor::sampleQueues(tkm::msg::monitor::ContextInfo &ctxInfo)
+{
+  uint64_t devicePending = 0;
+
+  CollectorApp()->getDeviceManager()->foreachDevice(
+      [&devicePending](const std::shared_ptr<MonitorDevice> &device) {
+        devicePending += device->getPendingCount();
+      });
+
+  // ContextInfo has no queue field, the context name tells TotalFDCount is a depth
+  const auto addQueue = [&ctxInfo](uint64_t id, const std::string &name, uint64_t pending) {
+    auto entry = ctxInfo.add_entry();
+
+    entry->set_ctx_id(id);
+    entry->set_ctx_name("QueueDepth." + name);
+    entry->set_total_cpu_time(0);
+    entry->set_total_cpu_percent(0);
+    entry->set_total_mem_rss(0);
+    entry->set_total_mem_pss(0);
+    entry->set_total_fd_count(static_cast<uint32_t>(pending));
+  };
+
+  addQueue(0, "Dispatcher", CollectorApp()->getDispatcher()->getPendingCount());
+  addQueue(1, "Database", CollectorApp()->getDatabase()->getPendingCount());
+  addQueue(2, "Device", devicePending);
+}
+
+} // namespace tkm::collector
@@ -0,0 +1,58 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     SelfMonitor Class
+ * @details   Collector resource usage pseudo-device
+ *-
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <taskmonitor/taskmonitor.h>
+
+#include "../bswinfra/source/Timer.h"
+
+using namespace bswi::event;
+
+namespace tkm::collector
+{
+
+// Reserved hash of the collector self monitoring device
+constexpr const char *GSelfDeviceHash = "tkmcollector.self";
+
+// Samples written into the self device session:
+//   ProcInfo    : one entry for the collector process (cpu, rss, pss, fd count)
+//   ContextInfo : one QueueDepth.<Queue> pseudo-context per internal queue, the
+//                 queue depth is stored in total_fd_count and the other fields are 0
+class SelfMonitor : public std::enable_shared_from_this<SelfMonitor>
+{
+public:
+  explicit SelfMonitor(uint64_t interval);
+  ~SelfMonitor() = default;
+
+  void enableEvents();
+
+public:
+  SelfMonitor(SelfMonitor const &) = delete;
+  void operator=(SelfMonitor const &) = delete;
+
+private:
+  bool update(void);
+  void sampleProcess(tkm::msg::monitor::ProcInfo &procInfo);
+  void sampleQueues(tkm::msg::monitor::ContextInfo &ctxInfo);
+
+private:
+  std::shared_ptr<Timer> m_timer = nullptr;
+  tkm::msg::monitor::SessionInfo m_sessionInfo{};
+  uint64_t m_interval = 0;
+  uint64_t m_lastCpuTicks = 0;
+  uint64_t m_lastSampleTime = 0;
+  bool m_attached = false;
+};
+
+} // namespace tkm::collector
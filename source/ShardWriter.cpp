@@ -0,0 +1,128 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ShardWriter Class
+ * @details   Writer thread for a session data file
+ *-
+ */
+
+#include "ShardWriter.h"
+
+#include <Helpers.h>
+#include <iterator>
+
+namespace tkm::collector
+{
+
+static auto execWrite(sqlite3 *handle, const std::string &sql, std::string &error) -> bool
+{
+  char *queryError = nullptr;
+
+  if (::sqlite3_exec(handle, sql.c_str(), nullptr, nullptr, &queryError) != SQLITE_OK) {
+    error = (queryError != nullptr) ? queryError : sqlite3_errmsg(handle);
+    sqlite3_free(queryError);
+    return false;
+  }
+
+  return true;
+}
+
+ShardWriter::ShardWriter(sqlite3 *handle)
+: m_handle(handle)
+{
+  m_thread = std::thread(&ShardWriter::writer, this);
+}
+
+ShardWriter::~ShardWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_stop = true;
+  }
+  m_wake.notify_one();
+  m_thread.join();
+  sqlite3_close(m_handle);
+}
+
+void ShardWriter::write(Sample &&sample)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_pending.push_back(std::move(sample));
+  }
+  m_wake.notify_one();
+}
+
+bool ShardWriter::run(const std::function<bool(sqlite3 *)> &fn)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // The writer does not take new samples while the lock is held
+  m_idle.wait(lock, [this]() { return m_pending.empty() && !m_busy; });
+  return fn(m_handle);
+}
+
+auto ShardWriter::takeWritten() -> std::vector<Sample>
+{
+  std::vector<Sample> written{};
+  std::lock_guard<std::mutex> lock(m_lock);
+
+  written.swap(m_written);
+  return written;
+}
+
+void ShardWriter::writer()
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+
+  // Queued samples are written before the thread stops
+  while (!m_stop || !m_pending.empty()) {
+    m_wake.wait(lock, [this]() { return m_stop || !m_pending.empty(); });
+    if (m_pending.empty()) {
+      continue;
+    }
+
+    std::vector<Sample> batch{};
+    batch.swap(m_pending);
+    m_busy = true;
+    lock.unlock();
+
+    std::string error{};
+    if (!execWrite(m_handle, "BEGIN TRANSACTION;", error)) {
+      for (auto &sample : batch) {
+        sample.status = false;
+        sample.error = error;
+      }
+    } else {
+      for (auto &sample : batch) {
+        sample.status = execWrite(m_handle, sample.sql, sample.error);
+      }
+      if (!execWrite(m_handle, "COMMIT;", error)) {
+        std::string rollbackError{};
+        execWrite(m_handle, "ROLLBACK;", rollbackError);
+        for (auto &sample : batch) {
+          sample.status = false;
+          sample.error = error;
+        }
+      }
+    }
+
+    const auto commitTime = getMonotonicTimeNs();
+    for (auto &sample : batch) {
+      sample.commitTime = commitTime;
+      sample.sql.clear();
+    }
+
+    lock.lock();
+    m_written.insert(m_written.end(),
+                     std::make_move_iterator(batch.begin()),
+                     std::make_move_iterator(batch.end()));
+    m_busy = false;
+    m_idle.notify_all();
+  }
+}
+
+} // namespace tkm::collector
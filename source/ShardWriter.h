@@ -0,0 +1,79 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     ShardWriter Class
+ * @details   Writer thread for a session data file
+ *-
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sqlite3.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Defaults.h"
+#include <taskmonitor/taskmonitor.h>
+
+namespace tkm::collector
+{
+
+// Each session file has its own connection and thread so the samples of
+// different sessions are written in parallel. Queued samples are committed in
+// one transaction per wake up. The connection is only used by the main thread
+// through run() which waits for the queued samples to be written first.
+class ShardWriter
+{
+public:
+  // Sample inserts and the request arguments used for its accounting.
+  // The writer fills in the commit time and the result.
+  typedef struct Sample {
+    tkm::msg::monitor::Data_What what;
+    std::map<Defaults::Arg, std::string> args;
+    std::string sql;
+    uint64_t writeStart = 0;
+    uint64_t commitTime = 0;
+    uint64_t rows = 0;
+    bool status = true;
+    std::string error{};
+  } Sample;
+
+public:
+  explicit ShardWriter(sqlite3 *handle);
+  ~ShardWriter();
+
+  void write(Sample &&sample);
+  // Run on the connection once the queued samples are written
+  bool run(const std::function<bool(sqlite3 *)> &fn);
+  // Samples written since the last call
+  auto takeWritten() -> std::vector<Sample>;
+
+public:
+  ShardWriter(ShardWriter const &) = delete;
+  void operator=(ShardWriter const &) = delete;
+
+private:
+  void writer();
+
+private:
+  sqlite3 *m_handle = nullptr;
+  std::mutex m_lock{};
+  std::condition_variable m_wake{};
+  std::condition_variable m_idle{};
+  std::vector<Sample> m_pending{};
+  std::vector<Sample> m_written{};
+  bool m_busy = false;
+  bool m_stop = false;
+  std::thread m_thread{};
+};
+
+} // namespace tkm::collector
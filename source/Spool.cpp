@@ -0,0 +1,233 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Spool Class
+ * @details   Local sample spool used while the database is unavailable
+ *-
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Application.h"
+#include "IDatabase.h"
+#include "Spool.h"
+
+// Reject corrupted records instead of allocating huge buffers
+constexpr uint32_t GSpoolMaxRecordSize = 64 * 1024 * 1024;
+// Log one warning per this many dropped samples
+constexpr uint64_t GSpoolDropLogRate = 1000;
+
+namespace tkm::collector
+{
+
+Spool::Spool(const std::filesystem::path &path, uint64_t maxSize, uint64_t interval)
+: m_path(path)
+, m_maxSize(maxSize)
+, m_interval(interval)
+{
+  std::error_code ec;
+
+  if (m_path.has_parent_path()) {
+    std::filesystem::create_directories(m_path.parent_path(), ec);
+  }
+
+  // Continue the replay of a spool left by a previous run
+  if (std::filesystem::exists(m_path, ec)) {
+    char magic[GSpoolMagicSize]{};
+    uint64_t readOffset = 0;
+
+    m_stream.open(m_path, std::ios::binary | std::ios::in | std::ios::out);
+    m_stream.read(magic, GSpoolMagicSize);
+    m_stream.read(reinterpret_cast<char *>(&readOffset), sizeof(readOffset));
+    m_writeOffset = std::filesystem::file_size(m_path, ec);
+
+    if (m_stream.good() && (memcmp(magic, GSpoolMagic, GSpoolMagicSize) == 0) &&
+        (readOffset >= GSpoolHeaderSize) && (readOffset <= m_writeOffset)) {
+      m_readOffset = readOffset;
+      if (!isEmpty()) {
+        logInfo() << "Spool " << m_path.string() << " holds " << getSize()
+                  << " bytes to replay";
+      }
+      return;
+    }
+    logWarn() << "Invalid spool file " << m_path.string() << ", starting a new one";
+  }
+
+  if (!reset()) {
+    throw std::runtime_error("Fail to open spool file " + m_path.string());
+  }
+}
+
+void Spool::enableEvents()
+{
+  m_timer = std::make_shared<Timer>("SpoolTimer", [this]() { return update(); });
+  m_timer->start(m_interval, true);
+  CollectorApp()->addEventSource(m_timer);
+}
+
+bool Spool::update(void)
+{
+  auto database = CollectorApp()->getDatabase();
+
+  if (m_inFlight || isEmpty() || (database == nullptr)) {
+    return true;
+  }
+
+  // The database handler reconnects if needed and replays the first batch
+  IDatabase::Request rq{.client = nullptr,
+                        .action = IDatabase::Action::CheckDatabase,
+                        .args = std::map<Defaults::Arg, std::string>(),
+                        .bulkData = std::make_any<int>(0)};
+  m_inFlight = true;
+  if (!database->pushRequest(rq)) {
+    m_inFlight = false;
+  }
+
+  return true;
+}
+
+bool Spool::reset(void)
+{
+  const uint64_t readOffset = GSpoolHeaderSize;
+
+  if (m_stream.is_open()) {
+    m_stream.close();
+  }
+  m_stream.open(m_path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+  if (!m_stream.is_open()) {
+    return false;
+  }
+
+  m_stream.write(GSpoolMagic, GSpoolMagicSize);
+  m_stream.write(reinterpret_cast<const char *>(&readOffset), sizeof(readOffset));
+  m_stream.flush();
+
+  m_readOffset = GSpoolHeaderSize;
+  m_writeOffset = GSpoolHeaderSize;
+  m_readEnds.clear();
+
+  return m_stream.good();
+}
+
+bool Spool::append(const std::string &sessionHash, const tkm::msg::monitor::Data &data)
+{
+  m_buffer.clear();
+  if (!data.SerializeToString(&m_buffer)) {
+    return false;
+  }
+
+  const auto hashSize = static_cast<uint32_t>(sessionHash.size());
+  const auto dataSize = static_cast<uint32_t>(m_buffer.size());
+  const uint64_t recordSize = sizeof(hashSize) + sizeof(dataSize) + hashSize + dataSize;
+
+  if (m_writeOffset + recordSize > m_maxSize) {
+    if ((m_dropped++ % GSpoolDropLogRate) == 0) {
+      logWarn() << "Spool full, " << m_dropped << " samples dropped";
+    }
+    return false;
+  }
+
+  if (isEmpty()) {
+    logWarn() << "Database unavailable, spooling samples to " << m_path.string();
+  }
+
+  m_stream.clear();
+  m_stream.seekp(static_cast<std::streamoff>(m_writeOffset));
+  m_stream.write(reinterpret_cast<const char *>(&hashSize), sizeof(hashSize));
+  m_stream.write(reinterpret_cast<const char *>(&dataSize), sizeof(dataSize));
+  m_stream.write(sessionHash.data(), static_cast<std::streamsize>(hashSize));
+  m_stream.write(m_buffer.data(), static_cast<std::streamsize>(dataSize));
+  m_stream.flush();
+
+  if (!m_stream.good()) {
+    logError() << "Fail to write spool file " << m_path.string();
+    return false;
+  }
+  m_writeOffset += recordSize;
+
+  return true;
+}
+
+bool Spool::read(size_t count, std::vector<Record> &records)
+{
+  uint64_t offset = m_readOffset;
+
+  records.clear();
+  m_readEnds.clear();
+
+  m_stream.clear();
+  m_stream.seekg(static_cast<std::streamoff>(offset));
+
+  while ((records.size() < count) && (offset < m_writeOffset)) {
+    uint32_t hashSize = 0;
+    uint32_t dataSize = 0;
+    Record record{};
+
+    m_stream.read(reinterpret_cast<char *>(&hashSize), sizeof(hashSize));
+    m_stream.read(reinterpret_cast<char *>(&dataSize), sizeof(dataSize));
+
+    const uint64_t recordSize = sizeof(hashSize) + sizeof(dataSize) + hashSize + dataSize;
+    if (!m_stream.good() || (dataSize > GSpoolMaxRecordSize) ||
+        (offset + recordSize > m_writeOffset)) {
+      // A record cut by a crash, the tail is not replayable
+      logError() << "Corrupted spool record at offset " << offset << ", dropping spool tail";
+      m_writeOffset = offset;
+      break;
+    }
+
+    record.sessionHash.resize(hashSize);
+    m_buffer.resize(dataSize);
+    m_stream.read(record.sessionHash.data(), static_cast<std::streamsize>(hashSize));
+    m_stream.read(m_buffer.data(), static_cast<std::streamsize>(dataSize));
+    if (!m_stream.good()) {
+      logError() << "Fail to read spool file " << m_path.string();
+      return false;
+    }
+
+    offset += recordSize;
+    if (!record.data.ParseFromString(m_buffer)) {
+      logError() << "Invalid spool record at offset " << offset << ", skipped";
+      continue;
+    }
+
+    records.push_back(std::move(record));
+    m_readEnds.push_back(offset);
+  }
+
+  // Only invalid records were read, consume them
+  if (records.empty() && (offset > m_readOffset)) {
+    m_readEnds.push_back(offset);
+    return commit(1);
+  }
+
+  return true;
+}
+
+bool Spool::commit(size_t count)
+{
+  if ((count == 0) || m_readEnds.empty()) {
+    return true;
+  }
+
+  m_readOffset = m_readEnds.at(std::min(count, m_readEnds.size()) - 1);
+  m_readEnds.clear();
+
+  if (isEmpty()) {
+    logInfo() << "Spool replay complete";
+    return reset();
+  }
+
+  m_stream.clear();
+  m_stream.seekp(static_cast<std::streamoff>(GSpoolMagicSize));
+  m_stream.write(reinterpret_cast<const char *>(&m_readOffset), sizeof(m_readOffset));
+  m_stream.flush();
+
+  return m_stream.good();
+}
+
+} // namespace tkm::collector
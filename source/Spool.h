@@ -0,0 +1,93 @@
+/*-
+ * SPDX-License-Identifier: MIT
+ *-
+ * @date      2021-2022
+ * @author    Alin Popa <alin.popa@fxdata.ro>
+ * @copyright MIT
+ * @brief     Spool Class
+ * @details   Local sample spool used while the database is unavailable
+ *-
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <taskmonitor/taskmonitor.h>
+
+#include "../bswinfra/source/Timer.h"
+
+using namespace bswi::event;
+
+namespace tkm::collector
+{
+
+// Spool file layout (host byte order):
+//   header: 8 bytes magic "TKMSPL01", uint64_t replay offset
+//   record: uint32_t hash size, uint32_t data size, session hash, serialized
+//           tkm.msg.monitor.Data
+constexpr const char *GSpoolMagic = "TKMSPL01";
+constexpr size_t GSpoolMagicSize = 8;
+constexpr uint64_t GSpoolHeaderSize = GSpoolMagicSize + sizeof(uint64_t);
+
+// Samples the database could not take are appended in arrival order and
+// replayed from the oldest one. The replay offset is saved in the header
+// after every replayed batch so a restart continues where it stopped, and
+// the file is truncated once it is fully replayed. Every Interval
+// microseconds a CheckDatabase request is queued while the spool holds
+// samples, the database handler reconnects if needed and replays a batch.
+class Spool
+{
+public:
+  typedef struct Record {
+    std::string sessionHash;
+    tkm::msg::monitor::Data data;
+  } Record;
+
+public:
+  Spool(const std::filesystem::path &path, uint64_t maxSize, uint64_t interval);
+  ~Spool() = default;
+
+  void enableEvents();
+
+  // Samples are refused once the file would grow past maxSize
+  bool append(const std::string &sessionHash, const tkm::msg::monitor::Data &data);
+  // Read up to count records from the replay offset, nothing is consumed
+  bool read(size_t count, std::vector<Record> &records);
+  // Consume the first count records returned by the last read
+  bool commit(size_t count);
+  void setReplaying(bool state) { m_inFlight = state; }
+
+  [[nodiscard]] bool isEmpty() const { return m_readOffset >= m_writeOffset; }
+  [[nodiscard]] auto getSize() const -> uint64_t { return m_writeOffset - m_readOffset; }
+  [[nodiscard]] auto getDropped() const -> uint64_t { return m_dropped; }
+
+public:
+  Spool(Spool const &) = delete;
+  void operator=(Spool const &) = delete;
+
+private:
+  bool update(void);
+  bool reset(void);
+
+private:
+  std::shared_ptr<Timer> m_timer = nullptr;
+  std::filesystem::path m_path{};
+  std::fstream m_stream;
+  std::string m_buffer{};
+  std::vector<uint64_t> m_readEnds{};
+  uint64_t m_maxSize = 0;
+  uint64_t m_interval = 0;
+  uint64_t m_readOffset = GSpoolHeaderSize;
+  uint64_t m_writeOffset = GSpoolHeaderSize;
+  uint64_t m_dropped = 0;
+  std::atomic<bool> m_inFlight{false};
+};
+
+} // namespace tkm::collector